@@ -34,6 +34,7 @@
 #include <util/sll/unreachable.h>
 #include "interfaces/azoth/iaccount.h"
 #include "avatarsstorage.h"
+#include "scaledavatarscache.h"
 #include "resourcesmanager.h"
 #include "xmlsettingsmanager.h"
 
@@ -44,10 +45,20 @@ namespace Azoth
 	AvatarsManager::AvatarsManager (QObject *parent)
 	: QObject { parent }
 	, Storage_ { new AvatarsStorage { this } }
+	, ScaledCache_ { new ScaledAvatarsCache { this, this } }
 	{
 		handleCacheSizeChanged ();
 		XmlSettingsManager::Instance ().RegisterObject ("AvatarsCacheSize",
 				this, "handleCacheSizeChanged");
+
+		handleScaledCacheSizeChanged ();
+		XmlSettingsManager::Instance ().RegisterObject ("ScaledAvatarsCacheSize",
+				this, "handleScaledCacheSizeChanged");
+
+		connect (ScaledCache_,
+				SIGNAL (avatarScaled (QObject*)),
+				this,
+				SIGNAL (scaledAvatarReady (QObject*)));
 	}
 
 	namespace
@@ -144,6 +155,16 @@ namespace Azoth
 				false;
 	}
 
+	boost::optional<QImage> AvatarsManager::GetScaledAvatar (QObject *entryObj, int dim)
+	{
+		return ScaledCache_->Get (entryObj, dim);
+	}
+
+	void AvatarsManager::ForgetScaledAvatars (QObject *entryObj)
+	{
+		ScaledCache_->Forget (entryObj);
+	}
+
 	Util::DefaultScopeGuard AvatarsManager::Subscribe (QObject *obj,
 			IHaveAvatars::Size size, const AvatarHandler_f& handler)
 	{
@@ -221,6 +242,7 @@ namespace Azoth
 		}
 
 		Storage_->DeleteAvatars (entry->GetEntryID ());
+		ScaledCache_->Forget (that);
 
 		emit avatarInvalidated (that);
 
@@ -232,5 +254,11 @@ namespace Azoth
 		Storage_->SetCacheSize (XmlSettingsManager::Instance ()
 				.property ("AvatarsCacheSize").toInt ());
 	}
+
+	void AvatarsManager::handleScaledCacheSizeChanged ()
+	{
+		ScaledCache_->SetCacheSize (XmlSettingsManager::Instance ()
+				.property ("ScaledAvatarsCacheSize").toInt ());
+	}
 }
 }
@@ -30,6 +30,7 @@
 #pragma once
 
 #include <functional>
+#include <boost/optional.hpp>
 #include <QObject>
 #include <QHash>
 #include <util/sll/util.h>
@@ -44,6 +45,7 @@ namespace LeechCraft
 namespace Azoth
 {
 	class AvatarsStorage;
+	class ScaledAvatarsCache;
 
 	class AvatarsManager : public QObject
 						 , public IAvatarsManager
@@ -51,6 +53,7 @@ namespace Azoth
 		Q_OBJECT
 
 		AvatarsStorage * const Storage_;
+		ScaledAvatarsCache * const ScaledCache_;
 
 		QHash<QObject*, QHash<IHaveAvatars::Size, QFuture<QImage>>> PendingRequests_;
 	public:
@@ -66,6 +69,14 @@ namespace Azoth
 
 		bool HasAvatar (QObject*) const;
 
+		/** Returns the thumbnail avatar of the given entry scaled to fit
+		 * into dim×dim, if it is already in the scaled avatars cache.
+		 * Otherwise schedules scaling it and returns nothing,
+		 * scaledAvatarReady() will be emitted when it is done.
+		 */
+		boost::optional<QImage> GetScaledAvatar (QObject*, int dim);
+		void ForgetScaledAvatars (QObject*);
+
 		Util::DefaultScopeGuard Subscribe (QObject*, IHaveAvatars::Size, const AvatarHandler_f&);
 	private:
 		void HandleSubscriptions (QObject*);
@@ -76,8 +87,10 @@ namespace Azoth
 		void invalidateAvatar (QObject*);
 
 		void handleCacheSizeChanged ();
+		void handleScaledCacheSizeChanged ();
 	signals:
 		void avatarInvalidated (QObject*);
+		void scaledAvatarReady (QObject*);
 	};
 }
 }
@@ -76,6 +76,7 @@
 #include "interfaces/azoth/imucperms.h"
 #include "interfaces/azoth/iupdatablechatentry.h"
 #include "interfaces/azoth/iprovidecommands.h"
+#include "interfaces/azoth/ihavemessageretention.h"
 #ifdef ENABLE_CRYPT
 #include "interfaces/azoth/isupportpgp.h"
 #endif
@@ -761,30 +762,57 @@ namespace Azoth
 		me->SetMUCSubject (Ui_.SubjEdit_->toPlainText ());
 	}
 
+	namespace
+	{
+		const int DefaultRenderWindow = 200;
+	}
+
+	QList<IMessage*> ChatTab::CollectMessages () const
+	{
+		auto messages = HistoryMessages_;
+
+		ICLEntry *e = GetEntry<ICLEntry> ();
+		if (!e)
+			return messages;
+
+		auto entryMessages = e->GetAllMessages ();
+
+		const auto& dummyMsgs = DummyMsgManager::Instance ().GetIMessages (e->GetQObject ());
+		if (!dummyMsgs.isEmpty ())
+		{
+			entryMessages += dummyMsgs;
+			std::sort (entryMessages.begin (), entryMessages.end (), Util::ComparingBy (&IMessage::GetDateTime));
+		}
+
+		return messages + entryMessages;
+	}
+
 	void ChatTab::on_View__loadFinished (bool)
 	{
-		for (const auto msg : HistoryMessages_)
-			AppendMessage (msg);
+		qDeleteAll (CoreMessages_);
+		CoreMessages_.clear ();
+		LastDateTime_ = QDateTime ();
+		RenderedMessages_ = 0;
+
+		const auto& messages = CollectMessages ();
 
 		ICLEntry *e = GetEntry<ICLEntry> ();
 		if (!e)
 		{
 			qWarning () << Q_FUNC_INFO
 					<< "null entry";
+			AppendMessages (messages);
 			return;
 		}
 
-		auto messages = e->GetAllMessages ();
+		const int window = ScrollbackPos_ ?
+				messages.size () :
+				DefaultRenderWindow + ExtraRenderedMessages_;
+		HiddenMessages_ = std::max (messages.size () - window, 0);
+		AppendMessages (messages.mid (HiddenMessages_));
+		UpdateOlderMessagesLink ();
 
-		const auto& dummyMsgs = DummyMsgManager::Instance ().GetIMessages (e->GetQObject ());
-		if (!dummyMsgs.isEmpty ())
-		{
-			messages += dummyMsgs;
-			std::sort (messages.begin (), messages.end (), Util::ComparingBy (&IMessage::GetDateTime));
-		}
-
-		for (const auto msg : messages)
-			AppendMessage (msg);
+		const auto frame = Ui_.View_->page ()->mainFrame ();
 
 		QFile scrollerJS (":/plugins/azoth/resources/scripts/scrollers.js");
 		if (!scrollerJS.open (QIODevice::ReadOnly))
@@ -793,10 +821,16 @@ namespace Azoth
 					<< scrollerJS.errorString ();
 		else
 		{
-			Ui_.View_->page ()->mainFrame ()->evaluateJavaScript (scrollerJS.readAll ());
-			Ui_.View_->page ()->mainFrame ()->evaluateJavaScript ("InstallEventListeners(); ScrollToBottom();");
+			frame->evaluateJavaScript (scrollerJS.readAll ());
+			if (PrevDocHeight_ >= 0)
+				frame->evaluateJavaScript (QString ("InstallEventListeners(); ScrollToOffsetFromBottom(%1);")
+						.arg (PrevDocHeight_));
+			else
+				frame->evaluateJavaScript ("InstallEventListeners(); ScrollToBottom();");
 		}
 
+		PrevDocHeight_ = -1;
+
 		emit hookThemeReloaded (Util::DefaultHookProxy_ptr (new Util::DefaultHookProxy),
 				this, Ui_.View_, GetEntry<QObject> ());
 	}
@@ -873,6 +907,7 @@ namespace Azoth
 		CoreMessages_.clear ();
 		DummyMsgManager::Instance ().ClearMessages (GetCLEntry ());
 		LastDateTime_ = QDateTime ();
+		ExtraRenderedMessages_ = 0;
 		PrepareTheme ();
 	}
 
@@ -1225,7 +1260,19 @@ namespace Azoth
 		}
 
 		const auto& host = url.host ();
-		if (host == "msgeditreplace")
+		if (host == "loadolder")
+		{
+			if (HiddenMessages_)
+				RenderOlderMessages ();
+			else
+			{
+				const auto frame = Ui_.View_->page ()->mainFrame ();
+				PrevDocHeight_ = frame->evaluateJavaScript ("document.height").toInt ();
+				if (!RequestOlderLogs ())
+					frame->evaluateJavaScript ("OlderMessagesLoaded();");
+			}
+		}
+		else if (host == "msgeditreplace")
 		{
 			const auto& queryItems = QUrlQuery { url }.queryItems ();
 			if (queryItems.isEmpty ())
@@ -1389,6 +1436,8 @@ namespace Azoth
 
 		if (!messages.isEmpty ())
 			PrepareTheme ();
+		else
+			Ui_.View_->page ()->mainFrame ()->evaluateJavaScript ("OlderMessagesLoaded();");
 
 		disconnect (sender (),
 				SIGNAL (gotLastMessages (QObject*, const QList<QObject*>&)),
@@ -1812,7 +1861,19 @@ namespace Azoth
 				this, "handleMinLinesHeightChanged");
 	}
 
-	void ChatTab::RequestLogs (int num)
+	bool ChatTab::RequestOlderLogs ()
+	{
+		const auto entry = GetEntry<ICLEntry> ();
+		if (!entry)
+			return false;
+
+		ScrollbackPos_ = std::max (ScrollbackPos_, entry->GetAllMessages ().size ()) + DefaultRenderWindow;
+		qDeleteAll (HistoryMessages_);
+		HistoryMessages_.clear ();
+		return RequestLogs (ScrollbackPos_);
+	}
+
+	bool ChatTab::RequestLogs (int num)
 	{
 		ICLEntry *entry = GetEntry<ICLEntry> ();
 		if (!entry)
@@ -1820,13 +1881,14 @@ namespace Azoth
 			qWarning () << Q_FUNC_INFO
 					<< "null entry for"
 					<< EntryID_;
-			return;
+			return false;
 		}
 
 		QObject *entryObj = entry->GetQObject ();
 
 		const auto& histories = Core::Instance ().GetProxy ()->
 				GetPluginsManager ()->GetAllCastableRoots<IHistoryPlugin*> ();
+		bool requested = false;
 		for (const auto histObj : histories)
 		{
 			const auto hist = qobject_cast<IHistoryPlugin*> (histObj);
@@ -1840,7 +1902,10 @@ namespace Azoth
 					Qt::UniqueConnection);
 
 			hist->RequestLastMessages (entryObj, num);
+			requested = true;
 		}
+
+		return requested;
 	}
 
 	namespace
@@ -1851,7 +1916,145 @@ namespace Azoth
 		}
 	}
 
+	struct ChatTab::AppendContext
+	{
+		bool ShowStatusChanges_;
+		bool ShowStatusChangesInPrivates_;
+		bool ShowJoinsLeaves_;
+		bool ShowEndConversations_;
+		bool SeparateMUCEventLog_;
+
+		bool IsActiveChat_;
+		bool UseRichText_;
+	};
+
+	ChatTab::AppendContext ChatTab::MakeAppendContext ()
+	{
+		const auto& xsm = XmlSettingsManager::Instance ();
+		return
+		{
+			xsm.property ("ShowStatusChangesEvents").toBool (),
+			xsm.property ("ShowStatusChangesEventsInPrivates").toBool (),
+			xsm.property ("ShowJoinsLeaves").toBool (),
+			xsm.property ("ShowEndConversations").toBool (),
+			xsm.property ("SeparateMUCEventLogWindow").toBool (),
+			Core::Instance ().GetChatTabsManager ()->IsActiveChat (GetEntry<ICLEntry> ()),
+			ToggleRichText_->isChecked ()
+		};
+	}
+
 	void ChatTab::AppendMessage (IMessage *msg)
+	{
+		AppendMessages ({ msg });
+	}
+
+	void ChatTab::AppendMessages (const QList<IMessage*>& messages)
+	{
+		if (messages.isEmpty ())
+			return;
+
+		if (!RenderedMessages_)
+			OldestRenderedDT_ = messages.first ()->GetDateTime ();
+		RenderedMessages_ += messages.size ();
+
+		const auto& ctx = MakeAppendContext ();
+
+		QList<ChatMsgAppendItem> items;
+		for (const auto msg : messages)
+			PrepareAppend (msg, ctx, items);
+
+		if (!Core::Instance ().AppendMessagesByTemplate (Ui_.View_->page ()->mainFrame (), items))
+			qWarning () << Q_FUNC_INFO
+					<< "unhandled append message :(";
+	}
+
+	void ChatTab::PrependMessages (const QList<IMessage*>& messages, IMessage *next)
+	{
+		if (messages.isEmpty ())
+			return;
+
+		// The older messages shall affect neither the date separators
+		// nor the last link of the already rendered ones.
+		const auto lastDateTime = LastDateTime_;
+		const auto lastLink = LastLink_;
+		LastDateTime_ = QDateTime ();
+
+		const auto& ctx = MakeAppendContext ();
+
+		QList<ChatMsgAppendItem> items;
+		for (const auto msg : messages)
+			PrepareAppend (msg, ctx, items);
+
+		if (next && !LastDateTime_.isNull () && !IsSameDay (LastDateTime_, next))
+			if (const auto parent = qobject_cast<ICLEntry*> (next->ParentCLEntry ()))
+				AppendDaySeparator (next, parent, ctx, items);
+
+		LastDateTime_ = lastDateTime;
+		LastLink_ = lastLink;
+
+		if (!Core::Instance ().PrependMessagesByTemplate (Ui_.View_->page ()->mainFrame (), items))
+			qWarning () << Q_FUNC_INFO
+					<< "unhandled prepend messages :(";
+	}
+
+	void ChatTab::RenderOlderMessages ()
+	{
+		const auto& messages = CollectMessages ();
+		const auto oldestPos = messages.size () - RenderedMessages_;
+		if (oldestPos < 0 || oldestPos >= messages.size () ||
+				messages [oldestPos]->GetDateTime () != OldestRenderedDT_)
+		{
+			// the messages have changed under us, so just rerender the view
+			PrevDocHeight_ = Ui_.View_->page ()->mainFrame ()->evaluateJavaScript ("document.height").toInt ();
+			ExtraRenderedMessages_ += DefaultRenderWindow;
+			PrepareTheme ();
+			return;
+		}
+
+		const auto frame = Ui_.View_->page ()->mainFrame ();
+		const auto prevHeight = frame->evaluateJavaScript ("document.height").toInt ();
+
+		const auto& link = frame->findFirstElement ("#azothLoadOlder");
+		if (!link.isNull ())
+			link.parent ().removeFromDocument ();
+
+		const auto start = std::max (oldestPos - DefaultRenderWindow, 0);
+		ExtraRenderedMessages_ += oldestPos - start;
+		HiddenMessages_ = start;
+
+		PrependMessages (messages.mid (start, oldestPos - start), messages [oldestPos]);
+		RenderedMessages_ += oldestPos - start;
+		OldestRenderedDT_ = messages [start]->GetDateTime ();
+
+		UpdateOlderMessagesLink ();
+
+		frame->evaluateJavaScript (QString ("ScrollToOffsetFromBottom(%1); OlderMessagesLoaded();")
+				.arg (prevHeight));
+	}
+
+	void ChatTab::AppendDaySeparator (IMessage *msg, ICLEntry *parent,
+			const AppendContext& ctx, QList<ChatMsgAppendItem>& items)
+	{
+		auto datetime = msg->GetDateTime ();
+		const auto& thisDate = datetime.date ();
+		const auto& str = QLocale ().toString (thisDate, QLocale::LongFormat);
+
+		datetime.setTime ({0, 0});
+
+		auto coreMessage = new CoreMessage (str, datetime,
+				IMessage::Type::ServiceMessage, IMessage::Direction::In, parent->GetQObject (), this);
+		ChatMsgAppendInfo coreInfo
+		{
+			false,
+			ctx.IsActiveChat_,
+			ctx.UseRichText_,
+			Account_
+		};
+		items.append ({ coreMessage, coreInfo });
+		CoreMessages_ << coreMessage;
+	}
+
+	void ChatTab::PrepareAppend (IMessage *msg, const AppendContext& ctx, QList<ChatMsgAppendItem>& items)
 	{
 		auto other = qobject_cast<ICLEntry*> (msg->OtherPart ());
 
@@ -1867,22 +2070,22 @@ namespace Azoth
 
 		if (msg->GetMessageSubType () == IMessage::SubType::ParticipantStatusChange &&
 				(!parent || parent->GetEntryType () == ICLEntry::EntryType::MUC) &&
-				!XmlSettingsManager::Instance ().property ("ShowStatusChangesEvents").toBool ())
+				!ctx.ShowStatusChanges_)
 			return;
 
 		if (msg->GetMessageSubType () == IMessage::SubType::ParticipantStatusChange &&
 				(!parent || parent->GetEntryType () != ICLEntry::EntryType::MUC) &&
-				!XmlSettingsManager::Instance ().property ("ShowStatusChangesEventsInPrivates").toBool ())
+				!ctx.ShowStatusChangesInPrivates_)
 			return;
 
 		if ((msg->GetMessageSubType () == IMessage::SubType::ParticipantJoin ||
 					msg->GetMessageSubType () == IMessage::SubType::ParticipantLeave) &&
-				!XmlSettingsManager::Instance ().property ("ShowJoinsLeaves").toBool ())
+				!ctx.ShowJoinsLeaves_)
 			return;
 
 		if (msg->GetMessageSubType () == IMessage::SubType::ParticipantEndedConversation)
 		{
-			if (!XmlSettingsManager::Instance ().property ("ShowEndConversations").toBool ())
+			if (!ctx.ShowEndConversations_)
 				return;
 			else if (other)
 				msg->SetBody (tr ("%1 ended the conversation.")
@@ -1896,7 +2099,7 @@ namespace Azoth
 		if (proxy->IsCancelled ())
 			return;
 
-		if (XmlSettingsManager::Instance ().property ("SeparateMUCEventLogWindow").toBool () &&
+		if (ctx.SeparateMUCEventLog_ &&
 				(!parent || parent->GetEntryType () == ICLEntry::EntryType::MUC) &&
 				(msg->GetMessageType () != IMessage::Type::MUCMessage &&
 					msg->GetMessageType () != IMessage::Type::ServiceMessage))
@@ -1909,39 +2112,16 @@ namespace Azoth
 				return;
 		}
 
-		QWebFrame *frame = Ui_.View_->page ()->mainFrame ();
-
-		const bool isActiveChat = Core::Instance ()
-				.GetChatTabsManager ()->IsActiveChat (GetEntry<ICLEntry> ());
-
 		if (!LastDateTime_.isNull () && !IsSameDay (LastDateTime_, msg) && parent)
-		{
-			auto datetime = msg->GetDateTime ();
-			const auto& thisDate = datetime.date ();
-			const auto& str = QLocale ().toString (thisDate, QLocale::LongFormat);
-
-			datetime.setTime ({0, 0});
-
-			auto coreMessage = new CoreMessage (str, datetime,
-					IMessage::Type::ServiceMessage, IMessage::Direction::In, parent->GetQObject (), this);
-			ChatMsgAppendInfo coreInfo
-			{
-				false,
-				isActiveChat,
-				ToggleRichText_->isChecked (),
-				Account_
-			};
-			Core::Instance ().AppendMessageByTemplate (frame, coreMessage, coreInfo);
-			CoreMessages_ << coreMessage;
-		}
+			AppendDaySeparator (msg, parent, ctx, items);
 
 		LastDateTime_ = msg->GetDateTime ();
 
 		ChatMsgAppendInfo info
 		{
 			Core::Instance ().IsHighlightMessage (msg),
-			isActiveChat,
-			ToggleRichText_->isChecked (),
+			ctx.IsActiveChat_,
+			ctx.UseRichText_,
 			Account_
 		};
 
@@ -1949,10 +2129,27 @@ namespace Azoth
 		if (!links.isEmpty ())
 			LastLink_ = links.last ();
 
-		if (!Core::Instance ().AppendMessageByTemplate (frame,
-				msg->GetQObject (), info))
-			qWarning () << Q_FUNC_INFO
-					<< "unhandled append message :(";
+		items.append ({ msg->GetQObject (), info });
+	}
+
+	void ChatTab::UpdateOlderMessagesLink ()
+	{
+		if (HiddenMessages_)
+		{
+			ShowOlderMessagesLink (HiddenMessages_);
+			return;
+		}
+
+		const auto retention = GetEntry<IHaveMessageRetention> ();
+		if (retention && retention->HasDroppedMessages ())
+			ShowOlderMessagesLink (DefaultRenderWindow);
+	}
+
+	void ChatTab::ShowOlderMessagesLink (int count)
+	{
+		auto body = Ui_.View_->page ()->mainFrame ()->findFirstElement ("body");
+		body.prependInside (QString ("<div style='text-align: center;'><a id='azothLoadOlder' href='azoth://loadolder/'>%1</a></div>")
+				.arg (tr ("Show %n earlier message(s)", 0, std::min (count, DefaultRenderWindow))));
 	}
 
 	QString ChatTab::ReformatTitle ()
@@ -66,6 +66,7 @@ namespace Azoth
 	class ContactDropFilter;
 	class MsgFormatterWidget;
 	class AvatarsManager;
+	struct ChatMsgAppendItem;
 
 	class ChatTab : public QWidget
 				  , public ITabWidget
@@ -108,6 +109,25 @@ namespace Azoth
 		QDateTime LastDateTime_;
 		QList<CoreMessage*> CoreMessages_;
 
+		/** The number of messages loaded on scroll-back in addition to
+		 * the default rendering window.
+		 */
+		int ExtraRenderedMessages_ = 0;
+
+		/** The number of messages known to the tab but not rendered.
+		 */
+		int HiddenMessages_ = 0;
+		int PrevDocHeight_ = -1;
+
+		/** The number of the most recent messages currently rendered
+		 * and the timestamp of the oldest of them, used to find where
+		 * the older messages end when rendering them on scroll-back.
+		 */
+		int RenderedMessages_ = 0;
+		QDateTime OldestRenderedDT_;
+
+		struct AppendContext;
+
 		QIcon TabIcon_;
 		bool IsMUC_ = false;
 		int PreviousTextHeight_ = 0;
@@ -253,7 +273,13 @@ namespace Azoth
 		void InitMsgEdit ();
 		void RegisterSettings ();
 
-		void RequestLogs (int);
+		bool RequestLogs (int);
+
+		/** Requests the messages older than the ones currently known
+		 * to the tab from the history plugins, for the case when the
+		 * entry has dropped them from memory.
+		 */
+		bool RequestOlderLogs ();
 
 		void UpdateTextHeight ();
 
@@ -261,6 +287,24 @@ namespace Azoth
 		 */
 		void AppendMessage (IMessage*);
 
+		QList<IMessage*> CollectMessages () const;
+
+		AppendContext MakeAppendContext ();
+
+		/** Appends the messages to the message view area at once.
+		 */
+		void AppendMessages (const QList<IMessage*>&);
+
+		/** Inserts the messages older than \em next before all the
+		 * already rendered ones.
+		 */
+		void PrependMessages (const QList<IMessage*>&, IMessage *next);
+		void RenderOlderMessages ();
+		void PrepareAppend (IMessage*, const AppendContext&, QList<ChatMsgAppendItem>&);
+		void AppendDaySeparator (IMessage*, ICLEntry*, const AppendContext&, QList<ChatMsgAppendItem>&);
+		void UpdateOlderMessagesLink ();
+		void ShowOlderMessagesLink (int count);
+
 		/** Updates the tab icon and other usages of state icon from the
 		 * TabIcon_.
 		 */
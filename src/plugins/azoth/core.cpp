@@ -28,6 +28,7 @@
  **********************************************************************/
 
 #include "core.h"
+#include <algorithm>
 #include <QIcon>
 #include <QAction>
 #include <QStandardItemModel>
@@ -40,6 +41,7 @@
 #include <QStringListModel>
 #include <QMessageBox>
 #include <QClipboard>
+#include <QTimer>
 #include <QtDebug>
 #include <util/util.h>
 #include <util/xpc/util.h>
@@ -175,6 +177,49 @@ namespace Azoth
 		return accounts;
 	}
 
+	namespace
+	{
+		/** Roster updates are accumulated for about a frame before
+		 * being applied to the model.
+		 */
+		const int RosterFlushInterval = 16;
+
+		/** Emits a single dataChanged() for each run of adjacent
+		 * \em items sharing the same parent.
+		 */
+		void EmitCoalescedDataChanged (QStandardItemModel *model, const QList<QStandardItem*>& items)
+		{
+			QHash<QStandardItem*, QList<int>> parent2rows;
+			for (const auto item : items)
+			{
+				const auto parent = item->parent () ? item->parent () : model->invisibleRootItem ();
+				parent2rows [parent] << item->row ();
+			}
+
+			for (auto i = parent2rows.begin (); i != parent2rows.end (); ++i)
+			{
+				auto& rows = *i;
+				std::sort (rows.begin (), rows.end ());
+				rows.erase (std::unique (rows.begin (), rows.end ()), rows.end ());
+
+				const auto& parentIdx = i.key ()->index ();
+				auto start = rows.first ();
+				for (int j = 1; j <= rows.size (); ++j)
+				{
+					if (j < rows.size () && rows [j] == rows [j - 1] + 1)
+						continue;
+
+					QMetaObject::invokeMethod (model,
+							"dataChanged",
+							Q_ARG (QModelIndex, model->index (start, 0, parentIdx)),
+							Q_ARG (QModelIndex, model->index (rows [j - 1], 0, parentIdx)));
+					if (j < rows.size ())
+						start = rows [j];
+				}
+			}
+		}
+	}
+
 	Core::Core ()
 	: Proxy_ (nullptr)
 	, AvatarsManager_ (std::make_shared<AvatarsManager> ())
@@ -186,6 +231,7 @@ namespace Azoth
 	, ActionsManager_ (new ActionsManager (AvatarsManager_.get (), this))
 	, ItemIconManager_ (new AnimatedIconManager<QStandardItem*> ([] (QStandardItem *it, const QIcon& ic)
 						{ it->setIcon (ic); }))
+	, RosterFlushTimer_ (new QTimer (this))
 	, SmilesOptionsModel_ (new SourceTrackingModel<IEmoticonResourceSource> ({ tr ("Smile pack") }))
 	, ChatStylesOptionsModel_ (new SourceTrackingModel<IChatStyleResourceSource> ({ tr ("Chat style") }))
 	, PluginManager_ (new PluginManager)
@@ -199,6 +245,22 @@ namespace Azoth
 	{
 		FillANFields ();
 
+		RosterFlushTimer_->setSingleShot (true);
+		RosterFlushTimer_->setInterval (RosterFlushInterval);
+		connect (RosterFlushTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (flushRosterUpdates ()));
+
+		connect (AvatarsManager_.get (),
+				SIGNAL (avatarInvalidated (QObject*)),
+				this,
+				SLOT (handleAvatarUpdated (QObject*)));
+		connect (AvatarsManager_.get (),
+				SIGNAL (scaledAvatarReady (QObject*)),
+				this,
+				SLOT (handleAvatarUpdated (QObject*)));
+
 		connect (this,
 				SIGNAL (hookAddingCLEntryEnd (LeechCraft::IHookProxy_ptr, QObject*)),
 				ChatTabsManager_,
@@ -585,14 +647,12 @@ namespace Azoth
 
 	void Core::UpdateItem (QObject *entryObj)
 	{
-		for (const auto item : Entry2Items_.value (qobject_cast<ICLEntry*> (entryObj)))
-		{
-			const auto& idx = item->index ();
-			QMetaObject::invokeMethod (CLModel_,
-					"dataChanged",
-					Q_ARG (QModelIndex, idx),
-					Q_ARG (QModelIndex, idx));
-		}
+		const auto entry = qobject_cast<ICLEntry*> (entryObj);
+		if (!Entry2Items_.contains (entry))
+			return;
+
+		PendingRepaintEntries_ << entry;
+		ScheduleRosterFlush ();
 	}
 
 	QStringList Core::GetChatGroups () const
@@ -775,6 +835,42 @@ namespace Azoth
 		return src->AppendMessage (frame, message, info);
 	}
 
+	bool Core::AppendMessagesByTemplate (QWebFrame *frame, const QList<ChatMsgAppendItem>& items)
+	{
+		if (items.isEmpty ())
+			return true;
+
+		const auto firstMsg = qobject_cast<IMessage*> (items.first ().Message_);
+		IChatStyleResourceSource *src = GetCurrentChatStyle (firstMsg->ParentCLEntry ());
+		if (!src)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "empty result for"
+					<< items.first ().Message_;
+			return false;
+		}
+
+		return src->AppendMessages (frame, items);
+	}
+
+	bool Core::PrependMessagesByTemplate (QWebFrame *frame, const QList<ChatMsgAppendItem>& items)
+	{
+		if (items.isEmpty ())
+			return true;
+
+		const auto firstMsg = qobject_cast<IMessage*> (items.first ().Message_);
+		IChatStyleResourceSource *src = GetCurrentChatStyle (firstMsg->ParentCLEntry ());
+		if (!src)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "empty result for"
+					<< items.first ().Message_;
+			return false;
+		}
+
+		return src->PrependMessages (frame, items);
+	}
+
 	void Core::FrameFocused (QObject *entry, QWebFrame *frame)
 	{
 		IChatStyleResourceSource *src = GetCurrentChatStyle (entry);
@@ -1202,12 +1298,6 @@ namespace Azoth
 					SLOT (handleBeenBanned (const QString&)));
 		}
 
-		if (qobject_cast<IHaveAvatars*> (entryObj))
-			connect (entryObj,
-					SIGNAL (avatarChanged (QObject*)),
-					this,
-					SLOT (invalidateSmoothAvatarCache (QObject*)));
-
 		NotificationsManager_->AddCLEntry (entryObj);
 
 #ifdef ENABLE_CRYPT
@@ -1297,13 +1387,20 @@ namespace Azoth
 		emit hookEntryStatusChanged (Util::DefaultHookProxy_ptr (new Util::DefaultHookProxy),
 				entry->GetQObject (), variant);
 
+		PendingStatusEntries_ << entry;
+		ScheduleRosterFlush ();
+	}
+
+	void Core::UpdateStatusIcon (ICLEntry *entry)
+	{
 		const State state = entry->GetStatus ().State_;
 		const auto& icon = ResourcesManager::Instance ().GetIconPathForState (state);
 
 		for (auto item : Entry2Items_.value (entry))
 		{
 			ItemIconManager_->SetIcon (item, icon.get ());
-			RecalculateOnlineForCat (item->parent ());
+			if (const auto parent = item->parent ())
+				PendingOnlineCats_ << QPersistentModelIndex (parent->index ());
 		}
 
 		const QString& id = entry->GetEntryID ();
@@ -1311,6 +1408,28 @@ namespace Azoth
 			CheckFileIcon (id);
 	}
 
+	void Core::ScheduleUnreadRecalc (QStandardItem *clItem)
+	{
+		const auto parent = clItem->parent ();
+		if (!parent)
+			return;
+
+		PendingUnreadCats_ << QPersistentModelIndex (parent->index ());
+		ScheduleRosterFlush ();
+	}
+
+	void Core::ScheduleRosterFlush ()
+	{
+		if (!RosterFlushTimer_->isActive ())
+			RosterFlushTimer_->start ();
+	}
+
+	void Core::ForgetPendingUpdates (ICLEntry *entry)
+	{
+		PendingStatusEntries_.remove (entry);
+		PendingRepaintEntries_.remove (entry);
+	}
+
 	void Core::CheckFileIcon (const QString& id)
 	{
 		ICLEntry *entry = qobject_cast<ICLEntry*> (GetEntry (id));
@@ -1344,7 +1463,7 @@ namespace Azoth
 			{
 				int prevValue = item->data (CLRUnreadMsgCount).toInt ();
 				item->setData (std::max (0, prevValue + amount), CLRUnreadMsgCount);
-				RecalculateUnreadForParents (item);
+				ScheduleUnreadRecalc (item);
 			}
 	}
 
@@ -1358,35 +1477,13 @@ namespace Azoth
 
 	QImage Core::GetAvatar (ICLEntry *entry, int size)
 	{
-		if (const auto candPtr = Entry2SmoothAvatarCache_ [entry])
-		{
-			const auto& cand = *candPtr;
-			if (cand.width () == size ||
-				cand.height () == size)
-				return cand;
-
-			if (cand.width () >= size ||
-				cand.height () >= size)
-				return cand.scaled ({ size, size }, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-		}
-
 		if (!entry)
 			return {};
 
-		const auto obj = entry->GetQObject ();
-		Util::Sequence (obj, AvatarsManager_->GetAvatar (obj, IHaveAvatars::Size::Thumbnail)) >>
-				[=] (QImage avatar)
-				{
-					avatar = avatar.isNull () ?
-							QImage {} :
-							avatar.scaled ({ size, size },
-									Qt::KeepAspectRatio, Qt::SmoothTransformation);
-					Entry2SmoothAvatarCache_.insert (entry, new QImage { avatar }, avatar.byteCount ());
-
-					UpdateItem (obj);
-				};
-
-		return ResourcesManager::Instance ().GetDefaultAvatar (size);
+		const auto& avatar = AvatarsManager_->GetScaledAvatar (entry->GetQObject (), size);
+		return avatar && !avatar->isNull () ?
+				*avatar :
+				ResourcesManager::Instance ().GetDefaultAvatar (size);
 	}
 
 	ActionsManager* Core::GetActionsManager () const
@@ -1399,9 +1496,8 @@ namespace Azoth
 		return CoreCommandsManager_;
 	}
 
-	void Core::RecalculateUnreadForParents (QStandardItem *clItem)
+	void Core::RecalculateUnreadForCat (QStandardItem *category)
 	{
-		QStandardItem *category = clItem->parent ();
 		int sum = 0;
 		for (int i = 0, rc = category->rowCount ();
 				i < rc; ++i)
@@ -1837,7 +1933,10 @@ namespace Azoth
 
 		for (auto entry : Entry2Items_.keys ())
 			if (entry->GetParentAccount () == accFace)
+			{
 				Entry2Items_.remove (entry);
+				ForgetPendingUpdates (entry);
+			}
 
 		NotificationsManager_->RemoveAccount (account);
 
@@ -1926,12 +2025,13 @@ namespace Azoth
 				RemoveCLItem (item);
 
 			Entry2Items_.remove (entry);
+			ForgetPendingUpdates (entry);
 
 			ActionsManager_->HandleEntryRemoved (entry);
 
 			ID2Entry_.remove (entry->GetEntryID ());
 
-			Entry2SmoothAvatarCache_.remove (entry);
+			AvatarsManager_->ForgetScaledAvatars (clitem);
 
 			NotificationsManager_->RemoveCLEntry (clitem);
 
@@ -2306,7 +2406,7 @@ namespace Azoth
 		for (auto item : Entry2Items_.value (entry))
 		{
 			item->setData (0, CLRUnreadMsgCount);
-			RecalculateUnreadForParents (item);
+			ScheduleUnreadRecalc (item);
 		}
 	}
 
@@ -2365,19 +2465,56 @@ namespace Azoth
 		RIEX::HandleRIEXItemsSuggested (items, from, message);
 	}
 
-	void Core::invalidateSmoothAvatarCache (QObject *entryObj)
+	void Core::flushRosterUpdates ()
 	{
-		const auto entry = qobject_cast<ICLEntry*> (entryObj);
-		if (!entry)
-		{
-			qWarning () << Q_FUNC_INFO
-					<< sender ()
-					<< "could not be casted to ICLEntry";
-			return;
-		}
+		QList<QStandardItem*> changed;
+
+		/* The per-item notifications are suppressed while the pending
+		 * updates are applied, and the changed items are announced
+		 * afterwards as ranges, so the proxies re-sort each run of rows
+		 * once.
+		 */
+		CLModel_->blockSignals (true);
 
-		Entry2SmoothAvatarCache_.remove (entry);
-		updateItem ();
+		const auto statusEntries = PendingStatusEntries_;
+		PendingStatusEntries_.clear ();
+		for (const auto entry : statusEntries)
+			if (Entry2Items_.contains (entry))
+			{
+				UpdateStatusIcon (entry);
+				changed += Entry2Items_.value (entry);
+			}
+
+		for (const auto& idx : PendingOnlineCats_)
+			if (idx.isValid ())
+			{
+				const auto catItem = CLModel_->itemFromIndex (idx);
+				RecalculateOnlineForCat (catItem);
+				changed << catItem;
+			}
+		PendingOnlineCats_.clear ();
+
+		for (const auto& idx : PendingUnreadCats_)
+			if (idx.isValid ())
+			{
+				const auto catItem = CLModel_->itemFromIndex (idx);
+				RecalculateUnreadForCat (catItem);
+				changed << catItem;
+			}
+		PendingUnreadCats_.clear ();
+
+		for (const auto entry : PendingRepaintEntries_)
+			changed += Entry2Items_.value (entry);
+		PendingRepaintEntries_.clear ();
+
+		CLModel_->blockSignals (false);
+
+		EmitCoalescedDataChanged (CLModel_, changed);
+	}
+
+	void Core::handleAvatarUpdated (QObject *entryObj)
+	{
+		UpdateItem (entryObj);
 	}
 }
 }
@@ -32,10 +32,10 @@
 #include <functional>
 #include <QObject>
 #include <QSet>
-#include <QCache>
 #include <QIcon>
 #include <QDateTime>
 #include <QUrl>
+#include <QPersistentModelIndex>
 #include <interfaces/core/ihookproxy.h>
 #include <interfaces/an/ianemitter.h>
 #include <interfaces/iinfo.h>
@@ -51,6 +51,7 @@
 
 class QStandardItemModel;
 class QStandardItem;
+class QTimer;
 
 namespace LeechCraft
 {
@@ -119,11 +120,18 @@ namespace Azoth
 		typedef QHash<QString, QObject*> ID2Entry_t;
 		ID2Entry_t ID2Entry_;
 
-		typedef QCache<ICLEntry*, QImage> Entry2SmoothAvatarCache_t;
-		Entry2SmoothAvatarCache_t Entry2SmoothAvatarCache_ { 5 * 1024 * 1024 };
-
 		AnimatedIconManager<QStandardItem*> *ItemIconManager_;
 
+		/** Roster updates postponed till the next flushRosterUpdates()
+		 * call, so that a storm of presence changes results in a
+		 * single update of each affected item.
+		 */
+		QSet<ICLEntry*> PendingStatusEntries_;
+		QSet<ICLEntry*> PendingRepaintEntries_;
+		QSet<QPersistentModelIndex> PendingOnlineCats_;
+		QSet<QPersistentModelIndex> PendingUnreadCats_;
+		QTimer * const RosterFlushTimer_;
+
 		QMap<State, int> StateCounter_;
 
 		std::shared_ptr<SourceTrackingModel<IEmoticonResourceSource>> SmilesOptionsModel_;
@@ -264,6 +272,8 @@ namespace Azoth
 		QUrl GetSelectedChatTemplateURL (QObject*) const;
 
 		bool AppendMessageByTemplate (QWebFrame*, QObject*, const ChatMsgAppendInfo&);
+		bool AppendMessagesByTemplate (QWebFrame*, const QList<ChatMsgAppendItem>&);
+		bool PrependMessagesByTemplate (QWebFrame*, const QList<ChatMsgAppendItem>&);
 
 		void FrameFocused (QObject*, QWebFrame*);
 
@@ -326,15 +336,28 @@ namespace Azoth
 		void HandleStatusChanged (const EntryStatus& status,
 				ICLEntry *entry, const QString& variant);
 
+		/** Updates the status icon of the items representing the
+		 * entry and marks their categories for online count update.
+		 */
+		void UpdateStatusIcon (ICLEntry*);
+
+		/** Marks the category of the given item for unread count
+		 * update on the next roster flush.
+		 */
+		void ScheduleUnreadRecalc (QStandardItem*);
+
+		void ScheduleRosterFlush ();
+		void ForgetPendingUpdates (ICLEntry*);
+
 		/** Checks whether icon representing incoming file should be
 		 * drawn for the entry with the given id.
 		 */
 		void CheckFileIcon (const QString& id);
 
 		/** This functions calculates new value of number of unread
-		 * items for the chain of parents of the given item.
+		 * items in the given category.
 		 */
-		void RecalculateUnreadForParents (QStandardItem*);
+		void RecalculateUnreadForCat (QStandardItem*);
 
 		void RecalculateOnlineForCat (QStandardItem*);
 
@@ -467,7 +490,9 @@ namespace Azoth
 
 		void handleRIEXItemsSuggested (QList<LeechCraft::Azoth::RIEXItem>, QObject*, QString);
 
-		void invalidateSmoothAvatarCache (QObject*);
+		void handleAvatarUpdated (QObject*);
+
+		void flushRosterUpdates ();
 	signals:
 		void gotEntity (const LeechCraft::Entity&);
 		void delegateEntity (const LeechCraft::Entity&, int*, QObject**);
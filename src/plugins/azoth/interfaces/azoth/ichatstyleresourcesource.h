@@ -62,6 +62,21 @@ namespace Azoth
 		IAccount *Account_;
 	};
 
+	/** @brief A single message to be appended in a batch.
+	 *
+	 * @sa IChatStyleResourceSource::AppendMessages()
+	 */
+	struct ChatMsgAppendItem
+	{
+		/** @brief The message object implementing IMessage.
+		 */
+		QObject *Message_;
+
+		/** @brief Additional parameters of this message.
+		 */
+		ChatMsgAppendInfo Info_;
+	};
+
 	/** @brief Interface for chat style resource loaders and handlers.
 	 *
 	 * This interface should be implemented by resource sources that are
@@ -136,6 +151,47 @@ namespace Azoth
 		virtual bool AppendMessage (QWebFrame *frame, QObject *message,
 				const ChatMsgAppendInfo& info) = 0;
 
+		/** @brief Appends a batch of messages to the chat view.
+		 *
+		 * This function is called whenever lots of messages should be
+		 * appended at once, for example, when the chat view is
+		 * (re)initialized. The messages are ordered from the oldest to
+		 * the newest, and the result should be the same as if
+		 * AppendMessage() has been called for each of them in order.
+		 *
+		 * Implementations are expected to do this with as few DOM
+		 * modifications as possible.
+		 *
+		 * @param[in] frame The chat view frame.
+		 * @param[in] items The messages to be appended.
+		 * @return true on success, false otherwise.
+		 *
+		 * @sa AppendMessage()
+		 */
+		virtual bool AppendMessages (QWebFrame *frame,
+				const QList<ChatMsgAppendItem>& items) = 0;
+
+		/** @brief Inserts a batch of older messages before the others.
+		 *
+		 * This function is called when the user scrolls back to the
+		 * messages that haven't been rendered yet. The messages are
+		 * ordered from the oldest to the newest, and all of them are
+		 * older than any message already shown in the \em frame.
+		 *
+		 * The messages should be inserted before the already shown ones
+		 * without rerendering them, and the state used to format the
+		 * messages appended later (like the sender of the last message)
+		 * should be left intact.
+		 *
+		 * @param[in] frame The chat view frame.
+		 * @param[in] items The messages to be prepended.
+		 * @return true on success, false otherwise.
+		 *
+		 * @sa AppendMessages()
+		 */
+		virtual bool PrependMessages (QWebFrame *frame,
+				const QList<ChatMsgAppendItem>& items) = 0;
+
 		/** @brief Notifies about a frame obtaining user input focus.
 		 *
 		 * This function is called whenever a given frame receives user
@@ -166,6 +222,6 @@ namespace Azoth
 }
 
 Q_DECLARE_INTERFACE (LeechCraft::Azoth::IChatStyleResourceSource,
-		"org.Deviant.LeechCraft.Azoth.IChatStyleResourceSource/1.0")
+		"org.Deviant.LeechCraft.Azoth.IChatStyleResourceSource/1.1")
 
 #endif
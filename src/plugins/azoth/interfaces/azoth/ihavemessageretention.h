@@ -0,0 +1,69 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QtPlugin>
+
+namespace LeechCraft
+{
+namespace Azoth
+{
+	/** @brief Interface for entries keeping only the recent messages.
+	 *
+	 * This interface is to be implemented by entries (implementing
+	 * ICLEntry) that limit the number of messages kept in memory, like
+	 * the ones using the MessageRing class. Older messages are dropped
+	 * by such entries, and Azoth pages them in from the history plugins
+	 * when the user scrolls back in the chat tab.
+	 *
+	 * @sa ICLEntry, MessageRing
+	 */
+	class IHaveMessageRetention
+	{
+	public:
+		virtual ~IHaveMessageRetention () {}
+
+		/** @brief Returns whether some of the messages were dropped.
+		 *
+		 * This function should return true if the list returned from
+		 * ICLEntry::GetAllMessages() lacks some older messages that have
+		 * been received or sent since the entry was created or last
+		 * purged via ICLEntry::PurgeMessages().
+		 *
+		 * @return Whether the older messages should be requested from
+		 * the history.
+		 */
+		virtual bool HasDroppedMessages () const = 0;
+	};
+}
+}
+
+Q_DECLARE_INTERFACE (LeechCraft::Azoth::IHaveMessageRetention,
+		"org.LeechCraft.Azoth.IHaveMessageRetention/1.0")
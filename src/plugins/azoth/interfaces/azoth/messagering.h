@@ -0,0 +1,262 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <QList>
+#include <QDateTime>
+#include "azothutil.h"
+#include "imessage.h"
+
+namespace LeechCraft
+{
+namespace Azoth
+{
+	/** @brief A bounded store of the messages of a single entry.
+	 *
+	 * This class is to be used by the protocol plugins instead of a
+	 * plain list of messages in ICLEntry implementations. It keeps at
+	 * most GetCapacity() most recent messages, deleting the oldest ones
+	 * as new messages are appended. The dropped messages are still
+	 * available to the user via the history plugins, and the entry is
+	 * expected to implement IHaveMessageRetention to let Azoth know
+	 * when it should ask the history for the older messages.
+	 *
+	 * The ring also maintains a list of the messages cast to IMessage,
+	 * so that ICLEntry::GetAllMessages() may just return an implicitly
+	 * shared copy of it.
+	 *
+	 * The messages are kept sorted in the order they have been
+	 * appended, and the ring owns them: they are deleted when evicted
+	 * or purged. The messages still contained in the ring are not
+	 * deleted when the ring is destroyed, though, since they typically
+	 * have a QObject parent taking care of them.
+	 *
+	 * @tparam T The type of the message object, which should be
+	 * implementing the IMessage interface.
+	 *
+	 * @sa IHaveMessageRetention
+	 */
+	template<typename T>
+	class MessageRing
+	{
+		QList<T*> Messages_;
+		QList<IMessage*> IMessages_;
+
+		int Capacity_ = DefaultCapacity;
+		bool HasEvicted_ = false;
+
+		std::function<void (T*)> EvictHandler_;
+	public:
+		/** @brief The capacity used when none has been set explicitly.
+		 */
+		static const int DefaultCapacity = 1000;
+
+		typedef typename QList<T*>::const_iterator const_iterator;
+
+		MessageRing () = default;
+
+		MessageRing (const MessageRing&) = delete;
+		MessageRing& operator= (const MessageRing&) = delete;
+
+		/** @brief Returns the maximum number of messages kept.
+		 *
+		 * Zero means the number of messages is unbounded.
+		 */
+		int GetCapacity () const
+		{
+			return Capacity_;
+		}
+
+		/** @brief Sets the maximum number of messages kept.
+		 *
+		 * If the ring already contains more than \em capacity messages,
+		 * the oldest ones are evicted immediately.
+		 *
+		 * @param[in] capacity The new capacity, or 0 for no limit.
+		 */
+		void SetCapacity (int capacity)
+		{
+			Capacity_ = std::max (capacity, 0);
+			Trim ();
+		}
+
+		/** @brief Sets the function called before a message is evicted.
+		 *
+		 * The handler is called right before the evicted message is
+		 * deleted, so the entry can drop other references to it (like
+		 * the list of unread messages).
+		 */
+		void SetEvictHandler (const std::function<void (T*)>& handler)
+		{
+			EvictHandler_ = handler;
+		}
+
+		/** @brief Appends the given message, evicting the oldest ones.
+		 */
+		void Append (T *msg)
+		{
+			Messages_ << msg;
+			IMessages_ << AzothUtil::detail::GetIMessage (msg);
+			Trim ();
+		}
+
+		MessageRing& operator<< (T *msg)
+		{
+			Append (msg);
+			return *this;
+		}
+
+		/** @brief Merges the given messages preserving timestamp order.
+		 *
+		 * Both the \em messages and the messages already in the ring are
+		 * assumed to be sorted by their timestamps. The ring takes the
+		 * ownership of the \em messages.
+		 */
+		void Merge (const QList<T*>& messages)
+		{
+			if (messages.isEmpty ())
+				return;
+
+			const auto size = Messages_.size ();
+			Messages_ += messages;
+			std::inplace_merge (Messages_.begin (),
+					Messages_.begin () + size,
+					Messages_.end (),
+					[] (T *msg1, T *msg2) { return msg1->GetDateTime () < msg2->GetDateTime (); });
+			RebuildIMessages ();
+			Trim ();
+		}
+
+		/** @brief Removes all the messages from the ring without deleting
+		 * them, transferring their ownership to the caller.
+		 */
+		QList<T*> TakeAll ()
+		{
+			const auto result = Messages_;
+			Messages_.clear ();
+			IMessages_.clear ();
+			return result;
+		}
+
+		/** @brief Deletes the messages older than \em before.
+		 *
+		 * If \em before is invalid all the messages are deleted. Either
+		 * way, the ring is considered to have not evicted any messages
+		 * after this, since the user has explicitly asked to get rid of
+		 * them.
+		 *
+		 * @sa AzothUtil::StandardPurgeMessages()
+		 */
+		void Purge (const QDateTime& before)
+		{
+			AzothUtil::StandardPurgeMessages (Messages_, before);
+			RebuildIMessages ();
+			HasEvicted_ = false;
+		}
+
+		/** @brief Deletes all the messages in the ring.
+		 */
+		void DeleteAll ()
+		{
+			qDeleteAll (Messages_);
+			Messages_.clear ();
+			IMessages_.clear ();
+		}
+
+		const QList<T*>& GetMessages () const
+		{
+			return Messages_;
+		}
+
+		const QList<IMessage*>& GetIMessages () const
+		{
+			return IMessages_;
+		}
+
+		bool IsEmpty () const
+		{
+			return Messages_.isEmpty ();
+		}
+
+		int Size () const
+		{
+			return Messages_.size ();
+		}
+
+		/** @brief Returns whether any messages have been evicted.
+		 *
+		 * @sa IHaveMessageRetention::HasDroppedMessages()
+		 */
+		bool HasEvicted () const
+		{
+			return HasEvicted_;
+		}
+
+		const_iterator begin () const
+		{
+			return Messages_.begin ();
+		}
+
+		const_iterator end () const
+		{
+			return Messages_.end ();
+		}
+	private:
+		void Trim ()
+		{
+			if (!Capacity_ || Messages_.size () <= Capacity_)
+				return;
+
+			const auto toEvict = Messages_.size () - Capacity_;
+			for (int i = 0; i < toEvict; ++i)
+			{
+				const auto msg = Messages_.at (i);
+				if (EvictHandler_)
+					EvictHandler_ (msg);
+				delete msg;
+			}
+
+			Messages_.erase (Messages_.begin (), Messages_.begin () + toEvict);
+			IMessages_.erase (IMessages_.begin (), IMessages_.begin () + toEvict);
+			HasEvicted_ = true;
+		}
+
+		void RebuildIMessages ()
+		{
+			IMessages_.clear ();
+			IMessages_.reserve (Messages_.size ());
+			for (const auto msg : Messages_)
+				IMessages_ << AzothUtil::detail::GetIMessage (msg);
+		}
+	};
+}
+}
@@ -29,14 +29,15 @@
 
 #include "channelclentry.h"
 #include <util/sll/prelude.h>
+#include <xmlsettingsdialog/basesettingsmanager.h>
 #include <interfaces/azoth/iproxyobject.h>
-#include <interfaces/azoth/azothutil.h>
 #include "channelhandler.h"
 #include "channelpublicmessage.h"
 #include "ircmessage.h"
 #include "ircaccount.h"
 #include "channelconfigwidget.h"
 #include "channelsmanager.h"
+#include "core.h"
 
 namespace LeechCraft
 {
@@ -112,6 +113,11 @@ namespace Acetamide
 				Translations_ ["owner"] = tr ("Owner");
 				break;
 			}
+
+		const auto xsm = Core::Instance ().GetPluginProxy ()->GetSettingsManager ();
+		qobject_cast<Util::BaseSettingsManager*> (xsm)->RegisterObject ("MessageRetentionLimit",
+				this, "handleMessageRetentionLimitChanged");
+		handleMessageRetentionLimitChanged ();
 	}
 
 	ChannelHandler* ChannelCLEntry::GetChannelHandler () const
@@ -188,12 +194,12 @@ namespace Acetamide
 
 	QList<IMessage*> ChannelCLEntry::GetAllMessages () const
 	{
-		return AllMessages_;
+		return AllMessages_.GetIMessages ();
 	}
 
 	void ChannelCLEntry::PurgeMessages (const QDateTime& before)
 	{
-		AzothUtil::StandardPurgeMessages (AllMessages_, before);
+		AllMessages_.Purge (before);
 	}
 
 	void ChannelCLEntry::SetChatPartState (ChatPartState, const QString&)
@@ -566,6 +572,11 @@ namespace Acetamide
 		emit gotInviteListItem (mask, nick, date);
 	}
 
+	bool ChannelCLEntry::HasDroppedMessages () const
+	{
+		return AllMessages_.HasEvicted ();
+	}
+
 	void ChannelCLEntry::SetIsWidgetRequest (bool set)
 	{
 		IsWidgetRequest_ = set;
@@ -615,6 +626,12 @@ namespace Acetamide
 	{
 		return Role2Str_ [role];
 	}
+
+	void ChannelCLEntry::handleMessageRetentionLimitChanged ()
+	{
+		const auto xsm = Core::Instance ().GetPluginProxy ()->GetSettingsManager ();
+		AllMessages_.SetCapacity (xsm->property ("MessageRetentionLimit").toInt ());
+	}
 }
 }
 }
@@ -35,6 +35,8 @@
 #include <interfaces/azoth/imucentry.h>
 #include <interfaces/azoth/imucperms.h>
 #include <interfaces/azoth/iconfigurablemuc.h>
+#include <interfaces/azoth/ihavemessageretention.h>
+#include <interfaces/azoth/messagering.h>
 #include "localtypes.h"
 
 namespace LeechCraft
@@ -53,16 +55,17 @@ namespace Acetamide
 						 , public IMUCEntry
 						 , public IMUCPerms
 						 , public IConfigurableMUC
-
+						 , public IHaveMessageRetention
 	{
 		Q_OBJECT
 		Q_INTERFACES (LeechCraft::Azoth::IMUCEntry
 				LeechCraft::Azoth::ICLEntry
 				LeechCraft::Azoth::IMUCPerms
-				LeechCraft::Azoth::IConfigurableMUC)
+				LeechCraft::Azoth::IConfigurableMUC
+				LeechCraft::Azoth::IHaveMessageRetention)
 
 		ChannelHandler *ICH_;
-		QList<IMessage*> AllMessages_;
+		MessageRing<IMessage> AllMessages_;
 		bool IsWidgetRequest_;
 
 		QMap<QByteArray, QList<QByteArray>> Perms_;
@@ -147,6 +150,10 @@ namespace Acetamide
 				const QDateTime&);
 		void SetInviteListItem (const QString&, const QString&,
 				const QDateTime&);
+
+		// IHaveMessageRetention
+		bool HasDroppedMessages () const;
+
 		void SetIsWidgetRequest (bool);
 		bool GetIsWidgetRequest () const;
 		void AddBanListItem (QString);
@@ -157,6 +164,8 @@ namespace Acetamide
 		void RemoveInviteListItem (QString);
 		void SetNewChannelModes (const ChannelModes&);
 		QString Role2String (const ChannelRole&) const;
+	private slots:
+		void handleMessageRetentionLimitChanged ();
 	signals:
 		void gotNewParticipants (const QList<QObject*>&);
 		void mucSubjectChanged (const QString&);
@@ -29,14 +29,15 @@
 
 #include "entrybase.h"
 #include <QAction>
+#include <xmlsettingsdialog/basesettingsmanager.h>
 #include <interfaces/azoth/iproxyobject.h>
-#include <interfaces/azoth/azothutil.h>
 #include "clientconnection.h"
 #include "ircprotocol.h"
 #include "ircaccount.h"
 #include "ircmessage.h"
 #include "vcarddialog.h"
 #include "ircparticipantentry.h"
+#include "core.h"
 
 namespace LeechCraft
 {
@@ -49,11 +50,15 @@ namespace Acetamide
 	, Account_ (account)
 	, VCardDialog_ (0)
 	{
+		const auto xsm = Core::Instance ().GetPluginProxy ()->GetSettingsManager ();
+		qobject_cast<Util::BaseSettingsManager*> (xsm)->RegisterObject ("MessageRetentionLimit",
+				this, "handleMessageRetentionLimitChanged");
+		handleMessageRetentionLimitChanged ();
 	}
 
 	EntryBase::~EntryBase ()
 	{
-		qDeleteAll (AllMessages_);
+		AllMessages_.DeleteAll ();
 		qDeleteAll (Actions_);
 		delete VCardDialog_;
 	}
@@ -65,12 +70,12 @@ namespace Acetamide
 
 	QList<IMessage*> EntryBase::GetAllMessages () const
 	{
-		return AllMessages_;
+		return AllMessages_.GetIMessages ();
 	}
 
 	void EntryBase::PurgeMessages (const QDateTime& before)
 	{
-		AzothUtil::StandardPurgeMessages (AllMessages_, before);
+		AllMessages_.Purge (before);
 	}
 
 	void EntryBase::SetChatPartState (ChatPartState, const QString&)
@@ -121,6 +126,11 @@ namespace Acetamide
 		emit chatTabClosed ();
 	}
 
+	bool EntryBase::HasDroppedMessages () const
+	{
+		return AllMessages_.HasEvicted ();
+	}
+
 	void EntryBase::HandleMessage (IrcMessage *msg)
 	{
 		msg->SetOtherPart (this);
@@ -155,6 +165,12 @@ namespace Acetamide
 		if (VCardDialog_)
 			VCardDialog_->UpdateInfo (msg);
 	}
+
+	void EntryBase::handleMessageRetentionLimitChanged ()
+	{
+		const auto xsm = Core::Instance ().GetPluginProxy ()->GetSettingsManager ();
+		AllMessages_.SetCapacity (xsm->property ("MessageRetentionLimit").toInt ());
+	}
 };
 };
 };
@@ -34,6 +34,8 @@
 #include <QImage>
 #include <QVariant>
 #include <interfaces/azoth/iclentry.h>
+#include <interfaces/azoth/ihavemessageretention.h>
+#include <interfaces/azoth/messagering.h>
 #include "localtypes.h"
 
 namespace LeechCraft
@@ -48,11 +50,13 @@ namespace Acetamide
 
 	class EntryBase : public QObject
 					, public ICLEntry
+					, public IHaveMessageRetention
 	{
 		Q_OBJECT
-		Q_INTERFACES (LeechCraft::Azoth::ICLEntry)
+		Q_INTERFACES (LeechCraft::Azoth::ICLEntry
+				LeechCraft::Azoth::IHaveMessageRetention)
 	protected:
-		QList<IMessage*> AllMessages_;
+		MessageRing<IMessage> AllMessages_;
 		EntryStatus CurrentStatus_;
 		QList<QAction*> Actions_;
 
@@ -77,13 +81,16 @@ namespace Acetamide
 
 		virtual QString GetEntryID () const = 0;
 
+		bool HasDroppedMessages () const;
+
 		void HandleMessage (IrcMessage*);
 		void SetStatus (const EntryStatus&);
 		void SetAvatar (const QByteArray&);
 		void SetAvatar (const QImage&);
 		void SetRawInfo (const QString&);
 		void SetInfo (const WhoIsMessage& msg);
-
+	private slots:
+		void handleMessageRetentionLimitChanged ();
 	signals:
 		void gotMessage (QObject*);
 		void statusChanged (const EntryStatus&, const QString&);
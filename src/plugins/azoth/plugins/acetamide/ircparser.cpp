@@ -28,10 +28,7 @@
  **********************************************************************/
 
 #include "ircparser.h"
-#include <boost/bind.hpp>
-#include <boost/spirit/include/classic_core.hpp>
-#include <boost/spirit/include/classic_loops.hpp>
-#include <boost/spirit/include/classic_push_back_actor.hpp>
+#include <algorithm>
 #include <QTextCodec>
 #include <util/sll/prelude.h>
 #include "ircaccount.h"
@@ -43,8 +40,6 @@ namespace Azoth
 {
 namespace Acetamide
 {
-	using namespace boost::spirit::classic;
-
 	IrcParser::IrcParser (IrcServerHandler *sh)
 	: QObject (sh)
 	, ISH_ (sh)
@@ -414,85 +409,146 @@ namespace Acetamide
 		ISH_->SendCommand (chListCmd);
 	}
 
+	namespace
+	{
+		bool IsSpecial (char c)
+		{
+			switch (c)
+			{
+			case '[':
+			case ']':
+			case '\\':
+			case '`':
+			case '_':
+			case '^':
+			case '{':
+			case '|':
+			case '}':
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		bool IsAlpha (char c)
+		{
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+		}
+
+		bool IsDigit (char c)
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		const char* FindSpace (const char *pos, const char *end)
+		{
+			return std::find (pos, end, ' ');
+		}
+
+		/** Returns the end of the longest RFC 2812 nickname at the
+		 * beginning of the [pos; end) range.
+		 */
+		const char* NicknameEnd (const char *pos, const char *end)
+		{
+			if (pos == end || !(IsAlpha (*pos) || IsSpecial (*pos)))
+				return pos;
+
+			while (++pos != end)
+				if (!IsAlpha (*pos) && !IsDigit (*pos) && !IsSpecial (*pos) && *pos != '-')
+					break;
+			return pos;
+		}
+
+		void ParsePrefix (const char *pos, const char *end, IrcMessageOptions& opts)
+		{
+			const auto at = std::find (pos, end, '@');
+			if (at == end)
+			{
+				// Either a server name or a bare nickname, and nicknames can't contain dots.
+				opts.Host_ = QString::fromUtf8 (pos, end - pos);
+				if (std::find (pos, end, '.') == end)
+					opts.Nick_ = QString::fromUtf8 (pos, NicknameEnd (pos, end) - pos);
+				return;
+			}
+
+			const auto bang = std::find (pos, at, '!');
+			opts.Nick_ = QString::fromUtf8 (pos, bang - pos);
+			if (bang != at)
+				opts.UserName_ = QString::fromUtf8 (bang + 1, at - bang - 1);
+			opts.Host_ = QString::fromUtf8 (at + 1, end - at - 1);
+		}
+	}
+
 	bool IrcParser::ParseMessage (const QByteArray& message)
 	{
-		const auto& msg = GetCodec ()->toUnicode (message);
-
-		IrcMessageOptions_.Command_.clear ();
-		IrcMessageOptions_.Nick_.clear ();
-		IrcMessageOptions_.Message_.clear ();
-		IrcMessageOptions_.Parameters_.clear ();
-		IrcMessageOptions_.UserName_.clear ();
-		IrcMessageOptions_.Host_.clear ();
-
-		std::string nickStr;
-		std::string userStr;
-		std::string hostStr;
-		std::string commandStr;
-		std::string msgStr;
-		QList<std::string> opts;
-
-		range<> ascii (char (0x01), char (0x7F));
-		rule<> special = lexeme_d [ch_p ('[') | ']' | '\\' | '`' |
-				'_' | '^' | '{' | '|' | '}'];
-		rule<> shortname = *(alnum_p
-				>> *(alnum_p || ch_p ('-'))
-				>> *alnum_p);
-		rule<> hostname = (shortname
-				>> *(ch_p ('.')
-				>> shortname)) [assign_a (hostStr)];
-		rule<> nickname = (alpha_p | special)
-				>> *(alnum_p | special | ch_p ('-'));
-		rule<> user =  +(ascii - '\r' - '\n' - ' ' - '@' - '\0');
-		rule<> host = lexeme_d [+(anychar_p - ' ')] ;
-		rule<> nick = lexeme_d [nickname [assign_a (nickStr)]
-				>> !(!(ch_p ('!')
-				>> user [assign_a (userStr)])
-				>> ch_p ('@')
-				>> host [assign_a (hostStr)])];
-		rule<> nospcrlfcl = (anychar_p - '\0' - '\r' - '\n' -
-				' ' - ':');
-		rule<> lastParam = lexeme_d [ch_p (' ')
-				>> !ch_p (':')
-				>> (*(ch_p (':') | ch_p (' ') | nospcrlfcl))
-					[assign_a (msgStr)]];
-		rule<> firsParam = lexeme_d [ch_p (' ')
-				>> (nospcrlfcl
-				>> *(ch_p (':') | nospcrlfcl))
-					[push_back_a (opts)]];
-		rule<> params =  *firsParam
-				>> !lastParam;
-		rule<> command = longest_d [(+alpha_p) |
-				(repeat_p (3) [digit_p])] [assign_a (commandStr)];
-		rule<> prefix = longest_d [hostname | nick];
-		rule<> reply = (lexeme_d [!(ch_p (':')
-				>> prefix >> ch_p (' '))]
-				>> command
-				>> !params
-				>> eol_p);
-
-		bool res = parse (msg.toUtf8 ().constData (), reply).full;
-
-		if (!res)
+		IrcMessageOptions_ = IrcMessageOptions {};
+
+		auto pos = message.constData ();
+		auto end = pos + message.size ();
+		while (end != pos && (end [-1] == '\n' || end [-1] == '\r'))
+			--end;
+
+		auto fail = [&message]
 		{
 			qWarning () << "input string is not a valide IRC command"
-					<< msg;
+					<< message;
 			return false;
+		};
+
+		if (pos != end && *pos == ':')
+		{
+			const auto prefixEnd = FindSpace (pos + 1, end);
+			if (prefixEnd == end || prefixEnd == pos + 1)
+				return fail ();
+
+			ParsePrefix (pos + 1, prefixEnd, IrcMessageOptions_);
+			pos = prefixEnd + 1;
 		}
-		else
+
+		const auto cmdEnd = FindSpace (pos, end);
+		if (cmdEnd == pos)
+			return fail ();
+
+		if (cmdEnd - pos == 3 && std::all_of (pos, cmdEnd, IsDigit))
+			IrcMessageOptions_.Numeric_ = (pos [0] - '0') * 100 + (pos [1] - '0') * 10 + (pos [2] - '0');
+		else if (!std::all_of (pos, cmdEnd, IsAlpha))
+			return fail ();
+
+		IrcMessageOptions_.Command_ = QString::fromLatin1 (pos, cmdEnd - pos).toLower ();
+
+		const auto codec = GetCodec ();
+		const bool isUtf8 = codec->mibEnum () == 106;
+		const auto toStdString = [codec, isUtf8] (const char *begin, const char *end)
+		{
+			return isUtf8 ?
+					std::string (begin, end) :
+					codec->toUnicode (begin, end - begin).toUtf8 ().toStdString ();
+		};
+
+		pos = cmdEnd;
+		while (pos != end)
 		{
-			IrcMessageOptions_.Nick_ = QString::fromUtf8 (nickStr.c_str ());
-			IrcMessageOptions_.Command_ = QString::fromUtf8 (commandStr.c_str ()).toLower ();
-			IrcMessageOptions_.Message_ = QString::fromUtf8 (msgStr.c_str ());
-			IrcMessageOptions_.UserName_ = QString::fromUtf8 (userStr.c_str ());
-			IrcMessageOptions_.Host_ = QString::fromUtf8 (hostStr.c_str ());
-			IrcMessageOptions_.Parameters_ = opts;
+			if (*pos == ' ')
+			{
+				++pos;
+				continue;
+			}
+
+			if (*pos == ':')
+			{
+				IrcMessageOptions_.Message_ = codec->toUnicode (pos + 1, end - pos - 1);
+				break;
+			}
+
+			const auto paramEnd = FindSpace (pos, end);
+			IrcMessageOptions_.Parameters_ << toStdString (pos, paramEnd);
+			pos = paramEnd;
 		}
 
 		return true;
 	}
 
-	IrcMessageOptions IrcParser::GetIrcMessageOptions () const
+	const IrcMessageOptions& IrcParser::GetIrcMessageOptions () const
 	{
 		return IrcMessageOptions_;
 	}
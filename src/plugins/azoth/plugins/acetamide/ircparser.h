@@ -99,10 +99,13 @@ namespace Acetamide
 		void ChanModeCommand (const QStringList&);
 		void ChannelsListCommand (const QStringList&);
 
-		/** Automatically converts the \em ba to UTF-8.
+		/** Parses the raw \em ba line as received from the server.
+		 *
+		 * The line is split in place, and only the resulting fields
+		 * are converted from the server encoding.
 		 */
 		bool ParseMessage (const QByteArray& ba);
-		IrcMessageOptions GetIrcMessageOptions () const;
+		const IrcMessageOptions& GetIrcMessageOptions () const;
 	private:
 		QTextCodec* GetCodec ();
 		QStringList EncodingList (const QStringList&);
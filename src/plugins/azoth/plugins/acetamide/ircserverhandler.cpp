@@ -962,7 +962,8 @@ namespace Acetamide
 
 	void IrcServerHandler::SendCommand (const QString& cmd)
 	{
-		SendToConsole (IMessage::Direction::Out, cmd.trimmed ());
+		if (IsConsoleEnabled_)
+			SendToConsole (IMessage::Direction::Out, cmd.trimmed ());
 		if (Socket_)
 			Socket_->Send (cmd);
 	}
@@ -1028,15 +1029,17 @@ namespace Acetamide
 
 	void IrcServerHandler::ReadReply (const QByteArray& msg)
 	{
-		SendToConsole (IMessage::Direction::In, msg.trimmed ());
+		if (IsConsoleEnabled_)
+			SendToConsole (IMessage::Direction::In, msg.trimmed ());
+
 		if (!IrcParser_->ParseMessage (msg))
 			return;
 
 		const auto& opts = IrcParser_->GetIrcMessageOptions ();
-		if (ErrorHandler_->IsError (opts.Command_.toInt ()))
+		if (opts.Numeric_ >= 0 && ErrorHandler_->IsError (opts.Numeric_))
 		{
 			ErrorHandler_->HandleError (opts);
-			if (opts.Command_ == "433")
+			if (opts.Numeric_ == 433)
 			{
 				NickCmdError ();
 			}
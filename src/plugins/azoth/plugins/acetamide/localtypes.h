@@ -106,6 +106,11 @@ namespace Acetamide
 		QString Command_;
 		QString Message_;
 		QList<std::string> Parameters_;
+
+		/** The numeric reply code, or -1 if the Command_ is not a
+		 * numeric reply.
+		 */
+		int Numeric_ = -1;
 	};
 
 	struct IrcBookmark
@@ -150,16 +150,41 @@ namespace Acetamide
 		Command2Action_ ["378"] = [this] (const IrcMessageOptions& opts) { ISH_->ShowAnswer ("278", opts.Message_); };
 
 		MatchString2Server_ ["unreal"] = IrcServer::UnrealIRCD;
+
+		Numeric2Action_.resize (1000);
+		for (auto it = Command2Action_.begin (); it != Command2Action_.end (); )
+		{
+			bool isNumeric = false;
+			const auto code = it.key ().toInt (&isNumeric);
+			if (isNumeric)
+			{
+				Numeric2Action_ [code] = *it;
+				it = Command2Action_.erase (it);
+			}
+			else
+				++it;
+		}
 	}
 
 	void ServerResponseManager::DoAction (const IrcMessageOptions& opts)
 	{
+		if (opts.Numeric_ >= 0)
+		{
+			if (const auto& action = Numeric2Action_ [opts.Numeric_])
+				action (opts);
+			else
+				ISH_->ShowAnswer ("UNKNOWN CMD " + opts.Command_, opts.Message_);
+			return;
+		}
+
+		auto pos = Command2Action_.constFind (opts.Command_);
 		if (opts.Command_ == "privmsg" && IsCTCPMessage (opts.Message_))
-			Command2Action_ ["ctcp_rpl"] (opts);
+			pos = Command2Action_.constFind ("ctcp_rpl");
 		else if (opts.Command_ == "notice" && IsCTCPMessage (opts.Message_))
-			Command2Action_ ["ctcp_rqst"] (opts);
-		else if (Command2Action_.contains (opts.Command_))
-			Command2Action_ [opts.Command_] (opts);
+			pos = Command2Action_.constFind ("ctcp_rqst");
+
+		if (pos != Command2Action_.constEnd ())
+			(*pos) (opts);
 		else
 			ISH_->ShowAnswer ("UNKNOWN CMD " + opts.Command_, opts.Message_);
 	}
@@ -399,7 +424,7 @@ namespace Acetamide
 
 	void ServerResponseManager::GotSetAway (const IrcMessageOptions& opts)
 	{
-		switch (opts.Command_.toInt ())
+		switch (opts.Numeric_)
 		{
 		case 305:
 			ISH_->ChangeAway (false);
@@ -992,28 +1017,28 @@ namespace Acetamide
 		case IrcServer::UnknownServer:
 			break;
 		case IrcServer::UnrealIRCD:
-			Command2Action_ ["307"] = [this] (const IrcMessageOptions& opts)
+			Numeric2Action_ [307] = [this] (const IrcMessageOptions& opts)
 				{
 					WhoIsMessage msg;
 					msg.Nick_ = QString::fromStdString (opts.Parameters_ [1]);
 					msg.IsRegistered_ = opts.Message_;
 					ISH_->ShowWhoIsReply (msg);
 				};
-			Command2Action_ ["310"] = [this] (const IrcMessageOptions& opts)
+			Numeric2Action_ [310] = [this] (const IrcMessageOptions& opts)
 				{
 					WhoIsMessage msg;
 					msg.Nick_ = QString::fromStdString (opts.Parameters_ [1]);
 					msg.IsHelpOp_ = opts.Message_;
 					ISH_->ShowWhoIsReply (msg);
 				};
-			Command2Action_ ["320"] = [this] (const IrcMessageOptions& opts)
+			Numeric2Action_ [320] = [this] (const IrcMessageOptions& opts)
 				{
 					WhoIsMessage msg;
 					msg.Nick_ = QString::fromStdString (opts.Parameters_ [1]);
 					msg.Mail_ = opts.Message_;
 					ISH_->ShowWhoIsReply (msg);
 				};
-			Command2Action_ ["378"] = [this] (const IrcMessageOptions& opts)
+			Numeric2Action_ [378] = [this] (const IrcMessageOptions& opts)
 				{
 					WhoIsMessage msg;
 					msg.Nick_ = QString::fromStdString (opts.Parameters_ [1]);
@@ -31,6 +31,7 @@
 
 #include <functional>
 #include <string>
+#include <vector>
 #include <QObject>
 #include <QHash>
 #include <QMap>
@@ -49,7 +50,13 @@ namespace Acetamide
 		Q_OBJECT
 
 		IrcServerHandler *ISH_;
-		QHash<QString, std::function<void (IrcMessageOptions)>> Command2Action_;
+		typedef std::function<void (const IrcMessageOptions&)> Action_f;
+
+		QHash<QString, Action_f> Command2Action_;
+
+		/** Actions for the numeric replies, indexed by the reply code.
+		 */
+		std::vector<Action_f> Numeric2Action_;
 		QMap<QString, IrcServer> MatchString2Server_;
 	public:
 		ServerResponseManager (IrcServerHandler*);
@@ -280,6 +280,86 @@ namespace AdiumStyles
 
 	bool AdiumStyleSource::AppendMessage (QWebFrame *frame,
 			QObject *msgObj, const ChatMsgAppendInfo& info)
+	{
+		return AppendMessages (frame, { { msgObj, info } });
+	}
+
+	bool AdiumStyleSource::AppendMessages (QWebFrame *frame, const QList<ChatMsgAppendItem>& items)
+	{
+		bool result = true;
+
+		QString commands;
+		QList<PreparedMessage> prepared;
+		for (const auto& item : items)
+		{
+			const auto& maybePrepared = PrepareMessage (frame, item.Message_, item.Info_);
+			if (!maybePrepared)
+			{
+				result = false;
+				continue;
+			}
+
+			commands += maybePrepared->Command_;
+			prepared << *maybePrepared;
+		}
+
+		if (commands.isEmpty ())
+			return result;
+
+		frame->evaluateJavaScript (commands);
+
+		for (const auto& msg : prepared)
+		{
+			if (msg.StateSelector_.isEmpty ())
+				continue;
+
+			QWebElement elem = frame->findFirstElement (msg.StateSelector_);
+			elem.setInnerXml (msg.StateReplacement_);
+		}
+
+		return result;
+	}
+
+	bool AdiumStyleSource::PrependMessages (QWebFrame *frame, const QList<ChatMsgAppendItem>& items)
+	{
+		if (items.isEmpty ())
+			return true;
+
+		// Adium templates only know how to append to the #Chat element, so
+		// the already shown messages are moved away for a while, and the
+		// older ones are appended to the emptied element. The last contact
+		// is saved as well so that the newer messages are continued from
+		// the right one.
+		const bool hadLastContact = Frame2LastContact_.contains (frame);
+		const auto lastContact = Frame2LastContact_.take (frame);
+
+		frame->evaluateJavaScript ("var azothChat = document.getElementById('Chat');"
+				"var azothNewer = document.createDocumentFragment();"
+				"while (azothChat && azothChat.firstChild)"
+				"	azothNewer.appendChild(azothChat.firstChild);");
+
+		const auto result = AppendMessages (frame, items);
+
+		// The insertion point of the older batch shall not be picked by
+		// appendNextMessage(), the one of the newer messages should.
+		frame->evaluateJavaScript ("if (azothChat)"
+				"{"
+				"	var azothInsert = document.getElementById('insert');"
+				"	if (azothInsert)"
+				"		azothInsert.parentNode.removeChild(azothInsert);"
+				"	azothChat.appendChild(azothNewer);"
+				"}");
+
+		if (hadLastContact)
+			Frame2LastContact_ [frame] = lastContact;
+		else
+			Frame2LastContact_.remove (frame);
+
+		return result;
+	}
+
+	boost::optional<AdiumStyleSource::PreparedMessage> AdiumStyleSource::PrepareMessage (QWebFrame *frame,
+			QObject *msgObj, const ChatMsgAppendInfo& info)
 	{
 		IMessage *msg = qobject_cast<IMessage*> (msgObj);
 		if (!msg)
@@ -287,7 +367,7 @@ namespace AdiumStyles
 			qWarning () << Q_FUNC_INFO
 					<< msgObj
 					<< "doesn't implement IMessage";
-			return false;
+			return {};
 		}
 
 		const QString& pack = Frame2Pack_ [frame];
@@ -297,7 +377,7 @@ namespace AdiumStyles
 					<< "empty pack for"
 					<< msgObj
 					<< msg->OtherPart ();
-			return false;
+			return {};
 		}
 
 		connect (msgObj,
@@ -359,7 +439,7 @@ namespace AdiumStyles
 					<< "unable to load content template for"
 					<< pack
 					<< prefix;
-			return false;
+			return {};
 		}
 
 		if (!content->open (QIODevice::ReadOnly))
@@ -369,7 +449,7 @@ namespace AdiumStyles
 					<< pack
 					<< prefix
 					<< content->errorString ();
-			return false;
+			return {};
 		}
 
 		QString templ = QString::fromUtf8 (content->readAll ());
@@ -403,7 +483,8 @@ namespace AdiumStyles
 		}
 
 		const QString& command = isNextMsg ? "appendNextMessage(\"%1\");" : "appendMessage(\"%1\");";
-		frame->evaluateJavaScript (command.arg (body));
+
+		PreparedMessage result { command.arg (body), {}, {} };
 
 		if (templ.contains ("%stateElementId%"))
 		{
@@ -427,13 +508,12 @@ namespace AdiumStyles
 			if (stateContent && stateContent->open (QIODevice::ReadOnly))
 				replacement = QString::fromUtf8 (stateContent->readAll ());
 
-			const QString& selector = QString ("*[id=\"delivery_state_%1\"]")
+			result.StateSelector_ = QString ("*[id=\"delivery_state_%1\"]")
 					.arg (GetMessageID (msgObj));
-			QWebElement elem = frame->findFirstElement (selector);
-			elem.setInnerXml (replacement);
+			result.StateReplacement_ = replacement;
 		}
 
-		return true;
+		return result;
 	}
 
 	void AdiumStyleSource::FrameFocused (QWebFrame*)
@@ -30,6 +30,7 @@
 #pragma once
 
 #include <memory>
+#include <boost/optional.hpp>
 #include <QObject>
 #include <QDateTime>
 #include <QHash>
@@ -73,6 +74,14 @@ namespace AdiumStyles
 		QHash<QObject*, QWebFrame*> Msg2Frame_;
 
 		mutable QHash<QWebFrame*, QObject*> Frame2LastContact_;
+
+		struct PreparedMessage
+		{
+			QString Command_;
+
+			QString StateSelector_;
+			QString StateReplacement_;
+		};
 	public:
 		AdiumStyleSource (IProxyObject*, QObject* = 0);
 
@@ -81,6 +90,8 @@ namespace AdiumStyles
 		QString GetHTMLTemplate (const QString&,
 				const QString&, QObject*, QWebFrame*) const;
 		bool AppendMessage (QWebFrame*, QObject*, const ChatMsgAppendInfo&);
+		bool AppendMessages (QWebFrame*, const QList<ChatMsgAppendItem>&);
+		bool PrependMessages (QWebFrame*, const QList<ChatMsgAppendItem>&);
 		void FrameFocused (QWebFrame*);
 		QStringList GetVariantsForPack (const QString&);
 	private:
@@ -90,6 +101,8 @@ namespace AdiumStyles
 		QString ParseMsgTemplate (QString templ, const QString& path,
 				QWebFrame*, QObject*, const ChatMsgAppendInfo&);
 		QString GetMessageID (QObject*);
+
+		boost::optional<PreparedMessage> PrepareMessage (QWebFrame*, QObject*, const ChatMsgAppendInfo&);
 	private slots:
 		void handleMessageDelivered ();
 		void handleMessageDestroyed ();
@@ -141,9 +141,93 @@ namespace StandardStyles
 
 	bool StandardStyleSource::AppendMessage (QWebFrame *frame,
 			QObject *msgObj, const ChatMsgAppendInfo& info)
+	{
+		return AppendMessages (frame, { { msgObj, info } });
+	}
+
+	namespace
+	{
+		const QString LastSeparator = "<hr class=\"lastSeparator\" />";
+	}
+
+	StandardStyleSource::AppendContext StandardStyleSource::MakeAppendContext (QWebFrame *frame)
 	{
 		QObject *azothSettings = Proxy_->GetSettingsManager ();
-		const auto& colors = CreateColors (frame->metaData ().value ("coloring"), frame);
+		return
+		{
+			CreateColors (frame->metaData ().value ("coloring"), frame),
+			azothSettings->property ("PreNickText").toString (),
+			azothSettings->property ("PostNickText").toString (),
+			azothSettings->property ("ShowNormalChatResources").toBool ()
+		};
+	}
+
+	bool StandardStyleSource::AppendMessages (QWebFrame *frame, const QList<ChatMsgAppendItem>& items)
+	{
+		if (items.isEmpty ())
+			return true;
+
+		const auto& ctx = MakeAppendContext (frame);
+
+		QWebElement elem = frame->findFirstElement ("body");
+
+		QString html;
+		int separatorPos = -1;
+		for (const auto& item : items)
+		{
+			bool needsSeparator = false;
+			const auto& string = FormatMessage (frame, item.Message_, item.Info_, ctx, needsSeparator);
+
+			if (needsSeparator)
+			{
+				if (separatorPos >= 0)
+					html.remove (separatorPos, LastSeparator.size ());
+				else
+				{
+					auto hr = elem.findFirst ("hr[class=\"lastSeparator\"]");
+					if (!hr.isNull ())
+						hr.removeFromDocument ();
+				}
+
+				separatorPos = html.size ();
+				html += LastSeparator;
+			}
+
+			html += string;
+		}
+
+		elem.appendInside (html);
+		return true;
+	}
+
+	bool StandardStyleSource::PrependMessages (QWebFrame *frame, const QList<ChatMsgAppendItem>& items)
+	{
+		if (items.isEmpty ())
+			return true;
+
+		const auto& ctx = MakeAppendContext (frame);
+
+		// Older messages never get the unread separator, and they
+		// shouldn't affect it for the newer ones either.
+		const auto wasLastRead = IsLastMsgRead_.value (frame, false);
+
+		QString html;
+		for (const auto& item : items)
+		{
+			bool needsSeparator = false;
+			html += FormatMessage (frame, item.Message_, item.Info_, ctx, needsSeparator);
+		}
+
+		IsLastMsgRead_ [frame] = wasLastRead;
+
+		frame->findFirstElement ("body").prependInside (html);
+		return true;
+	}
+
+	QString StandardStyleSource::FormatMessage (QWebFrame *frame, QObject *msgObj,
+			const ChatMsgAppendInfo& info, const AppendContext& ctx, bool& needsSeparator)
+	{
+		const auto& colors = ctx.Colors_;
 		auto& formatter = Proxy_->GetFormatterProxy ();
 
 		const QString& msgId = GetMessageID (msgObj);
@@ -154,7 +238,7 @@ namespace StandardStyles
 				other->GetEntryName ().toHtmlEscaped () :
 				QString ();
 		if (msg->GetMessageType () == IMessage::Type::ChatMessage &&
-				Proxy_->GetSettingsManager ()->property ("ShowNormalChatResources").toBool () &&
+				ctx.ShowResources_ &&
 				!msg->GetOtherVariant ().isEmpty ())
 			entryName += '/' + msg->GetOtherVariant ();
 
@@ -196,11 +280,9 @@ namespace StandardStyles
 		const QString dateEnd ("</span>");
 
 		const QString& preNick =
-				WrapNickPart (azothSettings->property ("PreNickText").toString (),
-						nickColor, msg->GetMessageType ());
+				WrapNickPart (ctx.PreNick_, nickColor, msg->GetMessageType ());
 		const QString& postNick =
-				WrapNickPart (azothSettings->property ("PostNickText").toString (),
-						nickColor, msg->GetMessageType ());
+				WrapNickPart (ctx.PostNick_, nickColor, msg->GetMessageType ());
 
 		QString divClass;
 		QString statusIconName;
@@ -309,27 +391,18 @@ namespace StandardStyles
 					.arg (msgId));
 		string.append (body);
 
-		QWebElement elem = frame->findFirstElement ("body");
-
 		if (msg->GetMessageType () == IMessage::Type::ChatMessage ||
 			msg->GetMessageType () == IMessage::Type::MUCMessage)
 		{
 			const auto isRead = Proxy_->IsMessageRead (msgObj);
-			if (!info.IsActiveChat_ &&
-					!isRead && IsLastMsgRead_.value (frame, false))
-			{
-				auto hr = elem.findFirst ("hr[class=\"lastSeparator\"]");
-				if (!hr.isNull ())
-					hr.removeFromDocument ();
-				elem.appendInside ("<hr class=\"lastSeparator\" />");
-			}
+			needsSeparator = !info.IsActiveChat_ &&
+					!isRead && IsLastMsgRead_.value (frame, false);
 			IsLastMsgRead_ [frame] = isRead;
 		}
 
-		elem.appendInside (QString ("<div class='%1' style='word-wrap: break-word;'>%2</div>")
+		return QString ("<div class='%1' style='word-wrap: break-word;'>%2</div>")
 					.arg (divClass)
-					.arg (string));
-		return true;
+					.arg (string);
 	}
 
 	void StandardStyleSource::FrameFocused (QWebFrame *frame)
@@ -65,6 +65,14 @@ namespace StandardStyles
 		mutable QString LastPack_;
 
 		QHash<QObject*, QWebFrame*> Msg2Frame_;
+
+		struct AppendContext
+		{
+			QList<QColor> Colors_;
+			QString PreNick_;
+			QString PostNick_;
+			bool ShowResources_;
+		};
 	public:
 		StandardStyleSource (IProxyObject*, QObject* = 0);
 
@@ -73,10 +81,15 @@ namespace StandardStyles
 		QString GetHTMLTemplate (const QString&,
 				const QString&, QObject*, QWebFrame*) const;
 		bool AppendMessage (QWebFrame*, QObject*, const ChatMsgAppendInfo&);
+		bool AppendMessages (QWebFrame*, const QList<ChatMsgAppendItem>&);
+		bool PrependMessages (QWebFrame*, const QList<ChatMsgAppendItem>&);
 		void FrameFocused (QWebFrame*);
 		QStringList GetVariantsForPack (const QString&);
 	private:
 		QList<QColor> CreateColors (const QString&, QWebFrame*);
+		AppendContext MakeAppendContext (QWebFrame*);
+		QString FormatMessage (QWebFrame*, QObject*, const ChatMsgAppendInfo&,
+				const AppendContext&, bool& needsSeparator);
 		QString GetMessageID (QObject*);
 		QString GetStatusImage (const QString&);
 	private slots:
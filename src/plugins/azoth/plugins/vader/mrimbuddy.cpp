@@ -35,8 +35,8 @@
 #include <util/sll/functional.h>
 #include <util/xpc/util.h>
 #include <util/threads/futures.h>
+#include <xmlsettingsdialog/basesettingsmanager.h>
 #include <interfaces/core/ientitymanager.h>
-#include <interfaces/azoth/azothutil.h>
 #include <interfaces/azoth/iproxyobject.h>
 #include "proto/headers.h"
 #include "proto/connection.h"
@@ -91,6 +91,11 @@ namespace Vader
 		};
 
 		UpdateClientVersion ();
+
+		const auto xsm = acc->GetParentProtocol ()->GetAzothProxy ()->GetSettingsManager ();
+		qobject_cast<Util::BaseSettingsManager*> (xsm)->RegisterObject ("MessageRetentionLimit",
+				this, "handleMessageRetentionLimitChanged");
+		handleMessageRetentionLimitChanged ();
 	}
 
 	void MRIMBuddy::HandleMessage (MRIMMessage *msg)
@@ -324,14 +329,12 @@ namespace Vader
 
 	QList<IMessage*> MRIMBuddy::GetAllMessages () const
 	{
-		QList<IMessage*> result;
-		std::copy (AllMessages_.begin (), AllMessages_.end (), std::back_inserter (result));
-		return result;
+		return AllMessages_.GetIMessages ();
 	}
 
 	void MRIMBuddy::PurgeMessages (const QDateTime& before)
 	{
-		AzothUtil::StandardPurgeMessages (AllMessages_, before);
+		AllMessages_.Purge (before);
 	}
 
 	void MRIMBuddy::SetChatPartState (ChatPartState state, const QString&)
@@ -407,6 +410,11 @@ namespace Vader
 		return false;
 	}
 
+	bool MRIMBuddy::HasDroppedMessages () const
+	{
+		return AllMessages_.HasEvicted ();
+	}
+
 	void MRIMBuddy::UpdateClientVersion ()
 	{
 		auto defClient = [this] ()
@@ -512,6 +520,12 @@ namespace Vader
 						.arg (SentSMS_.take (seq)),
 				PCritical_));
 	}
+
+	void MRIMBuddy::handleMessageRetentionLimitChanged ()
+	{
+		const auto xsm = A_->GetParentProtocol ()->GetAzothProxy ()->GetSettingsManager ();
+		AllMessages_.SetCapacity (xsm->property ("MessageRetentionLimit").toInt ());
+	}
 }
 }
 }
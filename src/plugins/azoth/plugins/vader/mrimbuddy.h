@@ -37,6 +37,8 @@
 #include <interfaces/azoth/iadvancedclentry.h>
 #include <interfaces/azoth/ihavecontacttune.h>
 #include <interfaces/azoth/ihaveavatars.h>
+#include <interfaces/azoth/ihavemessageretention.h>
+#include <interfaces/azoth/messagering.h>
 #include "mrimaccount.h"
 #include "proto/contactinfo.h"
 
@@ -55,19 +57,21 @@ namespace Vader
 						  , public IHaveAvatars
 						  , public IHaveContactTune
 						  , public IAdvancedCLEntry
+						  , public IHaveMessageRetention
 	{
 		Q_OBJECT
 		Q_INTERFACES (LeechCraft::Azoth::ICLEntry
 				LeechCraft::Azoth::IHaveAvatars
 				LeechCraft::Azoth::IHaveContactTune
-				LeechCraft::Azoth::IAdvancedCLEntry)
+				LeechCraft::Azoth::IAdvancedCLEntry
+				LeechCraft::Azoth::IHaveMessageRetention)
 
 		MRIMAccount *A_;
 		Proto::ContactInfo Info_;
 		QString Group_;
 
 		EntryStatus Status_;
-		QList<MRIMMessage*> AllMessages_;
+		MessageRing<MRIMMessage> AllMessages_;
 		bool IsAuthorized_ = true;
 		bool GaveSubscription_ = true;
 
@@ -151,6 +155,9 @@ namespace Vader
 		QFuture<QImage> RefreshAvatar (Size);
 		bool HasAvatar () const;
 		bool SupportsSize (Size) const;
+
+		// IHaveMessageRetention
+		bool HasDroppedMessages () const;
 	private:
 		void UpdateClientVersion ();
 	private slots:
@@ -160,6 +167,8 @@ namespace Vader
 		void handleSMSDelivered (quint32);
 		void handleSMSServUnavail (quint32);
 		void handleSMSBadParms (quint32);
+
+		void handleMessageRetentionLimitChanged ();
 	signals:
 		void gotMessage (QObject*);
 		void statusChanged (const EntryStatus&, const QString&);
@@ -49,8 +49,8 @@
 #include <util/sll/qtutil.h>
 #include <util/sll/delayedexecutor.h>
 #include <util/threads/futures.h>
+#include <xmlsettingsdialog/basesettingsmanager.h>
 #include <interfaces/azoth/iproxyobject.h>
-#include <interfaces/azoth/azothutil.h>
 #include "glooxmessage.h"
 #include "glooxclentry.h"
 #include "glooxprotocol.h"
@@ -109,11 +109,18 @@ namespace Xoox
 				SIGNAL (triggered ()),
 				this,
 				SLOT (handleDetectNick ()));
+
+		AllMessages_.SetEvictHandler ([this] (GlooxMessage *msg) { UnreadMessages_.removeOne (msg); });
+
+		const auto xsm = parent->GetParentProtocol ()->GetProxyObject ()->GetSettingsManager ();
+		qobject_cast<Util::BaseSettingsManager*> (xsm)->RegisterObject ("MessageRetentionLimit",
+				this, "handleMessageRetentionLimitChanged");
+		handleMessageRetentionLimitChanged ();
 	}
 
 	EntryBase::~EntryBase ()
 	{
-		qDeleteAll (AllMessages_);
+		AllMessages_.DeleteAll ();
 		qDeleteAll (Actions_);
 		delete VCardDialog_;
 	}
@@ -130,14 +137,12 @@ namespace Xoox
 
 	QList<IMessage*> EntryBase::GetAllMessages () const
 	{
-		QList<IMessage*> result;
-		std::copy (AllMessages_.begin (), AllMessages_.end (), std::back_inserter (result));
-		return result;
+		return AllMessages_.GetIMessages ();
 	}
 
 	void EntryBase::PurgeMessages (const QDateTime& before)
 	{
-		AzothUtil::StandardPurgeMessages (AllMessages_, before);
+		AllMessages_.Purge (before);
 	}
 
 	namespace
@@ -564,6 +569,11 @@ namespace Xoox
 		return new PendingVersionQuery { vm, jid, this };
 	}
 
+	bool EntryBase::HasDroppedMessages () const
+	{
+		return AllMessages_.HasEvicted ();
+	}
+
 	const QByteArray& EntryBase::GetVCardPhotoHash () const
 	{
 		return VCardPhotoHash_;
@@ -1072,6 +1082,12 @@ namespace Xoox
 		emit entityTimeUpdated ();
 	}
 
+	void EntryBase::handleMessageRetentionLimitChanged ()
+	{
+		const auto xsm = Account_->GetParentProtocol ()->GetProxyObject ()->GetSettingsManager ();
+		AllMessages_.SetCapacity (xsm->property ("MessageRetentionLimit").toInt ());
+	}
+
 	void EntryBase::handleCommands ()
 	{
 		auto jid = GetJID ();
@@ -47,12 +47,14 @@
 #include <interfaces/azoth/ihaveentitytime.h>
 #include <interfaces/azoth/ihavepings.h>
 #include <interfaces/azoth/ihavequeriableversion.h>
+#include <interfaces/azoth/ihavemessageretention.h>
 #include <interfaces/azoth/ihavecontacttune.h>
 #include <interfaces/azoth/ihavecontactmood.h>
 #include <interfaces/azoth/ihavecontactactivity.h>
 #include <interfaces/azoth/ihaveavatars.h>
 #include <interfaces/azoth/moodinfo.h>
 #include <interfaces/azoth/activityinfo.h>
+#include <interfaces/azoth/messagering.h>
 #include "glooxaccount.h"
 
 class QXmppPresence;
@@ -94,6 +96,7 @@ namespace Xoox
 					, public IHaveEntityTime
 					, public IHavePings
 					, public IHaveQueriableVersion
+					, public IHaveMessageRetention
 	{
 		Q_OBJECT
 		Q_INTERFACES (LeechCraft::Azoth::ICLEntry
@@ -107,13 +110,14 @@ namespace Xoox
 				LeechCraft::Azoth::IHaveContactActivity
 				LeechCraft::Azoth::IHaveEntityTime
 				LeechCraft::Azoth::IHavePings
-				LeechCraft::Azoth::IHaveQueriableVersion)
+				LeechCraft::Azoth::IHaveQueriableVersion
+				LeechCraft::Azoth::IHaveMessageRetention)
 	protected:
 		GlooxAccount *Account_;
 
 		const QString HumanReadableId_;
 
-		QList<GlooxMessage*> AllMessages_;
+		MessageRing<GlooxMessage> AllMessages_;
 		QList<GlooxMessage*> UnreadMessages_;
 		QMap<QString, EntryStatus> CurrentStatus_;
 		QList<QAction*> Actions_;
@@ -201,6 +205,9 @@ namespace Xoox
 		// IHaveQueriableVersion
 		QObject* QueryVersion (const QString& variant);
 
+		// IHaveMessageRetention
+		bool HasDroppedMessages () const;
+
 		const QByteArray& GetVCardPhotoHash () const;
 
 		virtual QString GetJID () const = 0;
@@ -243,6 +250,8 @@ namespace Xoox
 
 		void handleCommands ();
 		void handleDetectNick ();
+
+		void handleMessageRetentionLimitChanged ();
 	signals:
 		void gotMessage (QObject*);
 		void statusChanged (const EntryStatus&, const QString&);
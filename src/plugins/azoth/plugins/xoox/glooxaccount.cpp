@@ -1156,13 +1156,19 @@ namespace Xoox
 
 	void GlooxAccount::handleEntryRemoved (QObject *entry)
 	{
-		emit removedCLItems ({ entry });
+		handleEntriesRemoved ({ entry });
+	}
 
-		if (ExistingEntry2JoinConflict_.contains (entry))
-		{
-			const auto& pair = ExistingEntry2JoinConflict_.take (entry);
-			JoinRoom (pair.first, pair.second, {});
-		}
+	void GlooxAccount::handleEntriesRemoved (const QList<QObject*>& entries)
+	{
+		emit removedCLItems (entries);
+
+		for (const auto entry : entries)
+			if (ExistingEntry2JoinConflict_.contains (entry))
+			{
+				const auto& pair = ExistingEntry2JoinConflict_.take (entry);
+				JoinRoom (pair.first, pair.second, {});
+			}
 	}
 
 	void GlooxAccount::handleGotRosterItems (const QList<QObject*>& items)
@@ -288,6 +288,7 @@ namespace Xoox
 		QString GetDefaultReqHost () const;
 	public slots:
 		void handleEntryRemoved (QObject*);
+		void handleEntriesRemoved (const QList<QObject*>&);
 		void handleGotRosterItems (const QList<QObject*>&);
 	private slots:
 		void regenAccountIcon (const QString&);
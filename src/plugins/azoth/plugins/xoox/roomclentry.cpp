@@ -33,8 +33,8 @@
 #include <QXmppBookmarkManager.h>
 #include <QXmppDiscoveryManager.h>
 #include <util/sll/prelude.h>
+#include <xmlsettingsdialog/basesettingsmanager.h>
 #include <interfaces/azoth/iproxyobject.h>
-#include <interfaces/azoth/azothutil.h>
 #include "glooxaccount.h"
 #include "glooxprotocol.h"
 #include "roompublicmessage.h"
@@ -129,6 +129,11 @@ namespace Xoox
 				SIGNAL (bookmarksReceived (QXmppBookmarkSet)),
 				this,
 				SLOT (handleBookmarks (QXmppBookmarkSet)));
+
+		const auto xsm = Account_->GetParentProtocol ()->GetProxyObject ()->GetSettingsManager ();
+		qobject_cast<Util::BaseSettingsManager*> (xsm)->RegisterObject ("MessageRetentionLimit",
+				this, "handleMessageRetentionLimitChanged");
+		handleMessageRetentionLimitChanged ();
 	}
 
 	RoomHandler* RoomCLEntry::GetRoomHandler () const
@@ -204,12 +209,12 @@ namespace Xoox
 
 	QList<IMessage*> RoomCLEntry::GetAllMessages () const
 	{
-		return AllMessages_;
+		return AllMessages_.GetIMessages ();
 	}
 
 	void RoomCLEntry::PurgeMessages (const QDateTime& before)
 	{
-		AzothUtil::StandardPurgeMessages (AllMessages_, before);
+		AllMessages_.Purge (before);
 	}
 
 	void RoomCLEntry::SetChatPartState (ChatPartState, const QString&)
@@ -594,6 +599,11 @@ namespace Xoox
 		conn->GetClient ()->sendPacket (pres);
 	}
 
+	bool RoomCLEntry::HasDroppedMessages () const
+	{
+		return AllMessages_.HasEvicted ();
+	}
+
 	void RoomCLEntry::MoveMessages (const RoomParticipantEntry_ptr& from, const RoomParticipantEntry_ptr& to)
 	{
 		for (const auto msgFace : AllMessages_)
@@ -637,6 +647,12 @@ namespace Xoox
 	{
 		emit statusChanged (status, QString ());
 	}
+
+	void RoomCLEntry::handleMessageRetentionLimitChanged ()
+	{
+		const auto xsm = Account_->GetParentProtocol ()->GetProxyObject ()->GetSettingsManager ();
+		AllMessages_.SetCapacity (xsm->property ("MessageRetentionLimit").toInt ());
+	}
 }
 }
 }
@@ -37,6 +37,8 @@
 #include <interfaces/azoth/imucentry.h>
 #include <interfaces/azoth/imucperms.h>
 #include <interfaces/azoth/iconfigurablemuc.h>
+#include <interfaces/azoth/ihavemessageretention.h>
+#include <interfaces/azoth/messagering.h>
 #include "roomparticipantentry.h"
 #include "glooxaccount.h"
 
@@ -57,19 +59,21 @@ namespace Xoox
 					  , public IMUCPerms
 					  , public IConfigurableMUC
 					  , public IHaveDirectedStatus
+					  , public IHaveMessageRetention
 	{
 		Q_OBJECT
 		Q_INTERFACES (LeechCraft::Azoth::ICLEntry
 						LeechCraft::Azoth::IMUCEntry
 						LeechCraft::Azoth::IMUCPerms
 						LeechCraft::Azoth::IConfigurableMUC
-						LeechCraft::Azoth::IHaveDirectedStatus)
+						LeechCraft::Azoth::IHaveDirectedStatus
+						LeechCraft::Azoth::IHaveMessageRetention)
 
 		friend class RoomHandler;
 
 		const bool IsAutojoined_;
 		GlooxAccount *Account_;
-		QList<IMessage*> AllMessages_;
+		MessageRing<IMessage> AllMessages_;
 		RoomHandler *RH_;
 
 		const QMap<QByteArray, QList<QByteArray>> Perms_;
@@ -144,6 +148,9 @@ namespace Xoox
 		bool CanSendDirectedStatusNow (const QString&);
 		void SendDirectedStatus (const EntryStatus&, const QString&);
 
+		// IHaveMessageRetention
+		bool HasDroppedMessages () const;
+
 		void MoveMessages (const RoomParticipantEntry_ptr& from, const RoomParticipantEntry_ptr& to);
 
 		void HandleMessage (RoomPublicMessage*);
@@ -152,6 +159,7 @@ namespace Xoox
 	private slots:
 		void handleBookmarks (const QXmppBookmarkSet&);
 		void reemitStatusChange (const EntryStatus&);
+		void handleMessageRetentionLimitChanged ();
 	signals:
 		void gotMessage (QObject*);
 		void statusChanged (const EntryStatus&, const QString&);
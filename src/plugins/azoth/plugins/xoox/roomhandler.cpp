@@ -60,6 +60,14 @@ namespace Xoox
 {
 	const QString NSData = "jabber:x:data";
 
+	namespace
+	{
+		/** If more participants than this leave at once, a single
+		 * summary message is posted instead of a message per each one.
+		 */
+		const int MassLeaveThreshold = 5;
+	}
+
 	RoomHandler::RoomHandler (const QString& jid,
 			const QString& ourNick,
 			bool asAutojoin,
@@ -70,6 +78,7 @@ namespace Xoox
 	, Room_ (MUCManager_->addRoom (jid))
 	, CLEntry_ (new RoomCLEntry (this, asAutojoin, Account_))
 	, HadRequestedPassword_ (false)
+	, IsJoining_ (true)
 	{
 		const QString& server = jid.split ('@', QString::SkipEmptyParts).value (1);
 		auto sdManager = Account_->GetClientConnection ()->GetSDManager ();
@@ -511,6 +520,7 @@ namespace Xoox
 		if (Room_->isJoined ())
 			return;
 
+		IsJoining_ = true;
 		Room_->join ();
 	}
 
@@ -521,8 +531,14 @@ namespace Xoox
 
 	void RoomHandler::Leave (const QString& msg, bool remove)
 	{
+		QList<QObject*> removed;
 		for (const auto& entry : Nick2Entry_)
-			Account_->handleEntryRemoved (entry.get ());
+			if (!ForgetPendingJoin (entry.get ()))
+				removed << entry.get ();
+		Account_->handleEntriesRemoved (removed);
+
+		PendingLeaves_.clear ();
+		IsJoining_ = false;
 
 		Room_->leave (msg);
 		Nick2Entry_.clear ();
@@ -622,6 +638,9 @@ namespace Xoox
 		QString nick;
 		ClientConnection::Split (jid, 0, &nick);
 
+		if (!PendingLeaves_.isEmpty ())
+			FlushPendingLeaves ();
+
 		const bool existed = Nick2Entry_.contains (nick);
 
 		const auto& entry = GetParticipantEntry (nick, false);
@@ -637,6 +656,17 @@ namespace Xoox
 
 		entry->HandlePresence (pres, {});
 
+		if (IsJoining_)
+		{
+			if (!existed)
+				PendingJoins_ << entry;
+
+			// Our own presence finishes the initial presence burst.
+			if (nick == Room_->nickName ())
+				FlushPendingJoins ();
+			return;
+		}
+
 		if (!existed)
 			Account_->handleGotRosterItems ({ entry.get () });
 
@@ -650,6 +680,9 @@ namespace Xoox
 		QString nick;
 		ClientConnection::Split (jid, 0, &nick);
 
+		if (!PendingLeaves_.isEmpty ())
+			FlushPendingLeaves ();
+
 		const auto& entry = GetParticipantEntry (nick);
 
 		entry->HandlePresence (pres, QString ());
@@ -674,8 +707,21 @@ namespace Xoox
 		const auto& entry = GetParticipantEntry (nick);
 		const auto& item = pres.mucItem ();
 		const auto& reason = item.reason ();
-		if (!item.nick ().isEmpty () &&
-				item.nick () != nick)
+
+		const bool isRename = !item.nick ().isEmpty () && item.nick () != nick;
+		const auto& codes = pres.mucStatusCodes ();
+		if (!us && !isRename && !codes.contains (301) && !codes.contains (307))
+		{
+			if (PendingLeaves_.isEmpty ())
+				new Util::DelayedExecutor { [this] { FlushPendingLeaves (); }, 0, this };
+			PendingLeaves_.append ({ nick, pres.statusText () });
+			return;
+		}
+
+		if (!PendingLeaves_.isEmpty ())
+			FlushPendingLeaves ();
+
+		if (isRename)
 		{
 			HandleRenameStart (entry, nick, item.nick ());
 			return;
@@ -691,14 +737,7 @@ namespace Xoox
 		else
 			MakeLeaveMessage (pres, nick);
 
-		const auto checkRejoin = Util::MakeScopeGuard ([this]
-				{
-					if (Nick2Entry_.isEmpty () ||
-							std::all_of (Nick2Entry_.begin (), Nick2Entry_.end (),
-									[] (const RoomParticipantEntry_ptr& entry)
-										{ return entry->GetStatus ({}).State_ == SOffline; }))
-						new Util::DelayedExecutor { [this] { Join (); }, 5000, this };
-				});
+		const auto checkRejoin = Util::MakeScopeGuard ([this] { CheckRejoin (); });
 
 		if (us)
 		{
@@ -761,10 +800,107 @@ namespace Xoox
 
 	void RoomHandler::RemoveEntry (RoomParticipantEntry *entry)
 	{
-		Account_->handleEntryRemoved (entry);
+		if (!ForgetPendingJoin (entry))
+			Account_->handleEntryRemoved (entry);
 		Nick2Entry_.remove (entry->GetNick ());
 	}
 
+	void RoomHandler::FlushPendingJoins ()
+	{
+		IsJoining_ = false;
+
+		QList<QObject*> announced;
+		for (const auto& entry : PendingJoins_)
+			if (Nick2Entry_.value (entry->GetNick ()) == entry)
+				announced << entry.get ();
+		PendingJoins_.clear ();
+
+		if (announced.isEmpty ())
+			return;
+
+		Account_->handleGotRosterItems (announced);
+
+		const auto message = new RoomPublicMessage (tr ("%n participant(s) in the room.", 0, announced.size ()),
+				IMessage::Direction::In,
+				CLEntry_,
+				IMessage::Type::StatusMessage,
+				IMessage::SubType::ParticipantJoin);
+		CLEntry_->HandleMessage (message);
+	}
+
+	void RoomHandler::FlushPendingLeaves ()
+	{
+		const auto leaves = PendingLeaves_;
+		PendingLeaves_.clear ();
+
+		if (leaves.isEmpty ())
+			return;
+
+		QList<RoomParticipantEntry_ptr> left;
+		for (const auto& leave : leaves)
+			if (const auto& entry = Nick2Entry_.value (leave.Nick_))
+				left << entry;
+
+		if (leaves.size () <= MassLeaveThreshold)
+			for (const auto& leave : leaves)
+			{
+				QXmppPresence pres { QXmppPresence::Unavailable };
+				pres.setStatusText (leave.Status_);
+				MakeLeaveMessage (pres, leave.Nick_);
+			}
+		else
+		{
+			const auto& nicks = Util::Map (leaves, &PendingLeave::Nick_);
+			const auto message = new RoomPublicMessage (tr ("%n participant(s) have left the room: %1", 0, nicks.size ())
+						.arg (QStringList { nicks }.join (", ")),
+					IMessage::Direction::In,
+					CLEntry_,
+					IMessage::Type::StatusMessage,
+					IMessage::SubType::ParticipantLeave);
+			CLEntry_->HandleMessage (message);
+		}
+
+		QList<QObject*> removed;
+		for (const auto& entry : left)
+		{
+			if (entry->HasUnreadMsgs ())
+			{
+				entry->SetStatus (EntryStatus (SOffline, {}),
+						QString (), QXmppPresence (QXmppPresence::Unavailable));
+				continue;
+			}
+
+			if (!ForgetPendingJoin (entry.get ()))
+				removed << entry.get ();
+			Nick2Entry_.remove (entry->GetNick ());
+		}
+
+		if (!removed.isEmpty ())
+			Account_->handleEntriesRemoved (removed);
+
+		CheckRejoin ();
+	}
+
+	bool RoomHandler::ForgetPendingJoin (RoomParticipantEntry *entry)
+	{
+		const auto pos = std::find_if (PendingJoins_.begin (), PendingJoins_.end (),
+				[entry] (const RoomParticipantEntry_ptr& pending) { return pending.get () == entry; });
+		if (pos == PendingJoins_.end ())
+			return false;
+
+		PendingJoins_.erase (pos);
+		return true;
+	}
+
+	void RoomHandler::CheckRejoin ()
+	{
+		if (Nick2Entry_.isEmpty () ||
+				std::all_of (Nick2Entry_.begin (), Nick2Entry_.end (),
+						[] (const RoomParticipantEntry_ptr& entry)
+							{ return entry->GetStatus ({}).State_ == SOffline; }))
+			new Util::DelayedExecutor { [this] { Join (); }, 5000, this };
+	}
+
 	void RoomHandler::RemoveThis ()
 	{
 		Account_->GetClientConnection ()->Unregister (this);
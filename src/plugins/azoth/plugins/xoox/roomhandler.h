@@ -65,6 +65,19 @@ namespace Xoox
 		QSet<QString> PendingNickChanges_;
 		bool HadRequestedPassword_;
 
+		/** Whether we are waiting for our own presence, collecting the
+		 * initial presences of the room occupants into PendingJoins_.
+		 */
+		bool IsJoining_;
+		QList<RoomParticipantEntry_ptr> PendingJoins_;
+
+		struct PendingLeave
+		{
+			QString Nick_;
+			QString Status_;
+		};
+		QList<PendingLeave> PendingLeaves_;
+
 		QXmppDiscoveryIq ServerDisco_;
 	public:
 		RoomHandler (const QString& roomJID, const QString& ourNick,
@@ -140,6 +153,20 @@ namespace Xoox
 
 		void RemoveEntry (RoomParticipantEntry*);
 
+		/** Announces the participants collected during the join to
+		 * Azoth at once, posting a single summary message instead of
+		 * a join message per participant.
+		 */
+		void FlushPendingJoins ();
+
+		/** Handles the participants that have left since the last
+		 * call, collapsing mass leaves (like netsplits) into a single
+		 * message and a single roster update.
+		 */
+		void FlushPendingLeaves ();
+		bool ForgetPendingJoin (RoomParticipantEntry*);
+		void CheckRejoin ();
+
 		void RemoveThis ();
 	signals:
 		void gotPendingForm (QXmppDataForm*, const QString&);
@@ -140,22 +140,25 @@ namespace Xoox
 
 	void RoomParticipantEntry::StealMessagesFrom (RoomParticipantEntry *other)
 	{
-		if (other->AllMessages_.isEmpty ())
+		if (other->AllMessages_.IsEmpty ())
 			return;
 
-		for (auto msg : other->AllMessages_)
+		const auto& otherMessages = other->AllMessages_.TakeAll ();
+		for (auto msg : otherMessages)
 			msg->SetVariant (Nick_);
 
-		MergeMessages (AllMessages_, other->AllMessages_);
-		other->AllMessages_.clear ();
+		const bool hadUnread = other->HasUnreadMsgs ();
+		if (hadUnread)
+			MergeMessages (UnreadMessages_, other->UnreadMessages_);
 
-		if (other->HasUnreadMsgs ())
-		{
-			for (auto msg : other->UnreadMessages_)
-				emit gotMessage (msg);
+		// Merging may evict some of the messages, dropping them from
+		// UnreadMessages_ as well, so only the survivors are emitted.
+		AllMessages_.Merge (otherMessages);
 
-			MergeMessages (UnreadMessages_, other->UnreadMessages_);
-		}
+		if (hadUnread)
+			for (auto msg : other->UnreadMessages_)
+				if (UnreadMessages_.contains (msg))
+					emit gotMessage (msg);
 	}
 
 	QXmppMucItem::Affiliation RoomParticipantEntry::GetAffiliation () const
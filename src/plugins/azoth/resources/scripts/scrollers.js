@@ -4,8 +4,23 @@ function ScrollToBottom() {
 	if (window.ShouldScroll)
 		document.body.scrollTop = document.height - window.innerHeight;
 }
+function ScrollToOffsetFromBottom(height) {
+	window.ShouldScroll = false;
+	document.body.scrollTop = document.height - height;
+}
 function TestScroll() {
 	window.ShouldScroll = document.height <= (window.innerHeight + window.pageYOffset + window.innerHeight / 5);
+
+	if (window.pageYOffset == 0 && !window.LoadingOlder) {
+		var loader = document.getElementById("azothLoadOlder");
+		if (loader) {
+			window.LoadingOlder = true;
+			loader.click();
+		}
+	}
+}
+function OlderMessagesLoaded() {
+	window.LoadingOlder = false;
 }
 function InstallEventListeners() {
 	window.ShouldScroll = true;
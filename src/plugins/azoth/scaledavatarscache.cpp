@@ -0,0 +1,212 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "scaledavatarscache.h"
+#include <QCryptographicHash>
+#include <QtConcurrentRun>
+#include <QtDebug>
+#include <util/threads/futures.h>
+#include "avatarsmanager.h"
+
+namespace LeechCraft
+{
+namespace Azoth
+{
+	double ScaledAvatarsCache::Stats::GetHitRate () const
+	{
+		const auto total = Hits_ + Misses_;
+		return total ?
+				static_cast<double> (Hits_) / total :
+				0;
+	}
+
+	ScaledAvatarsCache::ScaledAvatarsCache (AvatarsManager *am, QObject *parent)
+	: QObject { parent }
+	, AM_ { am }
+	, Variants_ { 4 * 1024 * 1024 }
+	{
+	}
+
+	ScaledAvatarsCache::~ScaledAvatarsCache ()
+	{
+		const auto& stats = GetStats ();
+		qDebug () << Q_FUNC_INFO
+				<< "hits:" << stats.Hits_
+				<< "misses:" << stats.Misses_
+				<< "hit rate:" << stats.GetHitRate ()
+				<< "variants:" << stats.VariantsCount_
+				<< "for" << stats.EntriesCount_ << "entries";
+	}
+
+	boost::optional<QImage> ScaledAvatarsCache::Get (QObject *entryObj, int dim)
+	{
+		const auto hashPos = Entry2Hash_.constFind (entryObj);
+		if (hashPos != Entry2Hash_.constEnd ())
+			if (const auto image = Variants_.object ({ *hashPos, dim }))
+			{
+				++Hits_;
+				return *image;
+			}
+
+		if (Schedule (entryObj, dim))
+			++Misses_;
+		return {};
+	}
+
+	void ScaledAvatarsCache::Forget (QObject *entryObj)
+	{
+		Entry2Hash_.remove (entryObj);
+
+		for (auto i = Pending_.begin (); i != Pending_.end (); )
+			if (i.key ().first == entryObj)
+				i = Pending_.erase (i);
+			else
+				++i;
+	}
+
+	void ScaledAvatarsCache::SetCacheSize (int mibs)
+	{
+		Variants_.setMaxCost (mibs * 1024 * 1024);
+	}
+
+	ScaledAvatarsCache::Stats ScaledAvatarsCache::GetStats () const
+	{
+		return
+		{
+			Hits_,
+			Misses_,
+			Variants_.totalCost (),
+			Variants_.maxCost (),
+			Variants_.size (),
+			Entry2Hash_.size ()
+		};
+	}
+
+	namespace
+	{
+		struct HashedImage
+		{
+			QByteArray Hash_;
+			QImage Image_;
+		};
+
+		QByteArray HashImage (const QImage& image)
+		{
+			QCryptographicHash hash { QCryptographicHash::Md5 };
+			hash.addData (QByteArray::number (image.width ()) + 'x' +
+					QByteArray::number (image.height ()) + '@' +
+					QByteArray::number (image.format ()));
+			hash.addData (reinterpret_cast<const char*> (image.constBits ()), image.byteCount ());
+			return hash.result ();
+		}
+
+		int GetImageCost (const QImage& image)
+		{
+			if (image.isNull ())
+				return 1;
+
+			return image.width () * image.height () * image.depth () / 8;
+		}
+	}
+
+	bool ScaledAvatarsCache::Schedule (QObject *entryObj, int dim)
+	{
+		const PendingKey_t pendingKey { entryObj, dim };
+		if (Pending_.contains (pendingKey))
+			return false;
+
+		const auto requestId = ++LastRequestId_;
+		Pending_ [pendingKey] = requestId;
+
+		Util::Sequence (this, AM_->GetAvatar (entryObj, IHaveAvatars::Size::Thumbnail)) >>
+				[] (const QImage& source)
+				{
+					return QtConcurrent::run ([source]
+							{
+								if (source.isNull ())
+									return HashedImage { {}, {} };
+
+								return HashedImage { HashImage (source), source };
+							});
+				} >>
+				[this, pendingKey, requestId] (const HashedImage& hashed)
+				{
+					// The entry has been invalidated or forgotten in the meantime.
+					if (Pending_.value (pendingKey) != requestId)
+						return;
+
+					const VariantKey_t variantKey { hashed.Hash_, pendingKey.second };
+					if (Variants_.contains (variantKey))
+					{
+						Complete (pendingKey, variantKey.first);
+						return;
+					}
+
+					auto& waiters = PendingScales_ [variantKey];
+					waiters.append ({ pendingKey.first, requestId });
+					if (waiters.size () == 1)
+						Scale (variantKey, hashed.Image_);
+				};
+		return true;
+	}
+
+	void ScaledAvatarsCache::Scale (const VariantKey_t& variantKey, const QImage& source)
+	{
+		const auto dim = variantKey.second;
+		Util::Sequence (this, QtConcurrent::run ([source, dim]
+					{
+						if (source.isNull () || source.width () == dim || source.height () == dim)
+							return source;
+
+						return source.scaled ({ dim, dim },
+								Qt::KeepAspectRatio, Qt::SmoothTransformation);
+					})) >>
+				[this, variantKey] (const QImage& scaled)
+				{
+					if (!Variants_.contains (variantKey))
+						Variants_.insert (variantKey,
+								new QImage { scaled }, GetImageCost (scaled));
+
+					for (const auto& waiter : PendingScales_.take (variantKey))
+					{
+						const PendingKey_t pendingKey { waiter.first, variantKey.second };
+						if (Pending_.value (pendingKey) == waiter.second)
+							Complete (pendingKey, variantKey.first);
+					}
+				};
+	}
+
+	void ScaledAvatarsCache::Complete (const PendingKey_t& pendingKey, const QByteArray& hash)
+	{
+		Pending_.remove (pendingKey);
+		Entry2Hash_ [pendingKey.first] = hash;
+		emit avatarScaled (pendingKey.first);
+	}
+}
+}
@@ -0,0 +1,108 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+
+namespace LeechCraft
+{
+namespace Azoth
+{
+	class AvatarsManager;
+
+	/** @brief Decoded and pre-scaled avatars for the views.
+	 *
+	 * Scaled variants are keyed by the hash of the source image contents
+	 * and the requested dimension, so contacts sharing the same avatar
+	 * (like the transports' or the default protocol ones) share a single
+	 * scaled image. The entries themselves only map to the content hash.
+	 * The source image is hashed before it is scaled, so an already
+	 * cached variant is reused right away, and concurrent requests for
+	 * the same variant share a single scaling job.
+	 *
+	 * Scaling is done in a worker thread. Get() never blocks: on a miss
+	 * it schedules the scaling and returns nothing, and avatarScaled()
+	 * is emitted once the variant is ready. Repeated requests for a
+	 * variant that is still being scaled are counted as a single miss.
+	 */
+	class ScaledAvatarsCache : public QObject
+	{
+		Q_OBJECT
+
+		AvatarsManager * const AM_;
+
+		using VariantKey_t = QPair<QByteArray, int>;
+		QCache<VariantKey_t, QImage> Variants_;
+
+		QHash<QObject*, QByteArray> Entry2Hash_;
+		quint64 LastRequestId_ = 0;
+		using PendingKey_t = QPair<QObject*, int>;
+		QHash<PendingKey_t, quint64> Pending_;
+		QHash<VariantKey_t, QList<QPair<QObject*, quint64>>> PendingScales_;
+
+		quint64 Hits_ = 0;
+		quint64 Misses_ = 0;
+	public:
+		struct Stats
+		{
+			quint64 Hits_;
+			quint64 Misses_;
+
+			int UsedBytes_;
+			int MaxBytes_;
+			int VariantsCount_;
+			int EntriesCount_;
+
+			double GetHitRate () const;
+		};
+
+		ScaledAvatarsCache (AvatarsManager*, QObject* = nullptr);
+		~ScaledAvatarsCache ();
+
+		boost::optional<QImage> Get (QObject*, int dim);
+
+		void Forget (QObject*);
+
+		void SetCacheSize (int mibs);
+
+		Stats GetStats () const;
+	private:
+		bool Schedule (QObject*, int dim);
+		void Scale (const VariantKey_t&, const QImage&);
+		void Complete (const PendingKey_t&, const QByteArray&);
+	signals:
+		void avatarScaled (QObject*);
+	};
+}
+}
@@ -53,6 +53,7 @@
 #include "task.h"
 #include "xmlsettingsmanager.h"
 #include "addtask.h"
+#include "filewriter.h"
 
 Q_DECLARE_METATYPE (QNetworkReply*)
 Q_DECLARE_METATYPE (QToolBar*)
@@ -74,8 +75,21 @@ namespace CSTP
 {
 	Core::Core ()
 	: Headers_ { "URL", tr ("State"), tr ("Progress") }
+	, UpdateTimer_ { new QTimer { this } }
+	, WriterThread_ { new FileWriterThread { this } }
 	{
 		setObjectName ("CSTP Core");
+
+		WriterThread_->SetAutoQuit (true);
+		WriterThread_->start (QThread::HighPriority);
+
+		UpdateTimer_->setSingleShot (true);
+		UpdateTimer_->setInterval (500);
+		connect (UpdateTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (flushUpdates ()));
+
 		qRegisterMetaType<std::shared_ptr<QFile>> ("std::shared_ptr<QFile>");
 		qRegisterMetaType<QNetworkReply*> ("QNetworkReply*");
 
@@ -109,6 +123,11 @@ namespace CSTP
 		return CoreProxy_;
 	}
 
+	FileWriterThread* Core::GetWriterThread () const
+	{
+		return WriterThread_;
+	}
+
 	void Core::SetToolbar (QToolBar *widget)
 	{
 		Toolbar_ = widget;
@@ -328,6 +347,7 @@ namespace CSTP
 
 		beginInsertRows (QModelIndex (), rowCount (), rowCount ());
 		ActiveTasks_.push_back (td);
+		TaskRows_ [td.Task_.get ()] = ActiveTasks_.size () - 1;
 		endInsertRows ();
 		ScheduleSave ();
 		if (!(td.Parameters_ & LeechCraft::NoAutostart))
@@ -608,6 +628,10 @@ namespace CSTP
 			return;
 		selected.Task_->Stop ();
 		selected.File_->close ();
+
+		// Segmented tasks keep the map of what's left to download in
+		// their state, so save it right away.
+		ScheduleSave ();
 	}
 
 	void Core::startAllTriggered ()
@@ -721,12 +745,28 @@ namespace CSTP
 
 	void Core::updateInterface ()
 	{
-		auto it = FindTask (sender ());
-		if (it == ActiveTasks_.end ())
-			return;
+		DirtyTasks_ << sender ();
+		if (!UpdateTimer_->isActive ())
+			UpdateTimer_->start ();
+	}
 
-		int pos = std::distance<tasks_t::const_iterator> (ActiveTasks_.begin (), it);
-		emit dataChanged (index (pos, 0), index (pos, columnCount () - 1));
+	void Core::flushUpdates ()
+	{
+		int minRow = rowCount ();
+		int maxRow = -1;
+		for (const auto task : DirtyTasks_)
+		{
+			const auto pos = TaskRows_.find (task);
+			if (pos == TaskRows_.end ())
+				continue;
+
+			minRow = std::min (minRow, *pos);
+			maxRow = std::max (maxRow, *pos);
+		}
+		DirtyTasks_.clear ();
+
+		if (maxRow >= 0)
+			emit dataChanged (index (minRow, 0), index (maxRow, columnCount () - 1));
 	}
 
 	void Core::writeSettings ()
@@ -800,6 +840,8 @@ namespace CSTP
 		}
 		SaveScheduled_ = false;
 		settings.endArray ();
+
+		RebuildTaskRows ();
 	}
 
 	void Core::ScheduleSave ()
@@ -810,24 +852,39 @@ namespace CSTP
 		QTimer::singleShot (100, this, SLOT (writeSettings ()));
 	}
 
+	void Core::RebuildTaskRows ()
+	{
+		TaskRows_.clear ();
+		for (int i = 0, size = ActiveTasks_.size (); i < size; ++i)
+			TaskRows_ [ActiveTasks_ [i].Task_.get ()] = i;
+	}
+
 	Core::tasks_t::const_iterator Core::FindTask (QObject *task) const
 	{
-		return std::find_if (ActiveTasks_.begin (), ActiveTasks_.end (),
-				[task] (const Core::TaskDescr& td) { return task == td.Task_.get (); });
+		const auto pos = TaskRows_.find (task);
+		return pos == TaskRows_.end () ?
+				ActiveTasks_.end () :
+				ActiveTasks_.begin () + *pos;
 	}
 
 	Core::tasks_t::iterator Core::FindTask (QObject *task)
 	{
-		return std::find_if (ActiveTasks_.begin (), ActiveTasks_.end (),
-				[task] (const Core::TaskDescr& td) { return task == td.Task_.get (); });
+		const auto pos = TaskRows_.find (task);
+		return pos == TaskRows_.end () ?
+				ActiveTasks_.end () :
+				ActiveTasks_.begin () + *pos;
 	}
 
 	void Core::Remove (tasks_t::iterator it)
 	{
 		int dst = std::distance (ActiveTasks_.begin (), it);
 		int id = it->ID_;
+		DirtyTasks_.remove (it->Task_.get ());
+		if (it->File_)
+			WriterThread_->Close (it->File_->fileName ());
 		beginRemoveRows (QModelIndex (), dst, dst);
 		ActiveTasks_.erase (it);
+		RebuildTaskRows ();
 		endRemoveRows ();
 		CoreProxy_->FreeID (id);
 
@@ -36,6 +36,7 @@
 #include <QNetworkProxy>
 #include <QNetworkAccessManager>
 #include <QSet>
+#include <QHash>
 #include <QUrl>
 #include <interfaces/iinfo.h>
 #include <interfaces/structures.h>
@@ -43,6 +44,7 @@
 
 class QFile;
 class QToolBar;
+class QTimer;
 
 struct EntityTestHandleResult;
 
@@ -51,6 +53,7 @@ namespace LeechCraft
 namespace CSTP
 {
 	class Task;
+	class FileWriterThread;
 
 	class Core : public QAbstractItemModel
 	{
@@ -70,6 +73,13 @@ namespace CSTP
 		};
 		typedef std::vector<TaskDescr> tasks_t;
 		tasks_t ActiveTasks_;
+		QHash<QObject*, int> TaskRows_;
+
+		QSet<QObject*> DirtyTasks_;
+		QTimer *UpdateTimer_;
+
+		FileWriterThread *WriterThread_;
+
 		bool SaveScheduled_ = false;
 		QNetworkAccessManager *NetworkAccessManager_ = nullptr;
 		QToolBar *Toolbar_ = nullptr;
@@ -100,6 +110,7 @@ namespace CSTP
 		void Release ();
 		void SetCoreProxy (ICoreProxy_ptr);
 		ICoreProxy_ptr GetCoreProxy () const;
+		FileWriterThread* GetWriterThread () const;
 		void SetToolbar (QToolBar*);
 		void ItemSelected (const QModelIndex&);
 
@@ -134,6 +145,7 @@ namespace CSTP
 	private slots:
 		void done (bool);
 		void updateInterface ();
+		void flushUpdates ();
 		void writeSettings ();
 		void finishedReply (QNetworkReply*);
 	private:
@@ -153,6 +165,7 @@ namespace CSTP
 		int AddTask (TaskDescr&);
 		void ReadSettings ();
 		void ScheduleSave ();
+		void RebuildTaskRows ();
 		tasks_t::const_iterator FindTask (QObject*) const;
 		tasks_t::iterator FindTask (QObject*);
 		void Remove (tasks_t::iterator);
@@ -0,0 +1,123 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "filewriter.h"
+#include <QFile>
+#include <QtDebug>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+namespace LeechCraft
+{
+namespace CSTP
+{
+	boost::optional<QString> FileWriter::Preallocate (const QString& path, qint64 size, bool keepSize)
+	{
+		const auto& file = GetFile (path);
+		if (!file->isOpen ())
+			return file->errorString ();
+
+		if (file->size () >= size)
+			return {};
+
+#ifdef Q_OS_LINUX
+		// Reserving the blocks upfront keeps writes at arbitrary offsets
+		// from fragmenting the file or failing halfway due to the lack of
+		// free space. Not all filesystems support this, hence no errors.
+		const auto rc = keepSize ?
+				fallocate (file->handle (), FALLOC_FL_KEEP_SIZE, 0, size) :
+				posix_fallocate (file->handle (), 0, size);
+		if (!rc || keepSize)
+			return {};
+#else
+		if (keepSize)
+			return {};
+#endif
+
+		if (!file->resize (size))
+			return file->errorString ();
+
+		return {};
+	}
+
+	boost::optional<QString> FileWriter::Write (const QString& path, qint64 offset, const QByteArray& data)
+	{
+		const auto& file = GetFile (path);
+		if (!file->isOpen ())
+			return file->errorString ();
+
+		if (!file->seek (offset))
+			return file->errorString ();
+
+		if (file->write (data) != data.size ())
+			return file->errorString ();
+
+		return {};
+	}
+
+	void FileWriter::Close (const QString& path)
+	{
+		if (const auto& file = Files_.take (path))
+			file->close ();
+	}
+
+	std::shared_ptr<QFile> FileWriter::GetFile (const QString& path)
+	{
+		auto& file = Files_ [path];
+		if (file && file->isOpen ())
+			return file;
+
+		file = std::make_shared<QFile> (path);
+		// The data is already coalesced into large chunks by the tasks.
+		if (!file->open (QIODevice::ReadWrite | QIODevice::Unbuffered))
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< path
+					<< file->errorString ();
+		return file;
+	}
+
+	QFuture<boost::optional<QString>> FileWriterThread::Preallocate (const QString& path, qint64 size, bool keepSize)
+	{
+		return ScheduleImpl (&W::Preallocate, path, size, keepSize);
+	}
+
+	QFuture<boost::optional<QString>> FileWriterThread::Write (const QString& path, qint64 offset, const QByteArray& data)
+	{
+		return ScheduleImpl (&W::Write, path, offset, data);
+	}
+
+	QFuture<void> FileWriterThread::Close (const QString& path)
+	{
+		return ScheduleImpl (&W::Close, path);
+	}
+}
+}
@@ -0,0 +1,80 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <QHash>
+#include <QString>
+#include <boost/optional.hpp>
+#include <util/threads/workerthreadbase.h>
+
+class QFile;
+
+namespace LeechCraft
+{
+namespace CSTP
+{
+	/** Performs the disk I/O of the downloads off the GUI thread.
+	 *
+	 * Files are addressed by their paths and are opened lazily on first
+	 * access. All the methods return an error string on failure.
+	 */
+	class FileWriter
+	{
+		QHash<QString, std::shared_ptr<QFile>> Files_;
+	public:
+		/** Reserves disk space for the file to be at least size bytes.
+		 *
+		 * If keepSize is true, the blocks are reserved without changing
+		 * the size of the file as seen by others, which is only possible
+		 * on Linux.
+		 */
+		boost::optional<QString> Preallocate (const QString& path, qint64 size, bool keepSize);
+		boost::optional<QString> Write (const QString& path, qint64 offset, const QByteArray& data);
+		void Close (const QString& path);
+	private:
+		std::shared_ptr<QFile> GetFile (const QString&);
+	};
+
+	class FileWriterThread final : public Util::WorkerThread<FileWriter>
+	{
+	public:
+		using WorkerThread::WorkerThread;
+
+		QFuture<boost::optional<QString>> Preallocate (const QString& path, qint64 size, bool keepSize);
+		QFuture<boost::optional<QString>> Write (const QString& path, qint64 offset, const QByteArray& data);
+
+		/** Closes the file after all the writes scheduled before
+		 * have completed.
+		 */
+		QFuture<void> Close (const QString& path);
+	};
+}
+}
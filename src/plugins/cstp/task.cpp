@@ -36,13 +36,16 @@
 #include <QDir>
 #include <QTimer>
 #include <QtDebug>
+#include <boost/optional.hpp>
 #include <util/xpc/util.h>
 #include <util/sll/qtutil.h>
 #include <util/sll/prelude.h>
 #include <util/sll/qstringwrappers.h>
 #include <interfaces/core/icoreproxy.h>
 #include <interfaces/core/ientitymanager.h>
+#include <util/threads/futures.h>
 #include "core.h"
+#include "filewriter.h"
 #include "xmlsettingsmanager.h"
 
 namespace LeechCraft
@@ -51,6 +54,11 @@ namespace CSTP
 {
 	namespace
 	{
+		/** Limits how much data a reply buffers on its own, so that the
+		 * network is throttled when the disk can't keep up.
+		 */
+		const qint64 ReadBufferSize = 4 * 1024 * 1024;
+
 		void LateDelete (QNetworkReply *rep)
 		{
 			if (rep)
@@ -119,10 +127,70 @@ namespace CSTP
 			Core::Instance ().RemoveFinishedReply (Reply_.get ());
 	}
 
+	QNetworkRequest Task::MakeRequest () const
+	{
+		auto ua = XmlSettingsManager::Instance ().property ("UserUserAgent").toString ();
+		if (ua.isEmpty ())
+			ua = XmlSettingsManager::Instance ().property ("PredefinedUserAgent").toString ();
+
+		if (ua == "%leechcraft%")
+			ua = "LeechCraft.CSTP/" + Core::Instance ().GetCoreProxy ()->GetVersion ();
+
+		QNetworkRequest req { URL_ };
+		req.setRawHeader ("User-Agent", ua.toLatin1 ());
+
+		if (Referer_.isEmpty ())
+			req.setRawHeader ("Referer", QString (QString ("http://") + URL_.host ()).toLatin1 ());
+		else
+			req.setRawHeader ("Referer", Referer_.toEncoded ());
+
+		req.setRawHeader ("Host", URL_.host ().toLatin1 ());
+		req.setRawHeader ("Origin", URL_.scheme ().toLatin1 () + "://" + URL_.host ().toLatin1 ());
+		req.setRawHeader ("Accept", "*/*");
+
+		for (const auto& pair : Util::Stlize (Headers_))
+			req.setRawHeader (pair.first.toLatin1 (), pair.second.toByteArray ());
+
+		return req;
+	}
+
 	void Task::Start (const std::shared_ptr<QFile>& tof)
 	{
 		FileSizeAtStart_ = tof->size ();
 		To_ = tof;
+		Error_.clear ();
+		WriteFailed_ = false;
+		WriteBuffer_.clear ();
+
+		// Requests passed to us from outside never ask for a range.
+		WritePos_ = Reply_ ? 0 : FileSizeAtStart_;
+
+		if (!Reply_ && !Segments_.empty ())
+		{
+			// The segments write at their own offsets into the file
+			// preallocated to the whole size. If it's gone or has been
+			// changed since the segments were saved, their data can't be
+			// trusted, so the download starts anew.
+			if (tof->exists () && FileSizeAtStart_ == Total_)
+			{
+				StartSegments ();
+				return;
+			}
+
+			qWarning () << Q_FUNC_INFO
+					<< "dropping the saved segments since the file"
+					<< tof->fileName ()
+					<< "has size"
+					<< FileSizeAtStart_
+					<< "instead of"
+					<< Total_;
+
+			Segments_.clear ();
+			tof->resize (0);
+			FileSizeAtStart_ = 0;
+			WritePos_ = 0;
+			Done_ = 0;
+		}
 
 		if (!Reply_)
 		{
@@ -134,32 +202,12 @@ namespace CSTP
 				return;
 			}
 
-			auto ua = XmlSettingsManager::Instance ().property ("UserUserAgent").toString ();
-			if (ua.isEmpty ())
-				ua = XmlSettingsManager::Instance ().property ("PredefinedUserAgent").toString ();
-
-			if (ua == "%leechcraft%")
-				ua = "LeechCraft.CSTP/" + Core::Instance ().GetCoreProxy ()->GetVersion ();
-
-			QNetworkRequest req { URL_ };
+			auto req = MakeRequest ();
 			if (tof->size ())
 				req.setRawHeader ("Range", QString ("bytes=%1-").arg (tof->size ()).toLatin1 ());
-			req.setRawHeader ("User-Agent", ua.toLatin1 ());
-
-			if (Referer_.isEmpty ())
-				req.setRawHeader ("Referer", QString (QString ("http://") + URL_.host ()).toLatin1 ());
-			else
-				req.setRawHeader ("Referer", Referer_.toEncoded ());
-
-			req.setRawHeader ("Host", URL_.host ().toLatin1 ());
-			req.setRawHeader ("Origin", URL_.scheme ().toLatin1 () + "://" + URL_.host ().toLatin1 ());
-			req.setRawHeader ("Accept", "*/*");
 
 			StartTime_.restart ();
 
-			for (const auto& pair : Util::Stlize (Headers_))
-				req.setRawHeader (pair.first.toLatin1 (), pair.second.toByteArray ());
-
 			auto nam = Core::Instance ().GetNetworkAccessManager ();
 			switch (Operation_)
 			{
@@ -201,6 +249,8 @@ namespace CSTP
 			Timer_->start (3000);
 
 		Reply_->setParent (nullptr);
+		if (!URL_.isEmpty ())
+			Reply_->setReadBufferSize (ReadBufferSize);
 		connect (Reply_.get (),
 				SIGNAL (downloadProgress (qint64, qint64)),
 				this,
@@ -227,6 +277,9 @@ namespace CSTP
 	{
 		if (Reply_)
 			Reply_->abort ();
+
+		StopSegments ();
+		CloseFile ();
 	}
 
 	void Task::ForbidNameChanges ()
@@ -239,13 +292,18 @@ namespace CSTP
 		QByteArray result;
 		{
 			QDataStream out (&result, QIODevice::WriteOnly);
-			out << 2
+			QList<QPair<qint64, qint64>> segments;
+			for (const auto& segment : Segments_)
+				segments.append ({ *segment->Written_, segment->End_ });
+
+			out << 3
 				<< URL_
 				<< StartTime_
 				<< Done_
 				<< Total_
 				<< Speed_
-				<< CanChangeName_;
+				<< CanChangeName_
+				<< segments;
 		}
 		return result;
 	}
@@ -255,7 +313,7 @@ namespace CSTP
 		QDataStream in (&data, QIODevice::ReadOnly);
 		int version = 0;
 		in >> version;
-		if (version < 1 || version > 2)
+		if (version < 1 || version > 3)
 			throw std::runtime_error ("Unknown version");
 
 		in >> URL_
@@ -266,6 +324,16 @@ namespace CSTP
 
 		if (version >= 2)
 			in >> CanChangeName_;
+
+		if (version >= 3)
+		{
+			QList<QPair<qint64, qint64>> segments;
+			in >> segments;
+
+			Segments_.clear ();
+			for (const auto& pair : segments)
+				Segments_.emplace_back (new Segment { pair.first, pair.second, { nullptr, &LateDelete }, 0, {}, std::make_shared<qint64> (pair.first) });
+		}
 	}
 
 	double Task::GetSpeed () const
@@ -285,7 +353,7 @@ namespace CSTP
 
 	QString Task::GetState () const
 	{
-		if (!Reply_)
+		if (!Reply_ && !HasRunningSegments ())
 			return tr ("Stopped");
 		else if (Done_ == Total_)
 			return tr ("Finished");
@@ -305,11 +373,14 @@ namespace CSTP
 
 	bool Task::IsRunning () const
 	{
-		return Reply_ && !URL_.isEmpty ();
+		return (Reply_ || HasRunningSegments ()) && !URL_.isEmpty ();
 	}
 
 	QString Task::GetErrorString () const
 	{
+		if (!Error_.isEmpty ())
+			return Error_;
+
 		return Reply_ ? Reply_->errorString () : tr ("Task isn't initialized properly");
 	}
 
@@ -321,6 +392,8 @@ namespace CSTP
 		Speed_ = 0;
 		FileSizeAtStart_ = -1;
 		Reply_.reset ();
+		StopSegments ();
+		Segments_.clear ();
 	}
 
 	void Task::RecalculateSpeed ()
@@ -467,6 +540,10 @@ namespace CSTP
 			return;
 		}
 
+		// Nothing is written before the metadata is received, so the
+		// writer can just forget about the old name.
+		Core::Instance ().GetWriterThread ()->Close (oldPath);
+
 		const auto openMode = To_->openMode ();
 		To_->close ();
 
@@ -487,6 +564,457 @@ namespace CSTP
 		}
 	}
 
+	void Task::ReportWriteError (const QString& error)
+	{
+		qWarning () << Q_FUNC_INFO
+				<< "Error writing to file:"
+				<< To_->fileName ()
+				<< error;
+
+		const auto& errString = tr ("Error writing to file %1: %2")
+				.arg (To_->fileName ())
+				.arg (error);
+		const auto& e = Util::MakeNotification ("LeechCraft CSTP",
+				errString,
+				PCritical_);
+		Core::Instance ().GetCoreProxy ()->GetEntityManager ()->HandleEntity (e);
+	}
+
+	namespace
+	{
+		const qint64 MinSegmentSize = 1024 * 1024;
+		const int MaxSegmentRetries = 3;
+
+		/** Received data is passed to the writer in chunks of at least
+		 * this size, ending on WriteAlignment boundaries in the file.
+		 */
+		const int WriteChunkSize = 512 * 1024;
+		const int WriteAlignment = 64 * 1024;
+
+		/** The reading from the network is paused while there are more
+		 * chunks than this waiting to be written.
+		 */
+		const int MaxPendingWrites = 16;
+
+		struct ContentRange
+		{
+			qint64 First_;
+			qint64 Last_;
+			qint64 Total_;
+		};
+
+		boost::optional<ContentRange> ParseContentRange (QByteArray header)
+		{
+			header = header.trimmed ();
+			if (!header.startsWith ("bytes "))
+				return {};
+
+			header = header.mid (6);
+			const auto dashPos = header.indexOf ('-');
+			const auto slashPos = header.indexOf ('/');
+			if (dashPos <= 0 || slashPos <= dashPos)
+				return {};
+
+			bool firstOk = false, lastOk = false, totalOk = false;
+			const ContentRange result
+			{
+				header.left (dashPos).toLongLong (&firstOk),
+				header.mid (dashPos + 1, slashPos - dashPos - 1).toLongLong (&lastOk),
+				header.mid (slashPos + 1).toLongLong (&totalOk)
+			};
+			if (!firstOk || !lastOk || !totalOk)
+				return {};
+
+			return result;
+		}
+
+		int GetMaxSegments ()
+		{
+			return XmlSettingsManager::Instance ().property ("SegmentsCount").toInt ();
+		}
+	}
+
+	void Task::ScheduleWrite (QByteArray& buffer, qint64 endPos, bool flush,
+			const std::shared_ptr<qint64>& written)
+	{
+		qint64 toWrite = 0;
+		if (flush)
+			toWrite = buffer.size ();
+		else if (buffer.size () >= WriteChunkSize)
+			toWrite = buffer.size () - endPos % WriteAlignment;
+
+		if (toWrite <= 0 || WriteFailed_)
+			return;
+
+		const auto startPos = endPos - buffer.size ();
+		const auto& chunk = buffer.left (toWrite);
+		buffer.remove (0, toWrite);
+
+		++PendingWrites_;
+		Util::Sequence (this, Core::Instance ().GetWriterThread ()->Write (To_->fileName (), startPos, chunk)) >>
+				[this, written, writtenPos = startPos + toWrite] (const boost::optional<QString>& error)
+				{
+					--PendingWrites_;
+					if (written && !error)
+						*written = writtenPos;
+					HandleWriteResult (error);
+
+					if (ReadingPaused_ && CanRead ())
+						ResumeReading ();
+				};
+	}
+
+	void Task::CloseFile ()
+	{
+		if (!To_)
+			return;
+
+		// Closing is queued after the writes scheduled so far, including
+		// the remaining data of the primary reply.
+		ScheduleWrite (WriteBuffer_, WritePos_, true);
+		Core::Instance ().GetWriterThread ()->Close (To_->fileName ());
+	}
+
+	void Task::HandleWriteResult (const boost::optional<QString>& error)
+	{
+		if (!error || WriteFailed_)
+			return;
+
+		WriteFailed_ = true;
+		ReportWriteError (*error);
+		Fail (*error);
+	}
+
+	bool Task::CanRead ()
+	{
+		ReadingPaused_ = PendingWrites_ >= MaxPendingWrites;
+		return !ReadingPaused_;
+	}
+
+	void Task::ResumeReading ()
+	{
+		if (Reply_ && Reply_->bytesAvailable ())
+			handleReadyRead ();
+
+		std::vector<Segment*> segments;
+		for (const auto& segment : Segments_)
+			if (segment->Reply_ && segment->Reply_->bytesAvailable ())
+				segments.push_back (segment.get ());
+
+		for (const auto segment : segments)
+			if (CanRead ())
+				HandleSegmentData (segment);
+	}
+
+	void Task::ReadPrimary ()
+	{
+		const auto& data = Reply_->readAll ();
+		WriteBuffer_ += data;
+		WritePos_ += data.size ();
+		ScheduleWrite (WriteBuffer_, WritePos_, false);
+	}
+
+	void Task::Preallocate (qint64 size, bool keepSize)
+	{
+		Util::Sequence (this, Core::Instance ().GetWriterThread ()->Preallocate (To_->fileName (), size, keepSize)) >>
+				[this] (const boost::optional<QString>& error) { HandleWriteResult (error); };
+	}
+
+	bool Task::TrySegment ()
+	{
+		if (!Reply_ ||
+				!Segments_.empty () ||
+				URL_.isEmpty () ||
+				Operation_ != QNetworkAccessManager::GetOperation ||
+				GetMaxSegments () <= 1)
+			return false;
+
+		qint64 start = 0;
+		qint64 total = 0;
+		switch (Reply_->attribute (QNetworkRequest::HttpStatusCodeAttribute).toInt ())
+		{
+		case 206:
+		{
+			const auto& range = ParseContentRange (Reply_->rawHeader ("Content-Range"));
+			if (!range || range->Last_ != range->Total_ - 1)
+				return false;
+
+			start = range->First_;
+			total = range->Total_;
+			break;
+		}
+		case 200:
+			if (FileSizeAtStart_ > 0 ||
+					Reply_->rawHeader ("Accept-Ranges").trimmed ().toLower () != "bytes")
+				return false;
+
+			total = Reply_->header (QNetworkRequest::ContentLengthHeader).toLongLong ();
+			break;
+		default:
+			return false;
+		}
+
+		if (total - start < 2 * MinSegmentSize)
+			return false;
+
+		// Segments write at their own offsets, so the file should span
+		// the whole download from the very beginning.
+		Preallocate (total, false);
+
+		Done_ = start;
+		Total_ = total;
+		SessionDone_ = 0;
+
+		// The already running request becomes the first segment, and the
+		// rest of the segments are split off it.
+		disconnect (Reply_.get (),
+				0,
+				this,
+				0);
+
+		Segments_.emplace_back (new Segment { start, total - 1, { Reply_.release (), &LateDelete }, 0, {}, std::make_shared<qint64> (start) });
+		const auto first = Segments_.front ().get ();
+
+		while (static_cast<int> (Segments_.size ()) < GetMaxSegments () &&
+				SplitLargestSegment ())
+			;
+
+		connect (first->Reply_.get (),
+				&QNetworkReply::readyRead,
+				this,
+				[this, first] { HandleSegmentData (first); });
+		connect (first->Reply_.get (),
+				&QNetworkReply::finished,
+				this,
+				[this, first] { HandleSegmentFinished (first); });
+
+		if (first->Reply_->bytesAvailable ())
+			HandleSegmentData (first);
+
+		return true;
+	}
+
+	void Task::StartSegments ()
+	{
+		StartTime_.restart ();
+		SessionDone_ = 0;
+
+		qint64 remaining = 0;
+		for (const auto& segment : Segments_)
+			remaining += segment->End_ - segment->Pos_ + 1;
+		Done_ = Total_ - remaining;
+
+		for (const auto& segment : Segments_)
+			StartSegment (segment.get ());
+
+		if (!Timer_->isActive ())
+			Timer_->start (3000);
+	}
+
+	void Task::StartSegment (Task::Segment *segment)
+	{
+		auto req = MakeRequest ();
+		req.setRawHeader ("Range", "bytes=" + QByteArray::number (segment->Pos_) +
+				"-" + QByteArray::number (segment->End_));
+		req.setAttribute (QNetworkRequest::FollowRedirectsAttribute, true);
+
+		segment->Reply_.reset (Core::Instance ().GetNetworkAccessManager ()->get (req));
+
+		const auto reply = segment->Reply_.get ();
+		reply->setParent (nullptr);
+		reply->setReadBufferSize (ReadBufferSize);
+		connect (reply,
+				&QNetworkReply::metaDataChanged,
+				this,
+				[this, segment] { CheckSegmentReply (segment); });
+		connect (reply,
+				&QNetworkReply::readyRead,
+				this,
+				[this, segment] { HandleSegmentData (segment); });
+		connect (reply,
+				&QNetworkReply::finished,
+				this,
+				[this, segment] { HandleSegmentFinished (segment); });
+	}
+
+	bool Task::SplitLargestSegment ()
+	{
+		const auto remaining = [] (const std::unique_ptr<Segment>& segment)
+				{ return segment->End_ - segment->Pos_ + 1; };
+
+		const auto largest = std::max_element (Segments_.begin (), Segments_.end (),
+				[&remaining] (const auto& left, const auto& right)
+					{ return remaining (left) < remaining (right); });
+		if (largest == Segments_.end () ||
+				remaining (*largest) < 2 * MinSegmentSize)
+			return false;
+
+		// The request of the split segment still asks for the original
+		// range, so its excess data is just dropped in HandleSegmentData().
+		const auto mid = (*largest)->Pos_ + remaining (*largest) / 2;
+		Segments_.emplace_back (new Segment { mid, (*largest)->End_, { nullptr, &LateDelete }, 0, {}, std::make_shared<qint64> (mid) });
+		(*largest)->End_ = mid - 1;
+
+		StartSegment (Segments_.back ().get ());
+		return true;
+	}
+
+	void Task::CheckSegmentReply (Task::Segment *segment)
+	{
+		const auto reply = segment->Reply_.get ();
+
+		const auto code = reply->attribute (QNetworkRequest::HttpStatusCodeAttribute).toInt ();
+		if (code >= 300 && code < 400)
+			return;
+
+		const auto& range = ParseContentRange (reply->rawHeader ("Content-Range"));
+		if (code == 206 && range && range->First_ == segment->Pos_)
+			return;
+
+		qWarning () << Q_FUNC_INFO
+				<< "unexpected response for segment"
+				<< segment->Pos_
+				<< segment->End_
+				<< code
+				<< reply->rawHeader ("Content-Range");
+		Fail (tr ("The server has stopped supporting partial downloads."));
+	}
+
+	bool Task::HandleSegmentData (Task::Segment *segment, bool force)
+	{
+		if (!segment->Reply_)
+			return false;
+
+		if (!force && !CanRead ())
+			return true;
+
+		const auto& data = segment->Reply_->readAll ();
+		const auto toWrite = std::min<qint64> (data.size (), segment->End_ - segment->Pos_ + 1);
+		if (toWrite > 0)
+		{
+			segment->Buffer_.append (data.constData (), toWrite);
+			segment->Pos_ += toWrite;
+			ScheduleWrite (segment->Buffer_, segment->Pos_, false, segment->Written_);
+
+			Done_ += toWrite;
+			SessionDone_ += toWrite;
+			Speed_ = static_cast<double> (SessionDone_ * 1000) / std::max (StartTime_.elapsed (), 1);
+		}
+
+		if (segment->Pos_ <= segment->End_)
+			return true;
+
+		FinishSegment (segment);
+		return false;
+	}
+
+	void Task::HandleSegmentFinished (Task::Segment *segment)
+	{
+		const auto reply = segment->Reply_.get ();
+		if (reply->bytesAvailable () && !HandleSegmentData (segment, true))
+			return;
+
+		// The connection has been closed before the whole segment has
+		// been received, so try to continue from where it stopped.
+		if (++segment->Retries_ > MaxSegmentRetries)
+		{
+			Fail (reply->errorString ());
+			return;
+		}
+
+		qWarning () << Q_FUNC_INFO
+				<< "restarting segment"
+				<< segment->Pos_
+				<< segment->End_
+				<< reply->errorString ();
+
+		disconnect (reply,
+				0,
+				this,
+				0);
+		StartSegment (segment);
+	}
+
+	void Task::FinishSegment (Task::Segment *segment)
+	{
+		ScheduleWrite (segment->Buffer_, segment->Pos_, true, segment->Written_);
+
+		if (const auto reply = segment->Reply_.get ())
+		{
+			disconnect (reply,
+					0,
+					this,
+					0);
+			reply->abort ();
+		}
+
+		const auto pos = std::find_if (Segments_.begin (), Segments_.end (),
+				[segment] (const auto& other) { return other.get () == segment; });
+		Segments_.erase (pos);
+
+		if (Segments_.empty ())
+		{
+			Done_ = Total_;
+			QTimer::singleShot (0,
+					this,
+					SLOT (handleFinished ()));
+			return;
+		}
+
+		// Keep all the connections busy by taking over half of what's
+		// left of the slowest segment.
+		if (static_cast<int> (Segments_.size ()) < GetMaxSegments ())
+			SplitLargestSegment ();
+	}
+
+	void Task::Fail (const QString& error)
+	{
+		Error_ = error;
+		StopSegments ();
+
+		if (Reply_)
+		{
+			disconnect (Reply_.get (),
+					0,
+					this,
+					0);
+			Reply_->abort ();
+			Reply_.reset ();
+		}
+
+		CloseFile ();
+
+		QTimer::singleShot (0,
+				this,
+				SLOT (handleError ()));
+	}
+
+	void Task::StopSegments ()
+	{
+		for (const auto& segment : Segments_)
+		{
+			ScheduleWrite (segment->Buffer_, segment->Pos_, true, segment->Written_);
+
+			const auto reply = segment->Reply_.get ();
+			if (!reply)
+				continue;
+
+			disconnect (reply,
+					0,
+					this,
+					0);
+			reply->abort ();
+			segment->Reply_.reset ();
+			segment->Retries_ = 0;
+		}
+	}
+
+	bool Task::HasRunningSegments () const
+	{
+		return std::any_of (Segments_.begin (), Segments_.end (),
+				[] (const auto& segment) { return static_cast<bool> (segment->Reply_); });
+	}
+
 	void Task::handleDataTransferProgress (qint64 done, qint64 total)
 	{
 		Done_ = done;
@@ -525,6 +1053,23 @@ namespace CSTP
 	{
 		HandleMetadataRedirection ();
 		HandleMetadataFilename ();
+		if (TrySegment () || URL_.isEmpty ())
+			return;
+
+		const auto code = Reply_->attribute (QNetworkRequest::HttpStatusCodeAttribute).toInt ();
+		if (code == 200 && WritePos_ && WriteBuffer_.isEmpty ())
+		{
+			// The server has ignored our Range header and sends the whole
+			// file once again.
+			WritePos_ = 0;
+			To_->resize (0);
+		}
+
+		// Only reserve the space without extending the file, since the
+		// file size is what a later resume starts from.
+		const auto length = Reply_->header (QNetworkRequest::ContentLengthHeader).toLongLong ();
+		if ((code == 200 || code == 206) && length > 0)
+			Preallocate (WritePos_ + length, true);
 	}
 
 	void Task::handleLocalTransfer ()
@@ -589,28 +1134,8 @@ namespace CSTP
 
 	bool Task::handleReadyRead ()
 	{
-		if (Reply_)
-		{
-			quint64 avail = Reply_->bytesAvailable ();
-			quint64 res = To_->write (Reply_->readAll ());
-			if (static_cast<quint64> (-1) == res ||
-					res != avail)
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "Error writing to file:"
-						<< To_->fileName ()
-						<< To_->errorString ();
-
-				const auto& errString = tr ("Error writing to file %1: %2")
-						.arg (To_->fileName ())
-						.arg (To_->errorString ());
-				const auto& e = Util::MakeNotification ("LeechCraft CSTP",
-						errString,
-						PCritical_);
-				Core::Instance ().GetCoreProxy ()->GetEntityManager ()->HandleEntity (e);
-				emit done (true);
-			}
-		}
+		if (Reply_ && CanRead ())
+			ReadPrimary ();
 		if (URL_.isEmpty () &&
 				Core::Instance ().HasFinishedReply (Reply_.get ()))
 		{
@@ -622,7 +1147,18 @@ namespace CSTP
 
 	void Task::handleFinished ()
 	{
-		emit done (false);
+		if (Reply_ && Reply_->bytesAvailable ())
+			ReadPrimary ();
+		ScheduleWrite (WriteBuffer_, WritePos_, true);
+
+		// The file is closed by the writer after all the pending writes,
+		// and only then it's safe to announce it.
+		Util::Sequence (this, Core::Instance ().GetWriterThread ()->Close (To_->fileName ())) >>
+				[this]
+				{
+					if (!WriteFailed_)
+						emit done (false);
+				};
 	}
 
 	void Task::handleError ()
@@ -31,11 +31,13 @@
 
 #include <memory>
 #include <functional>
+#include <vector>
 #include <QObject>
 #include <QUrl>
 #include <QTime>
 #include <QNetworkReply>
 #include <QStringList>
+#include <boost/optional.hpp>
 #include <interfaces/structures.h>
 
 class QAuthenticator;
@@ -52,7 +54,8 @@ namespace CSTP
 	{
 		Q_OBJECT
 
-		std::unique_ptr<QNetworkReply, std::function<void (QNetworkReply*)>> Reply_;
+		using Reply_ptr = std::unique_ptr<QNetworkReply, std::function<void (QNetworkReply*)>>;
+		Reply_ptr Reply_;
 		QUrl URL_;
 		QTime StartTime_;
 		qint64 Done_ = -1, Total_ = 0, FileSizeAtStart_ = -1;
@@ -69,6 +72,43 @@ namespace CSTP
 		const QVariantMap Headers_;
 
 		const QByteArray UploadData_ = {};
+
+		/** A byte range of the file downloaded over its own connection.
+		 *
+		 * Pos_ is the next byte to be written and End_ is the last byte
+		 * of the segment, inclusive.
+		 */
+		struct Segment
+		{
+			qint64 Pos_;
+			qint64 End_;
+			Reply_ptr Reply_;
+			int Retries_;
+
+			/** Received data not yet passed to the writer, ending
+			 * right before Pos_.
+			 */
+			QByteArray Buffer_;
+
+			/** The position right after the last byte the writer has
+			 * confirmed to be on disk. It is shared with the pending
+			 * writes, since the segment may be gone when they finish.
+			 */
+			std::shared_ptr<qint64> Written_;
+		};
+		std::vector<std::unique_ptr<Segment>> Segments_;
+		qint64 SessionDone_ = 0;
+		QString Error_;
+
+		/** The position in the file right after the last byte received
+		 * by a non-segmented download.
+		 */
+		qint64 WritePos_ = 0;
+		QByteArray WriteBuffer_;
+
+		int PendingWrites_ = 0;
+		bool ReadingPaused_ = false;
+		bool WriteFailed_ = false;
 	public:
 		explicit Task (const QUrl& url = QUrl (), const QVariantMap& params = QVariantMap ());
 		explicit Task (QNetworkReply*);
@@ -94,6 +134,30 @@ namespace CSTP
 		void RecalculateSpeed ();
 		void HandleMetadataRedirection ();
 		void HandleMetadataFilename ();
+		void ReportWriteError (const QString&);
+
+		void ScheduleWrite (QByteArray& buffer, qint64 endPos, bool flush,
+				const std::shared_ptr<qint64>& written = {});
+		void CloseFile ();
+		void HandleWriteResult (const boost::optional<QString>&);
+		bool CanRead ();
+		void ResumeReading ();
+		void ReadPrimary ();
+		void Preallocate (qint64 size, bool keepSize);
+
+		QNetworkRequest MakeRequest () const;
+
+		bool TrySegment ();
+		void StartSegments ();
+		void StartSegment (Segment*);
+		bool SplitLargestSegment ();
+		void CheckSegmentReply (Segment*);
+		bool HandleSegmentData (Segment*, bool force = false);
+		void HandleSegmentFinished (Segment*);
+		void FinishSegment (Segment*);
+		void Fail (const QString&);
+		void StopSegments ();
+		bool HasRunningSegments () const;
 	private slots:
 		void handleDataTransferProgress (qint64, qint64);
 		void redirectedConstruction (const QByteArray&);
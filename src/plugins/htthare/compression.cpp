@@ -0,0 +1,122 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "compression.h"
+#include <array>
+#include <QList>
+#include <QtDebug>
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	namespace
+	{
+		const auto CompressionLevel = 6;
+
+		quint32 Crc32 (const QByteArray& data)
+		{
+			static const auto table = []
+			{
+				std::array<quint32, 256> result;
+				for (quint32 i = 0; i < result.size (); ++i)
+				{
+					auto c = i;
+					for (int k = 0; k < 8; ++k)
+						c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+					result [i] = c;
+				}
+				return result;
+			} ();
+
+			quint32 crc = 0xffffffff;
+			for (const auto ch : data)
+				crc = table [(crc ^ static_cast<uchar> (ch)) & 0xff] ^ (crc >> 8);
+			return crc ^ 0xffffffff;
+		}
+
+		void AppendLE32 (QByteArray& ba, quint32 value)
+		{
+			for (int i = 0; i < 4; ++i)
+				ba += static_cast<char> ((value >> (i * 8)) & 0xff);
+		}
+	}
+
+	QByteArray Compress (const QByteArray& data, const QByteArray& encoding)
+	{
+		// qCompress() produces a zlib stream prepended by the 4-byte
+		// big-endian length of the uncompressed data.
+		auto zlib = qCompress (data, CompressionLevel);
+		zlib.remove (0, 4);
+
+		if (encoding == "deflate")
+			return zlib;
+
+		if (encoding != "gzip")
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unknown encoding"
+					<< encoding;
+			return data;
+		}
+
+		// gzip wants the raw deflate stream, so strip the 2-byte zlib
+		// header and the 4-byte Adler-32 trailer.
+		const auto& raw = zlib.mid (2, zlib.size () - 6);
+
+		QByteArray result;
+		result.reserve (raw.size () + 18);
+		result += QByteArray::fromRawData ("\x1f\x8b\x08\0\0\0\0\0\0\xff", 10);
+		result += raw;
+		AppendLE32 (result, Crc32 (data));
+		AppendLE32 (result, static_cast<quint32> (data.size ()));
+		return result;
+	}
+
+	bool IsCompressible (const QByteArray& mime)
+	{
+		if (mime.startsWith ("text/") ||
+				mime.endsWith ("+xml") ||
+				mime.endsWith ("+json"))
+			return true;
+
+		static const QList<QByteArray> others
+		{
+			"application/json",
+			"application/javascript",
+			"application/x-javascript",
+			"application/xml",
+			"application/x-subrip",
+			"application/x-mpegurl",
+			"audio/x-mpegurl"
+		};
+		return others.contains (mime);
+	}
+}
+}
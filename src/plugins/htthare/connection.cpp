@@ -36,16 +36,29 @@ namespace LeechCraft
 namespace HttHare
 {
 	Connection::Connection (boost::asio::io_service& service,
-			const StorageManager& stMgr, IconResolver *resolver, TrManager *trMgr)
+			const StorageManager& stMgr, IconResolver *resolver, TrManager *trMgr,
+			ResponseCache& listingCache, ResponseCache& compressedCache,
+			const ConnectionParams& params, ConnectionStats& stats)
 	: Strand_ { service }
 	, Socket_ { service }
 	, StorageMgr_ (stMgr)
 	, IconResolver_ { resolver }
 	, TrManager_ { trMgr }
+	, ListingCache_ (listingCache)
+	, CompressedCache_ (compressedCache)
+	, Params_ (params)
+	, Stats_ (stats)
 	, Buf_ { 2 * 1024 }
+	, IdleTimer_ { service }
 	{
 	}
 
+	Connection::~Connection ()
+	{
+		if (Started_)
+			--Stats_.ActiveConnections_;
+	}
+
 	boost::asio::ip::tcp::socket& Connection::GetSocket ()
 	{
 		return Socket_;
@@ -66,14 +79,77 @@ namespace HttHare
 		return TrManager_;
 	}
 
+	ResponseCache& Connection::GetListingCache () const
+	{
+		return ListingCache_;
+	}
+
+	ResponseCache& Connection::GetCompressedCache () const
+	{
+		return CompressedCache_;
+	}
+
 	const StorageManager& Connection::GetStorageManager () const
 	{
 		return StorageMgr_;
 	}
 
 	void Connection::Start ()
+	{
+		Started_ = true;
+		++Stats_.TotalConnections_;
+
+		const auto active = ++Stats_.ActiveConnections_;
+		auto peak = Stats_.PeakConnections_.load ();
+		while (active > peak &&
+				!Stats_.PeakConnections_.compare_exchange_weak (peak, active))
+			;
+
+		ReadRequest ();
+	}
+
+	bool Connection::CanKeepAlive () const
+	{
+		return Params_.IdleTimeout_.count () > 0 &&
+				RequestsCount_ < Params_.MaxRequests_;
+	}
+
+	std::chrono::seconds Connection::GetIdleTimeout () const
+	{
+		return Params_.IdleTimeout_;
+	}
+
+	void Connection::FinishResponse (bool keepAlive)
+	{
+		auto conn = shared_from_this ();
+		Strand_.dispatch ([conn, keepAlive]
+				{
+					if (keepAlive)
+						conn->ReadRequest ();
+					else
+						conn->Close ();
+				});
+	}
+
+	void Connection::ReadRequest ()
 	{
 		auto conn = shared_from_this ();
+
+		// The very first request is also subject to the timeout, so that
+		// a client that connects and sends nothing doesn't hold a socket.
+		const auto timeout = RequestsCount_ ?
+				Params_.IdleTimeout_ :
+				std::max (Params_.IdleTimeout_, std::chrono::seconds { 30 });
+		IdleTimer_.expires_from_now (timeout);
+		IdleTimer_.async_wait (Strand_.wrap ([conn] (const boost::system::error_code& ec)
+				{
+					if (ec == boost::asio::error::operation_aborted)
+						return;
+
+					++conn->Stats_.IdleTimeouts_;
+					conn->Close ();
+				}));
+
 		boost::asio::async_read_until (Socket_,
 				Buf_,
 				std::string { "\r\n\r\n" },
@@ -81,8 +157,25 @@ namespace HttHare
 					{ conn->HandleHeader (ec, transferred); }));
 	}
 
-	void Connection::HandleHeader (const boost::system::error_code&, unsigned long transferred)
+	void Connection::HandleHeader (const boost::system::error_code& ec, unsigned long transferred)
 	{
+		boost::system::error_code iec;
+		IdleTimer_.cancel (iec);
+
+		if (ec)
+		{
+			if (ec != boost::asio::error::eof &&
+					ec != boost::asio::error::operation_aborted)
+				qWarning () << Q_FUNC_INFO
+						<< ec.message ().c_str ();
+			Close ();
+			return;
+		}
+
+		++Stats_.TotalRequests_;
+		if (RequestsCount_++)
+			++Stats_.ReusedRequests_;
+
 		QByteArray data;
 		data.resize (transferred);
 
@@ -91,5 +184,13 @@ namespace HttHare
 
 		RequestHandler { shared_from_this () } (data);
 	}
+
+	void Connection::Close ()
+	{
+		boost::system::error_code ec;
+		IdleTimer_.cancel (ec);
+		Socket_.shutdown (boost::asio::socket_base::shutdown_both, ec);
+		Socket_.close (ec);
+	}
 }
 }
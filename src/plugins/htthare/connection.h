@@ -30,7 +30,11 @@
 #pragma once
 
 #include <memory>
+#include <atomic>
+#include <chrono>
 #include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <QtGlobal>
 
 namespace LeechCraft
 {
@@ -39,6 +43,29 @@ namespace HttHare
 	class StorageManager;
 	class IconResolver;
 	class TrManager;
+	class ResponseCache;
+
+	struct ConnectionParams
+	{
+		/** How long an idle persistent connection is kept open, zero
+		 * disables keep-alive altogether.
+		 */
+		std::chrono::seconds IdleTimeout_;
+
+		/** How many requests are served over a single connection.
+		 */
+		int MaxRequests_;
+	};
+
+	struct ConnectionStats
+	{
+		std::atomic<int> ActiveConnections_ { 0 };
+		std::atomic<int> PeakConnections_ { 0 };
+		std::atomic<quint64> TotalConnections_ { 0 };
+		std::atomic<quint64> TotalRequests_ { 0 };
+		std::atomic<quint64> ReusedRequests_ { 0 };
+		std::atomic<quint64> IdleTimeouts_ { 0 };
+	};
 
 	class Connection : public std::enable_shared_from_this<Connection>
 	{
@@ -48,10 +75,22 @@ namespace HttHare
 		const StorageManager& StorageMgr_;
 		IconResolver * const IconResolver_;
 		TrManager * const TrManager_;
+		ResponseCache& ListingCache_;
+		ResponseCache& CompressedCache_;
+
+		const ConnectionParams Params_;
+		ConnectionStats& Stats_;
 
 		boost::asio::streambuf Buf_;
+		boost::asio::steady_timer IdleTimer_;
+
+		int RequestsCount_ = 0;
+		bool Started_ = false;
 	public:
-		Connection (boost::asio::io_service&, const StorageManager&, IconResolver*, TrManager*);
+		Connection (boost::asio::io_service&, const StorageManager&, IconResolver*, TrManager*,
+				ResponseCache& listingCache, ResponseCache& compressedCache,
+				const ConnectionParams&, ConnectionStats&);
+		~Connection ();
 
 		Connection (const Connection&) = delete;
 		Connection& operator= (const Connection&) = delete;
@@ -60,12 +99,30 @@ namespace HttHare
 		boost::asio::io_service::strand& GetStrand ();
 		IconResolver* GetIconResolver () const;
 		TrManager* GetTrManager () const;
+		ResponseCache& GetListingCache () const;
+		ResponseCache& GetCompressedCache () const;
 
 		const StorageManager& GetStorageManager () const;
 
 		void Start ();
+
+		/** Returns whether the response to the request being handled
+		 * may leave the connection open for further requests.
+		 */
+		bool CanKeepAlive () const;
+		std::chrono::seconds GetIdleTimeout () const;
+
+		/** Called by RequestHandler once the response is fully written.
+		 *
+		 * Either waits for the next request on this connection (which
+		 * might already be in the buffer if the client pipelines its
+		 * requests) or closes it.
+		 */
+		void FinishResponse (bool keepAlive);
 	private:
+		void ReadRequest ();
 		void HandleHeader (const boost::system::error_code&, unsigned long);
+		void Close ();
 	};
 
 	typedef std::shared_ptr<Connection> Connection_ptr;
@@ -60,6 +60,8 @@ namespace HttHare
 
 		XmlSettingsManager::Instance ().RegisterObject ("EnableServer",
 				this, "handleEnableServerChanged");
+		XmlSettingsManager::Instance ().RegisterObject ({ "IOThreadsCount", "KeepAliveTimeout", "MaxKeepAliveRequests" },
+				this, "reapplyAddresses");
 		handleEnableServerChanged ();
 	}
 
@@ -97,6 +99,20 @@ namespace HttHare
 		return XSD_;
 	}
 
+	void Plugin::StartServer ()
+	{
+		auto& xsm = XmlSettingsManager::Instance ();
+
+		const ConnectionParams params
+		{
+			std::chrono::seconds { xsm.property ("KeepAliveTimeout").toInt () },
+			xsm.property ("MaxKeepAliveRequests").toInt ()
+		};
+
+		S_.reset (new Server { AddrMgr_->GetAddresses (), params });
+		S_->Start (xsm.property ("IOThreadsCount").toInt ());
+	}
+
 	void Plugin::handleEnableServerChanged ()
 	{
 		const bool enable = XmlSettingsManager::Instance ().property ("EnableServer").toBool ();
@@ -107,10 +123,7 @@ namespace HttHare
 		if (S_)
 			S_.reset ();
 		else
-		{
-			S_.reset (new Server { AddrMgr_->GetAddresses () });
-			S_->Start ();
-		}
+			StartServer ();
 	}
 
 	void Plugin::reapplyAddresses ()
@@ -125,8 +138,7 @@ namespace HttHare
 		QTimer::singleShot (100, &loop, SLOT (quit ()));
 		loop.exec ();
 
-		S_.reset (new Server { AddrMgr_->GetAddresses () });
-		S_->Start ();
+		StartServer ();
 	}
 }
 }
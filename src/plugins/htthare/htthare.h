@@ -68,6 +68,8 @@ namespace HttHare
 		QIcon GetIcon () const;
 
 		Util::XmlSettingsDialog_ptr GetSettingsDialog () const;
+	private:
+		void StartServer ();
 	private slots:
 		void handleEnableServerChanged ();
 		void reapplyAddresses ();
@@ -30,6 +30,7 @@
 #include "iconresolver.h"
 #include <QImage>
 #include <QIcon>
+#include <QStringList>
 #include <QtDebug>
 #include <util/util.h>
 
@@ -39,10 +40,63 @@ namespace HttHare
 {
 	IconResolver::IconResolver (QObject *parent)
 	: QObject (parent)
+	, Fallback_ (Render ("application/octet-stream"))
 	{
+		const QStringList common
+		{
+			"inode/directory",
+			"text/plain",
+			"text/html",
+			"image/jpeg",
+			"image/png",
+			"image/gif",
+			"audio/mpeg",
+			"audio/flac",
+			"audio/ogg",
+			"video/mp4",
+			"video/x-matroska",
+			"video/x-msvideo",
+			"application/pdf",
+			"application/zip",
+			"application/x-bittorrent"
+		};
+
+		for (const auto& mime : common)
+			Atlas_ [mime] = Render (mime);
+		Atlas_ ["application/octet-stream"] = Fallback_;
 	}
 
-	void IconResolver::resolveMime (QString mimetype, QByteArray& image, int dim)
+	boost::optional<QByteArray> IconResolver::GetIcon (const QString& mime)
+	{
+		{
+			QReadLocker locker { &AtlasLock_ };
+			const auto pos = Atlas_.find (mime);
+			if (pos != Atlas_.end ())
+				return *pos;
+		}
+
+		QWriteLocker locker { &AtlasLock_ };
+		if (Atlas_.contains (mime))
+			return Atlas_ [mime];
+
+		if (!Pending_.contains (mime))
+		{
+			Pending_ << mime;
+			QMetaObject::invokeMethod (this,
+					"renderMime",
+					Qt::QueuedConnection,
+					Q_ARG (QString, mime));
+		}
+
+		return {};
+	}
+
+	QByteArray IconResolver::GetFallbackIcon () const
+	{
+		return Fallback_;
+	}
+
+	QByteArray IconResolver::Render (QString mimetype)
 	{
 		mimetype.replace ('/', '-');
 		auto icon = QIcon::fromTheme (mimetype);
@@ -55,7 +109,16 @@ namespace HttHare
 		if (icon.isNull ())
 			icon = QIcon::fromTheme ("application-octet-stream");
 
-		image = Util::GetAsBase64Src (icon.pixmap (dim, dim).toImage ()).toLatin1 ();
+		return Util::GetAsBase64Src (icon.pixmap (IconSize, IconSize).toImage ()).toLatin1 ();
+	}
+
+	void IconResolver::renderMime (const QString& mime)
+	{
+		const auto& image = Render (mime);
+
+		QWriteLocker locker { &AtlasLock_ };
+		Atlas_ [mime] = image;
+		Pending_.remove (mime);
 	}
 }
 }
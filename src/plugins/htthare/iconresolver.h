@@ -30,20 +30,48 @@
 #pragma once
 
 #include <QObject>
-
-class QImage;
+#include <QHash>
+#include <QSet>
+#include <QReadWriteLock>
+#include <boost/optional.hpp>
 
 namespace LeechCraft
 {
 namespace HttHare
 {
+	/** Keeps data URIs of MIME type icons rendered in the GUI thread.
+	 *
+	 * The icons for the most common types are rendered right away, the
+	 * others are rendered asynchronously on first request, so that I/O
+	 * threads never wait for the GUI thread.
+	 *
+	 * GetIcon() and GetFallbackIcon() are thread-safe, while the object
+	 * itself should be created in the GUI thread.
+	 */
 	class IconResolver : public QObject
 	{
 		Q_OBJECT
+
+		mutable QReadWriteLock AtlasLock_;
+		QHash<QString, QByteArray> Atlas_;
+		QSet<QString> Pending_;
+
+		QByteArray Fallback_;
 	public:
+		static const int IconSize = 16;
+
 		IconResolver (QObject* = 0);
-	public slots:
-		void resolveMime (QString, QByteArray&, int);
+
+		/** Returns the data URI with the icon for the given MIME type,
+		 * or a null optional if it isn't rendered yet, scheduling its
+		 * rendering in the latter case.
+		 */
+		boost::optional<QByteArray> GetIcon (const QString& mime);
+		QByteArray GetFallbackIcon () const;
+	private:
+		static QByteArray Render (QString);
+	private slots:
+		void renderMime (const QString&);
 	};
 }
 }
@@ -42,19 +42,22 @@
 #endif
 
 #include <errno.h>
+#include <boost/optional.hpp>
 #include <QList>
 #include <QString>
 #include <QtDebug>
 #include <QFileInfo>
 #include <QDir>
 #include <QDateTime>
+#include <QLocale>
 #include <util/util.h>
-#include <util/sys/mimedetector.h>
-#include <util/sll/util.h>
 #include "connection.h"
 #include "storagemanager.h"
 #include "iconresolver.h"
 #include "trmanager.h"
+#include "mimeresolver.h"
+#include "responsecache.h"
+#include "compression.h"
 
 namespace LeechCraft
 {
@@ -93,6 +96,14 @@ namespace HttHare
 			Headers_ [line.left (colonPos)] = line.mid (colonPos + 1).trimmed ();
 		}
 
+		// The request body is never read, so the connection can't be reused
+		// if there is one: its bytes would be taken for the next request.
+		KeepAlive_ = WantsKeepAlive (req.value (2)) &&
+				Conn_->CanKeepAlive () &&
+				GetHeader ("Content-Length").isEmpty () &&
+				GetHeader ("Transfer-Encoding").isEmpty ();
+		Encoding_ = ChooseEncoding ();
+
 #ifdef QT_DEBUG
 		qDebug () << Q_FUNC_INFO << "got request";
 		qDebug () << req << Url_;
@@ -105,13 +116,16 @@ namespace HttHare
 		else if (verb == "get")
 			HandleRequest (Verb::Get);
 		else
+		{
+			KeepAlive_ = false;
 			return ErrorResponse (405, "Method Not Allowed",
 					"Method " + verb + " not supported by this server.");
+		}
 	}
 
-	QString RequestHandler::Tr (const char *msg)
+	QStringList RequestHandler::GetLocales () const
 	{
-		auto locales = Headers_ ["Accept-Language"].split (',');
+		auto locales = Headers_.value ("Accept-Language").split (',');
 		locales.removeAll ("*");
 		for (auto& locale : locales)
 		{
@@ -122,9 +136,166 @@ namespace HttHare
 		}
 		if (!locales.contains ("en"))
 			locales << "en";
+		return locales;
+	}
 
+	QString RequestHandler::Tr (const char *msg)
+	{
 		auto mgr = Conn_->GetTrManager ();
-		return mgr->Translate (locales, "LeechCraft::HttHare::RequestHandler", msg);
+		return mgr->Translate (GetLocales (), "LeechCraft::HttHare::RequestHandler", msg);
+	}
+
+	QString RequestHandler::GetHeader (const QString& name) const
+	{
+		for (auto i = Headers_.begin (); i != Headers_.end (); ++i)
+			if (!i.key ().compare (name, Qt::CaseInsensitive))
+				return i.value ();
+
+		return {};
+	}
+
+	bool RequestHandler::WantsKeepAlive (const QByteArray& version) const
+	{
+		const auto& tokens = GetHeader ("Connection").split (',', QString::SkipEmptyParts);
+		const auto hasToken = [&tokens] (const QString& token)
+		{
+			return std::any_of (tokens.begin (), tokens.end (),
+					[&token] (const QString& str) { return !str.trimmed ().compare (token, Qt::CaseInsensitive); });
+		};
+
+		// HTTP/1.1 connections are persistent unless told otherwise,
+		// while HTTP/1.0 ones should explicitly ask for it.
+		if (version.toUpper () == "HTTP/1.1")
+			return !hasToken ("close");
+
+		return hasToken ("keep-alive");
+	}
+
+	namespace
+	{
+		boost::optional<double> GetQValue (const QString& params)
+		{
+			for (const auto& param : params.split (';', QString::SkipEmptyParts))
+			{
+				const auto& trimmed = param.trimmed ();
+				if (!trimmed.startsWith ("q=", Qt::CaseInsensitive))
+					continue;
+
+				bool ok = false;
+				const auto q = trimmed.mid (2).toDouble (&ok);
+				if (ok)
+					return q;
+			}
+
+			return {};
+		}
+	}
+
+	QByteArray RequestHandler::ChooseEncoding () const
+	{
+		bool gzip = false;
+		bool deflate = false;
+		for (const auto& item : GetHeader ("Accept-Encoding").split (',', QString::SkipEmptyParts))
+		{
+			const auto semicolonPos = item.indexOf (';');
+			const auto& coding = item.left (semicolonPos).trimmed ().toLower ();
+			if (GetQValue (item.mid (semicolonPos + 1)).value_or (1) <= 0)
+				continue;
+
+			if (coding == "gzip" || coding == "x-gzip")
+				gzip = true;
+			else if (coding == "deflate")
+				deflate = true;
+		}
+
+		if (gzip)
+			return "gzip";
+		if (deflate)
+			return "deflate";
+		return {};
+	}
+
+	namespace
+	{
+		QString StripWeak (QString etag)
+		{
+			etag = etag.trimmed ();
+			if (etag.startsWith ("W/"))
+				etag.remove (0, 2);
+			return etag;
+		}
+
+		const QString HttpDateFormat = "ddd, dd MMM yyyy hh:mm:ss 'GMT'";
+
+		QByteArray ToHttpDate (const QDateTime& dt)
+		{
+			return QLocale::c ().toString (dt.toUTC (), HttpDateFormat).toLatin1 ();
+		}
+	}
+
+	bool RequestHandler::IsNotModified (const QByteArray& etag, const QDateTime& lastModified) const
+	{
+		// If-None-Match takes precedence over If-Modified-Since if both
+		// are present, and weak comparison is fine for GET and HEAD.
+		const auto& inm = GetHeader ("If-None-Match");
+		if (!inm.isEmpty ())
+		{
+			const auto& ourTag = StripWeak (etag);
+			for (const auto& tag : inm.split (',', QString::SkipEmptyParts))
+			{
+				const auto& theirTag = StripWeak (tag);
+				if (theirTag == "*" || theirTag == ourTag)
+					return true;
+			}
+			return false;
+		}
+
+		const auto& ims = GetHeader ("If-Modified-Since");
+		if (ims.isEmpty () || !lastModified.isValid ())
+			return false;
+
+		auto since = QLocale::c ().toDateTime (ims, HttpDateFormat);
+		if (!since.isValid ())
+			return false;
+		since.setTimeSpec (Qt::UTC);
+
+		// HTTP dates have a granularity of one second.
+		const auto modifiedSecs = lastModified.toMSecsSinceEpoch () / 1000;
+		return modifiedSecs <= since.toMSecsSinceEpoch () / 1000;
+	}
+
+	void RequestHandler::NotModified (Verb verb)
+	{
+		ResponseLine_ = "HTTP/1.1 304 Not Modified\r\n";
+		ResponseBody_.clear ();
+		IsNotModified_ = true;
+
+		DefaultWrite (verb);
+	}
+
+	void RequestHandler::CompressBody (const QString& cacheKey, const QDateTime& modified)
+	{
+		if (Encoding_.isEmpty () || ResponseBody_.isEmpty () || IsBodyCompressed_)
+			return;
+
+		IsBodyCompressed_ = true;
+		ResponseHeaders_.append ({ "Content-Encoding", Encoding_ });
+
+		if (cacheKey.isEmpty ())
+		{
+			ResponseBody_ = Compress (ResponseBody_, Encoding_);
+			return;
+		}
+
+		auto& cache = Conn_->GetCompressedCache ();
+		const auto& fullKey = Encoding_ + '\n' + cacheKey;
+		if (const auto cached = cache.Get (fullKey, modified))
+			ResponseBody_ = *cached;
+		else
+		{
+			ResponseBody_ = Compress (ResponseBody_, Encoding_);
+			cache.Put (fullKey, modified, ResponseBody_);
+		}
 	}
 
 	void RequestHandler::ErrorResponse (int code,
@@ -156,40 +327,47 @@ namespace HttHare
 					.replace ('.', '_')
 					.replace ('+', '_');
 		}
+	}
 
-		const auto IconSize = 16;
+	QString RequestHandler::GetListingKey (const QString& path, const QUrl& url) const
+	{
+		return path + '\n' + url.toString () + '\n' + GetLocales ().join (',');
 	}
 
 	QByteArray RequestHandler::MakeDirResponse (const QFileInfo& fi, const QString& path, const QUrl& url)
 	{
+		const auto& cacheKey = GetListingKey (path, url);
+		const auto& modified = fi.lastModified ();
+
+		auto& cache = Conn_->GetListingCache ();
+		if (const auto cached = cache.Get (cacheKey, modified))
+			return *cached;
+
 		const auto& entries = QDir { path }
 				.entryInfoList (QDir::AllEntries | QDir::NoDot,
 						QDir::Name | QDir::DirsFirst);
 
-		struct MimeInfo
-		{
-			QString MimeType_;
-		};
+		const auto resolver = Conn_->GetIconResolver ();
+		const auto iconSize = IconResolver::IconSize;
+
+		// A listing with some icons not rendered yet uses the fallback
+		// ones and isn't cached, so that the next request shows them.
+		bool allIconsReady = true;
+
 		QHash<QString, QByteArray> mimeCache;
-		QList<MimeInfo> mimes;
-		Util::MimeDetector detector;
+		QList<QByteArray> mimes;
 		for (const auto& entry : entries)
 		{
-			const auto& type = detector (entry.filePath ());
+			const auto& type = DetectMime (entry);
 
 			if (!mimeCache.contains (type))
 			{
-				QByteArray image;
-				QMetaObject::invokeMethod (Conn_->GetIconResolver (),
-						"resolveMime",
-						Qt::BlockingQueuedConnection,
-						Q_ARG (QString, type),
-						Q_ARG (QByteArray&, image),
-						Q_ARG (int, IconSize));
-				mimeCache [type] = image;
+				const auto& icon = resolver->GetIcon (type);
+				allIconsReady = allIconsReady && icon;
+				mimeCache [type] = icon ? *icon : resolver->GetFallbackIcon ();
 			}
 
-			mimes.append ({ type });
+			mimes.append (type);
 		}
 
 		QString result;
@@ -199,7 +377,7 @@ namespace HttHare
 			result += "." + NormalizeClass (pos.key ()) + " {";
 			result += "background-image: url('" + pos.value () + "');";
 			result += "background-repeat: no-repeat;";
-			result += "padding-left: " + QString::number (IconSize + 4) + ";";
+			result += "padding-left: " + QString::number (iconSize + 4) + ";";
 			result += "}";
 		}
 		result += "</style></head><body><h1>" + Tr ("Listing of %1").arg (url.toString ()) + "</h1>";
@@ -215,7 +393,7 @@ namespace HttHare
 
 			auto link = QUrl::toPercentEncoding (item.fileName (), {}, "'");
 
-			result += "<tr><td class=" + NormalizeClass (mimes.at (i).MimeType_) + "><a href='";
+			result += "<tr><td class=" + NormalizeClass (mimes.at (i)) + "><a href='";
 			result += link + "'>" + item.fileName () + "</a></td>";
 			result += "<td>" + Util::MakePrettySize (item.size ()) + "</td>";
 			result += "<td>" + item.created ().toString (Qt::SystemLocaleShortDate) + "</td></tr>";
@@ -223,7 +401,10 @@ namespace HttHare
 
 		result += "</table></body></html>";
 
-		return result.toUtf8 ();
+		const auto& html = result.toUtf8 ();
+		if (allIconsReady)
+			cache.Put (cacheKey, modified, html);
+		return html;
 	}
 
 	namespace
@@ -449,8 +630,19 @@ namespace HttHare
 			ResponseLine_ = "HTTP/1.1 200 OK\r\n";
 
 			ResponseHeaders_.append ({ "Content-Type", "text/html; charset=utf-8" });
+			ResponseHeaders_.append ({ "Vary", "Accept-Encoding" });
 			ResponseBody_ = MakeDirResponse (fi, path, Url_);
 
+			// The listing also depends on the files in the directory that
+			// don't necessarily touch its modification time, so only the
+			// contents are used for validation.
+			const auto& etag = "W/\"" + QByteArray::number (qHash (ResponseBody_), 16) + '"';
+			ResponseHeaders_.append ({ "ETag", etag });
+			if (IsNotModified (etag, {}))
+				return NotModified (verb);
+
+			CompressBody (GetListingKey (path, Url_), fi.lastModified ());
+
 			DefaultWrite (verb);
 		}
 		else
@@ -470,9 +662,36 @@ namespace HttHare
 	{
 		auto ranges = ParseRanges (Headers_.value ("Range"), fi.size ());
 
-		const auto& mime = Util::MimeDetector {} (path);
+		const auto& mime = DetectMime (fi);
 		ResponseHeaders_.append ({ "Content-Type", mime });
 
+		const auto& modified = fi.lastModified ();
+		ResponseHeaders_.append ({ "Last-Modified", ToHttpDate (modified) });
+
+		const auto compressible = IsCompressible (mime);
+		if (compressible)
+			ResponseHeaders_.append ({ "Vary", "Accept-Encoding" });
+
+		// Binary files and ranges go through sendfile(), while reasonably
+		// sized text files are compressed if the client supports it.
+		const auto compress = compressible &&
+				!Encoding_.isEmpty () &&
+				ranges.isEmpty () &&
+				fi.size () <= MaxCompressedFileSize;
+
+		auto etag = '"' + QByteArray::number (modified.toMSecsSinceEpoch (), 16) +
+				'-' + QByteArray::number (fi.size (), 16);
+		if (compress)
+			etag += '-' + Encoding_;
+		etag += '"';
+		ResponseHeaders_.append ({ "ETag", etag });
+
+		if (IsNotModified (etag, modified))
+			return NotModified (verb);
+
+		if (compress)
+			return WriteCompressedFile (path, fi, verb);
+
 		if (ranges.isEmpty ())
 		{
 			ResponseLine_ = "HTTP/1.1 200 OK\r\n";
@@ -490,21 +709,26 @@ namespace HttHare
 		}
 
 		auto c = Conn_;
+		const auto keepAlive = KeepAlive_;
 		boost::asio::async_write (c->GetSocket (),
 				ToBuffers (verb),
-				c->GetStrand ().wrap ([c, path, verb, ranges] (boost::system::error_code ec, ulong) mutable -> void
+				c->GetStrand ().wrap ([c, path, verb, ranges, keepAlive] (boost::system::error_code ec, ulong) mutable -> void
 					{
 						if (ec)
+						{
 							qWarning () << Q_FUNC_INFO
 									<< ec.message ().c_str ();
-
-						auto& s = c->GetSocket ();
-
-						auto shutdownGuard = Util::MakeScopeGuard ([&s, &ec]
-								{ s.shutdown (boost::asio::socket_base::shutdown_both, ec); }).Shared ();
+							c->FinishResponse (false);
+							return;
+						}
 
 						if (verb != Verb::Get)
+						{
+							c->FinishResponse (keepAlive);
 							return;
+						}
+
+						auto& s = c->GetSocket ();
 
 						auto file = std::make_shared<QFile> (path);
 						if (!file->open (QIODevice::ReadOnly))
@@ -513,6 +737,7 @@ namespace HttHare
 									<< "cannot open file"
 									<< path
 									<< file->errorString ();
+							c->FinishResponse (false);
 							return;
 						}
 
@@ -530,24 +755,55 @@ namespace HttHare
 							0,
 							headRange,
 							ranges,
-							[c, shutdownGuard] (boost::system::error_code, ulong) {}
+							[c, keepAlive] (boost::system::error_code ec, ulong)
+								{ c->FinishResponse (keepAlive && !ec); }
 						} (ec, 0);
 					}));
 	}
 
+	void RequestHandler::WriteCompressedFile (const QString& path, const QFileInfo& fi, Verb verb)
+	{
+		ResponseLine_ = "HTTP/1.1 200 OK\r\n";
+
+		const auto& cacheKey = "file\n" + path + '\n' + QString::number (fi.size ());
+		if (const auto cached = Conn_->GetCompressedCache ().Get (Encoding_ + '\n' + cacheKey, fi.lastModified ()))
+		{
+			ResponseBody_ = *cached;
+			IsBodyCompressed_ = true;
+			ResponseHeaders_.append ({ "Content-Encoding", Encoding_ });
+			return DefaultWrite (verb);
+		}
+
+		QFile file { path };
+		if (!file.open (QIODevice::ReadOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "cannot open file"
+					<< path
+					<< file.errorString ();
+			ResponseHeaders_.clear ();
+			return ErrorResponse (500, "Internal Server Error");
+		}
+
+		ResponseBody_ = file.readAll ();
+		CompressBody (cacheKey, fi.lastModified ());
+
+		DefaultWrite (verb);
+	}
+
 	void RequestHandler::DefaultWrite (Verb verb)
 	{
 		auto c = Conn_;
+		const auto keepAlive = KeepAlive_;
 		boost::asio::async_write (c->GetSocket (),
 				ToBuffers (verb),
-				c->GetStrand ().wrap ([c] (const boost::system::error_code& ec, ulong)
+				c->GetStrand ().wrap ([c, keepAlive] (const boost::system::error_code& ec, ulong)
 					{
 						if (ec)
 							qWarning () << Q_FUNC_INFO
 									<< ec.message ().c_str ();
 
-						boost::system::error_code iec;
-						c->GetSocket ().shutdown (boost::asio::socket_base::shutdown_both, iec);
+						c->FinishResponse (keepAlive && !ec);
 					}));
 	}
 
@@ -557,15 +813,6 @@ namespace HttHare
 		{
 			return { ba.constData (), static_cast<size_t> (ba.size ()) };
 		}
-
-		bool SupportsDeflate (const QStringList& ae)
-		{
-			for (const auto& val : ae)
-				if (!val.trimmed ().compare ("deflate", Qt::CaseInsensitive))
-					return true;
-
-			return false;
-		}
 	}
 
 	std::vector<boost::asio::const_buffer> RequestHandler::ToBuffers (Verb verb)
@@ -575,19 +822,20 @@ namespace HttHare
 		const bool hasContentLength = std::any_of (ResponseHeaders_.begin (), ResponseHeaders_.end (),
 				[] (const auto& pair) { return pair.first.toLower () == "content-length"; });
 
-		const auto& splitAe = Headers_.value ("Accept-Encoding").split (',');
-		if (verb == Verb::Get &&
-				!ResponseBody_.isEmpty () &&
-				SupportsDeflate (splitAe))
-		{
-			ResponseHeaders_.append ({ "Content-Encoding", "deflate" });
-			ResponseBody_ = qCompress (ResponseBody_, 6);
-			ResponseBody_.remove (0, 4);
-		}
+		CompressBody ({}, {});
 
-		if (!hasContentLength)
+		if (!hasContentLength && !IsNotModified_)
 			ResponseHeaders_.append ({ "Content-Length", QByteArray::number (ResponseBody_.size ()) });
 
+		if (KeepAlive_)
+		{
+			ResponseHeaders_.append ({ "Connection", "keep-alive" });
+			ResponseHeaders_.append ({ "Keep-Alive",
+					"timeout=" + QByteArray::number (static_cast<int> (Conn_->GetIdleTimeout ().count ())) });
+		}
+		else
+			ResponseHeaders_.append ({ "Connection", "close" });
+
 		CookedRH_.clear ();
 		for (const auto& pair : ResponseHeaders_)
 			CookedRH_ += pair.first + ": " + pair.second + "\r\n";
@@ -34,9 +34,11 @@
 #include <QByteArray>
 #include <QUrl>
 #include <QMap>
+#include <QStringList>
 #include <QCoreApplication>
 
 class QFileInfo;
+class QDateTime;
 
 namespace LeechCraft
 {
@@ -59,6 +61,14 @@ namespace HttHare
 		QByteArray CookedRH_;
 		QByteArray ResponseBody_;
 
+		bool KeepAlive_ = false;
+
+		QByteArray Encoding_;
+		bool IsBodyCompressed_ = false;
+		bool IsNotModified_ = false;
+
+		static const qint64 MaxCompressedFileSize = 4 * 1024 * 1024;
+
 		enum class Verb
 		{
 			Get,
@@ -69,7 +79,16 @@ namespace HttHare
 
 		void operator() (QByteArray);
 	private:
+		QStringList GetLocales () const;
 		QString Tr (const char*);
+		QString GetHeader (const QString&) const;
+		bool WantsKeepAlive (const QByteArray&) const;
+		QByteArray ChooseEncoding () const;
+		QString GetListingKey (const QString&, const QUrl&) const;
+
+		bool IsNotModified (const QByteArray& etag, const QDateTime& lastModified) const;
+		void NotModified (Verb);
+		void CompressBody (const QString& cacheKey, const QDateTime& modified);
 
 		void ErrorResponse (int, const QByteArray&, const QByteArray& = QByteArray ());
 		QByteArray MakeDirResponse (const QFileInfo&, const QString&, const QUrl&);
@@ -77,6 +96,7 @@ namespace HttHare
 		void HandleRequest (Verb);
 		void WriteDir (const QString&, const QFileInfo&, Verb);
 		void WriteFile (const QString&, const QFileInfo&, Verb);
+		void WriteCompressedFile (const QString&, const QFileInfo&, Verb);
 		void DefaultWrite (Verb);
 		std::vector<boost::asio::const_buffer> ToBuffers (Verb);
 	};
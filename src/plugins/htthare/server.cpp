@@ -40,8 +40,23 @@ namespace HttHare
 {
 	namespace ip = boost::asio::ip;
 
-	Server::Server (const QList<QPair<QString, QString>>& addresses)
-	: IconResolver_ { new IconResolver  }
+	QDebug operator<< (QDebug dbg, const ServerStats& stats)
+	{
+		QDebugStateSaver saver { dbg };
+		dbg.nospace () << "ServerStats { threads: " << stats.IOThreads_
+				<< "; active connections: " << stats.ActiveConnections_
+				<< "; peak connections: " << stats.PeakConnections_
+				<< "; total connections: " << stats.TotalConnections_
+				<< "; requests: " << stats.TotalRequests_
+				<< "; reused: " << stats.ReusedRequests_
+				<< "; idle timeouts: " << stats.IdleTimeouts_
+				<< " }";
+		return dbg;
+	}
+
+	Server::Server (const QList<QPair<QString, QString>>& addresses, const ConnectionParams& params)
+	: ConnParams_ (params)
+	, IconResolver_ { new IconResolver  }
 	, TrManager_ { new TrManager }
 	{
 		ip::tcp::resolver resolver { IoService_ };
@@ -78,12 +93,15 @@ namespace HttHare
 			Stop ();
 	}
 
-	void Server::Start ()
+	void Server::Start (int threadsCount)
 	{
 		if (Acceptors_.empty ())
 			return;
 
-		for (auto i = 0; i < 2; ++i)
+		if (threadsCount <= 0)
+			threadsCount = std::max<int> (std::thread::hardware_concurrency (), 1);
+
+		for (auto i = 0; i < threadsCount; ++i)
 			Threads_.emplace_back ([this] { IoService_.run (); });
 	}
 
@@ -92,12 +110,43 @@ namespace HttHare
 		IoService_.stop ();
 		for (auto& thread : Threads_)
 			thread.join ();
+
+		qDebug () << Q_FUNC_INFO
+				<< GetStats ();
+
 		Threads_.clear ();
 	}
 
+	ServerStats Server::GetStats () const
+	{
+		return
+		{
+			static_cast<int> (Threads_.size ()),
+			Stats_.ActiveConnections_,
+			Stats_.PeakConnections_,
+			Stats_.TotalConnections_,
+			Stats_.TotalRequests_,
+			Stats_.ReusedRequests_,
+			Stats_.IdleTimeouts_
+		};
+	}
+
 	void Server::StartAccept ()
 	{
-		Connection_ptr connection { new Connection { IoService_, StorageMgr_, IconResolver_, TrManager_ } };
+		Connection_ptr connection
+		{
+			new Connection
+			{
+				IoService_,
+				StorageMgr_,
+				IconResolver_,
+				TrManager_,
+				ListingCache_,
+				CompressedCache_,
+				ConnParams_,
+				Stats_
+			}
+		};
 
 		for (auto& acceptor : Acceptors_)
 			acceptor->async_accept (connection->GetSocket (),
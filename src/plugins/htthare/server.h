@@ -32,11 +32,14 @@
 #include <thread>
 #include <boost/asio.hpp>
 #include "storagemanager.h"
+#include "responsecache.h"
+#include "connection.h"
 
 template<typename T>
 class QSet;
 
 class QString;
+class QDebug;
 
 namespace LeechCraft
 {
@@ -45,26 +48,57 @@ namespace HttHare
 	class IconResolver;
 	class TrManager;
 
+	struct ServerStats
+	{
+		int IOThreads_;
+
+		int ActiveConnections_;
+		int PeakConnections_;
+		quint64 TotalConnections_;
+
+		quint64 TotalRequests_;
+
+		/** Requests served over an already established connection.
+		 */
+		quint64 ReusedRequests_;
+		quint64 IdleTimeouts_;
+	};
+
+	QDebug operator<< (QDebug, const ServerStats&);
+
 	class Server
 	{
+		// Pending handlers keep connections alive until the service is
+		// destroyed, and connections refer to these.
+		const ConnectionParams ConnParams_;
+		ConnectionStats Stats_;
+
 		boost::asio::io_service IoService_;
 		std::vector<std::unique_ptr<boost::asio::ip::tcp::acceptor>> Acceptors_;
 
 		StorageManager StorageMgr_;
+		ResponseCache ListingCache_;
+		ResponseCache CompressedCache_ { 16 * 1024 * 1024 };
 
 		std::vector<std::thread> Threads_;
 
 		IconResolver * const IconResolver_;
 		TrManager * const TrManager_;
 	public:
-		Server (const QList<QPair<QString, QString>>& addresses);
+		Server (const QList<QPair<QString, QString>>& addresses, const ConnectionParams&);
 		~Server ();
 
 		Server (const Server&) = delete;
 		Server& operator= (const Server&) = delete;
 
-		void Start ();
+		/** Starts serving requests in the given number of threads, or
+		 * in as many threads as there are CPU cores if the number is
+		 * zero.
+		 */
+		void Start (int threadsCount = 0);
 		void Stop ();
+
+		ServerStats GetStats () const;
 	private:
 		void StartAccept ();
 	};
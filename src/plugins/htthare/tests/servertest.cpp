@@ -0,0 +1,242 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "servertest.h"
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include "../server.h"
+
+QTEST_MAIN (LeechCraft::HttHare::ServerTest)
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	namespace
+	{
+		const int RequestsCount = 100;
+		const int ClientsCount = 8;
+		const int FileSize = 16 * 1024;
+		const int Timeout = 5000;
+
+		quint16 GetFreePort ()
+		{
+			QTcpServer server;
+			server.listen (QHostAddress::LocalHost);
+			return server.serverPort ();
+		}
+
+		QByteArray MakeRequest (const QString& path, bool keepAlive)
+		{
+			return "GET /" + QUrl::toPercentEncoding (path, "/") + " HTTP/1.1\r\n"
+					"Host: localhost\r\n"
+					"Connection: " + (keepAlive ? "keep-alive" : "close") + "\r\n"
+					"\r\n";
+		}
+
+		bool WaitForLine (QTcpSocket& socket)
+		{
+			while (!socket.canReadLine ())
+				if (!socket.waitForReadyRead (Timeout))
+					return false;
+			return true;
+		}
+
+		/** Reads a single response and returns its status code, or -1 if
+		 * the response could not be read.
+		 */
+		int ReadResponse (QTcpSocket& socket)
+		{
+			if (!WaitForLine (socket))
+				return -1;
+
+			const auto code = socket.readLine ().split (' ').value (1).toInt ();
+
+			qint64 length = 0;
+			while (true)
+			{
+				if (!WaitForLine (socket))
+					return -1;
+
+				const auto& line = socket.readLine ().trimmed ();
+				if (line.isEmpty ())
+					break;
+
+				const auto colon = line.indexOf (':');
+				if (line.left (colon).trimmed ().toLower () == "content-length")
+					length = line.mid (colon + 1).trimmed ().toLongLong ();
+			}
+
+			while (socket.bytesAvailable () < length)
+				if (!socket.waitForReadyRead (Timeout))
+					return -1;
+			socket.read (length);
+
+			return code;
+		}
+
+		bool Connect (QTcpSocket& socket, quint16 port)
+		{
+			socket.connectToHost (QHostAddress::LocalHost, port);
+			return socket.waitForConnected (Timeout);
+		}
+	}
+
+	ServerTest::ServerTest () = default;
+
+	ServerTest::~ServerTest () = default;
+
+	void ServerTest::initTestCase ()
+	{
+		// The server only serves the files under the home directory.
+		Dir_ = std::make_unique<QTemporaryDir> (QDir::homePath () + "/.lc_htthare_test_XXXXXX");
+		QVERIFY (Dir_->isValid ());
+
+		QFile file { Dir_->path () + "/file.bin" };
+		QVERIFY (file.open (QIODevice::WriteOnly));
+		file.write (QByteArray (FileSize, 'x'));
+		file.close ();
+
+		FilePath_ = QDir::home ().relativeFilePath (file.fileName ());
+
+		Port_ = GetFreePort ();
+		QVERIFY (Port_);
+
+		Server_ = std::make_unique<Server> (QList<QPair<QString, QString>> { { "127.0.0.1", QString::number (Port_) } },
+				ConnectionParams { std::chrono::seconds { 30 }, RequestsCount * 10 });
+		Server_->Start (2);
+	}
+
+	void ServerTest::cleanupTestCase ()
+	{
+		qDebug () << Server_->GetStats ();
+		Server_.reset ();
+		Dir_.reset ();
+	}
+
+	void ServerTest::testKeepAlive ()
+	{
+		const auto& before = Server_->GetStats ();
+
+		QTcpSocket socket;
+		QVERIFY (Connect (socket, Port_));
+		for (int i = 0; i < 10; ++i)
+		{
+			socket.write (MakeRequest (FilePath_, true));
+			QCOMPARE (ReadResponse (socket), 200);
+		}
+
+		const auto& after = Server_->GetStats ();
+		QCOMPARE (after.TotalConnections_ - before.TotalConnections_, 1ull);
+		QCOMPARE (after.TotalRequests_ - before.TotalRequests_, 10ull);
+		QCOMPARE (after.ReusedRequests_ - before.ReusedRequests_, 9ull);
+	}
+
+	void ServerTest::testPipelining ()
+	{
+		QTcpSocket socket;
+		QVERIFY (Connect (socket, Port_));
+
+		QByteArray requests;
+		for (int i = 0; i < 10; ++i)
+			requests += MakeRequest (FilePath_, true);
+		socket.write (requests);
+
+		for (int i = 0; i < 10; ++i)
+			QCOMPARE (ReadResponse (socket), 200);
+	}
+
+	void ServerTest::testConnectionClose ()
+	{
+		QTcpSocket socket;
+		QVERIFY (Connect (socket, Port_));
+
+		socket.write (MakeRequest (FilePath_, false));
+		QCOMPARE (ReadResponse (socket), 200);
+
+		if (socket.state () != QAbstractSocket::UnconnectedState)
+			QVERIFY (socket.waitForDisconnected (Timeout));
+	}
+
+	/* Each iteration of the benchmarks below makes RequestsCount
+	 * requests for a 16 KiB file.
+	 */
+	void ServerTest::benchmarkKeepAlive ()
+	{
+		QTcpSocket socket;
+		QVERIFY (Connect (socket, Port_));
+
+		const auto& request = MakeRequest (FilePath_, true);
+		QBENCHMARK {
+			for (int i = 0; i < RequestsCount; ++i)
+			{
+				socket.write (request);
+				ReadResponse (socket);
+			}
+		}
+	}
+
+	void ServerTest::benchmarkConnectionPerRequest ()
+	{
+		const auto& request = MakeRequest (FilePath_, false);
+		QBENCHMARK {
+			for (int i = 0; i < RequestsCount; ++i)
+			{
+				QTcpSocket socket;
+				Connect (socket, Port_);
+				socket.write (request);
+				ReadResponse (socket);
+			}
+		}
+	}
+
+	void ServerTest::benchmarkConcurrentClients ()
+	{
+		std::vector<std::unique_ptr<QTcpSocket>> sockets;
+		for (int i = 0; i < ClientsCount; ++i)
+		{
+			sockets.emplace_back (std::make_unique<QTcpSocket> ());
+			QVERIFY (Connect (*sockets.back (), Port_));
+		}
+
+		const auto& request = MakeRequest (FilePath_, true);
+		QBENCHMARK {
+			for (int i = 0; i < RequestsCount / ClientsCount; ++i)
+			{
+				for (const auto& socket : sockets)
+					socket->write (request);
+				for (const auto& socket : sockets)
+					ReadResponse (*socket);
+			}
+		}
+	}
+}
+}
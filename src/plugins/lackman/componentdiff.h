@@ -0,0 +1,66 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QStringList>
+#include "repoinfo.h"
+
+namespace LeechCraft
+{
+namespace LackMan
+{
+	using NameVersion_t = QPair<QString, QString>;
+	using PackagesIndex_t = QHash<NameVersion_t, int>;
+
+	struct ComponentDiff
+	{
+		/** IDs of the packages that are present in the component but are
+		 * missing in the fetched list.
+		 */
+		QList<int> Removed_;
+
+		/** IDs of the already known packages that should be added to the
+		 * component.
+		 */
+		QList<int> Relocated_;
+
+		/** Versions of the packages that aren't known yet, by package
+		 * name.
+		 */
+		QMap<QString, QStringList> NewVersions_;
+	};
+
+	ComponentDiff DiffComponent (const PackagesIndex_t& inComponent,
+			const PackagesIndex_t& known, const PackageShortInfoList& fetched);
+}
+}
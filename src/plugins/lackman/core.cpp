@@ -36,7 +36,11 @@
 #include <QTimer>
 #include <QtDebug>
 #include <util/util.h>
+#include <util/sll/either.h>
 #include <util/sll/prelude.h>
+#include <util/sll/void.h>
+#include <util/threads/futures.h>
+#include <util/threads/workerthreadbase.h>
 #include <util/xpc/util.h>
 #include <xmlsettingsdialog/datasourceroles.h>
 #include <interfaces/core/icoreproxy.h>
@@ -58,15 +62,58 @@ namespace LackMan
 {
 	QMap<Dependency::Relation, Comparator_t> Relation2comparator;
 
+	namespace
+	{
+		/* All the writes go through the storage worker so that the GUI
+		 * thread never waits on a transaction it doesn't own.
+		 */
+		template<typename Thread, typename F>
+		auto ScheduleWrite (Thread& thread, F f)
+		{
+			using Ret_t = std::result_of_t<F (Storage*)>;
+			using Result_t = Util::Either<QString, std::conditional_t<std::is_void<Ret_t>::value, Util::Void, Ret_t>>;
+
+			return thread.ScheduleImpl ([f] (Storage *storage)
+					{
+						try
+						{
+							if constexpr (std::is_void<Ret_t>::value)
+							{
+								f (storage);
+								return Result_t::Right ({});
+							}
+							else
+								return Result_t::Right (f (storage));
+						}
+						catch (const std::exception& e)
+						{
+							return Result_t::Left (QString::fromUtf8 (e.what ()));
+						}
+					});
+		}
+	}
+
 	Core::Core ()
 	: ExternalResourceManager_ (new ExternalResourceManager (this))
 	, Storage_ (new Storage (this))
+	, StorageThread_ (std::make_shared<StorageThread_t> (QString { "LackManConnectionWorker" }))
 	, PackagesModel_ (new PackagesModel (this))
 	, PendingManager_ (new PendingManager (this))
 	, PackageProcessor_ (new PackageProcessor (this))
 	, ReposModel_ (new QStandardItemModel (this))
 	, UpdatesEnabled_ (true)
 	{
+		StorageThread_->SetAutoQuit (true);
+		StorageThread_->start (QThread::LowestPriority);
+		StorageThread_->ScheduleImpl ([this] (Storage *storage)
+				{
+					connect (storage,
+							SIGNAL (packageRemoved (int)),
+							this,
+							SLOT (handlePackageRemoved (int)),
+							Qt::QueuedConnection);
+				});
+
 		Relation2comparator [Dependency::L] = IsVersionLess;
 		Relation2comparator [Dependency::G] = [] (QString l, QString r) { return Relation2comparator [Dependency::L] (r, l); };
 		Relation2comparator [Dependency::GE] = [] (QString l, QString r) { return !Relation2comparator [Dependency::L] (l, r); };
@@ -82,10 +129,6 @@ namespace LackMan
 				PackagesModel_,
 				SLOT (handlePackageInstallRemoveToggled (int)));
 
-		connect (Storage_,
-				SIGNAL (packageRemoved (int)),
-				this,
-				SLOT (handlePackageRemoved (int)));
 		connect (ExternalResourceManager_,
 				SIGNAL (delegateEntity (const LeechCraft::Entity&,
 						int*, QObject**)),
@@ -97,13 +140,9 @@ namespace LackMan
 				this,
 				SLOT (handlePackageInstallError (int, const QString&)));
 		connect (PackageProcessor_,
-				SIGNAL (packageInstalled (int)),
-				this,
-				SLOT (handlePackageInstalled (int)));
-		connect (PackageProcessor_,
-				SIGNAL (packageUpdated (int, int)),
+				&PackageProcessor::packagesProcessed,
 				this,
-				SLOT (handlePackageUpdated (int, int)));
+				&Core::HandlePackagesProcessed);
 
 		QStandardItem *item = new QStandardItem (tr ("URL"));
 		item->setData (DataSources::DataFieldType::Url, DataSources::DataSourceRole::FieldType);
@@ -133,6 +172,8 @@ namespace LackMan
 		delete RepoInfoFetcher_;
 		RepoInfoFetcher_ = 0;
 
+		StorageThread_.reset ();
+
 		delete Storage_;
 		Storage_ = 0;
 	}
@@ -425,44 +466,66 @@ namespace LackMan
 			return;
 		}
 
-		Q_FOREACH (const QString& oc, ourComponents)
+		auto fetchComponents = [this, url, id, components]
 		{
-			if (!components.contains (oc))
+			for (const QString& component : components)
 			{
-				qDebug () << Q_FUNC_INFO
-						<< "orphaned component"
-						<< oc;
-				try
+				QUrl compUrl = url;
+				compUrl.setPath ((compUrl.path () + "/dists/%1/all/").arg (component));
+				RepoInfoFetcher_->FetchComponent (compUrl, id, component);
+			}
+		};
+
+		const auto& orphaned = Util::Filter (ourComponents,
+				[&components] (const QString& oc) { return !components.contains (oc); });
+		if (orphaned.isEmpty ())
+		{
+			fetchComponents ();
+			return;
+		}
+
+		qDebug () << Q_FUNC_INFO
+				<< "orphaned components"
+				<< orphaned;
+
+		using Result_t = Util::Either<QString, Util::Void>;
+		auto future = StorageThread_->ScheduleImpl ([id, url, orphaned] (Storage *storage)
 				{
-					Storage_->RemoveComponent (id, oc);
-				}
-				catch (const std::exception& e)
+					for (const auto& oc : orphaned)
+						try
+						{
+							storage->RemoveComponent (id, oc);
+						}
+						catch (const std::exception& e)
+						{
+							qWarning () << Q_FUNC_INFO
+									<< "unable to remove component"
+									<< oc
+									<< "not present in freshly obtained description of"
+									<< id
+									<< url
+									<< "because of"
+									<< e.what ();
+							return Result_t::Left (oc);
+						}
+					return Result_t::Right ({});
+				});
+		Util::Sequence (this, future) >>
+				[this, url, fetchComponents] (const Result_t& result)
 				{
-					qWarning () << Q_FUNC_INFO
-							<< "unable to remove component"
-							<< oc
-							<< "not present in freshly obtained description of"
-							<< id
-							<< url
-							<< "because of"
-							<< e.what ();
+					if (result.IsRight ())
+					{
+						fetchComponents ();
+						return;
+					}
+
 					emit gotEntity (Util::MakeNotification (tr ("Error updating repository"),
 							tr ("Unable to remove the component `%1` which "
 								"disappeared from the list of components for repo %2.")
-								.arg (oc)
+								.arg (result.GetLeft ())
 								.arg (url.toString ()),
 							PCritical_));
-					return;
-				}
-			}
-		}
-
-		for (const QString& component : components)
-		{
-			QUrl compUrl = url;
-			compUrl.setPath ((compUrl.path () + "/dists/%1/all/").arg (component));
-			RepoInfoFetcher_->FetchComponent (compUrl, id, component);
-		}
+				};
 	}
 
 	void Core::cancelPending ()
@@ -580,77 +643,25 @@ namespace LackMan
 		}
 	}
 
-	void Core::HandleNewPackages (const PackageShortInfoList& shortInfos,
-			int componentId, const QString& component, const QUrl& repoUrl)
+	void Core::HandleComponentUpdate (const ComponentUpdate& update, const QString& component)
 	{
-		QMap<QString, QList<QString>> PackageName2NewVersions_;
+		PackagesModel_->RemovePackages (QSet<int>::fromList (update.RemovedPackages_));
 
 		int newPackages = 0;
-		for (const auto& info : shortInfos)
-			for (const QString& version : info.Versions_)
-			{
-				int packageId = -1;
-				try
-				{
-					packageId = Storage_->FindPackage (info.Name_, version);
-				}
-				catch (const std::exception& e)
-				{
-					qWarning () << Q_FUNC_INFO
-							<< "unable to get package ID for"
-							<< info.Name_
-							<< version
-							<< e.what ();
-					emit gotEntity (Util::MakeNotification (tr ("Error parsing component"),
-							tr ("Unable to load package ID for package `%1`-%2")
-								.arg (info.Name_)
-								.arg (version),
-							PCritical_));
-					return;
-				}
-
-				if (packageId == -1)
-				{
-					PackageName2NewVersions_ [info.Name_] << version;
-					++newPackages;
-				}
-
-				try
-				{
-					if (packageId != -1 &&
-							!Storage_->HasLocation (packageId, componentId))
-						Storage_->AddLocation (packageId, componentId);
-				}
-				catch (const std::exception& e)
-				{
-					qWarning () << Q_FUNC_INFO
-							<< "unable to add package location"
-							<< info.Name_
-							<< version
-							<< e.what ();
-					emit gotEntity (Util::MakeNotification (tr ("Error parsing component"),
-							tr ("Unable to save package location for "
-								"package `%1`-%2 and component %3")
-								.arg (info.Name_)
-								.arg (version)
-								.arg (component),
-							PCritical_));
-					return;
-				}
-			}
-
-		for (const QString& packageName : PackageName2NewVersions_.keys ())
+		for (auto i = update.NewVersions_.begin (), end = update.NewVersions_.end (); i != end; ++i)
 		{
-			auto packageUrl = repoUrl;
-			const auto& normalized = LackManUtil::NormalizePackageName (packageName);
+			auto packageUrl = update.RepoUrl_;
+			const auto& normalized = LackManUtil::NormalizePackageName (i.key ());
 			packageUrl.setPath (packageUrl.path () +
 					"/dists/" + component + "/all" +
 					'/' + normalized +
 					'/');
 			RepoInfoFetcher_->ScheduleFetchPackageInfo (packageUrl,
-					packageName,
-					PackageName2NewVersions_ [packageName],
-					componentId);
+					i.key (),
+					i.value (),
+					update.ComponentID_);
+
+			newPackages += i->size ();
 		}
 
 		if (newPackages)
@@ -681,14 +692,7 @@ namespace LackMan
 			return;
 		}
 
-		if (!RecordUninstalled (packageId))
-			return;
-
-		UpdateRowFor (packageId);
-
-		PendingManager_->SuccessfullyRemoved (packageId);
-
-		emit packageRowActionFinished (GetPackageRow (packageId));
+		RecordUninstalled (packageId);
 	}
 
 	void Core::UpdateRowFor (int packageId)
@@ -708,21 +712,60 @@ namespace LackMan
 		}
 	}
 
-	bool Core::RecordInstalled (int packageId)
+	void Core::RecordUninstalled (int packageId)
 	{
-		try
-		{
-			Storage_->AddToInstalled (packageId);
-		}
-		catch (const std::exception& e)
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "while trying to record installed package"
-					<< e.what ();
-			emit gotEntity (Util::MakeNotification (tr ("Error installing package"),
-						tr ("Error recording package to the package DB."),
-						PCritical_));
+		auto future = ScheduleWrite (*StorageThread_,
+				[packageId] (Storage *storage) { storage->RemoveFromInstalled (packageId); });
+		Util::Sequence (this, future) >>
+				[this, packageId] (const auto& result)
+				{
+					if (result.IsLeft ())
+					{
+						qWarning () << Q_FUNC_INFO
+								<< "unable to remove from installed"
+								<< packageId
+								<< result.GetLeft ();
+						emit gotEntity (Util::MakeNotification (tr ("Unable to remove package"),
+									result.GetLeft (),
+									PCritical_));
+						return;
+					}
+
+					UpdateRowFor (packageId);
+
+					PendingManager_->SuccessfullyRemoved (packageId);
+
+					emit packageRowActionFinished (GetPackageRow (packageId));
+				};
+	}
+
+	void Core::HandlePackagesProcessed (const QList<int>& installed, const QMap<int, int>& updated)
+	{
+		auto future = ScheduleWrite (*StorageThread_,
+				[toAdd = installed + updated.keys (), toRemove = updated.values ()] (Storage *storage)
+				{
+					storage->UpdateInstalled (toAdd, toRemove);
+				});
+		Util::Sequence (this, future) >>
+				[this, installed, updated] (const auto& result)
+				{
+					if (result.IsLeft ())
+						HandleInstalledRecordFailed (installed, result.GetLeft ());
+					else
+						HandleInstalledRecorded (installed, updated);
+				};
+	}
+
+	void Core::HandleInstalledRecordFailed (const QList<int>& installed, const QString& error)
+	{
+		qWarning () << Q_FUNC_INFO
+				<< "while trying to record installed packages"
+				<< error;
+		emit gotEntity (Util::MakeNotification (tr ("Error installing package"),
+					tr ("Error recording packages to the package DB."),
+					PCritical_));
 
+		for (const auto packageId : installed)
 			try
 			{
 				PackageProcessor_->Remove (packageId);
@@ -733,32 +776,50 @@ namespace LackMan
 						<< "while trying to cleanup partially installed package"
 						<< e.what ();
 			}
-			return false;
-		}
-
-		return true;
 	}
 
-	bool Core::RecordUninstalled (int packageId)
+	void Core::HandleInstalledRecorded (const QList<int>& installed, const QMap<int, int>& updated)
 	{
-		try
+		QStringList names;
+		auto finish = [this, &names] (int packageId)
 		{
-			Storage_->RemoveFromInstalled (packageId);
+			UpdateRowFor (packageId);
+
+			try
+			{
+				names << "<em>" + Storage_->GetPackage (packageId).Name_ + "</em>";
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "while trying to get installed package name"
+						<< e.what ();
+			}
+
+			emit packageRowActionFinished (GetPackageRow (packageId));
+		};
+
+		for (const auto packageId : installed)
+		{
+			PendingManager_->SuccessfullyInstalled (packageId);
+			finish (packageId);
 		}
-		catch (const std::exception& e)
+
+		for (const auto packageId : updated.keys ())
 		{
-			QString str = Util::FromStdString (e.what ());
-			qWarning () << Q_FUNC_INFO
-					<< "unable to remove from installed"
-					<< packageId
-					<< str;
-			emit gotEntity (Util::MakeNotification (tr ("Unable to remove package"),
-						str,
-						PCritical_));
-			return false;
+			PendingManager_->SuccessfullyUpdated (packageId);
+			finish (packageId);
 		}
 
-		return true;
+		if (names.isEmpty ())
+			return;
+
+		const auto& text = names.size () == 1 ?
+				tr ("Package %1 installed successfully.").arg (names.value (0)) :
+				tr ("Packages installed successfully: %1.").arg (names.join (", "));
+		emit gotEntity (Util::MakeNotification (tr ("Packages installed"),
+					text,
+					PInfo_));
 	}
 
 	int Core::GetPackageRow (int packageId) const
@@ -887,18 +948,17 @@ namespace LackMan
 			QList<QStandardItem*> items = ReposModel_->takeRow (row);
 			QUrl url = items.at (RCURL)->data ().value<QUrl> ();
 
-			try
-			{
-				int repoId = Storage_->FindRepo (url);
-				Storage_->RemoveRepo (repoId);
-			}
-			catch (const std::exception& e)
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "unable to remove repo"
-						<< url
-						<< e.what ();
-			}
+			auto future = ScheduleWrite (*StorageThread_,
+					[url] (Storage *storage) { storage->RemoveRepo (storage->FindRepo (url)); });
+			Util::Sequence (this, future) >>
+					[url] (const auto& result)
+					{
+						if (result.IsLeft ())
+							qWarning () << Q_FUNC_INFO
+									<< "unable to remove repo"
+									<< url
+									<< result.GetLeft ();
+					};
 
 			qDeleteAll (items);
 		}
@@ -936,190 +996,140 @@ namespace LackMan
 
 	void Core::handleInfoFetched (const RepoInfo& ri)
 	{
-		int repoId = -1;
-		try
-		{
-			repoId = Storage_->FindRepo (ri.GetUrl ());
-			if (repoId == -1)
-				repoId = Storage_->AddRepo (ri);
-		}
-		catch (const std::exception& e)
-		{
-			QString str;
-			QDebug debug (&str);
-			debug << "unable to find/add repo"
-					<< ri.GetName ()
-					<< ri.GetUrl ()
-					<< "with error"
-					<< e.what ();
-			qWarning () << Q_FUNC_INFO
-					<< str;
-			emit gotEntity (Util::MakeNotification (tr ("Error adding/updating repository"),
-					tr ("While trying to add or update the repository: %1.")
-						.arg (str),
-					PCritical_));
-		}
+		auto future = ScheduleWrite (*StorageThread_,
+				[ri] (Storage *storage)
+				{
+					const auto repoId = storage->FindRepo (ri.GetUrl ());
+					return repoId == -1 ? storage->AddRepo (ri) : repoId;
+				});
+		Util::Sequence (this, future) >>
+				[this, ri] (const auto& result)
+				{
+					if (result.IsLeft ())
+					{
+						QString str;
+						QDebug debug (&str);
+						debug << "unable to find/add repo"
+								<< ri.GetName ()
+								<< ri.GetUrl ()
+								<< "with error"
+								<< result.GetLeft ();
+						qWarning () << Q_FUNC_INFO
+								<< str;
+						emit gotEntity (Util::MakeNotification (tr ("Error adding/updating repository"),
+								tr ("While trying to add or update the repository: %1.")
+									.arg (str),
+								PCritical_));
+						return;
+					}
 
-		if (repoId == -1)
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to add repo"
-					<< ri.GetUrl ()
-					<< ri.GetName ();
-			return;
-		}
+					if (result.GetRight () == -1)
+					{
+						qWarning () << Q_FUNC_INFO
+								<< "unable to add repo"
+								<< ri.GetUrl ()
+								<< ri.GetName ();
+						return;
+					}
 
-		UpdateRepo (ri.GetUrl (), ri.GetComponents ());
+					UpdateRepo (ri.GetUrl (), ri.GetComponents ());
+				};
 	}
 
 	void Core::handleComponentFetched (const PackageShortInfoList& shortInfos,
 			const QString& component, int repoId)
 	{
-		int componentId = -1;
-		QUrl repoUrl;
-		try
-		{
-			componentId = Storage_->FindComponent (repoId, component);
-			if (componentId == -1)
-				componentId = Storage_->AddComponent (repoId, component);
-
-			repoUrl = Storage_->GetRepo (repoId).GetUrl ();
-		}
-		catch (const std::exception& e)
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to get component ID for"
-					<< component
-					<< "of"
-					<< repoId
-					<< e.what ();
-			emit gotEntity (Util::MakeNotification (tr ("Error parsing component"),
-					tr ("Unable to load component ID for component %1.")
-						.arg (component),
-					PCritical_));
-			return;
-		}
-
-		QList<int> presentPackages;
-		QSet<int> installedPackages;
-		try
-		{
-			presentPackages = Storage_->GetPackagesInComponent (componentId);
-			installedPackages = Storage_->GetInstalledPackagesIDs ();
-		}
-		catch (const std::exception& e)
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to get installed or present packages in component:"
-					<< e.what ();
-			emit gotEntity (Util::MakeNotification (tr ("Error handling component"),
-					tr ("Unable to load packages already present in the component %1.")
-						.arg (component),
-					PCritical_));
-			return;
-		}
-
-		for (int presentPId : presentPackages)
-		{
-			PackageShortInfo psi;
-			try
-			{
-				psi = Storage_->GetPackage (presentPId);
-			}
-			catch (const std::exception& e)
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "unable to get present package:"
-						<< e.what ();
-				emit gotEntity (Util::MakeNotification (tr ("Error handling component"),
-						tr ("Unable to load package already present in the component %1.")
-							.arg (component),
-						PCritical_));
-				return;
-			}
-
-			const QString& ourVersion = psi.Versions_.at (0);
-			bool found = false;
-			for (const auto& candidate : shortInfos)
-			{
-				if (candidate.Name_ == psi.Name_ &&
-						candidate.Versions_.contains (ourVersion))
+		auto future = ScheduleWrite (*StorageThread_,
+				[repoId, component, shortInfos] (Storage *storage)
 				{
-					found = true;
-					break;
-				}
-			}
-
-			if (!found)
-			{
-				try
+					return storage->UpdateComponent (repoId, component, shortInfos);
+				});
+		Util::Sequence (this, future) >>
+				[this, component, repoId] (const auto& result)
 				{
-					Storage_->RemoveLocation (presentPId, componentId);
+					if (result.IsRight ())
+					{
+						HandleComponentUpdate (result.GetRight (), component);
+						return;
+					}
 
-					if (!installedPackages.contains (presentPId))
-						Storage_->RemovePackage (presentPId);
-				}
-				catch (const std::exception& e)
-				{
 					qWarning () << Q_FUNC_INFO
-							<< "unable to remove package for:"
+							<< "unable to update component"
 							<< component
-							<< presentPId
-							<< e.what ();
+							<< "of"
+							<< repoId
+							<< result.GetLeft ();
 					emit gotEntity (Util::MakeNotification (tr ("Error handling component"),
-							tr ("Unable to remove package which has been removed upstream from %1.")
+							tr ("Unable to update packages of the component %1.")
 								.arg (component),
 							PCritical_));
-					return;
-				}
-			}
-		}
-
-		HandleNewPackages (shortInfos, componentId, component, repoUrl);
+				};
 	}
 
 	void Core::handlePackageFetched (const PackageInfo& pInfo,
 			int componentId)
 	{
-		try
-		{
-			Storage_->AddPackages (pInfo);
+		auto future = ScheduleWrite (*StorageThread_,
+				[pInfo, componentId] (Storage *storage)
+				{
+					storage->AddPackages (pInfo);
 
-			QStringList versions = pInfo.Versions_;
-			std::sort (versions.begin (), versions.end (), IsVersionLess);
-			const auto& greatest = versions.last ();
+					QStringList versions = pInfo.Versions_;
+					std::sort (versions.begin (), versions.end (), IsVersionLess);
+					const auto& greatest = versions.last ();
 
-			Q_FOREACH (const auto& version, pInfo.Versions_)
-			{
-				const int packageId = Storage_->FindPackage (pInfo.Name_, version);
-				Storage_->AddLocation (packageId, componentId);
+					int greatestId = -1;
+					for (const auto& version : pInfo.Versions_)
+					{
+						const int packageId = storage->FindPackage (pInfo.Name_, version);
+						storage->AddLocation (packageId, componentId);
 
-				if (version == greatest)
+						if (version == greatest)
+							greatestId = packageId;
+					}
+					return std::make_pair (greatest, greatestId);
+				});
+		Util::Sequence (this, future) >>
+				[this, pInfo] (const auto& result)
 				{
-					const auto& existing = PackagesModel_->FindPackage (pInfo.Name_).Version_;
-					if (existing.isEmpty ())
-						PackagesModel_->AddRow (Storage_->GetSingleListPackageInfo (packageId));
-					else if (IsVersionLess (existing, greatest))
+					const auto reportError = [this, &pInfo] (const QString& error)
 					{
-						auto info = Storage_->GetSingleListPackageInfo (packageId);
-						info.HasNewVersion_ = info.IsInstalled_;
-						PackagesModel_->UpdateRow (info);
+						pInfo.Dump ();
+						qWarning () << Q_FUNC_INFO
+								<< error;
+						emit gotEntity (Util::MakeNotification (tr ("Error retrieving package"),
+								tr ("Unable to save package %1.")
+									.arg (pInfo.Name_),
+								PCritical_));
+					};
+
+					if (result.IsLeft ())
+					{
+						reportError (result.GetLeft ());
+						return;
 					}
-				}
-			}
 
-			emit tagsUpdated (GetAllTags ());
-		}
-		catch (const std::runtime_error& e)
-		{
-			pInfo.Dump ();
-			qWarning () << Q_FUNC_INFO
-					<< e.what ();
-			emit gotEntity (Util::MakeNotification (tr ("Error retrieving package"),
-					tr ("Unable to save package %1.")
-						.arg (pInfo.Name_),
-					PCritical_));
-		}
+					try
+					{
+						const auto& [greatest, packageId] = result.GetRight ();
+
+						const auto& existing = PackagesModel_->FindPackage (pInfo.Name_).Version_;
+						if (existing.isEmpty ())
+							PackagesModel_->AddRow (Storage_->GetSingleListPackageInfo (packageId));
+						else if (IsVersionLess (existing, greatest))
+						{
+							auto info = Storage_->GetSingleListPackageInfo (packageId);
+							info.HasNewVersion_ = info.IsInstalled_;
+							PackagesModel_->UpdateRow (info);
+						}
+
+						emit tagsUpdated (GetAllTags ());
+					}
+					catch (const std::runtime_error& e)
+					{
+						reportError (QString::fromUtf8 (e.what ()));
+					}
+				};
 
 		if (pInfo.IconURL_.isValid ())
 		{
@@ -1167,67 +1177,6 @@ namespace LackMan
 					PCritical_));
 	}
 
-	void Core::handlePackageInstalled (int packageId)
-	{
-		if (!RecordInstalled (packageId))
-			return;
-
-		UpdateRowFor (packageId);
-
-		PendingManager_->SuccessfullyInstalled (packageId);
-
-		QString packageName;
-		try
-		{
-			packageName = Storage_->GetPackage (packageId).Name_;
-		}
-		catch (const std::exception& e)
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "while trying to get installed package name"
-					<< e.what ();
-			return;
-		}
-
-		emit gotEntity (Util::MakeNotification (tr ("Package installed"),
-					tr ("Package %1 installed successfully.")
-						.arg ("<em>" + packageName + "</em>"),
-					PInfo_));
-
-		emit packageRowActionFinished (GetPackageRow (packageId));
-	}
-
-	void Core::handlePackageUpdated (int fromId, int packageId)
-	{
-		if (!RecordUninstalled (fromId) ||
-				!RecordInstalled (packageId))
-			return;
-
-		UpdateRowFor (packageId);
-
-		PendingManager_->SuccessfullyUpdated (packageId);
-
-		QString packageName;
-		try
-		{
-			packageName = Storage_->GetPackage (packageId).Name_;
-		}
-		catch (const std::exception& e)
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "while trying to get installed package name"
-					<< e.what ();
-			return;
-		}
-
-		emit gotEntity (Util::MakeNotification (tr ("Package updated"),
-					tr ("Package %1 updated successfully.")
-						.arg ("<em>" + packageName + "</em>"),
-					PInfo_));
-
-		emit packageRowActionFinished (GetPackageRow (packageId));
-	}
-
 	void Core::handlePackageRemoved (int packageId)
 	{
 		PackagesModel_->RemovePackage (packageId);
@@ -29,8 +29,10 @@
 
 #ifndef PLUGINS_LACKMAN_CORE_H
 #define PLUGINS_LACKMAN_CORE_H
+#include <memory>
 #include <QObject>
 #include <QModelIndex>
+#include <util/threads/workerthreadbasefwd.h>
 #include <interfaces/iinfo.h>
 #include "repoinfo.h"
 
@@ -49,6 +51,7 @@ namespace LackMan
 	class PendingManager;
 	class PackageProcessor;
 	class UpdatesNotificationManager;
+	struct ComponentUpdate;
 
 	class Core : public QObject
 	{
@@ -58,6 +61,10 @@ namespace LackMan
 		RepoInfoFetcher *RepoInfoFetcher_ = nullptr;
 		ExternalResourceManager *ExternalResourceManager_;
 		Storage *Storage_;
+
+		using StorageThread_t = Util::WorkerThread<Storage>;
+		std::shared_ptr<StorageThread_t> StorageThread_;
+
 		PackagesModel *PackagesModel_;
 		PendingManager *PendingManager_;
 		PackageProcessor *PackageProcessor_;
@@ -104,12 +111,13 @@ namespace LackMan
 		InstalledDependencyInfoList GetLackManInstalledPackages () const;
 		InstalledDependencyInfoList GetAllInstalledPackages () const;
 		void PopulatePluginsModel ();
-		void HandleNewPackages (const PackageShortInfoList& shorts,
-				int componentId, const QString& component, const QUrl& repoUrl);
+		void HandleComponentUpdate (const ComponentUpdate&, const QString& component);
 		void PerformRemoval (int);
 		void UpdateRowFor (int);
-		bool RecordInstalled (int);
-		bool RecordUninstalled (int);
+		void RecordUninstalled (int);
+		void HandlePackagesProcessed (const QList<int>& installed, const QMap<int, int>& updated);
+		void HandleInstalledRecordFailed (const QList<int>& installed, const QString& error);
+		void HandleInstalledRecorded (const QList<int>& installed, const QMap<int, int>& updated);
 		int GetPackageRow (int packageId) const;
 		void ReadSettings ();
 		void WriteSettings ();
@@ -128,8 +136,6 @@ namespace LackMan
 				const QString&, int);
 		void handlePackageFetched (const PackageInfo&, int);
 		void handlePackageInstallError (int, const QString&);
-		void handlePackageInstalled (int);
-		void handlePackageUpdated (int from, int to);
 		void handlePackageRemoved (int);
 	signals:
 		void delegateEntity (const LeechCraft::Entity&,
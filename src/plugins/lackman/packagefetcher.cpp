@@ -0,0 +1,190 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "packagefetcher.h"
+#include <algorithm>
+#include <QFile>
+#include <QTimer>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QtDebug>
+
+namespace LeechCraft
+{
+namespace LackMan
+{
+	namespace
+	{
+		const int ThrottleInterval = 100;
+	}
+
+	PackageFetcher::PackageFetcher (QNetworkAccessManager *nam, QObject *parent)
+	: QObject { parent }
+	, NAM_ { nam }
+	, ThrottleTimer_ { new QTimer { this } }
+	{
+		ThrottleTimer_->setInterval (ThrottleInterval);
+		connect (ThrottleTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (throttle ()));
+	}
+
+	void PackageFetcher::SetMaxParallel (int max)
+	{
+		MaxParallel_ = std::max (max, 1);
+		StartScheduled ();
+	}
+
+	void PackageFetcher::SetBandwidthLimit (qint64 limit)
+	{
+		BandwidthLimit_ = std::max<qint64> (limit, 0);
+
+		const auto quota = GetPerReplyQuota ();
+		for (const auto reply : Active_.keys ())
+			reply->setReadBufferSize (quota);
+
+		if (BandwidthLimit_ && !Active_.isEmpty ())
+			ThrottleTimer_->start ();
+		else
+			ThrottleTimer_->stop ();
+	}
+
+	void PackageFetcher::Fetch (const QUrl& url, const QString& path)
+	{
+		Scheduled_.append ({ url, path });
+		StartScheduled ();
+	}
+
+	void PackageFetcher::StartScheduled ()
+	{
+		while (!Scheduled_.isEmpty () && Active_.size () < MaxParallel_)
+		{
+			const auto scheduled = Scheduled_.takeFirst ();
+
+			const auto file = std::make_shared<QFile> (scheduled.Path_);
+			if (!file->open (QIODevice::WriteOnly | QIODevice::Truncate))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to open"
+						<< file->fileName ()
+						<< "for writing:"
+						<< file->errorString ();
+				emit fetchFailed (scheduled.URL_,
+						tr ("Unable to open %1 for writing: %2.")
+							.arg (file->fileName ())
+							.arg (file->errorString ()));
+				continue;
+			}
+
+			QNetworkRequest req { scheduled.URL_ };
+			req.setAttribute (QNetworkRequest::FollowRedirectsAttribute, true);
+			const auto reply = NAM_->get (req);
+			Active_ [reply] = { scheduled.URL_, file };
+
+			connect (reply,
+					SIGNAL (readyRead ()),
+					this,
+					SLOT (handleReadyRead ()));
+			connect (reply,
+					SIGNAL (finished ()),
+					this,
+					SLOT (handleFinished ()));
+		}
+
+		const auto quota = GetPerReplyQuota ();
+		for (const auto reply : Active_.keys ())
+			reply->setReadBufferSize (quota);
+
+		if (BandwidthLimit_ && !Active_.isEmpty () && !ThrottleTimer_->isActive ())
+			ThrottleTimer_->start ();
+	}
+
+	void PackageFetcher::Finish (QNetworkReply *reply)
+	{
+		reply->deleteLater ();
+
+		const auto active = Active_.take (reply);
+		if (!active.File_)
+			return;
+
+		active.File_->write (reply->readAll ());
+		active.File_->close ();
+
+		if (reply->error () != QNetworkReply::NoError)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "error fetching"
+					<< active.URL_
+					<< reply->errorString ();
+			active.File_->remove ();
+			emit fetchFailed (active.URL_, reply->errorString ());
+		}
+		else
+			emit fetched (active.URL_);
+
+		if (Active_.isEmpty ())
+			ThrottleTimer_->stop ();
+
+		StartScheduled ();
+	}
+
+	qint64 PackageFetcher::GetPerReplyQuota () const
+	{
+		if (!BandwidthLimit_ || Active_.isEmpty ())
+			return 0;
+
+		const auto perTick = BandwidthLimit_ * ThrottleInterval / 1000;
+		return std::max<qint64> (perTick / Active_.size (), 1024);
+	}
+
+	void PackageFetcher::handleReadyRead ()
+	{
+		if (BandwidthLimit_)
+			return;
+
+		const auto reply = qobject_cast<QNetworkReply*> (sender ());
+		const auto& active = Active_.value (reply);
+		if (active.File_)
+			active.File_->write (reply->readAll ());
+	}
+
+	void PackageFetcher::handleFinished ()
+	{
+		Finish (qobject_cast<QNetworkReply*> (sender ()));
+	}
+
+	void PackageFetcher::throttle ()
+	{
+		const auto quota = GetPerReplyQuota ();
+		for (auto i = Active_.begin (), end = Active_.end (); i != end; ++i)
+			i->File_->write (i.key ()->read (quota));
+	}
+}
+}
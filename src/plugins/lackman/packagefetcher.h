@@ -0,0 +1,103 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <QObject>
+#include <QHash>
+#include <QUrl>
+
+class QFile;
+class QTimer;
+class QNetworkAccessManager;
+class QNetworkReply;
+
+namespace LeechCraft
+{
+namespace LackMan
+{
+	/** Downloads package archives with a limited number of parallel
+	 * downloads and an optional bandwidth cap shared between all of
+	 * them.
+	 *
+	 * Archives are fetched in the order they have been passed to
+	 * Fetch().
+	 */
+	class PackageFetcher : public QObject
+	{
+		Q_OBJECT
+
+		QNetworkAccessManager * const NAM_;
+
+		int MaxParallel_ = 3;
+		qint64 BandwidthLimit_ = 0;
+
+		struct Scheduled
+		{
+			QUrl URL_;
+			QString Path_;
+		};
+		QList<Scheduled> Scheduled_;
+
+		struct Active
+		{
+			QUrl URL_;
+			std::shared_ptr<QFile> File_;
+		};
+		QHash<QNetworkReply*, Active> Active_;
+
+		QTimer * const ThrottleTimer_;
+	public:
+		PackageFetcher (QNetworkAccessManager*, QObject* = nullptr);
+
+		void SetMaxParallel (int);
+
+		/** @brief Sets the total download speed limit.
+		 *
+		 * @param[in] limit The limit in bytes per second, or 0 to
+		 * disable limiting.
+		 */
+		void SetBandwidthLimit (qint64 limit);
+
+		void Fetch (const QUrl& url, const QString& path);
+	private:
+		void StartScheduled ();
+		void Finish (QNetworkReply*);
+		qint64 GetPerReplyQuota () const;
+	private slots:
+		void handleReadyRead ();
+		void handleFinished ();
+		void throttle ();
+	signals:
+		void fetched (const QUrl&);
+		void fetchFailed (const QUrl&, const QString&);
+	};
+}
+}
@@ -29,19 +29,217 @@
 
 #include "packageprocessor.h"
 #include <stdexcept>
+#include <algorithm>
 #include <QFile>
 #include <QDirIterator>
 #include <QFileInfo>
+#include <QTimer>
+#include <QtConcurrentRun>
 #include <util/util.h>
 #include <util/sys/paths.h>
+#include <util/threads/futures.h>
+#include <interfaces/core/icoreproxy.h>
 #include "core.h"
 #include "externalresourcemanager.h"
+#include "packagefetcher.h"
 #include "storage.h"
+#include "xmlsettingsmanager.h"
 
 namespace LeechCraft
 {
 namespace LackMan
 {
+	namespace
+	{
+		bool CleanupDir (const QString& directory)
+		{
+#ifndef QT_NO_DEBUG
+			qDebug () << Q_FUNC_INFO
+					<< directory;
+#endif
+
+			QDir dir (directory);
+			for (const auto& subdir : dir.entryList (QDir::Dirs | QDir::NoDotAndDotDot))
+				if (!CleanupDir (dir.absoluteFilePath (subdir)))
+				{
+					qWarning () << Q_FUNC_INFO
+							<< "failed to cleanup subdir"
+							<< subdir
+							<< "for"
+							<< directory;
+					return false;
+				}
+
+			for (const auto& entry : dir.entryList (QDir::Files | QDir::Hidden | QDir::System))
+				if (!dir.remove (entry))
+				{
+					qWarning () << Q_FUNC_INFO
+							<< "failed to remove file"
+							<< entry
+							<< "for dir"
+							<< directory;
+					return false;
+				}
+
+			const auto& dirName = dir.dirName ();
+			if (!dir.cdUp ())
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "cannot cd up from"
+						<< directory;
+				return false;
+			}
+
+			const auto res = dir.rmdir (dirName);
+			if (!res)
+				qWarning () << Q_FUNC_INFO
+						<< "cannot remove directory"
+						<< dirName
+						<< "from parent"
+						<< dir.absolutePath ();
+
+			return res;
+		}
+
+		/** Returns an empty string if the archive at the path looks
+		 * sane, or the error description otherwise.
+		 */
+		QString VerifyArchive (const QString& path, qint64 expectedSize)
+		{
+			QFile file (path);
+			if (!file.open (QIODevice::ReadOnly))
+				return PackageProcessor::tr ("Unable to open package archive %1: %2.")
+						.arg (path)
+						.arg (file.errorString ());
+
+			const auto size = file.size ();
+			if (!size)
+				return PackageProcessor::tr ("Package archive is empty.");
+
+			if (expectedSize > 0 && size != expectedSize)
+				return PackageProcessor::tr ("Package archive size mismatch: expected %1 bytes, got %2 bytes.")
+						.arg (expectedSize)
+						.arg (size);
+
+			return {};
+		}
+
+		QString HandleEntry (const QFileInfo& fi,
+				const QString& stagingDir, QDir& packageDir, QFile& dbFile)
+		{
+			QString sourceName = fi.absoluteFilePath ();
+			sourceName = sourceName.mid (stagingDir.length ());
+			if (sourceName.at (0) == '/')
+				sourceName = sourceName.mid (1);
+
+			if (fi.isFile ())
+			{
+				QString destName = packageDir.filePath (sourceName);
+#ifndef QT_NO_DEBUG
+				qDebug () << Q_FUNC_INFO
+						<< "gotta copy"
+						<< fi.absoluteFilePath ()
+						<< "to"
+						<< destName;
+#endif
+
+				QFile file (fi.absoluteFilePath ());
+				if (!file.copy (destName))
+				{
+					qWarning () << Q_FUNC_INFO
+							<< "could not copy"
+							<< fi.absoluteFilePath ()
+							<< "to"
+							<< destName
+							<< "because of"
+							<< file.errorString ();
+
+					return PackageProcessor::tr ("Could not copy file %1 because of %2.")
+							.arg (sourceName)
+							.arg (file.errorString ());
+				}
+			}
+			else if (fi.isDir ())
+			{
+#ifndef QT_NO_DEBUG
+				qDebug () << Q_FUNC_INFO
+						<< "gotta create"
+						<< sourceName
+						<< "for"
+						<< fi.absoluteFilePath ();
+#endif
+
+				if (!packageDir.mkpath (sourceName))
+				{
+					qWarning () << Q_FUNC_INFO
+							<< "unable to mkdir"
+							<< sourceName
+							<< "in"
+							<< packageDir.path ();
+
+					return PackageProcessor::tr ("Unable to create directory %1.")
+							.arg (sourceName);
+				}
+			}
+
+			dbFile.write (sourceName.toUtf8 ());
+			dbFile.write ("\n");
+
+			return {};
+		}
+
+		/** Copies the unpacked files from the staging directory to the
+		 * package directory, recording them in the package DB file,
+		 * and then removes the staging directory.
+		 *
+		 * Returns an empty string on success or the error description
+		 * otherwise.
+		 */
+		QString InstallStaged (const QString& stagingDir,
+				QDir packageDir, const QString& dbFilePath)
+		{
+			QFile dbFile (dbFilePath);
+			if (!dbFile.open (QIODevice::WriteOnly | QIODevice::Append))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "could not open DB file"
+						<< dbFile.fileName ()
+						<< "for write:"
+						<< dbFile.errorString ();
+				CleanupDir (stagingDir);
+				return PackageProcessor::tr ("Could not open database file %1: %2.")
+						.arg (dbFile.fileName ())
+						.arg (dbFile.errorString ());
+			}
+
+			QString error;
+
+			QDirIterator dirIt (stagingDir,
+					QDir::NoDotAndDotDot |
+						QDir::Readable |
+						QDir::NoSymLinks |
+						QDir::Dirs |
+						QDir::Files,
+					QDirIterator::Subdirectories);
+			while (dirIt.hasNext ())
+			{
+				dirIt.next ();
+				const auto& fi = dirIt.fileInfo ();
+
+				if (fi.isDir () ||
+						fi.isFile ())
+				{
+					error = HandleEntry (fi, stagingDir, packageDir, dbFile);
+					if (!error.isEmpty ())
+						break;
+				}
+			}
+
+			CleanupDir (stagingDir);
+			return error;
+		}
+	}
+
 	PackageProcessor::PackageProcessor (QObject *parent)
 	: QObject (parent)
 	, DBDir_ (Util::CreateIfNotExists ("lackman/filesdb/"))
@@ -156,30 +354,152 @@ namespace LackMan
 
 	void PackageProcessor::Install (int packageId)
 	{
-		const QUrl& url = GetURLFor (packageId);
+		Schedule (packageId, MInstall);
+	}
+
+	void PackageProcessor::Update (int toPackageId)
+	{
+		Schedule (toPackageId, MUpdate);
+	}
+
+	void PackageProcessor::Schedule (int packageId, Mode mode)
+	{
+		if (Jobs_.contains (packageId))
+			return;
 
-		ExternalResourceManager *erm = PrepareResourceManager ();
+		const auto& url = GetURLFor (packageId);
 
+		const auto storage = Core::Instance ().GetStorage ();
+		const auto& info = storage->GetPackage (packageId);
+
+		Job job
+		{
+			packageId,
+			mode,
+			url,
+			info.Name_,
+			info.VersionArchivers_.value (info.Versions_.value (0), "gz"),
+			storage->GetPackageSize (packageId),
+			{},
+			JobState::Scheduled,
+			{}
+		};
+		Jobs_ [packageId] = job;
 		URL2Id_ [url] = packageId;
-		URL2Mode_ [url] = MInstall;
-		erm->GetResourceData (url);
+
+		if (!BatchScheduled_)
+		{
+			BatchScheduled_ = true;
+			QTimer::singleShot (0,
+					this,
+					SLOT (startBatch ()));
+		}
 	}
 
-	void PackageProcessor::Update (int toPackageId)
+	void PackageProcessor::startBatch ()
 	{
-		QUrl url = GetURLFor (toPackageId);
+		BatchScheduled_ = false;
+
+		QHash<QString, int> name2id;
+		for (const auto& job : Jobs_)
+			if (job.State_ != JobState::Failed)
+				name2id [job.Name_] = job.PackageID_;
+
+		QList<int> scheduled;
+		for (auto& job : Jobs_)
+		{
+			if (job.State_ != JobState::Scheduled)
+				continue;
+
+			scheduled << job.PackageID_;
+
+			for (const auto& dep : Core::Instance ().GetDependencies (job.PackageID_))
+			{
+				const auto depId = name2id.value (dep.Name_, -1);
+				if (depId != -1 && depId != job.PackageID_)
+					job.Deps_ << depId;
+			}
+		}
+
+		/* Start fetching the dependencies before their dependents,
+		 * falling back to the original order on cycles.
+		 */
+		QList<int> ordered;
+		QSet<int> orderedSet;
+		while (!scheduled.isEmpty ())
+		{
+			auto pos = std::find_if (scheduled.begin (), scheduled.end (),
+					[this, &orderedSet] (int id)
+					{
+						for (const auto dep : Jobs_ [id].Deps_)
+							if (!orderedSet.contains (dep) &&
+									Jobs_ [dep].State_ == JobState::Scheduled)
+								return false;
+						return true;
+					});
+			if (pos == scheduled.end ())
+				pos = scheduled.begin ();
+
+			ordered << *pos;
+			orderedSet << *pos;
+			scheduled.erase (pos);
+		}
 
-		ExternalResourceManager *erm = PrepareResourceManager ();
+		const auto fetcher = PrepareFetcher ();
+		const auto erm = Core::Instance ().GetExtResourceManager ();
+		for (const auto id : ordered)
+		{
+			auto& job = Jobs_ [id];
+			job.State_ = JobState::Fetching;
+			fetcher->Fetch (job.URL_, erm->GetResourcePath (job.URL_));
+		}
+	}
 
-		URL2Id_ [url] = toPackageId;
-		URL2Mode_ [url] = MUpdate;
-		erm->GetResourceData (url);
+	void PackageProcessor::handleFetcherSettingsChanged ()
+	{
+		if (!Fetcher_)
+			return;
+
+		const auto xsm = XmlSettingsManager::Instance ();
+		Fetcher_->SetMaxParallel (xsm->property ("MaxParallelDownloads").toInt ());
+		Fetcher_->SetBandwidthLimit (xsm->property ("DownloadSpeedLimit").toLongLong () * 1024);
 	}
 
 	void PackageProcessor::handleResourceFetched (const QUrl& url)
 	{
-		if (URL2Id_.contains (url))
-			HandleFile (URL2Id_.take (url), url, URL2Mode_.take (url));
+		const auto id = URL2Id_.value (url, -1);
+		if (id == -1 || Jobs_ [id].State_ != JobState::Fetching)
+			return;
+
+		const auto& path = Core::Instance ().GetExtResourceManager ()->GetResourcePath (url);
+		const auto expectedSize = Jobs_ [id].ExpectedSize_;
+		Util::Sequence (this, QtConcurrent::run ([path, expectedSize] { return VerifyArchive (path, expectedSize); })) >>
+				[this, id] (const QString& error)
+				{
+					if (!Jobs_.contains (id) || Jobs_ [id].State_ != JobState::Fetching)
+						return;
+
+					if (!error.isEmpty ())
+					{
+						qWarning () << Q_FUNC_INFO
+								<< "verification failed for"
+								<< id
+								<< error;
+						Fail (id, error);
+						return;
+					}
+
+					Unpack (id);
+				};
+	}
+
+	void PackageProcessor::handleResourceFetchFailed (const QUrl& url, const QString& error)
+	{
+		const auto id = URL2Id_.value (url, -1);
+		if (id == -1 || Jobs_ [id].State_ != JobState::Fetching)
+			return;
+
+		Fail (id, tr ("Unable to download package archive: %1.").arg (error));
 	}
 
 	void PackageProcessor::handlePackageUnarchFinished (int ret, QProcess::ExitStatus)
@@ -189,13 +509,17 @@ namespace LackMan
 		QProcess *unarch = qobject_cast<QProcess*> (sender ());
 		int packageId = unarch->property ("PackageID").toInt ();
 		const auto& stagingDir = unarch->property ("StagingDirectory").toString ();
-		Mode mode = static_cast<Mode> (unarch->property ("Mode").toInt ());
 
-		auto cleanupGuard = std::shared_ptr<void> (nullptr,
-				[&stagingDir, this] (void*) { CleanupDir (stagingDir); });
+		if (!Jobs_.contains (packageId) || Jobs_ [packageId].State_ != JobState::Unpacking)
+		{
+			CleanupDir (stagingDir);
+			return;
+		}
 
 		if (ret)
 		{
+			CleanupDir (stagingDir);
+
 			QString errString = QString::fromUtf8 (unarch->readAllStandardError ());
 			qWarning () << Q_FUNC_INFO
 					<< "unpacker exited with"
@@ -208,129 +532,48 @@ namespace LackMan
 			QString errorString = tr ("Unable to unpack package archive, unpacker exited with %1: %2.")
 					.arg (ret)
 					.arg (errString);
-			emit packageInstallError (packageId, errorString);
-
-			return;
-		}
-
-		int oldId = -1;
-		if (mode == MUpdate)
-		{
-			oldId = Core::Instance ().GetStorage ()->FindInstalledPackage (packageId);
-			if (!CleanupBeforeUpdate (oldId, packageId))
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "unable to cleanup";
-				return;
-			}
-		}
-
-		QDir packageDir;
-		try
-		{
-			packageDir = Core::Instance ().GetPackageDir (packageId);
-		}
-		catch (const std::exception& e)
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "while trying to get dir for package"
-					<< packageId
-					<< "got we exception"
-					<< e.what ();
-			QString errorString = tr ("Unable to get directory for the package: %1.")
-					.arg (QString::fromUtf8 (e.what ()));
-			emit packageInstallError (packageId, errorString);
+			Fail (packageId, errorString);
 			return;
 		}
 
-		QDirIterator dirIt (stagingDir,
-				QDir::NoDotAndDotDot |
-					QDir::Readable |
-					QDir::NoSymLinks |
-					QDir::Dirs |
-					QDir::Files,
-				QDirIterator::Subdirectories);
-		while (dirIt.hasNext ())
-		{
-			dirIt.next ();
-			QFileInfo fi = dirIt.fileInfo ();
+		auto& job = Jobs_ [packageId];
+		job.State_ = JobState::Unpacked;
+		job.StagingDir_ = stagingDir;
 
-			if (fi.isDir () ||
-					fi.isFile ())
-				if (!HandleEntry (packageId, fi, stagingDir, packageDir))
-				{
-					try
-					{
-						Remove (packageId);
-					}
-					catch (const std::exception& e)
-					{
-						qWarning () << Q_FUNC_INFO
-								<< "while removing partially installed package"
-								<< packageId
-								<< "got:"
-								<< e.what ();
-					}
-
-					QString errorString = tr ("Unable to copy "
-							"files from staging area to "
-							"destination directory.");
-					emit packageInstallError (packageId, errorString);
-					return;
-				}
-		}
-
-		switch (mode)
-		{
-		case MInstall:
-			emit packageInstalled (packageId);
-			break;
-		case MUpdate:
-			emit packageUpdated (oldId, packageId);
-			break;
-		}
+		InstallReady ();
 	}
 
 	void PackageProcessor::handleUnarchError (QProcess::ProcessError error)
 	{
 		sender ()->deleteLater ();
 
+		const auto packageId = sender ()->property ("PackageID").toInt ();
+		CleanupDir (sender ()->property ("StagingDirectory").toString ());
+
 		QByteArray errString = qobject_cast<QProcess*> (sender ())->readAllStandardError ();
 		qWarning () << Q_FUNC_INFO
 				<< "unable to unpack for"
-				<< sender ()->property ("PackageID").toInt ()
+				<< packageId
 				<< sender ()->property ("Path").toString ()
 				<< "with"
 				<< error
 				<< errString;
 
+		if (!Jobs_.contains (packageId) || Jobs_ [packageId].State_ != JobState::Unpacking)
+			return;
+
 		QString errorString = tr ("Unable to unpack package archive, unpacker died with %1: %2.")
 				.arg (error)
 				.arg (QString::fromUtf8 (errString));
-		emit packageInstallError (sender ()->property ("PackageID").toInt (),
-				errorString);
-
-		CleanupDir (sender ()->property ("StagingDirectory").toString ());
+		Fail (packageId, errorString);
 	}
 
-	void PackageProcessor::HandleFile (int packageId,
-			const QUrl& url, PackageProcessor::Mode mode)
+	void PackageProcessor::Unpack (int packageId)
 	{
-		QString path = Core::Instance ().GetExtResourceManager ()->GetResourcePath (url);
+		auto& job = Jobs_ [packageId];
+		job.State_ = JobState::Unpacking;
 
-		PackageShortInfo info;
-		try
-		{
-			info = Core::Instance ().GetStorage ()->GetPackage (packageId);
-		}
-		catch (const std::exception& e)
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to get package info for"
-					<< packageId
-					<< e.what ();
-			return;
-		}
+		QString path = Core::Instance ().GetExtResourceManager ()->GetResourcePath (job.URL_);
 
 		QProcess *unarch = new QProcess (this);
 		connect (unarch,
@@ -362,8 +605,7 @@ namespace LackMan
 			<< "-so"
 			<< path;
 #else
-		const auto& archiver = info.VersionArchivers_.value (info.Versions_.value (0), "gz");
-		if (archiver == "lzma")
+		if (job.Archiver_ == "lzma")
 			args << "--lzma";
 		args << "-xf";
 		args << path;
@@ -373,7 +615,6 @@ namespace LackMan
 		unarch->setProperty ("PackageID", packageId);
 		unarch->setProperty ("StagingDirectory", dirname);
 		unarch->setProperty ("Path", path);
-		unarch->setProperty ("Mode", mode);
 
 		QFileInfo sdInfo (dirname);
 		QDir stagingParentDir (sdInfo.path ());
@@ -386,10 +627,11 @@ namespace LackMan
 					<< "in"
 					<< sdInfo.path ();
 
+			unarch->deleteLater ();
+
 			QString errorString = tr ("Unable to create staging directory %1.")
 					.arg (sdInfo.fileName ());
-			emit packageInstallError (packageId, errorString);
-
+			Fail (packageId, errorString);
 			return;
 		}
 
@@ -402,183 +644,192 @@ namespace LackMan
 		unarch->start (command, args);
 	}
 
-	QUrl PackageProcessor::GetURLFor (int packageId) const
+	void PackageProcessor::InstallReady ()
 	{
-		const auto& urls = Core::Instance ().GetPackageURLs (packageId);
-		if (!urls.size ())
-			throw std::runtime_error (tr ("No URLs for package %1.")
-					.arg (packageId).toUtf8 ().constData ());
+		for (auto& job : Jobs_)
+		{
+			if (job.State_ != JobState::Unpacked)
+				continue;
 
-		QUrl url = urls.at (0);
-		qDebug () << Q_FUNC_INFO
-				<< "would fetch"
-				<< packageId
-				<< "from"
-				<< url;
-		return url;
+			const bool depsReady = std::all_of (job.Deps_.begin (), job.Deps_.end (),
+					[this] (int dep) { return Jobs_.value (dep).State_ == JobState::Done; });
+			if (!depsReady)
+				continue;
+
+			const auto packageId = job.PackageID_;
+			const auto stagingDir = job.StagingDir_;
+
+			int oldId = -1;
+			if (job.Mode_ == MUpdate)
+				try
+				{
+					oldId = Core::Instance ().GetStorage ()->FindInstalledPackage (packageId);
+					Remove (oldId);
+				}
+				catch (const std::exception& e)
+				{
+					qWarning () << Q_FUNC_INFO
+							<< "while removing package"
+							<< oldId
+							<< "for update to"
+							<< packageId
+							<< "got exception:"
+							<< e.what ();
+					CleanupDir (stagingDir);
+					Fail (packageId, tr ("Unable to update package: %1.")
+								.arg (QString::fromUtf8 (e.what ())));
+					return InstallReady ();
+				}
+
+			QDir packageDir;
+			try
+			{
+				packageDir = Core::Instance ().GetPackageDir (packageId);
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "while trying to get dir for package"
+						<< packageId
+						<< "got we exception"
+						<< e.what ();
+				CleanupDir (stagingDir);
+				Fail (packageId, tr ("Unable to get directory for the package: %1.")
+							.arg (QString::fromUtf8 (e.what ())));
+				return InstallReady ();
+			}
+
+			job.State_ = JobState::Installing;
+
+			const auto& dbFilePath = DBDir_.filePath (QString::number (packageId));
+			Util::Sequence (this,
+					QtConcurrent::run ([=] { return InstallStaged (stagingDir, packageDir, dbFilePath); })) >>
+					[this, packageId, oldId] (const QString& error)
+					{
+						if (!error.isEmpty ())
+						{
+							try
+							{
+								Remove (packageId);
+							}
+							catch (const std::exception& e)
+							{
+								qWarning () << Q_FUNC_INFO
+										<< "while removing partially installed package"
+										<< packageId
+										<< "got:"
+										<< e.what ();
+							}
+
+							Fail (packageId, error);
+							InstallReady ();
+							return;
+						}
+
+						auto& job = Jobs_ [packageId];
+						job.State_ = JobState::Done;
+						switch (job.Mode_)
+						{
+						case MInstall:
+							Installed_ << packageId;
+							break;
+						case MUpdate:
+							Updated_ [packageId] = oldId;
+							break;
+						}
+
+						InstallReady ();
+						CheckBatchFinished ();
+					};
+		}
 	}
 
-	ExternalResourceManager* PackageProcessor::PrepareResourceManager ()
+	void PackageProcessor::Fail (int packageId, const QString& error)
 	{
-		ExternalResourceManager *erm = Core::Instance ().GetExtResourceManager ();
-		connect (erm,
-				SIGNAL (resourceFetched (const QUrl&)),
-				this,
-				SLOT (handleResourceFetched (const QUrl&)),
-				Qt::UniqueConnection);
-		return erm;
+		FailJob (packageId, error);
+		CheckBatchFinished ();
 	}
 
-	bool PackageProcessor::HandleEntry (int packageId, const QFileInfo& fi,
-			const QString& stagingDir, QDir& packageDir)
+	void PackageProcessor::FailJob (int packageId, const QString& error)
 	{
-		QFile dbFile (DBDir_.filePath (QString::number (packageId)));
-		if (!dbFile.open (QIODevice::WriteOnly | QIODevice::Append))
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "could not open DB file"
-					<< dbFile.fileName ()
-					<< "for write:"
-					<< dbFile.errorString ();
-			return false;
-		}
+		auto& job = Jobs_ [packageId];
+		if (job.State_ == JobState::Failed)
+			return;
 
-		QString sourceName = fi.absoluteFilePath ();
-		sourceName = sourceName.mid (stagingDir.length ());
-		if (sourceName.at (0) == '/')
-			sourceName = sourceName.mid (1);
+		if (job.State_ == JobState::Unpacked)
+			CleanupDir (job.StagingDir_);
 
-		if (fi.isFile ())
-		{
-			QString destName = packageDir.filePath (sourceName);
-#ifndef QT_NO_DEBUG
-			qDebug () << Q_FUNC_INFO
-					<< "gotta copy"
-					<< fi.absoluteFilePath ()
-					<< "to"
-					<< destName;
-#endif
+		job.State_ = JobState::Failed;
+		emit packageInstallError (packageId, error);
 
-			QFile file (fi.absoluteFilePath ());
-			if (!file.copy (destName))
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "could not copy"
-						<< fi.absoluteFilePath ()
-						<< "to"
-						<< destName
-						<< "because of"
-						<< file.errorString ();
+		QList<int> dependents;
+		for (const auto& other : Jobs_)
+			if (other.Deps_.contains (packageId) &&
+					other.State_ != JobState::Installing &&
+					other.State_ != JobState::Done)
+				dependents << other.PackageID_;
 
-				QString errorString = tr ("Could not copy file %1 because of %2.")
-						.arg (sourceName)
-						.arg (file.errorString ());
-				emit packageInstallError (packageId, errorString);
-				return false;
-			}
-		}
-		else if (fi.isDir ())
-		{
-#ifndef QT_NO_DEBUG
-			qDebug () << Q_FUNC_INFO
-					<< "gotta create"
-					<< sourceName
-					<< "for"
-					<< fi.absoluteFilePath ();
-#endif
+		const auto& depError = tr ("Dependency %1 could not be installed.")
+				.arg (job.Name_);
+		for (const auto dependent : dependents)
+			FailJob (dependent, depError);
+	}
 
-			if (!packageDir.mkpath (sourceName))
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "unable to mkdir"
-						<< sourceName
-						<< "in"
-						<< packageDir.path ();
+	void PackageProcessor::CheckBatchFinished ()
+	{
+		const bool finished = std::all_of (Jobs_.begin (), Jobs_.end (),
+				[] (const Job& job) { return job.State_ == JobState::Done || job.State_ == JobState::Failed; });
+		if (!finished || BatchScheduled_)
+			return;
 
-				QString errorString = tr ("Unable to create directory %1.")
-						.arg (sourceName);
-				emit packageInstallError (packageId, errorString);
-				return false;
-			}
-		}
+		Jobs_.clear ();
+		URL2Id_.clear ();
 
-		dbFile.write (sourceName.toUtf8 ());
-		dbFile.write ("\n");
+		const auto installed = Installed_;
+		const auto updated = Updated_;
+		Installed_.clear ();
+		Updated_.clear ();
 
-		return true;
+		if (!installed.isEmpty () || !updated.isEmpty ())
+			emit packagesProcessed (installed, updated);
 	}
 
-	bool PackageProcessor::CleanupBeforeUpdate (int oldId, int newId)
+	QUrl PackageProcessor::GetURLFor (int packageId) const
 	{
-		try
-		{
-			Remove (oldId);
-		}
-		catch (const std::exception& e)
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "while removing package"
-					<< oldId
-					<< "for update to"
-					<< newId
-					<< "got exception:"
-					<< e.what ();
-			const auto& str = tr ("Unable to update package: %1.")
-					.arg (QString::fromUtf8 (e.what ()));
-			emit packageInstallError (newId, str);
-			return false;
-		}
-		return true;
-	}
+		const auto& urls = Core::Instance ().GetPackageURLs (packageId);
+		if (!urls.size ())
+			throw std::runtime_error (tr ("No URLs for package %1.")
+					.arg (packageId).toUtf8 ().constData ());
 
-	bool PackageProcessor::CleanupDir (const QString& directory)
-	{
-#ifndef QT_NO_DEBUG
+		QUrl url = urls.at (0);
 		qDebug () << Q_FUNC_INFO
-				<< directory;
-#endif
-
-		QDir dir (directory);
-		for (const auto& subdir : dir.entryList (QDir::Dirs | QDir::NoDotAndDotDot))
-			if (!CleanupDir (dir.absoluteFilePath (subdir)))
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "failed to cleanup subdir"
-						<< subdir
-						<< "for"
-						<< directory;
-				return false;
-			}
+				<< "would fetch"
+				<< packageId
+				<< "from"
+				<< url;
+		return url;
+	}
 
-		for (const auto& entry : dir.entryList (QDir::Files | QDir::Hidden | QDir::System))
-			if (!dir.remove (entry))
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "failed to remove file"
-						<< entry
-						<< "for dir"
-						<< directory;
-				return false;
-			}
+	PackageFetcher* PackageProcessor::PrepareFetcher ()
+	{
+		if (Fetcher_)
+			return Fetcher_;
 
-		const auto& dirName = dir.dirName ();
-		if (!dir.cdUp ())
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "cannot cd up from"
-					<< directory;
-			return false;
-		}
+		Fetcher_ = new PackageFetcher (Core::Instance ().GetProxy ()->GetNetworkAccessManager (), this);
+		connect (Fetcher_,
+				SIGNAL (fetched (const QUrl&)),
+				this,
+				SLOT (handleResourceFetched (const QUrl&)));
+		connect (Fetcher_,
+				SIGNAL (fetchFailed (const QUrl&, const QString&)),
+				this,
+				SLOT (handleResourceFetchFailed (const QUrl&, const QString&)));
 
-		const auto res = dir.rmdir (dirName);
-		if (!res)
-			qWarning () << Q_FUNC_INFO
-					<< "cannot remove directory"
-					<< dirName
-					<< "from parent"
-					<< dir.absolutePath ();
+		XmlSettingsManager::Instance ()->RegisterObject ({ "MaxParallelDownloads", "DownloadSpeedLimit" },
+				this, "handleFetcherSettingsChanged");
+		handleFetcherSettingsChanged ();
 
-		return res;
+		return Fetcher_;
 	}
 }
 }
@@ -32,6 +32,8 @@
 #include <QObject>
 #include <QDir>
 #include <QHash>
+#include <QMap>
+#include <QSet>
 #include <QUrl>
 #include <QProcess>
 
@@ -39,14 +41,24 @@ namespace LeechCraft
 {
 namespace LackMan
 {
-	class ExternalResourceManager;
+	class PackageFetcher;
 
+	/** Installs, updates and removes packages.
+	 *
+	 * Packages scheduled via Install() and Update() during a single
+	 * event loop iteration form a batch. Archives of the batch are
+	 * downloaded in parallel (dependencies first), verified and
+	 * unpacked as soon as they arrive, and then copied to their
+	 * destination once all their dependencies from the same batch
+	 * are installed. The packagesProcessed() signal is emitted once
+	 * the whole batch is handled.
+	 */
 	class PackageProcessor : public QObject
 	{
 		Q_OBJECT
 
 		QDir DBDir_;
-		QHash<QUrl, int> URL2Id_;
+		PackageFetcher *Fetcher_ = nullptr;
 
 		enum Mode
 		{
@@ -54,7 +66,36 @@ namespace LackMan
 			MUpdate
 		};
 
-		QHash<QUrl, Mode> URL2Mode_;
+		enum class JobState
+		{
+			Scheduled,
+			Fetching,
+			Unpacking,
+			Unpacked,
+			Installing,
+			Done,
+			Failed
+		};
+
+		struct Job
+		{
+			int PackageID_ = -1;
+			Mode Mode_ = MInstall;
+			QUrl URL_;
+			QString Name_;
+			QString Archiver_;
+			qint64 ExpectedSize_ = 0;
+
+			QSet<int> Deps_;
+			JobState State_ = JobState::Scheduled;
+			QString StagingDir_;
+		};
+		QHash<int, Job> Jobs_;
+		QHash<QUrl, int> URL2Id_;
+		bool BatchScheduled_ = false;
+
+		QList<int> Installed_;
+		QMap<int, int> Updated_;
 	public:
 		PackageProcessor (QObject* = 0);
 
@@ -62,40 +103,46 @@ namespace LackMan
 		void Install (int);
 		void Update (int);
 	private slots:
+		void startBatch ();
+		void handleFetcherSettingsChanged ();
 		void handleResourceFetched (const QUrl&);
+		void handleResourceFetchFailed (const QUrl&, const QString&);
 		void handlePackageUnarchFinished (int, QProcess::ExitStatus);
 		void handleUnarchError (QProcess::ProcessError);
 	private:
-		/** @brief This does all the heavy duty of installing a
-			* package.
-			*
-			* Package is identified by its id downloaded from the
-			* given url.
-			*
-			* This function can install or update the package to
-			* the given target id, depending on installation mode.
-			*
-			* This function expects that the package at the url is
-			* already fetched.
-			*
-			* @param[in] id The ID of the package.
-			* @param[in] url The exact URL from which the package
-			* @param[in] mode The handling mode.
-			* has been downloaded.
-			*/
-		void HandleFile (int id, const QUrl& url, Mode mode);
+		void Schedule (int id, Mode mode);
 
-		QUrl GetURLFor (int id) const;
-		ExternalResourceManager* PrepareResourceManager ();
+		/** @brief Starts unpacking the archive of the given package
+		 * to a staging directory.
+		 *
+		 * This function expects that the package archive is already
+		 * fetched and verified.
+		 *
+		 * @param[in] id The ID of the package.
+		 */
+		void Unpack (int id);
 
-		bool HandleEntry (int id, const QFileInfo& fi,
-				const QString& stagingDir, QDir& packageDir);
-		bool CleanupBeforeUpdate (int oldId, int toId);
-		bool CleanupDir (const QString&);
+		/** Copies the unpacked files of the packages whose
+		 * dependencies are already installed to their destination
+		 * directories.
+		 */
+		void InstallReady ();
+		void Fail (int id, const QString& error);
+		void FailJob (int id, const QString& error);
+		void CheckBatchFinished ();
+
+		QUrl GetURLFor (int id) const;
+		PackageFetcher* PrepareFetcher ();
 	signals:
 		void packageInstallError (int, const QString&);
-		void packageInstalled (int);
-		void packageUpdated (int from, int to);
+
+		/** @brief Emitted once all the packages in a batch are handled.
+		 *
+		 * @param[out] installed The IDs of the newly installed packages.
+		 * @param[out] updated The map from the IDs of the updated
+		 * packages to the IDs of the versions they replaced.
+		 */
+		void packagesProcessed (const QList<int>& installed, const QMap<int, int>& updated);
 	};
 }
 }
@@ -259,6 +259,28 @@ namespace LackMan
 			}
 	}
 
+	void PackagesModel::RemovePackages (const QSet<int>& packageIds)
+	{
+		if (packageIds.isEmpty ())
+			return;
+
+		for (int end = Packages_.size () - 1; end >= 0; --end)
+		{
+			if (!packageIds.contains (Packages_.at (end).PackageID_))
+				continue;
+
+			int begin = end;
+			while (begin > 0 && packageIds.contains (Packages_.at (begin - 1).PackageID_))
+				--begin;
+
+			beginRemoveRows (QModelIndex (), begin, end);
+			Packages_.erase (Packages_.begin () + begin, Packages_.begin () + end + 1);
+			endRemoveRows ();
+
+			end = begin;
+		}
+	}
+
 	ListPackageInfo PackagesModel::FindPackage (const QString& name) const
 	{
 		const auto pos = std::find_if (Packages_.begin (), Packages_.end (),
@@ -30,6 +30,7 @@
 #pragma once
 
 #include <QAbstractItemModel>
+#include <QSet>
 #include "repoinfo.h"
 
 namespace LeechCraft
@@ -80,6 +81,7 @@ namespace LackMan
 		void AddRow (const ListPackageInfo&);
 		void UpdateRow (const ListPackageInfo&);
 		void RemovePackage (int);
+		void RemovePackages (const QSet<int>&);
 		ListPackageInfo FindPackage (const QString&) const;
 		int GetRow (int packageId) const;
 		void Clear ();
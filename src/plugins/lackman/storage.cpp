@@ -71,8 +71,13 @@ namespace LackMan
 	}
 
 	Storage::Storage (QObject *parent)
+	: Storage ("LackManConnectionAvailable", parent)
+	{
+	}
+
+	Storage::Storage (const QString& connName, QObject *parent)
 	: QObject (parent)
-	, DB_ (QSqlDatabase::addDatabase ("QSQLITE", "LackManConnectionAvailable"))
+	, DB_ (QSqlDatabase::addDatabase ("QSQLITE", connName))
 	{
 		DB_.setDatabaseName (Util::CreateIfNotExists ("lackman").filePath ("availablepackages.db"));
 
@@ -87,6 +92,7 @@ namespace LackMan
 		QSqlQuery query (DB_);
 		query.exec ("PRAGMA foreign_keys = ON;");
 		query.exec ("PRAGMA synchronous = OFF;");
+		query.exec ("PRAGMA busy_timeout = 5000;");
 
 		InitTables ();
 		InitQueries ();
@@ -764,6 +770,73 @@ namespace LackMan
 		return result;
 	}
 
+	namespace
+	{
+		PackagesIndex_t ReadPackagesIndex (QSqlQuery& query)
+		{
+			if (!query.exec ())
+			{
+				Util::DBLock::DumpError (query);
+				throw std::runtime_error ("Query execution failed");
+			}
+
+			PackagesIndex_t result;
+			while (query.next ())
+				result [{ query.value (1).toString (), query.value (2).toString () }] = query.value (0).toInt ();
+
+			query.finish ();
+			return result;
+		}
+	}
+
+	PackagesIndex_t Storage::GetPackagesIndex ()
+	{
+		return ReadPackagesIndex (QueryGetPackagesIndex_);
+	}
+
+	PackagesIndex_t Storage::GetComponentPackagesIndex (int componentId)
+	{
+		QueryGetComponentPackagesIndex_.bindValue (":component_id", componentId);
+		return ReadPackagesIndex (QueryGetComponentPackagesIndex_);
+	}
+
+	ComponentUpdate Storage::UpdateComponent (int repoId,
+			const QString& component, const PackageShortInfoList& fetched)
+	{
+		Util::DBLock lock (DB_);
+		lock.Init ();
+
+		ComponentUpdate result;
+		result.ComponentID_ = FindComponent (repoId, component);
+		if (result.ComponentID_ == -1)
+			result.ComponentID_ = AddComponent (repoId, component);
+
+		result.RepoUrl_ = GetRepo (repoId).GetUrl ();
+
+		const auto& diff = DiffComponent (GetComponentPackagesIndex (result.ComponentID_),
+				GetPackagesIndex (), fetched);
+
+		const auto& installed = GetInstalledPackagesIDs ();
+		for (const auto packageId : diff.Removed_)
+		{
+			RemoveLocation (packageId, result.ComponentID_);
+
+			if (installed.contains (packageId))
+				continue;
+
+			RemovePackage (packageId);
+			result.RemovedPackages_ << packageId;
+		}
+
+		for (const auto packageId : diff.Relocated_)
+			AddLocation (packageId, result.ComponentID_);
+
+		lock.Good ();
+
+		result.NewVersions_ = diff.NewVersions_;
+		return result;
+	}
+
 	QMap<QString, QList<ListPackageInfo>> Storage::GetListPackageInfos ()
 	{
 		if (!QueryGetListPackageInfos_.exec ())
@@ -1067,6 +1140,19 @@ namespace LackMan
 		}
 	}
 
+	void Storage::UpdateInstalled (const QList<int>& installed, const QList<int>& uninstalled)
+	{
+		Util::DBLock lock (DB_);
+		lock.Init ();
+
+		for (const auto packageId : uninstalled)
+			RemoveFromInstalled (packageId);
+		for (const auto packageId : installed)
+			AddToInstalled (packageId);
+
+		lock.Good ();
+	}
+
 	void Storage::InitTables ()
 	{
 		QSqlQuery query (DB_);
@@ -1211,6 +1297,15 @@ namespace LackMan
 		QueryGetPackagesInComponent_ = QSqlQuery (DB_);
 		QueryGetPackagesInComponent_.prepare ("SELECT DISTINCT package_id FROM locations WHERE component_id = :component_id;");
 
+		QueryGetPackagesIndex_ = QSqlQuery (DB_);
+		QueryGetPackagesIndex_.prepare ("SELECT package_id, name, version FROM packages;");
+
+		QueryGetComponentPackagesIndex_ = QSqlQuery (DB_);
+		QueryGetComponentPackagesIndex_.prepare ("SELECT DISTINCT packages.package_id, packages.name, packages.version "
+				"FROM packages, locations "
+				"WHERE locations.package_id = packages.package_id "
+				"AND locations.component_id = :component_id;");
+
 		QueryGetListPackageInfos_ = QSqlQuery (DB_);
 		QueryGetListPackageInfos_.prepare ("SELECT DISTINCT packages.package_id, packages.name, packages.version, "
 				"infos.short_descr, infos.long_descr, infos.type, infos.language, infos.icon_url FROM packages, infos "
@@ -32,9 +32,9 @@
 #include <QObject>
 #include <QSqlDatabase>
 #include <QSqlQuery>
+#include <QUrl>
 #include "repoinfo.h"
-
-class QUrl;
+#include "componentdiff.h"
 
 namespace LeechCraft
 {
@@ -43,6 +43,15 @@ namespace LackMan
 	class RepoInfo;
 	struct PackageInfo;
 
+	struct ComponentUpdate
+	{
+		int ComponentID_;
+		QUrl RepoUrl_;
+
+		QList<int> RemovedPackages_;
+		QMap<QString, QStringList> NewVersions_;
+	};
+
 	class Storage : public QObject
 	{
 		Q_OBJECT
@@ -81,6 +90,8 @@ namespace LackMan
 		QSqlQuery QueryClearDeps_;
 		QSqlQuery QueryAddDep_;
 		QSqlQuery QueryGetPackagesInComponent_;
+		QSqlQuery QueryGetPackagesIndex_;
+		QSqlQuery QueryGetComponentPackagesIndex_;
 		QSqlQuery QueryGetListPackageInfos_;
 		QSqlQuery QueryGetSingleListPackageInfo_;
 		QSqlQuery QueryGetPackageTags_;
@@ -93,6 +104,7 @@ namespace LackMan
 		QSqlQuery QueryRemoveFromInstalled_;
 	public:
 		Storage (QObject* = 0);
+		Storage (const QString& connName, QObject* = 0);
 
 		int CountPackages (const QUrl& repoUrl);
 
@@ -120,6 +132,10 @@ namespace LackMan
 
 		QMap<int, QList<QString>> GetPackageLocations (int);
 		QList<int> GetPackagesInComponent (int);
+		PackagesIndex_t GetPackagesIndex ();
+		PackagesIndex_t GetComponentPackagesIndex (int);
+		ComponentUpdate UpdateComponent (int repoId,
+				const QString& component, const PackageShortInfoList& fetched);
 		QMap<QString, QList<ListPackageInfo>> GetListPackageInfos ();
 		QList<Image> GetImages (const QString&);
 		ListPackageInfo GetSingleListPackageInfo (int);
@@ -135,6 +151,11 @@ namespace LackMan
 
 		void AddToInstalled (int);
 		void RemoveFromInstalled (int);
+
+		/** Records the \em installed packages as installed and the
+		 * \em uninstalled ones as uninstalled in a single transaction.
+		 */
+		void UpdateInstalled (const QList<int>& installed, const QList<int>& uninstalled);
 	private:
 		void InitTables ();
 		void InitQueries ();
@@ -36,7 +36,6 @@
 #include <QStandardItemModel>
 #include <QMessageBox>
 #include <QClipboard>
-#include <QMutexLocker>
 #include <QFileInfo>
 #include <QtDebug>
 #include <taglib/taglib_config.h>
@@ -324,9 +323,10 @@ namespace LMP
 		if (info.LocalPath_.isEmpty ())
 			return;
 
-		QMutexLocker tlLocker (&Core::Instance ().GetLocalFileResolver ()->GetMutex ());
+		const auto resolver = Core::Instance ().GetLocalFileResolver ();
+		const auto tlGuard = resolver->LockForReading (info.LocalPath_);
 
-		auto r = Core::Instance ().GetLocalFileResolver ()->GetFileRef (info.LocalPath_);
+		auto r = resolver->GetFileRef (info.LocalPath_);
 		auto tag = r.tag ();
 		if (!tag)
 			return;
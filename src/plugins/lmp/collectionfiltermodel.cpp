@@ -0,0 +1,87 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "collectionfiltermodel.h"
+#include "localcollectionmodel.h"
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	CollectionFilterModel::CollectionFilterModel (QObject *parent)
+	: QSortFilterProxyModel { parent }
+	{
+		setDynamicSortFilter (true);
+	}
+
+	void CollectionFilterModel::SetMatches (const boost::optional<CollectionSearchIndex::Matches>& matches)
+	{
+		Matches_ = matches;
+		invalidateFilter ();
+	}
+
+	bool CollectionFilterModel::filterAcceptsRow (int sourceRow, const QModelIndex& sourceParent) const
+	{
+		const auto& source = sourceModel ()->index (sourceRow, 0, sourceParent);
+		const auto type = source.data (LocalCollectionModel::Role::Node).toInt ();
+		if (type == LocalCollectionModel::NodeType::Track &&
+				source.data (LocalCollectionModel::Role::IsTrackIgnored).toBool ())
+			return false;
+
+		if (!Matches_)
+		{
+			if (type == LocalCollectionModel::NodeType::Track)
+				return true;
+
+			// artists and albums whose tracks are all hidden are hidden too
+			const auto childrenCount = sourceModel ()->rowCount (source);
+			if (!childrenCount)
+				return true;
+
+			for (int i = 0; i < childrenCount; ++i)
+				if (filterAcceptsRow (i, source))
+					return true;
+			return false;
+		}
+
+		const auto artistId = source.data (LocalCollectionModel::Role::ArtistID).toInt ();
+		switch (type)
+		{
+		case LocalCollectionModel::NodeType::Artist:
+			return Matches_->Artists_.contains (artistId);
+		case LocalCollectionModel::NodeType::Album:
+			return Matches_->Albums_.contains ({ artistId, source.data (LocalCollectionModel::Role::AlbumID).toInt () });
+		case LocalCollectionModel::NodeType::Track:
+			return Matches_->Tracks_.contains ({ artistId, source.data (LocalCollectionModel::Role::TrackID).toInt () });
+		}
+
+		return false;
+	}
+}
+}
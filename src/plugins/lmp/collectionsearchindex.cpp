@@ -0,0 +1,118 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "collectionsearchindex.h"
+#include <QStringList>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	namespace
+	{
+		quint64 GetTrigram (const QChar *str)
+		{
+			return (static_cast<quint64> (str [0].unicode ()) << 32) |
+					(static_cast<quint64> (str [1].unicode ()) << 16) |
+					static_cast<quint64> (str [2].unicode ());
+		}
+	}
+
+	CollectionSearchIndex::CollectionSearchIndex (const CollectionSearchEntries_t& entries)
+	{
+		Entries_.reserve (entries.size ());
+		for (const auto& entry : entries)
+		{
+			const auto entryIdx = Entries_.size ();
+			Entries_ << entry;
+
+			const auto& text = entry.Text_;
+			const auto data = text.constData ();
+			for (int i = 0; i + 3 <= text.size (); ++i)
+			{
+				auto& postings = Trigram2Entries_ [GetTrigram (data + i)];
+				if (postings.isEmpty () || postings.last () != entryIdx)
+					postings << entryIdx;
+			}
+		}
+
+		for (auto& postings : Trigram2Entries_)
+			postings.squeeze ();
+	}
+
+	CollectionSearchIndex::Matches CollectionSearchIndex::Match (const QString& pattern) const
+	{
+		const auto& folded = pattern.toCaseFolded ();
+
+		Matches result;
+		auto addMatch = [&result] (const CollectionSearchEntry& entry)
+		{
+			result.Artists_ << entry.ArtistID_;
+			result.Albums_ << qMakePair (entry.ArtistID_, entry.AlbumID_);
+			result.Tracks_ << qMakePair (entry.ArtistID_, entry.TrackID_);
+		};
+
+		if (folded.size () < 3)
+		{
+			for (const auto& entry : Entries_)
+				if (entry.Text_.contains (folded))
+					addMatch (entry);
+			return result;
+		}
+
+		// Only the rarest trigram of the pattern is used to pick the
+		// candidates, the candidates are then checked directly.
+		const QVector<int> *candidates = nullptr;
+		const auto data = folded.constData ();
+		for (int i = 0; i + 3 <= folded.size (); ++i)
+		{
+			const auto pos = Trigram2Entries_.constFind (GetTrigram (data + i));
+			if (pos == Trigram2Entries_.constEnd ())
+				return result;
+
+			if (!candidates || pos->size () < candidates->size ())
+				candidates = &*pos;
+		}
+
+		for (const auto idx : *candidates)
+		{
+			const auto& entry = Entries_.at (idx);
+			if (entry.Text_.contains (folded))
+				addMatch (entry);
+		}
+
+		return result;
+	}
+
+	QString CollectionSearchIndex::Fold (const QStringList& fields)
+	{
+		return fields.join ('\n').toCaseFolded ();
+	}
+}
+}
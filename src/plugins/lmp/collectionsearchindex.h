@@ -0,0 +1,85 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QString>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	/** A single track as seen by the collection filter.
+	 *
+	 * Text_ contains all the searchable fields of the track, already
+	 * case-folded and separated by newlines, so that a substring match
+	 * against it is equivalent to matching each of the fields.
+	 */
+	struct CollectionSearchEntry
+	{
+		int ArtistID_;
+		int AlbumID_;
+		int TrackID_;
+
+		QString Text_;
+	};
+
+	/** Entries keyed by the (artist ID, track ID) pair, since the same
+	 * track may be shown under several artists.
+	 */
+	using CollectionSearchEntries_t = QHash<QPair<int, int>, CollectionSearchEntry>;
+
+	/** @brief Immutable trigram index over the collection tracks.
+	 *
+	 * Building the index and matching against it doesn't touch any
+	 * models, so both can be done in a worker thread.
+	 */
+	class CollectionSearchIndex
+	{
+		QVector<CollectionSearchEntry> Entries_;
+		QHash<quint64, QVector<int>> Trigram2Entries_;
+	public:
+		struct Matches
+		{
+			QSet<int> Artists_;
+			QSet<QPair<int, int>> Albums_;
+			QSet<QPair<int, int>> Tracks_;
+		};
+
+		explicit CollectionSearchIndex (const CollectionSearchEntries_t&);
+
+		Matches Match (const QString& pattern) const;
+
+		static QString Fold (const QStringList& fields);
+	};
+}
+}
@@ -28,10 +28,12 @@
  **********************************************************************/
 
 #include "collectionwidget.h"
-#include <QSortFilterProxyModel>
 #include <QMessageBox>
 #include <QMenu>
+#include <QTimer>
+#include <QtConcurrentRun>
 #include <util/gui/clearlineeditaddon.h>
+#include <util/threads/futures.h>
 #include <util/util.h>
 #include <util/xpc/defaulthookproxy.h>
 #include <interfaces/core/iiconthememanager.h>
@@ -45,58 +47,18 @@
 #include "collectionsmanager.h"
 #include "hookinterconnector.h"
 #include "player.h"
+#include "collectionfiltermodel.h"
+#include "collectionsearchindex.h"
 
 namespace LeechCraft
 {
 namespace LMP
 {
-	namespace
-	{
-		class CollectionFilterModel : public QSortFilterProxyModel
-		{
-		public:
-			CollectionFilterModel (QObject *parent = nullptr)
-			: QSortFilterProxyModel { parent }
-			{
-				setDynamicSortFilter (true);
-			}
-		protected:
-			bool filterAcceptsRow (int sourceRow, const QModelIndex& sourceParent) const
-			{
-				const auto& source = sourceModel ()->index (sourceRow, 0, sourceParent);
-				if (source.data (LocalCollectionModel::Role::IsTrackIgnored).toBool ())
-					return false;
-
-				const auto type = source.data (LocalCollectionModel::Role::Node).toInt ();
-				const bool isTrack = type == LocalCollectionModel::NodeType::Track;
-				const auto childrenCount = sourceModel ()->rowCount (source);
-				if (!isTrack)
-					for (int i = 0; i < childrenCount; ++i)
-						if (filterAcceptsRow (i, source))
-							return true;
-
-				const auto& pattern = filterRegExp ().pattern ();
-
-				if (pattern.isEmpty () && !isTrack && childrenCount)
-					return false;
-
-				auto check = [&source, &pattern] (int role)
-				{
-					return source.data (role).toString ().contains (pattern, Qt::CaseInsensitive);
-				};
-				return check (Qt::DisplayRole) ||
-						check (LocalCollectionModel::Role::ArtistName) ||
-						check (LocalCollectionModel::Role::AlbumName) ||
-						check (LocalCollectionModel::Role::TrackTitle) ||
-						check (LocalCollectionModel::Role::AlbumYear);
-			}
-		};
-	}
-
 	CollectionWidget::CollectionWidget (QWidget *parent)
 	: QWidget { parent }
 	, Player_ { Core::Instance ().GetPlayer () }
 	, CollectionFilterModel_ { new CollectionFilterModel { this } }
+	, FilterTimer_ { new QTimer { this } }
 	{
 		Ui_.setupUi (this);
 
@@ -127,10 +89,21 @@ namespace LMP
 				this,
 				SLOT (loadFromCollection ()));
 
+		FilterTimer_->setSingleShot (true);
+		FilterTimer_->setInterval (150);
+		connect (FilterTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (applyFilter ()));
+
 		connect (Ui_.CollectionFilter_,
 				SIGNAL (textChanged (QString)),
-				CollectionFilterModel_,
-				SLOT (setFilterFixedString (QString)));
+				this,
+				SLOT (handleFilterTextChanged ()));
+		connect (Core::Instance ().GetLocalCollection ()->GetCollectionModel (),
+				SIGNAL (searchEntriesChanged ()),
+				this,
+				SLOT (handleSearchEntriesChanged ()));
 
 		Core::Instance ().GetHookInterconnector ()->RegisterHookable (this);
 	}
@@ -330,5 +303,70 @@ namespace LMP
 			Ui_.ScanProgress_->show ();
 		Ui_.ScanProgress_->setValue (progress);
 	}
+
+	void CollectionWidget::handleFilterTextChanged ()
+	{
+		if (Ui_.CollectionFilter_->text ().isEmpty ())
+		{
+			FilterTimer_->stop ();
+			++LastFilterRequest_;
+			CollectionFilterModel_->SetMatches ({});
+			return;
+		}
+
+		FilterTimer_->start ();
+	}
+
+	void CollectionWidget::handleSearchEntriesChanged ()
+	{
+		++CollectionGen_;
+		SearchIndex_.reset ();
+
+		if (!Ui_.CollectionFilter_->text ().isEmpty ())
+			FilterTimer_->start ();
+	}
+
+	namespace
+	{
+		struct FilterResult
+		{
+			std::shared_ptr<const CollectionSearchIndex> Index_;
+			CollectionSearchIndex::Matches Matches_;
+		};
+	}
+
+	void CollectionWidget::applyFilter ()
+	{
+		const auto& pattern = Ui_.CollectionFilter_->text ();
+		if (pattern.isEmpty ())
+			return;
+
+		const auto requestId = ++LastFilterRequest_;
+		const auto gen = CollectionGen_;
+
+		auto index = SearchIndex_;
+		const auto& entries = index ?
+				CollectionSearchEntries_t {} :
+				Core::Instance ().GetLocalCollection ()->GetSearchEntries ();
+
+		Util::Sequence (this,
+				QtConcurrent::run ([index, entries, pattern]
+					{
+						const auto& realIndex = index ?
+								index :
+								std::make_shared<const CollectionSearchIndex> (entries);
+						return FilterResult { realIndex, realIndex->Match (pattern) };
+					})) >>
+				[this, requestId, gen] (const FilterResult& result)
+				{
+					if (gen == CollectionGen_)
+						SearchIndex_ = result.Index_;
+
+					if (requestId != LastFilterRequest_)
+						return;
+
+					CollectionFilterModel_->SetMatches (result.Matches_);
+				};
+	}
 }
 }
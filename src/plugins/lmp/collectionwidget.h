@@ -29,11 +29,12 @@
 
 #pragma once
 
+#include <memory>
 #include <QWidget>
 #include <interfaces/core/ihookproxy.h>
 #include "ui_collectionwidget.h"
 
-class QSortFilterProxyModel;
+class QTimer;
 
 namespace LeechCraft
 {
@@ -41,6 +42,8 @@ namespace LMP
 {
 	class Player;
 	struct MediaInfo;
+	class CollectionFilterModel;
+	class CollectionSearchIndex;
 
 	class CollectionWidget : public QWidget
 	{
@@ -50,10 +53,19 @@ namespace LMP
 
 		Player * const Player_;
 
-		QSortFilterProxyModel * const CollectionFilterModel_;
+		CollectionFilterModel * const CollectionFilterModel_;
+
+		QTimer * const FilterTimer_;
+		std::shared_ptr<const CollectionSearchIndex> SearchIndex_;
+		quint64 CollectionGen_ = 1;
+		quint64 LastFilterRequest_ = 0;
 	public:
 		CollectionWidget (QWidget* = nullptr);
 	private slots:
+		void handleFilterTextChanged ();
+		void handleSearchEntriesChanged ();
+		void applyFilter ();
+
 		void showCollectionTrackProps ();
 		void showCollectionAlbumArt ();
 		void showAlbumArtManager ();
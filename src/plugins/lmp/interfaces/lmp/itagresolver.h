@@ -31,7 +31,7 @@
 
 #include <QtPlugin>
 
-class QMutex;
+class QReadWriteLock;
 
 namespace TagLib
 {
@@ -66,9 +66,17 @@ namespace LMP
 
 		virtual TagLib::FileRef GetFileRef (const QString&) const = 0;
 		virtual ResolveResult_t ResolveInfo (const QString&) = 0;
-		virtual QMutex& GetMutex () = 0;
+		/** @brief Returns the lock guarding the TagLib file access.
+		 *
+		 * Reading the tags only requires the lock to be locked for
+		 * reading, so that many files can be read in parallel, while
+		 * modifying the tags requires locking it for writing.
+		 *
+		 * @return The TagLib access lock.
+		 */
+		virtual QReadWriteLock& GetLock () = 0;
 	};
 }
 }
 
-Q_DECLARE_INTERFACE (LeechCraft::LMP::ITagResolver, "org.LeechCraft.LMP.ITagResolver/1.0")
+Q_DECLARE_INTERFACE (LeechCraft::LMP::ITagResolver, "org.LeechCraft.LMP.ITagResolver/2.0")
@@ -119,6 +119,11 @@ namespace LMP
 		return CollectionModel_->GetTrackData (trackId, role);
 	}
 
+	const CollectionSearchEntries_t& LocalCollection::GetSearchEntries () const
+	{
+		return CollectionModel_->GetSearchEntries ();
+	}
+
 	void LocalCollection::Clear ()
 	{
 		Storage_->Clear ();
@@ -212,6 +212,7 @@ namespace LMP
 						item->setIcon (ArtistIcon_);
 						item->setText (artist.Name_);
 						item->setData (artist.Name_, Role::ArtistName);
+						item->setData (artist.ID_, Role::ArtistID);
 						item->setData (NodeType::Artist, Role::Node);
 					},
 					this,
@@ -228,6 +229,8 @@ namespace LMP
 							item->setData (album->Year_, Role::AlbumYear);
 							item->setData (album->Name_, Role::AlbumName);
 							item->setData (artist.Name_, Role::ArtistName);
+							item->setData (artist.ID_, Role::ArtistID);
+							item->setData (album->ID_, Role::AlbumID);
 							item->setData (NodeType::Album, Role::Node);
 							if (!album->CoverPath_.isEmpty ())
 								item->setData (album->CoverPath_, Role::AlbumArt);
@@ -236,6 +239,9 @@ namespace LMP
 						album->ID_,
 						artist.ID_);
 
+				const auto& albumText = albumItem->text ();
+				const auto& yearStr = QString::number (album->Year_);
+
 				for (const auto& track : album->Tracks_)
 				{
 					const QString& name = QString::fromUtf8 ("%1 — %2")
@@ -246,6 +252,8 @@ namespace LMP
 					item->setData (album->Year_, Role::AlbumYear);
 					item->setData (album->Name_, Role::AlbumName);
 					item->setData (artist.Name_, Role::ArtistName);
+					item->setData (artist.ID_, Role::ArtistID);
+					item->setData (album->ID_, Role::AlbumID);
 					item->setData (track.ID_, Role::TrackID);
 					item->setData (track.Number_, Role::TrackNumber);
 					item->setData (track.Name_, Role::TrackTitle);
@@ -256,9 +264,19 @@ namespace LMP
 					albumItem->appendRow (item);
 
 					Track2Item_ [track.ID_] = item;
+
+					SearchEntries_ [{ artist.ID_, track.ID_ }] =
+					{
+						artist.ID_,
+						album->ID_,
+						track.ID_,
+						CollectionSearchIndex::Fold ({ name, track.Name_, albumText, album->Name_, artist.Name_, yearStr })
+					};
 				}
 			}
 		}
+
+		emit searchEntriesChanged ();
 	}
 
 	void LocalCollectionModel::Clear ()
@@ -268,24 +286,36 @@ namespace LMP
 		Artist2Item_.clear ();
 		Album2Item_.clear ();
 		Track2Item_.clear ();
+
+		SearchEntries_.clear ();
+		emit searchEntriesChanged ();
 	}
 
 	void LocalCollectionModel::IgnoreTrack (int id)
 	{
 		auto item = Track2Item_.value (id);
 		item->setData (true, IsTrackIgnored);
+
+		RemoveSearchEntries (item);
+		emit searchEntriesChanged ();
 	}
 
 	void LocalCollectionModel::RemoveTrack (int id)
 	{
 		auto item = Track2Item_.take (id);
+		RemoveSearchEntries (item);
 		item->parent ()->removeRow (item->row ());
+		emit searchEntriesChanged ();
 	}
 
 	void LocalCollectionModel::RemoveAlbum (int id)
 	{
 		for (const auto item : Album2Item_.take (id))
+		{
+			RemoveSearchEntries (item);
 			item->parent ()->removeRow (item->row ());
+		}
+		emit searchEntriesChanged ();
 	}
 
 	QVariant LocalCollectionModel::GetTrackData (int trackId, LocalCollectionModel::Role role) const
@@ -296,7 +326,10 @@ namespace LMP
 
 	void LocalCollectionModel::RemoveArtist (int id)
 	{
-		removeRow (Artist2Item_.take (id)->row ());
+		const auto item = Artist2Item_.take (id);
+		RemoveSearchEntries (item);
+		removeRow (item->row ());
+		emit searchEntriesChanged ();
 	}
 
 	void LocalCollectionModel::SetAlbumArt (int id, const QString& path)
@@ -315,5 +348,25 @@ namespace LMP
 			item = item->parent ();
 		}
 	}
+
+	const CollectionSearchEntries_t& LocalCollectionModel::GetSearchEntries () const
+	{
+		return SearchEntries_;
+	}
+
+	void LocalCollectionModel::RemoveSearchEntries (QStandardItem *item)
+	{
+		if (item->data (Role::Node).toInt () == NodeType::Track)
+		{
+			SearchEntries_.remove ({
+					item->data (Role::ArtistID).toInt (),
+					item->data (Role::TrackID).toInt ()
+				});
+			return;
+		}
+
+		for (int i = 0; i < item->rowCount (); ++i)
+			RemoveSearchEntries (item->child (i));
+	}
 }
 }
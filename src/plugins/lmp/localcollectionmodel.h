@@ -34,6 +34,7 @@
 #include <util/models/dndactionsmixin.h>
 #include "interfaces/lmp/icollectionmodel.h"
 #include "interfaces/lmp/collectiontypes.h"
+#include "collectionsearchindex.h"
 
 namespace LeechCraft
 {
@@ -53,6 +54,8 @@ namespace LMP
 		QHash<int, QStandardItem*> Artist2Item_;
 		QHash<int, QHash<int, QStandardItem*>> Album2Item_;
 		QHash<int, QStandardItem*> Track2Item_;
+
+		CollectionSearchEntries_t SearchEntries_;
 	public:
 		enum NodeType
 		{
@@ -74,7 +77,9 @@ namespace LMP
 			TrackPath,
 			TrackGenres,
 			TrackLength,
-			IsTrackIgnored
+			IsTrackIgnored,
+			ArtistID,
+			AlbumID
 		};
 
 		LocalCollectionModel (LocalCollectionStorage*, QObject*);
@@ -98,6 +103,12 @@ namespace LMP
 		QVariant GetTrackData (int trackId, Role) const;
 
 		void UpdatePlayStats (int);
+
+		const CollectionSearchEntries_t& GetSearchEntries () const;
+	private:
+		void RemoveSearchEntries (QStandardItem*);
+	signals:
+		void searchEntriesChanged ();
 	};
 }
 }
@@ -468,6 +468,17 @@ namespace LMP
 		}
 	}
 
+	void LocalCollectionStorage::SetRgTrackInfos (const QList<QPair<int, RGData>>& infos)
+	{
+		Util::DBLock lock (DB_);
+		lock.Init ();
+
+		for (const auto& pair : infos)
+			SetRgTrackInfo (pair.first, pair.second);
+
+		lock.Good ();
+	}
+
 	RGData LocalCollectionStorage::GetRgTrackInfo (const QString& filepath)
 	{
 		GetTrackRgData_.bindValue (":filepath", filepath);
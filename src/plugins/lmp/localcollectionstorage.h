@@ -132,6 +132,7 @@ namespace LMP
 
 		QList<int> GetOutdatedRgTracks ();
 		void SetRgTrackInfo (int, const RGData&);
+		void SetRgTrackInfos (const QList<QPair<int, RGData>>&);
 		RGData GetRgTrackInfo (const QString&);
 	private:
 		void MarkLovedBanned (int, int);
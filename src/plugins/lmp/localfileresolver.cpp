@@ -30,6 +30,7 @@
 #include "localfileresolver.h"
 #include <QtDebug>
 #include <QFileInfo>
+#include <QSet>
 #include <taglib/fileref.h>
 #include <taglib/tag.h>
 #include <util/sll/prelude.h>
@@ -41,6 +42,27 @@ namespace LeechCraft
 {
 namespace LMP
 {
+	LocalFileResolver::LocalFileResolver (QObject *parent)
+	: QObject { parent }
+	{
+		XmlSettingsManager::Instance ().RegisterObject ({ "EnableLocalTagsRecoding", "TagsRecodingRegion" },
+				this, "handleRecodingSettingsChanged");
+		handleRecodingSettingsChanged ();
+	}
+
+	namespace
+	{
+		/** The formats whose TagLib readers have been checked to keep no
+		 * mutable state shared between different FileRefs, so that the
+		 * files of these formats may be read concurrently.
+		 */
+		bool CanReadConcurrently (const QString& file)
+		{
+			static const QSet<QString> suffixes { "flac", "mp3", "ogg", "oga", "opus", "m4a" };
+			return suffixes.contains (QFileInfo { file }.suffix ().toLower ());
+		}
+	}
+
 	TagLib::FileRef LocalFileResolver::GetFileRef (const QString& file) const
 	{
 #ifdef Q_OS_WIN32
@@ -50,68 +72,99 @@ namespace LMP
 #endif
 	}
 
+	Util::DefaultScopeGuard LocalFileResolver::LockForReading (const QString& file)
+	{
+		if (CanReadConcurrently (file))
+			TaglibLock_.lockForRead ();
+		else
+			TaglibLock_.lockForWrite ();
+
+		return Util::MakeScopeGuard ([this] { TaglibLock_.unlock (); });
+	}
+
 	LocalFileResolver::ResolveResult_t LocalFileResolver::ResolveInfo (const QString& file)
 	{
-		const auto& modified = QFileInfo (file).lastModified ();
+		const QFileInfo fileInfo { file };
+		const auto& modified = fileInfo.lastModified ();
+		const auto size = fileInfo.size ();
 
+		if (const auto cached = GetCached (file, modified, size))
+			return ResolveResult_t::Right (*cached);
+
+		QString region;
 		{
-			QReadLocker locker (&CacheLock_);
-			if (Cache_.contains (file))
-			{
-				const auto& pair = Cache_ [file];
-				if (pair.first == modified)
-					return ResolveResult_t::Right (pair.second);
-			}
+			QMutexLocker locker { &CacheLock_ };
+			region = RecodingRegion_;
 		}
 
-		QMutexLocker tlLocker (&TaglibMutex_);
+		MediaInfo info;
+		{
+			const auto guard = LockForReading (file);
 
-		auto r = GetFileRef (file);
-		auto tag = r.tag ();
-		if (!tag)
-			return ResolveResult_t::Left ({ file, "cannot get audio tags" });
+			auto r = GetFileRef (file);
+			auto tag = r.tag ();
+			if (!tag)
+				return ResolveResult_t::Left ({ file, "cannot get audio tags" });
 
-		auto audio = r.audioProperties ();
+			auto audio = r.audioProperties ();
 
-		auto& xsm = XmlSettingsManager::Instance ();
-		const auto& region = xsm.property ("EnableLocalTagsRecoding").toBool () ?
-				xsm.property ("TagsRecodingRegion").toString () :
-				QString {};
-		auto ftl = [&region] (const TagLib::String& str)
-		{
-			return GstUtil::FixEncoding (QString::fromUtf8 (str.toCString (true)), region);
-		};
+			auto ftl = [&region] (const TagLib::String& str)
+			{
+				return GstUtil::FixEncoding (QString::fromUtf8 (str.toCString (true)), region);
+			};
 
-		const auto& genres = ftl (tag->genre ()).split ('/', QString::SkipEmptyParts);
+			const auto& genres = ftl (tag->genre ()).split ('/', QString::SkipEmptyParts);
+
+			info = MediaInfo
+			{
+				file,
+				ftl (tag->artist ()),
+				ftl (tag->album ()),
+				ftl (tag->title ()),
+				Util::Map (genres, [] (const QString& genre) { return genre.trimmed (); }),
+				audio ? audio->length () : 0,
+				static_cast<qint32> (tag->year ()),
+				static_cast<qint32> (tag->track ())
+			};
+		}
 
-		MediaInfo info
-		{
-			file,
-			ftl (tag->artist ()),
-			ftl (tag->album ()),
-			ftl (tag->title ()),
-			Util::Map (genres, [] (const QString& genre) { return genre.trimmed (); }),
-			audio ? audio->length () : 0,
-			static_cast<qint32> (tag->year ()),
-			static_cast<qint32> (tag->track ())
-		};
 		{
-			QWriteLocker locker (&CacheLock_);
-			if (Cache_.size () > 200)
-				Cache_.clear ();
-			Cache_ [file] = qMakePair (modified, info);
+			QMutexLocker locker { &CacheLock_ };
+			Cache_.insert (file, new CachedInfo { modified, size, info });
 		}
 		return ResolveResult_t::Right (info);
 	}
 
-	QMutex& LocalFileResolver::GetMutex ()
+	QReadWriteLock& LocalFileResolver::GetLock ()
 	{
-		return TaglibMutex_;
+		return TaglibLock_;
 	}
 
-	void LocalFileResolver::flushCache ()
+	boost::optional<MediaInfo> LocalFileResolver::GetCached (const QString& file,
+			const QDateTime& modified, qint64 size)
 	{
-		QWriteLocker locker { &CacheLock_ };
+		QMutexLocker locker { &CacheLock_ };
+		const auto cached = Cache_.object (file);
+		if (!cached ||
+				cached->MTime_ != modified ||
+				cached->Size_ != size)
+			return {};
+
+		return cached->Info_;
+	}
+
+	void LocalFileResolver::handleRecodingSettingsChanged ()
+	{
+		auto& xsm = XmlSettingsManager::Instance ();
+		const auto& region = xsm.property ("EnableLocalTagsRecoding").toBool () ?
+				xsm.property ("TagsRecodingRegion").toString () :
+				QString {};
+
+		QMutexLocker locker { &CacheLock_ };
+		if (region == RecodingRegion_)
+			return;
+
+		RecodingRegion_ = region;
 		Cache_.clear ();
 	}
 }
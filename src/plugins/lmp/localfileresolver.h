@@ -30,12 +30,14 @@
 #pragma once
 
 #include <stdexcept>
+#include <boost/optional.hpp>
 #include <QObject>
-#include <QHash>
 #include <QReadWriteLock>
 #include <QMutex>
+#include <QCache>
 #include <QDateTime>
 #include <taglib/fileref.h>
+#include <util/sll/util.h>
 #include "interfaces/lmp/itagresolver.h"
 #include "mediainfo.h"
 
@@ -49,17 +51,34 @@ namespace LMP
 		Q_OBJECT
 		Q_INTERFACES (LeechCraft::LMP::ITagResolver)
 
-		QMutex TaglibMutex_;
-		QReadWriteLock CacheLock_;
-		QHash<QString, QPair<QDateTime, MediaInfo>> Cache_;
+		QReadWriteLock TaglibLock_;
+
+		struct CachedInfo
+		{
+			QDateTime MTime_;
+			qint64 Size_;
+			MediaInfo Info_;
+		};
+
+		QMutex CacheLock_;
+		QCache<QString, CachedInfo> Cache_ { 2000 };
+		QString RecodingRegion_;
 	public:
-		using QObject::QObject;
+		LocalFileResolver (QObject* = nullptr);
 
 		TagLib::FileRef GetFileRef (const QString&) const;
 		ResolveResult_t ResolveInfo (const QString&);
-		QMutex& GetMutex ();
+		QReadWriteLock& GetLock ();
+
+		/** Locks the TagLib lock for reading the given file, either
+		 * shared or exclusively depending on its format. The lock is
+		 * released when the returned guard is destroyed.
+		 */
+		Util::DefaultScopeGuard LockForReading (const QString&);
+	private:
+		boost::optional<MediaInfo> GetCached (const QString&, const QDateTime&, qint64);
 	private slots:
-		void flushCache ();
+		void handleRecodingSettingsChanged ();
 	};
 }
 }
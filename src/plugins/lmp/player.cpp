@@ -31,11 +31,14 @@
 #include <algorithm>
 #include <QStandardItemModel>
 #include <QFileInfo>
+#include <QSet>
 #include <QDir>
 #include <QUrl>
 #include <QtConcurrentRun>
 #include <QFutureSynchronizer>
 #include <QApplication>
+#include <QTimer>
+#include <QSaveFile>
 #include <util/util.h>
 #include <util/xpc/util.h>
 #include <util/sll/slotclosure.h>
@@ -132,6 +135,11 @@ namespace LMP
 	{
 		ResolveResult_t Resolved_;
 		bool ShouldClear_;
+
+		/** If set, Resolved_ only contains the items to be appended to
+		 * the existing playlist instead of the whole new playlist.
+		 */
+		bool Append_;
 	};
 
 	Player::Player (const ICoreProxy_ptr& proxy, QObject *parent)
@@ -143,6 +151,7 @@ namespace LMP
 	, Path_ (new Path (Source_, Output_))
 	, PRG_ { QDateTime::currentDateTime ().toTime_t () }
 	, RulesManager_ (new PlayerRulesManager (PlaylistModel_, this))
+	, SnapshotSaveTimer_ (new QTimer (this))
 	, FirstPlaylistRestore_ (true)
 	, PlayMode_ (PlayMode::Sequential)
 	{
@@ -187,6 +196,19 @@ namespace LMP
 				SLOT (nextTrack ()));
 
 		PlaylistModel_->setHorizontalHeaderLabels ({ tr ("Playlist") });
+
+		SnapshotSaveTimer_->setSingleShot (true);
+		SnapshotSaveTimer_->setInterval (2000);
+		connect (SnapshotSaveTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (savePlaylistSnapshot ()));
+	}
+
+	Player::~Player ()
+	{
+		if (SnapshotSaveTimer_->isActive ())
+			savePlaylistSnapshot ();
 	}
 
 	void Player::InitWithOtherPlugins ()
@@ -376,13 +398,16 @@ namespace LMP
 		if (CurrentStation_)
 			UnsetRadio ();
 
+		QSet<AudioSource> removed;
 		for (const auto& source : sources)
 		{
 			Url2Info_.remove (source.ToUrl ());
 
-			if (!CurrentQueue_.removeAll (source))
+			if (!Items_.contains (source) || removed.contains (source))
 				continue;
 
+			removed << source;
+
 			RemoveFromOneShotQueue (source);
 
 			auto item = Items_.take (source);
@@ -415,6 +440,13 @@ namespace LMP
 				PlaylistModel_->removeRow (item->row ());
 		}
 
+		if (removed.isEmpty ())
+			return;
+
+		CurrentQueue_.erase (std::remove_if (CurrentQueue_.begin (), CurrentQueue_.end (),
+					[&removed] (const AudioSource& source) { return removed.contains (source); }),
+				CurrentQueue_.end ());
+
 		SaveOnLoadPlaylist ();
 	}
 
@@ -904,9 +936,32 @@ namespace LMP
 
 		using ResolvedSource_t = QPair<AudioSource, MediaInfo>;
 
+		/** An already known media info for a source that doesn't need to be
+		 * resolved again. If ValidAt_ is set, the info is only used for local
+		 * files not modified after that moment.
+		 */
+		struct KnownInfo
+		{
+			MediaInfo Info_;
+			QDateTime ValidAt_;
+		};
+
+		using KnownInfos_t = QHash<AudioSource, KnownInfo>;
+
 		template<typename NonLocalGetter>
-		ResolvedSource_t PairResolve (const NonLocalGetter& getter, const AudioSource& source)
+		ResolvedSource_t PairResolve (const NonLocalGetter& getter,
+				const KnownInfos_t& known, const AudioSource& source)
 		{
+			const auto knownPos = known.constFind (source);
+			if (knownPos != known.constEnd ())
+			{
+				const auto& validAt = knownPos->ValidAt_;
+				if (!validAt.isValid () ||
+						!source.IsLocalFile () ||
+						QFileInfo { source.GetLocalPath () }.lastModified () <= validAt)
+					return { source, knownPos->Info_ };
+			}
+
 			if (!source.IsLocalFile ())
 				return { source, getter (source) };
 
@@ -951,22 +1006,16 @@ namespace LMP
 
 		template<typename NonLocalGetter>
 		ResolveResult_t PairResolveAll (const QList<AudioSource>& sources,
-				const NonLocalGetter& getter)
+				const NonLocalGetter& getter, const KnownInfos_t& known)
 		{
 			return Util::Map (sources,
-					[&] (const AudioSource& source) { return PairResolve (getter, source); });
+					[&] (const AudioSource& source) { return PairResolve (getter, known, source); });
 		}
 
-		template<typename Sorter, typename NonLocalGetter>
-		ResolveResult_t PairResolveSort (const QList<AudioSource>& sources,
-				Sorter sorter, NonLocalGetter nonLocalGetter, bool sort)
+		template<typename Sorter>
+		void SortResolved (ResolveResult_t& result, Sorter sorter)
 		{
-			auto result = PairResolveAll (sources, nonLocalGetter);
-
-			if (sorter.Criteria_.isEmpty () || !sort)
-				return result;
-
-			std::sort (result.begin (), result.end (),
+			std::stable_sort (result.begin (), result.end (),
 					[sorter] (const ResolvedSource_t& s1, const ResolvedSource_t& s2)
 					{
 						const auto leftUseful = !s1.second.IsUseless ();
@@ -981,37 +1030,74 @@ namespace LMP
 						else
 							return sorter (s1.second, s2.second);
 					});
+		}
+
+		/** Resolves the sources to be added to the playlist.
+		 *
+		 * Only the new sources are resolved if the existing ones are
+		 * known. If the playlist doesn't need to be sorted, or if the
+		 * sorted playlist starts with the current one, just the new items
+		 * are returned so that they are appended to the playlist model
+		 * instead of rebuilding it.
+		 */
+		template<typename Result, typename Sorter, typename NonLocalGetter>
+		Result ResolveForPlaylist (const QList<AudioSource>& current,
+				const QList<AudioSource>& sources, const KnownInfos_t& known,
+				Sorter sorter, NonLocalGetter getter, bool sort, bool clear)
+		{
+			if (clear || current.isEmpty ())
+			{
+				auto result = PairResolveAll (sources, getter, known);
+				if (sort && !sorter.Criteria_.isEmpty ())
+					SortResolved (result, sorter);
+				return { result, clear, false };
+			}
+
+			auto added = PairResolveAll (sources, getter, known);
+			if (!sort || sorter.Criteria_.isEmpty ())
+				return { added, false, true };
+
+			SortResolved (added, sorter);
 
-			return result;
+			auto all = PairResolveAll (current, getter, known) + added;
+			SortResolved (all, sorter);
+
+			const auto keepsOrder = std::equal (current.begin (), current.end (), all.begin (),
+					[] (const AudioSource& source, const ResolvedSource_t& pair) { return source == pair.first; });
+			if (keepsOrder)
+				return { all.mid (current.size ()), false, true };
+
+			return { all, true, false };
 		}
 	}
 
 	void Player::AddToPlaylistModel (QList<AudioSource> sources, bool sort, bool clear)
 	{
-		if (!CurrentQueue_.isEmpty () && !clear)
-		{
-			EnqueueFlags flags { EnqueueReplace };
-			if (sort)
-				flags |= EnqueueSort;
-			Enqueue (CurrentQueue_ + sources, flags);
-			return;
-		}
-
 		emit playerAvailable (false);
 
+		KnownInfos_t known;
+		for (auto i = SnapshotInfos_.begin (); i != SnapshotInfos_.end (); ++i)
+			known [i.key ()] = { i.value (), SnapshotSavedAt_ };
+		SnapshotInfos_.clear ();
+
+		const auto& current = clear ? QList<AudioSource> {} : CurrentQueue_;
+		for (const auto& source : current)
+			if (source.IsLocalFile ())
+				if (const auto item = Items_.value (source))
+					known [source] = { item->data (Role::Info).value<MediaInfo> (), {} };
+
 		const auto future = QtConcurrent::run ([=]
 				{
-					return ResolveJobResult
-					{
-						PairResolveSort (sources,
-								Sorter_,
-								[this] (const AudioSource& source)
-								{
-									return Url2Info_.value (source.ToUrl ());
-								},
-								sort),
-						clear
-					};
+					return ResolveForPlaylist<ResolveJobResult> (current,
+							sources,
+							known,
+							Sorter_,
+							[this] (const AudioSource& source)
+							{
+								return Url2Info_.value (source.ToUrl ());
+							},
+							sort,
+							clear);
 				});
 		Util::Sequence (this, future) >>
 				[this] (const ResolveJobResult& result)
@@ -1243,18 +1329,17 @@ namespace LMP
 
 	void Player::MarkAsCurrent (QStandardItem *curItem)
 	{
+		const auto prevItem = Items_.value (CurrentItemSource_);
+		if (prevItem && prevItem != curItem)
+			prevItem->setData (false, Role::IsCurrent);
+
 		if (curItem)
-			curItem->setData (true, Role::IsCurrent);
-		for (auto item : Items_)
 		{
-			if (item == curItem)
-				continue;
-			if (item->data (Role::IsCurrent).toBool ())
-			{
-				item->setData (false, Role::IsCurrent);
-				break;
-			}
+			curItem->setData (true, Role::IsCurrent);
+			CurrentItemSource_ = curItem->data (Role::Source).value<AudioSource> ();
 		}
+		else
+			CurrentItemSource_ = {};
 	}
 
 	void Player::play (const QModelIndex& index)
@@ -1415,29 +1500,68 @@ namespace LMP
 
 	void Player::ContinueAfterSorted (const ResolveJobResult& result)
 	{
-		const auto& sources = result.Resolved_;
+		if (result.Append_)
+			AppendResolved (result.Resolved_);
+		else
+		{
+			CurrentQueue_.clear ();
 
-		CurrentQueue_.clear ();
+			QMetaObject::invokeMethod (PlaylistModel_, "modelAboutToBeReset");
+
+			if (result.ShouldClear_)
+			{
+				if (const auto rc = PlaylistModel_->rowCount ())
+					PlaylistModel_->removeRows (0, rc);
+				Items_.clear ();
+				AlbumRoots_.clear ();
+			}
 
-		QMetaObject::invokeMethod (PlaylistModel_, "modelAboutToBeReset");
+			PlaylistModel_->blockSignals (true);
+			AppendResolved (result.Resolved_);
+			PlaylistModel_->blockSignals (false);
 
-		if (result.ShouldClear_)
+			QMetaObject::invokeMethod (PlaylistModel_, "modelReset");
+		}
+
+		SaveOnLoadPlaylist ();
+
+		if (Source_->GetState () == SourceState::Stopped)
 		{
-			if (const auto rc = PlaylistModel_->rowCount ())
-				PlaylistModel_->removeRows (0, rc);
-			Items_.clear ();
-			AlbumRoots_.clear ();
+			const auto& songUrl = XmlSettingsManager::Instance ().property ("LastSong").toByteArray ();
+			const auto& song = QUrl::fromEncoded (songUrl);
+			if (!song.isEmpty ())
+			{
+				const auto pos = std::find_if (CurrentQueue_.begin (), CurrentQueue_.end (),
+						[&song] (const auto& item) { return song == item.ToUrl (); });
+				if (pos != CurrentQueue_.end ())
+					Source_->SetCurrentSource (*pos);
+			}
+
+			if (FirstPlaylistRestore_ &&
+					XmlSettingsManager::Instance ().property ("AutoContinuePlayback").toBool ())
+				RestorePlayState ();
+			FirstPlaylistRestore_ = false;
 		}
 
-		PlaylistModel_->blockSignals (true);
+		const auto& currentSource = Source_->GetCurrentSource ();
+		if (Items_.contains (currentSource))
+			MarkAsCurrent (Items_ [currentSource]);
+	}
 
+	void Player::AppendResolved (const ResolveResult_t& sources)
+	{
 		QString prevAlbumRoot;
-
-		QList<QStandardItem*> managedRulesItems;
+		if (!CurrentQueue_.isEmpty ())
+			if (const auto lastItem = Items_.value (CurrentQueue_.last ()))
+				if (CurrentQueue_.last ().GetType () == AudioSource::Type::File)
+					prevAlbumRoot = lastItem->data (Role::Info).value<MediaInfo> ().Album_;
 
 		for (const auto& sourcePair : sources)
 		{
 			const auto& source = sourcePair.first;
+			if (Items_.contains (source))
+				continue;
+
 			CurrentQueue_ << source;
 
 			auto item = new QStandardItem ();
@@ -1475,8 +1599,6 @@ namespace LMP
 			{
 				const auto& info = sourcePair.second;
 
-				managedRulesItems << item;
-
 				const auto& albumID = info.Album_;
 				FillItem (item, info);
 				if (albumID != prevAlbumRoot ||
@@ -1523,44 +1645,103 @@ namespace LMP
 
 			Items_ [source] = item;
 		}
+	}
 
-		PlaylistModel_->blockSignals (false);
+	void Player::SaveOnLoadPlaylist () const
+	{
+		Core::Instance ().GetPlaylistManager ()->
+				GetStaticManager ()->SetOnLoadPlaylist (GetAsNativePlaylist ());
 
-		QMetaObject::invokeMethod (PlaylistModel_, "modelReset");
+		SnapshotSaveTimer_->start ();
+	}
 
-		SaveOnLoadPlaylist ();
+	namespace
+	{
+		const quint8 SnapshotVersion = 1;
 
-		if (Source_->GetState () == SourceState::Stopped)
+		QString GetSnapshotPath ()
 		{
-			const auto& songUrl = XmlSettingsManager::Instance ().property ("LastSong").toByteArray ();
-			const auto& song = QUrl::fromEncoded (songUrl);
-			if (!song.isEmpty ())
-			{
-				const auto pos = std::find_if (CurrentQueue_.begin (), CurrentQueue_.end (),
-						[&song] (const auto& item) { return song == item.ToUrl (); });
-				if (pos != CurrentQueue_.end ())
-					Source_->SetCurrentSource (*pos);
-			}
+			return Util::CreateIfNotExists ("lmp").filePath ("onload.snapshot");
+		}
+	}
 
-			if (FirstPlaylistRestore_ &&
-					XmlSettingsManager::Instance ().property ("AutoContinuePlayback").toBool ())
-				RestorePlayState ();
-			FirstPlaylistRestore_ = false;
+	void Player::savePlaylistSnapshot ()
+	{
+		SnapshotSaveTimer_->stop ();
+
+		QList<QPair<QUrl, MediaInfo>> infos;
+		for (const auto& source : CurrentQueue_)
+			if (source.IsLocalFile ())
+				if (const auto item = Items_.value (source))
+					infos.append ({ source.ToUrl (), item->data (Role::Info).value<MediaInfo> () });
+
+		QSaveFile file { GetSnapshotPath () };
+		if (!file.open (QIODevice::WriteOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< file.fileName ()
+					<< file.errorString ();
+			return;
 		}
 
-		const auto& currentSource = Source_->GetCurrentSource ();
-		if (Items_.contains (currentSource))
-			Items_ [currentSource]->setData (true, Role::IsCurrent);
+		QDataStream stream { &file };
+		stream << SnapshotVersion
+				<< QDateTime::currentDateTime ()
+				<< infos;
+		if (!file.commit ())
+			qWarning () << Q_FUNC_INFO
+					<< "unable to commit"
+					<< file.fileName ()
+					<< file.errorString ();
 	}
 
-	void Player::SaveOnLoadPlaylist () const
+	void Player::LoadPlaylistSnapshot ()
 	{
-		Core::Instance ().GetPlaylistManager ()->
-				GetStaticManager ()->SetOnLoadPlaylist (GetAsNativePlaylist ());
+		QFile file { GetSnapshotPath () };
+		if (!file.exists ())
+			return;
+
+		if (!file.open (QIODevice::ReadOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< file.fileName ()
+					<< file.errorString ();
+			return;
+		}
+
+		QDataStream stream { &file };
+		quint8 version = 0;
+		stream >> version;
+		if (version != SnapshotVersion)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unknown version"
+					<< version;
+			return;
+		}
+
+		QDateTime savedAt;
+		QList<QPair<QUrl, MediaInfo>> infos;
+		stream >> savedAt >> infos;
+		if (stream.status () != QDataStream::Ok)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "corrupted snapshot"
+					<< file.fileName ();
+			return;
+		}
+
+		SnapshotSavedAt_ = savedAt;
+		for (const auto& pair : infos)
+			SnapshotInfos_ [AudioSource { pair.first }] = pair.second;
 	}
 
 	void Player::restorePlaylist ()
 	{
+		LoadPlaylistSnapshot ();
+
 		const auto staticMgr = Core::Instance ().GetPlaylistManager ()->GetStaticManager ();
 		SetNativePlaylist (staticMgr->GetOnLoadPlaylist ());
 		emit playlistRestored ();
@@ -34,6 +34,7 @@
 #include <memory>
 #include <atomic>
 #include <QObject>
+#include <QDateTime>
 
 #ifdef ENABLE_MPRIS
 #include <qdbuscontext.h>
@@ -47,6 +48,7 @@
 #include "nativeplaylist.h"
 
 class QModelIndex;
+class QTimer;
 class QStandardItem;
 class QAbstractItemModel;
 class QStandardItemModel;
@@ -97,6 +99,12 @@ namespace LMP
 
 		MediaInfo LastPhononMediaInfo_;
 
+		AudioSource CurrentItemSource_;
+
+		QHash<AudioSource, MediaInfo> SnapshotInfos_;
+		QDateTime SnapshotSavedAt_;
+		QTimer * const SnapshotSaveTimer_;
+
 		bool FirstPlaylistRestore_;
 		bool IgnoreNextSaves_;
 	public:
@@ -147,6 +155,7 @@ namespace LMP
 		Q_DECLARE_FLAGS (EnqueueFlags, EnqueueFlag)
 
 		Player (const ICoreProxy_ptr& proxy, QObject* = 0);
+		~Player ();
 
 		void InitWithOtherPlugins ();
 
@@ -219,8 +228,10 @@ namespace LMP
 		void MarkAsCurrent (QStandardItem*);
 
 		void ContinueAfterSorted (const ResolveJobResult&);
+		void AppendResolved (const QList<QPair<AudioSource, MediaInfo>>&);
 
 		void SaveOnLoadPlaylist () const;
+		void LoadPlaylistSnapshot ();
 	public slots:
 		void play (const QModelIndex&);
 		void previousTrack ();
@@ -233,6 +244,7 @@ namespace LMP
 		void shufflePlaylist ();
 	private slots:
 		void restorePlaylist ();
+		void savePlaylistSnapshot ();
 		void handleStationError (const QString&);
 		void handleRadioStream (const QUrl&, const Media::AudioInfo&);
 		void handleGotRadioPlaylist (const QString&, const QString&);
@@ -36,6 +36,7 @@
 #include <QProgressDialog>
 #include <QtConcurrentRun>
 #include <QFutureWatcher>
+#include <QWriteLocker>
 #include <QtDebug>
 #include <QSettings>
 #include <taglib/fileref.h>
@@ -427,7 +428,7 @@ namespace Graffiti
 		{
 			const auto& newInfo = pair.first;
 
-			QMutexLocker locker (&resolver->GetMutex ());
+			QWriteLocker locker (&resolver->GetLock ());
 			auto file = resolver->GetFileRef (newInfo.LocalPath_);
 			auto tag = file.tag ();
 
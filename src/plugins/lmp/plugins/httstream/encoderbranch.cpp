@@ -0,0 +1,273 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "encoderbranch.h"
+#include <QtDebug>
+#include <gst/gst.h>
+#include "util/lmp/gstutil.h"
+
+namespace LeechCraft
+{
+namespace LMP
+{
+namespace HttStream
+{
+	namespace
+	{
+		struct FormatDescr
+		{
+			const char *Encoder_;
+			const char *Muxer_;
+		};
+
+		FormatDescr GetFormatDescr (StreamFormat format)
+		{
+			switch (format)
+			{
+			case StreamFormat::Vorbis:
+				return { "vorbisenc", "oggmux" };
+			case StreamFormat::Opus:
+				return { "opusenc", "oggmux" };
+			case StreamFormat::MP3:
+				return { "lamemp3enc", nullptr };
+			}
+
+			qWarning () << Q_FUNC_INFO
+					<< "unknown format"
+					<< static_cast<int> (format);
+			return { nullptr, nullptr };
+		}
+
+		bool HasFactory (const char *name)
+		{
+			const auto factory = gst_element_factory_find (name);
+			if (!factory)
+				return false;
+
+			gst_object_unref (factory);
+			return true;
+		}
+	}
+
+	QList<StreamFormat> GetAvailableFormats ()
+	{
+		QList<StreamFormat> result;
+		for (const auto format : { StreamFormat::Vorbis, StreamFormat::Opus, StreamFormat::MP3 })
+		{
+			const auto& descr = GetFormatDescr (format);
+			if (HasFactory (descr.Encoder_) &&
+					(!descr.Muxer_ || HasFactory (descr.Muxer_)))
+				result << format;
+			else
+				qWarning () << Q_FUNC_INFO
+						<< "format"
+						<< GetFormatName (format)
+						<< "is unavailable, missing"
+						<< descr.Encoder_
+						<< descr.Muxer_;
+		}
+		return result;
+	}
+
+	QByteArray GetFormatPath (StreamFormat format)
+	{
+		switch (format)
+		{
+		case StreamFormat::Vorbis:
+			return "/stream.ogg";
+		case StreamFormat::Opus:
+			return "/stream.opus";
+		case StreamFormat::MP3:
+			return "/stream.mp3";
+		}
+
+		return {};
+	}
+
+	QByteArray GetFormatMimeType (StreamFormat format)
+	{
+		switch (format)
+		{
+		case StreamFormat::Vorbis:
+			return "audio/ogg";
+		case StreamFormat::Opus:
+			return "audio/ogg; codecs=opus";
+		case StreamFormat::MP3:
+			return "audio/mpeg";
+		}
+
+		return {};
+	}
+
+	QString GetFormatName (StreamFormat format)
+	{
+		switch (format)
+		{
+		case StreamFormat::Vorbis:
+			return "vorbis";
+		case StreamFormat::Opus:
+			return "opus";
+		case StreamFormat::MP3:
+			return "mp3";
+		}
+
+		return {};
+	}
+
+	namespace
+	{
+		GstFlowReturn CbNewSample (GstElement *sink, gpointer udata)
+		{
+			GstSample *sample = nullptr;
+			g_signal_emit_by_name (sink, "pull-sample", &sample);
+			if (!sample)
+				return GST_FLOW_OK;
+
+			static_cast<EncoderBranch*> (udata)->HandleSample (sample);
+			gst_sample_unref (sample);
+			return GST_FLOW_OK;
+		}
+	}
+
+	EncoderBranch::EncoderBranch (StreamFormat format, QObject *parent)
+	: QObject { parent }
+	, Format_ { format }
+	, Bin_ { gst_bin_new (nullptr) }
+	, Encoder_ { gst_element_factory_make (GetFormatDescr (format).Encoder_, nullptr) }
+	, Sink_ { gst_element_factory_make ("appsink", nullptr) }
+	{
+		qRegisterMetaType<StreamFormat> ("StreamFormat");
+
+		gst_object_ref_sink (Bin_);
+
+		const auto queue = gst_element_factory_make ("queue", nullptr);
+		const auto aconv = gst_element_factory_make ("audioconvert", nullptr);
+		const auto resample = gst_element_factory_make ("audioresample", nullptr);
+
+		// Encoding never blocks the playback: if the encoder can't keep up,
+		// the listeners get a gap instead.
+		g_object_set (G_OBJECT (queue), "leaky", 2, nullptr);
+
+		g_object_set (G_OBJECT (Sink_),
+				"emit-signals", TRUE,
+				"sync", FALSE,
+				"async", FALSE,
+				nullptr);
+		g_signal_connect (Sink_, "new-sample", G_CALLBACK (CbNewSample), this);
+
+		if (format == StreamFormat::MP3)
+			g_object_set (G_OBJECT (Encoder_),
+					"target", 1,
+					"cbr", TRUE,
+					nullptr);
+
+		gst_bin_add_many (GST_BIN (Bin_), queue, aconv, resample, Encoder_, Sink_, nullptr);
+		gst_element_link_many (queue, aconv, resample, Encoder_, nullptr);
+
+		if (const auto muxerName = GetFormatDescr (format).Muxer_)
+		{
+			const auto muxer = gst_element_factory_make (muxerName, nullptr);
+			gst_bin_add (GST_BIN (Bin_), muxer);
+			gst_element_link_many (Encoder_, muxer, Sink_, nullptr);
+		}
+		else
+			gst_element_link (Encoder_, Sink_);
+
+		GstUtil::AddGhostPad (queue, Bin_, "sink");
+	}
+
+	EncoderBranch::~EncoderBranch ()
+	{
+		gst_element_set_state (Bin_, GST_STATE_NULL);
+		gst_object_unref (Bin_);
+	}
+
+	StreamFormat EncoderBranch::GetFormat () const
+	{
+		return Format_;
+	}
+
+	GstElement* EncoderBranch::GetElement () const
+	{
+		return Bin_;
+	}
+
+	void EncoderBranch::SetQuality (double quality)
+	{
+		if (Format_ == StreamFormat::Vorbis)
+			g_object_set (G_OBJECT (Encoder_), "quality", quality, nullptr);
+	}
+
+	void EncoderBranch::SetBitrate (int kbps)
+	{
+		switch (Format_)
+		{
+		case StreamFormat::Vorbis:
+			break;
+		case StreamFormat::Opus:
+			g_object_set (G_OBJECT (Encoder_), "bitrate", kbps * 1000, nullptr);
+			break;
+		case StreamFormat::MP3:
+			g_object_set (G_OBJECT (Encoder_), "bitrate", kbps, nullptr);
+			break;
+		}
+	}
+
+	void EncoderBranch::HandleSample (GstSample *sample)
+	{
+		const auto buffer = gst_sample_get_buffer (sample);
+		if (!buffer)
+			return;
+
+		GstMapInfo map;
+		if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+			return;
+
+		const QByteArray data { reinterpret_cast<const char*> (map.data), static_cast<int> (map.size) };
+		gst_buffer_unmap (buffer, &map);
+
+		if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_HEADER))
+		{
+			if (!InHeader_)
+			{
+				Header_.clear ();
+				InHeader_ = true;
+			}
+
+			Header_ += data;
+			emit streamHeader (Format_, Header_);
+		}
+		else
+			InHeader_ = false;
+
+		emit encodedData (Format_, data);
+	}
+}
+}
+}
@@ -0,0 +1,102 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QMetaType>
+
+typedef struct _GstElement GstElement;
+typedef struct _GstSample GstSample;
+
+namespace LeechCraft
+{
+namespace LMP
+{
+namespace HttStream
+{
+	enum class StreamFormat
+	{
+		Vorbis,
+		Opus,
+		MP3
+	};
+
+	inline uint qHash (StreamFormat format)
+	{
+		return static_cast<uint> (format);
+	}
+
+	QList<StreamFormat> GetAvailableFormats ();
+
+	QByteArray GetFormatPath (StreamFormat);
+	QByteArray GetFormatMimeType (StreamFormat);
+	QString GetFormatName (StreamFormat);
+
+	/** @brief A single encoder shared by all the listeners of a format.
+	 *
+	 * The branch is a GStreamer bin with a single sink pad that converts
+	 * the raw audio to the given format. The encoded buffers are emitted
+	 * from the streaming thread via the encodedData() signal, and the
+	 * stream headers (like Ogg headers) are additionally accumulated
+	 * and emitted via the streamHeader() signal so that listeners joining
+	 * later could be sent them first.
+	 */
+	class EncoderBranch : public QObject
+	{
+		Q_OBJECT
+
+		const StreamFormat Format_;
+
+		GstElement * const Bin_;
+		GstElement * const Encoder_;
+		GstElement * const Sink_;
+
+		bool InHeader_ = false;
+		QByteArray Header_;
+	public:
+		EncoderBranch (StreamFormat, QObject* = nullptr);
+		~EncoderBranch ();
+
+		StreamFormat GetFormat () const;
+		GstElement* GetElement () const;
+
+		void SetQuality (double);
+		void SetBitrate (int);
+
+		void HandleSample (GstSample*);
+	signals:
+		void streamHeader (StreamFormat, const QByteArray&);
+		void encodedData (StreamFormat, const QByteArray&);
+	};
+}
+}
+}
+
+Q_DECLARE_METATYPE (LeechCraft::LMP::HttStream::StreamFormat)
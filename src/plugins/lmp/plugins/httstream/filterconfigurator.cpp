@@ -59,6 +59,16 @@ namespace HttStream
 				this,
 				SLOT (handleEncQualityChanged ()));
 
+		FSM_->RegisterObject ({ "OpusBitrate", "MP3Bitrate" }, this, "handleBitratesChanged");
+		QTimer::singleShot (0,
+				this,
+				SLOT (handleBitratesChanged ()));
+
+		FSM_->RegisterObject ("ClientBufferSize", this, "handleClientBufferSizeChanged");
+		QTimer::singleShot (0,
+				this,
+				SLOT (handleClientBufferSizeChanged ()));
+
 		FSM_->RegisterObject ({ "Address", "Port" }, this, "handleAddressChanged");
 		QTimer::singleShot (0,
 				this,
@@ -92,6 +102,18 @@ namespace HttStream
 		const auto quality = FSM_->property ("EncQuality").toDouble ();
 		Filter_->SetQuality (quality);
 	}
+
+	void FilterConfigurator::handleBitratesChanged ()
+	{
+		Filter_->SetBitrate (StreamFormat::Opus, FSM_->property ("OpusBitrate").toInt ());
+		Filter_->SetBitrate (StreamFormat::MP3, FSM_->property ("MP3Bitrate").toInt ());
+	}
+
+	void FilterConfigurator::handleClientBufferSizeChanged ()
+	{
+		const auto size = FSM_->property ("ClientBufferSize").toInt ();
+		Filter_->SetClientBufferSize (size * 1024);
+	}
 }
 }
 }
@@ -64,6 +64,8 @@ namespace HttStream
 	private slots:
 		void handleAddressChanged ();
 		void handleEncQualityChanged ();
+		void handleBitratesChanged ();
+		void handleClientBufferSizeChanged ();
 	};
 }
 }
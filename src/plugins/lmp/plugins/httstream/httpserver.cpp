@@ -28,8 +28,13 @@
  **********************************************************************/
 
 #include "httpserver.h"
+#include <algorithm>
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QtDebug>
 
 namespace LeechCraft
 {
@@ -37,9 +42,21 @@ namespace LMP
 {
 namespace HttStream
 {
-	HttpServer::HttpServer (QObject *parent)
+	namespace
+	{
+		const int MaxRequestSize = 16 * 1024;
+
+		// The amount of data queued in the socket itself, the rest is
+		// kept in the client's queue which is subject to dropping.
+		const int SocketWatermark = 64 * 1024;
+
+		const int IcyMetaInt = 16000;
+	}
+
+	HttpServer::HttpServer (const QList<StreamFormat>& formats, QObject *parent)
 	: QObject { parent }
 	, Server_ { new QTcpServer { this } }
+	, Formats_ { formats }
 	{
 		connect (Server_,
 				SIGNAL (newConnection ()),
@@ -72,16 +89,14 @@ namespace HttStream
 		}
 	}
 
-	QList<int> HttpServer::GetConnectedFDs () const
+	void HttpServer::SetMaxClientBuffer (int size)
 	{
-		decltype (Socket2FD_) map;
-
-		{
-			QReadLocker locker { &MapLock_};
-			map = Socket2FD_;
-		}
+		MaxClientBuffer_ = size;
+	}
 
-		return map.values ();
+	void HttpServer::SetStreamTitle (const QString& title)
+	{
+		StreamTitle_ = title.toUtf8 ();
 	}
 
 	namespace
@@ -96,107 +111,384 @@ namespace HttStream
 
 			socket->write ("\r\n");
 		}
+
+		struct Request
+		{
+			QByteArray Method_;
+			QByteArray Path_;
+			QByteArray Version_;
+			QHash<QByteArray, QByteArray> Headers_;
+		};
+
+		boost::optional<Request> ParseRequest (const QByteArray& data)
+		{
+			const auto& lines = data.split ('\n');
+
+			const auto& requestLine = lines.value (0).trimmed ().split (' ');
+			if (requestLine.size () != 3)
+				return {};
+
+			Request request { requestLine [0], requestLine [1], requestLine [2], {} };
+
+			const auto queryPos = request.Path_.indexOf ('?');
+			if (queryPos >= 0)
+				request.Path_.truncate (queryPos);
+
+			for (int i = 1; i < lines.size (); ++i)
+			{
+				const auto& line = lines.at (i);
+				const auto colonPos = line.indexOf (':');
+				if (colonPos <= 0)
+					continue;
+
+				request.Headers_ [line.left (colonPos).trimmed ().toLower ()] = line.mid (colonPos + 1).trimmed ();
+			}
+
+			return request;
+		}
+
+		bool IsKeepAlive (const Request& request)
+		{
+			const auto& connection = request.Headers_.value ("connection").toLower ();
+			if (request.Version_ == "HTTP/1.1")
+				return connection != "close";
+			return connection == "keep-alive";
+		}
+
+		void Reply (QTcpSocket *socket, const QByteArray& status, bool keepAlive,
+				const QByteArray& contentType = {}, const QByteArray& body = {}, bool withBody = true)
+		{
+			QList<QByteArray> headers
+			{
+				"HTTP/1.1 " + status,
+				"Server: LeechCraft LMP",
+				"Content-Length: " + QByteArray::number (body.size ()),
+				keepAlive ? "Connection: keep-alive" : "Connection: close"
+			};
+			if (!contentType.isEmpty ())
+				headers << "Content-Type: " + contentType;
+
+			Write (socket, headers);
+			if (withBody)
+				socket->write (body);
+
+			if (!keepAlive)
+				socket->disconnectFromHost ();
+		}
+
+		QByteArray MakeIcyBlock (QByteArray title)
+		{
+			title.replace ('\'', '`');
+			title.truncate (4000);
+
+			auto meta = "StreamTitle='" + title + "';";
+			const auto blocks = (meta.size () + 15) / 16;
+			meta.append (QByteArray (blocks * 16 - meta.size (), '\0'));
+			return static_cast<char> (blocks) + meta;
+		}
 	}
 
-	void HttpServer::HandleSocket (QTcpSocket *socket)
+	bool HttpServer::HandleRequest (QTcpSocket *socket, Client& client, const QByteArray& data)
 	{
-		disconnect (socket,
-				SIGNAL (readyRead ()),
-				this,
-				0);
+		const auto& maybeRequest = ParseRequest (data);
+		if (!maybeRequest)
+		{
+			Reply (socket, "400 Bad Request", false);
+			return false;
+		}
+
+		const auto& request = *maybeRequest;
+		const auto keepAlive = IsKeepAlive (request);
 
-		if (!socket->canReadLine ())
+		const auto isHead = request.Method_ == "HEAD";
+		if (!isHead && request.Method_ != "GET")
 		{
-			connect (socket,
-					SIGNAL (readyRead ()),
-					this,
-					SLOT (tryReadLine ()));
-			return;
+			Reply (socket, "405 Method Not Allowed", false);
+			return false;
 		}
 
-		auto line = socket->readLine ();
-		line.chop (QString (" HTTP/1.0\r\n").size ());
+		if (request.Path_ == "/status")
+		{
+			Reply (socket, "200 OK", keepAlive, "application/json", GetStatus (), !isHead);
+			return keepAlive;
+		}
 
-		if (line.startsWith ("HEAD "))
+		const auto formatPos = std::find_if (Formats_.begin (), Formats_.end (),
+				[&request] (StreamFormat format)
+				{
+					return request.Path_ == GetFormatPath (format) ||
+							(request.Path_ == "/" && format == StreamFormat::Vorbis);
+				});
+		if (formatPos == Formats_.end ())
 		{
-			const auto& str = line.mid (5) == "/" ?
-					"HTTP/1.0 200 OK" :
-					"HTTP/1.0 404 Not Found";
-			Write (socket, { str });
-			connect (socket,
-					SIGNAL (bytesWritten (qint64)),
-					socket,
-					SLOT (deleteLater ()));
+			Reply (socket, "404 Not Found", keepAlive, {}, {}, !isHead);
+			return keepAlive;
+		}
+
+		if (isHead)
+		{
+			Reply (socket, "200 OK", keepAlive, GetFormatMimeType (*formatPos), {}, false);
+			return keepAlive;
+		}
+
+		client.UserAgent_ = request.Headers_.value ("user-agent");
+
+		const auto icy = *formatPos == StreamFormat::MP3 &&
+				request.Headers_.value ("icy-metadata") == "1";
+		StartStreaming (socket, client, *formatPos, icy);
+		return false;
+	}
+
+	void HttpServer::StartStreaming (QTcpSocket *socket, Client& client, StreamFormat format, bool icy)
+	{
+		QList<QByteArray> headers
+		{
+			"HTTP/1.0 200 OK",
+			"Content-Type: " + GetFormatMimeType (format),
+			"Cache-Control: no-cache",
+			"Server: LeechCraft LMP",
+			"icy-name: LeechCraft LMP"
+		};
+		if (icy)
+		{
+			headers << "icy-metaint: " + QByteArray::number (IcyMetaInt);
+			client.IcyMetaInt_ = IcyMetaInt;
+			client.BytesToMeta_ = IcyMetaInt;
+		}
+		Write (socket, headers);
+
+		client.Format_ = format;
+		client.ConnectedAt_ = QDateTime::currentDateTime ();
+
+		const auto& header = Headers_.value (format);
+		if (!header.isEmpty ())
+		{
+			client.Pending_.enqueue (header);
+			client.PendingSize_ += header.size ();
+			Flush (socket, client);
 		}
-		else if (line.startsWith ("GET "))
+
+		qDebug () << Q_FUNC_INFO
+				<< "new"
+				<< GetFormatName (format)
+				<< "listener"
+				<< client.Address_
+				<< client.UserAgent_;
+
+		int total = 0;
+		for (auto count : ListenersCount_)
+			total += count;
+		PeakListeners_ = std::max (PeakListeners_, total + 1);
+
+		if (!ListenersCount_ [format]++)
+			emit formatRequested (format);
+	}
+
+	void HttpServer::Flush (QTcpSocket *socket, Client& client)
+	{
+		while (!client.Pending_.isEmpty () && socket->bytesToWrite () < SocketWatermark)
 		{
-			if (line.mid (4) == "/")
+			const auto& chunk = client.Pending_.dequeue ();
+			client.PendingSize_ -= chunk.size ();
+			WriteChunk (socket, client, chunk);
+		}
+	}
+
+	void HttpServer::WriteChunk (QTcpSocket *socket, Client& client, const QByteArray& chunk)
+	{
+		client.BytesSent_ += chunk.size ();
+
+		if (!client.IcyMetaInt_)
+		{
+			socket->write (chunk);
+			return;
+		}
+
+		int pos = 0;
+		while (pos < chunk.size ())
+		{
+			const auto len = std::min (client.BytesToMeta_, chunk.size () - pos);
+			socket->write (chunk.constData () + pos, len);
+			pos += len;
+			client.BytesToMeta_ -= len;
+
+			if (client.BytesToMeta_)
+				continue;
+
+			client.BytesToMeta_ = client.IcyMetaInt_;
+			if (client.SentTitle_ == StreamTitle_)
+				socket->write (QByteArray (1, '\0'));
+			else
 			{
-				Write (socket,
+				socket->write (MakeIcyBlock (StreamTitle_));
+				client.SentTitle_ = StreamTitle_;
+			}
+		}
+	}
+
+	QByteArray HttpServer::GetStatus () const
+	{
+		QJsonArray listeners;
+		for (const auto& client : Clients_)
+		{
+			if (!client.Format_)
+				continue;
+
+			listeners.append (QJsonObject
 					{
-						"HTTP/1.0 200 OK",
-						"Content-Type: audio/ogg",
-						"Cache-Control: no-cache",
-						"Server: LeechCraft LMP"
+						{ "address", client.Address_ },
+						{ "userAgent", QString::fromUtf8 (client.UserAgent_) },
+						{ "format", GetFormatName (*client.Format_) },
+						{ "connectedAt", client.ConnectedAt_.toString (Qt::ISODate) },
+						{ "bytesSent", client.BytesSent_ },
+						{ "bytesQueued", client.PendingSize_ },
+						{ "resyncs", client.Resyncs_ }
 					});
+		}
 
-				{
-					QWriteLocker locker { &MapLock_ };
-					Socket2FD_ [socket] = socket->socketDescriptor ();
-				}
+		QJsonObject formats;
+		for (const auto format : Formats_)
+			formats [GetFormatName (format)] = QJsonObject
+					{
+						{ "path", QString::fromLatin1 (GetFormatPath (format)) },
+						{ "listeners", ListenersCount_.value (format) }
+					};
 
-				emit gotClient (socket->socketDescriptor ());
-			}
-			else
+		const QJsonObject status
+		{
+			{ "title", QString::fromUtf8 (StreamTitle_) },
+			{ "listeners", listeners },
+			{ "peakListeners", PeakListeners_ },
+			{ "formats", formats }
+		};
+		return QJsonDocument { status }.toJson ();
+	}
+
+	void HttpServer::handleStreamHeader (StreamFormat format, const QByteArray& header)
+	{
+		if (ListenersCount_.value (format))
+			Headers_ [format] = header;
+	}
+
+	void HttpServer::handleEncodedData (StreamFormat format, const QByteArray& data)
+	{
+		for (auto i = Clients_.begin (), end = Clients_.end (); i != end; ++i)
+		{
+			auto& client = i.value ();
+			if (client.Format_ != format)
+				continue;
+
+			if (client.PendingSize_ + data.size () > MaxClientBuffer_)
 			{
-				Write (socket, { "HTTP/1.0 404 Not Found" });
-				connect (socket,
-						SIGNAL (bytesWritten (qint64)),
-						socket,
-						SLOT (deleteLater ()));
+				qDebug () << Q_FUNC_INFO
+						<< "listener"
+						<< client.Address_
+						<< "is too slow, dropping"
+						<< client.PendingSize_
+						<< "bytes";
+				client.Pending_.clear ();
+				client.PendingSize_ = 0;
+				++client.Resyncs_;
 			}
+
+			client.Pending_.enqueue (data);
+			client.PendingSize_ += data.size ();
+
+			Flush (i.key (), client);
 		}
-		else
+	}
+
+	void HttpServer::handleNewConnection ()
+	{
+		while (const auto socket = Server_->nextPendingConnection ())
 		{
-			Write (socket, { "HTTP/1.0 400 Bad Request" });
+			connect (socket,
+					SIGNAL (disconnected ()),
+					this,
+					SLOT (handleDisconnected ()));
+			connect (socket,
+					SIGNAL (readyRead ()),
+					this,
+					SLOT (handleReadyRead ()));
 			connect (socket,
 					SIGNAL (bytesWritten (qint64)),
-					socket,
-					SLOT (deleteLater ()));
+					this,
+					SLOT (handleBytesWritten ()));
+
+			Clients_ [socket].Address_ = socket->peerAddress ().toString ();
 		}
 	}
 
-	void HttpServer::tryReadLine ()
+	void HttpServer::handleReadyRead ()
 	{
-		auto socket = qobject_cast<QTcpSocket*> (sender ());
-		HandleSocket (socket);
+		const auto socket = qobject_cast<QTcpSocket*> (sender ());
+		auto& client = Clients_ [socket];
+		if (client.Format_)
+		{
+			socket->readAll ();
+			return;
+		}
+
+		client.Request_ += socket->readAll ();
+
+		while (true)
+		{
+			const auto end = client.Request_.indexOf ("\r\n\r\n");
+			if (end == -1)
+			{
+				if (client.Request_.size () > MaxRequestSize)
+				{
+					client.Request_.clear ();
+					Reply (socket, "413 Request Entity Too Large", false);
+				}
+				return;
+			}
+
+			const auto& request = client.Request_.left (end);
+			client.Request_.remove (0, end + 4);
+
+			if (!HandleRequest (socket, client, request))
+				return;
+		}
 	}
 
-	void HttpServer::handleNewConnection ()
+	void HttpServer::handleBytesWritten ()
 	{
-		const auto socket = Server_->nextPendingConnection ();
-		connect (socket,
-				SIGNAL (disconnected ()),
-				this,
-				SLOT (handleDisconnected ()));
-		HandleSocket (socket);
+		const auto socket = qobject_cast<QTcpSocket*> (sender ());
+		const auto pos = Clients_.find (socket);
+		if (pos != Clients_.end () && pos->Format_)
+			Flush (socket, *pos);
 	}
 
 	void HttpServer::handleDisconnected ()
 	{
-		const auto sock = qobject_cast<QTcpSocket*> (sender ());
-		sock->deleteLater ();
+		const auto socket = qobject_cast<QTcpSocket*> (sender ());
+		socket->deleteLater ();
 
-		int sockFd = 0;
-		QWriteLocker lock { &MapLock_ };
-		{
-			if (!Socket2FD_.contains (sock))
-				return;
+		const auto& client = Clients_.take (socket);
+		if (!client.Format_)
+			return;
 
-			sockFd = Socket2FD_.take (sock);
-		}
+		const auto format = *client.Format_;
+
+		qDebug () << Q_FUNC_INFO
+				<< GetFormatName (format)
+				<< "listener"
+				<< client.Address_
+				<< "left after"
+				<< client.ConnectedAt_.secsTo (QDateTime::currentDateTime ())
+				<< "seconds;"
+				<< client.BytesSent_
+				<< "bytes sent,"
+				<< client.Resyncs_
+				<< "resyncs";
 
-		emit clientDisconnected (sockFd);
+		if (!--ListenersCount_ [format])
+		{
+			ListenersCount_.remove (format);
+			Headers_.remove (format);
+			emit formatReleased (format);
+		}
 	}
 }
 }
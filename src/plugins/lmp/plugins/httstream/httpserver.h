@@ -30,8 +30,11 @@
 #pragma once
 
 #include <QObject>
-#include <QMap>
-#include <QReadWriteLock>
+#include <QHash>
+#include <QQueue>
+#include <QDateTime>
+#include <boost/optional.hpp>
+#include "encoderbranch.h"
 
 class QTcpServer;
 class QTcpSocket;
@@ -42,30 +45,76 @@ namespace LMP
 {
 namespace HttStream
 {
+	/** @brief Serves the encoded streams to the HTTP listeners.
+	 *
+	 * Each listener has its own bounded queue of encoded buffers. A
+	 * listener that can't keep up with the stream has its queue dropped
+	 * and continues from the most recent buffer, so that slow listeners
+	 * never affect others.
+	 *
+	 * The streams are served at the paths returned by GetFormatPath(),
+	 * with the root path being the Vorbis stream. Listeners statistics are
+	 * available as JSON at the /status path.
+	 */
 	class HttpServer : public QObject
 	{
 		Q_OBJECT
 
 		QTcpServer * const Server_;
 
-		mutable QReadWriteLock MapLock_;
-		QMap<QTcpSocket*, int> Socket2FD_;
+		struct Client
+		{
+			QByteArray Request_;
+
+			boost::optional<StreamFormat> Format_;
+			QQueue<QByteArray> Pending_;
+			int PendingSize_ = 0;
+
+			int IcyMetaInt_ = 0;
+			int BytesToMeta_ = 0;
+			QByteArray SentTitle_;
+
+			QString Address_;
+			QByteArray UserAgent_;
+			QDateTime ConnectedAt_;
+			qint64 BytesSent_ = 0;
+			int Resyncs_ = 0;
+		};
+		QHash<QTcpSocket*, Client> Clients_;
+
+		QList<StreamFormat> Formats_;
+		QHash<StreamFormat, QByteArray> Headers_;
+		QHash<StreamFormat, int> ListenersCount_;
+		int PeakListeners_ = 0;
+
+		QByteArray StreamTitle_;
+
+		int MaxClientBuffer_ = 512 * 1024;
 	public:
-		HttpServer (QObject* = nullptr);
+		HttpServer (const QList<StreamFormat>&, QObject* = nullptr);
 
 		void SetAddress (const QString&, int);
-
-		QList<int> GetConnectedFDs () const;
+		void SetMaxClientBuffer (int);
+		void SetStreamTitle (const QString&);
 	private:
-		void HandleSocket (QTcpSocket*);
-	private slots:
-		void tryReadLine ();
+		bool HandleRequest (QTcpSocket*, Client&, const QByteArray&);
+		void StartStreaming (QTcpSocket*, Client&, StreamFormat, bool icy);
 
+		void Flush (QTcpSocket*, Client&);
+		void WriteChunk (QTcpSocket*, Client&, const QByteArray&);
+
+		QByteArray GetStatus () const;
+	public slots:
+		void handleStreamHeader (StreamFormat, const QByteArray&);
+		void handleEncodedData (StreamFormat, const QByteArray&);
+	private slots:
 		void handleNewConnection ();
+		void handleReadyRead ();
+		void handleBytesWritten ();
 		void handleDisconnected ();
 	signals:
-		void gotClient (int);
-		void clientDisconnected (int);
+		void formatRequested (StreamFormat);
+		void formatReleased (StreamFormat);
 	};
 }
 }
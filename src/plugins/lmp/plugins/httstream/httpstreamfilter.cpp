@@ -28,11 +28,10 @@
  **********************************************************************/
 
 #include "httpstreamfilter.h"
+#include <algorithm>
 #include <QUuid>
 #include <QtDebug>
-#include <QTimer>
 #include <gst/gst.h>
-#include <util/sll/delayedexecutor.h>
 #include "interfaces/lmp/ifilterconfigurator.h"
 #include "util/lmp/gstutil.h"
 #include "httpserver.h"
@@ -44,14 +43,6 @@ namespace LMP
 {
 namespace HttStream
 {
-	namespace
-	{
-		void CbRemoved (void*, gint fd, int reason, gpointer udata)
-		{
-			static_cast<HttpStreamFilter*> (udata)->HandleRemoved (fd, reason);
-		}
-	}
-
 	HttpStreamFilter::HttpStreamFilter (const QByteArray& filterId,
 			const QByteArray& instanceId, IPath *path)
 	: FilterId_ { filterId }
@@ -62,19 +53,23 @@ namespace HttStream
 	, Tee_ { gst_element_factory_make ("tee", nullptr) }
 	, TeeTemplate_ { gst_element_class_get_pad_template (GST_ELEMENT_GET_CLASS (Tee_), GstUtil::GetTeePadTemplateName ()) }
 	, AudioQueue_ { gst_element_factory_make ("queue", nullptr) }
-	, StreamQueue_ { gst_element_factory_make ("queue", nullptr) }
-	, AConv_ { gst_element_factory_make ("audioconvert", nullptr) }
-	, Encoder_ { gst_element_factory_make ("vorbisenc", nullptr) }
-	, Muxer_ { gst_element_factory_make ("oggmux", nullptr) }
-	, MSS_ { gst_element_factory_make ("multifdsink", nullptr) }
-	, Server_ { new HttpServer { this } }
+	, Formats_ { GetAvailableFormats () }
+	, Server_ { new HttpServer { Formats_, this } }
 	{
-		if (!MSS_)
-			qWarning () << Q_FUNC_INFO
-					<< "cannot create multisocketsink";
-
-		for (const auto elem : GetStreamBranchElements ())
-			gst_object_ref (elem);
+		for (const auto format : Formats_)
+		{
+			const auto branch = new EncoderBranch { format, this };
+			Branches_ [format] = branch;
+
+			connect (branch,
+					SIGNAL (streamHeader (StreamFormat, QByteArray)),
+					Server_,
+					SLOT (handleStreamHeader (StreamFormat, QByteArray)));
+			connect (branch,
+					SIGNAL (encodedData (StreamFormat, QByteArray)),
+					Server_,
+					SLOT (handleEncodedData (StreamFormat, QByteArray)));
+		}
 
 		gst_bin_add_many (GST_BIN (Elem_), Tee_, AudioQueue_, nullptr);
 
@@ -83,35 +78,23 @@ namespace HttStream
 		gst_pad_link (TeeAudioPad_, audioPad);
 		gst_object_unref (audioPad);
 
-		g_object_set (G_OBJECT (MSS_),
-				"recover-policy", 3,
-				"sync-method", 1,
-				"async", FALSE,
-				"sync", FALSE,
-				nullptr);
-
 		GstUtil::AddGhostPad (Tee_, Elem_, "sink");
 		GstUtil::AddGhostPad (AudioQueue_, Elem_, "src");
 
 		connect (Server_,
-				SIGNAL (gotClient (int)),
+				SIGNAL (formatRequested (StreamFormat)),
 				this,
-				SLOT (handleClient (int)));
+				SLOT (handleFormatRequested (StreamFormat)));
 		connect (Server_,
-				SIGNAL (clientDisconnected (int)),
+				SIGNAL (formatReleased (StreamFormat)),
 				this,
-				SLOT (handleClientDisconnected (int)));
-
-		g_signal_connect (MSS_, "client-removed", G_CALLBACK (CbRemoved), this);
+				SLOT (handleFormatReleased (StreamFormat)));
 	}
 
 	HttpStreamFilter::~HttpStreamFilter ()
 	{
-		for (const auto elem : GetStreamBranchElements ())
-		{
-			gst_element_set_state (elem, GST_STATE_NULL);
-			gst_object_unref (elem);
-		}
+		for (const auto format : TeeBranchPads_.keys ())
+			DetachBranch (format);
 	}
 
 	QByteArray HttpStreamFilter::GetEffectId () const
@@ -131,31 +114,24 @@ namespace HttStream
 
 	void HttpStreamFilter::SetQuality (double val)
 	{
-		g_object_set (G_OBJECT (Encoder_), "quality", val, nullptr);
+		if (const auto branch = Branches_.value (StreamFormat::Vorbis))
+			branch->SetQuality (val);
 	}
 
-	void HttpStreamFilter::SetAddress (const QString& host, int port)
+	void HttpStreamFilter::SetBitrate (StreamFormat format, int kbps)
 	{
-		Server_->SetAddress (host, port);
+		if (const auto branch = Branches_.value (format))
+			branch->SetBitrate (kbps);
 	}
 
-	namespace
+	void HttpStreamFilter::SetClientBufferSize (int size)
 	{
-		// http://cgit.collabora.com/git/user/kakaroto/gst-plugins-base.git/plain/gst/tcp/gstmultihandlesink.c
-		const int GST_CLIENT_STATUS_REMOVED = 2;
+		Server_->SetMaxClientBuffer (size);
 	}
 
-	void HttpStreamFilter::HandleRemoved (int fd, int reason)
+	void HttpStreamFilter::SetAddress (const QString& host, int port)
 	{
-		if (reason != GST_CLIENT_STATUS_REMOVED)
-			return;
-
-		qDebug () << Q_FUNC_INFO
-				<< "detected client removal because of"
-				<< reason
-				<< "; scheduling readd...";
-
-		Util::ExecuteLater ([this, fd] { g_signal_emit_by_name (MSS_, "add", fd); });
+		Server_->SetAddress (host, port);
 	}
 
 	GstElement* HttpStreamFilter::GetElement () const
@@ -165,42 +141,47 @@ namespace HttStream
 
 	void HttpStreamFilter::PostAdd (IPath *path)
 	{
-		path->AddSyncHandler ([this] (GstBus*, GstMessage *msg) { return HandleError (msg); }, this);
+		path->AddSyncHandler ([this] (GstBus*, GstMessage *msg) { return HandleBusMessage (msg); }, this);
 	}
 
-	void HttpStreamFilter::CreatePad ()
+	void HttpStreamFilter::AttachBranch (StreamFormat format)
 	{
-		qDebug () << Q_FUNC_INFO;
+		if (TeeBranchPads_.contains (format))
+			return;
 
-		gst_bin_add_many (GST_BIN (Elem_), StreamQueue_, Encoder_, AConv_, Muxer_, MSS_, nullptr);
-		gst_element_link_many (StreamQueue_, AConv_, Encoder_, Muxer_, MSS_, nullptr);
-		for (auto elem : GetStreamBranchElements ())
-			gst_element_sync_state_with_parent (elem);
+		qDebug () << Q_FUNC_INFO << GetFormatName (format);
 
-		TeeStreamPad_ = gst_element_request_pad (Tee_, TeeTemplate_, nullptr, nullptr);
-		auto streamPad = gst_element_get_static_pad (StreamQueue_, "sink");
-		gst_pad_link (TeeStreamPad_, streamPad);
-		gst_object_unref (streamPad);
+		const auto elem = Branches_ [format]->GetElement ();
+		gst_bin_add (GST_BIN (Elem_), elem);
+		gst_element_sync_state_with_parent (elem);
+
+		const auto teePad = gst_element_request_pad (Tee_, TeeTemplate_, nullptr, nullptr);
+		auto branchPad = gst_element_get_static_pad (elem, "sink");
+		gst_pad_link (teePad, branchPad);
+		gst_object_unref (branchPad);
+
+		TeeBranchPads_ [format] = teePad;
 	}
 
-	void HttpStreamFilter::DestroyPad ()
+	void HttpStreamFilter::DetachBranch (StreamFormat format)
 	{
-		auto streamPad = gst_element_get_static_pad (StreamQueue_, "sink");
-		gst_pad_unlink (TeeStreamPad_, streamPad);
-		gst_object_unref (streamPad);
+		const auto teePad = TeeBranchPads_.take (format);
+		if (!teePad)
+			return;
 
-		gst_element_release_request_pad (Tee_, TeeStreamPad_);
-		gst_object_unref (TeeStreamPad_);
+		qDebug () << Q_FUNC_INFO << GetFormatName (format);
 
-		gst_element_unlink_many (StreamQueue_, AConv_, Encoder_, Muxer_, MSS_, nullptr);
-		gst_bin_remove_many (GST_BIN (Elem_), StreamQueue_, Encoder_, AConv_, Muxer_, MSS_, nullptr);
+		const auto elem = Branches_ [format]->GetElement ();
 
-		TeeStreamPad_ = nullptr;
-	}
+		auto branchPad = gst_element_get_static_pad (elem, "sink");
+		gst_pad_unlink (teePad, branchPad);
+		gst_object_unref (branchPad);
 
-	std::vector<GstElement*> HttpStreamFilter::GetStreamBranchElements () const
-	{
-		return { StreamQueue_, AConv_, Encoder_, Muxer_, MSS_ };
+		gst_element_release_request_pad (Tee_, teePad);
+		gst_object_unref (teePad);
+
+		gst_element_set_state (elem, GST_STATE_NULL);
+		gst_bin_remove (GST_BIN (Elem_), elem);
 	}
 
 	bool HttpStreamFilter::HandleFirstClientConnected ()
@@ -209,39 +190,64 @@ namespace HttStream
 		StateOnFirst_ = source->GetState ();
 
 		if (StateOnFirst_ == SourceState::Playing)
-		{
-			CreatePad ();
 			return true;
-		}
-		else
-		{
-			connect (source->GetQObject (),
-					SIGNAL (stateChanged (SourceState, SourceState)),
-					this,
-					SLOT (checkCreatePad (SourceState)),
-					Qt::UniqueConnection);
 
-			source->SetState (SourceState::Playing);
+		connect (source->GetQObject (),
+				SIGNAL (stateChanged (SourceState, SourceState)),
+				this,
+				SLOT (checkAttachBranches (SourceState)),
+				Qt::UniqueConnection);
 
-			return false;
-		}
+		source->SetState (SourceState::Playing);
+
+		return false;
 	}
 
 	void HttpStreamFilter::HandleLastClientDisconnected ()
 	{
-		DestroyPad ();
+		disconnect (Path_->GetSourceObject ()->GetQObject (),
+				SIGNAL (stateChanged (SourceState, SourceState)),
+				this,
+				SLOT (checkAttachBranches (SourceState)));
 
 		if (StateOnFirst_ != SourceState::Playing)
 			Path_->GetSourceObject ()->SetState (SourceState::Paused);
 	}
 
-	int HttpStreamFilter::HandleError (GstMessage *msg)
+	int HttpStreamFilter::HandleBusMessage (GstMessage *msg)
 	{
-		if (GST_MESSAGE_TYPE (msg) != GST_MESSAGE_ERROR)
-			return GST_BUS_PASS;
-
-		if (QList<GstElement*> { StreamQueue_, Encoder_, MSS_ }.contains (GST_ELEMENT (msg->src)))
+		switch (GST_MESSAGE_TYPE (msg))
+		{
+		case GST_MESSAGE_TAG:
 		{
+			GstUtil::TagMap_t tags;
+			if (!GstUtil::ParseTagMessage (msg, tags, {}))
+				break;
+
+			const auto& title = tags.value ("title");
+			if (title.isEmpty ())
+				break;
+
+			const auto& artist = tags.value ("artist");
+			QMetaObject::invokeMethod (this,
+					"handleStreamTitle",
+					Qt::QueuedConnection,
+					Q_ARG (QString, artist.isEmpty () ? title : artist + " - " + title));
+			break;
+		}
+		case GST_MESSAGE_ERROR:
+		{
+			// Branches_ is never modified after the constructor, so it's
+			// safe to access it from the streaming thread.
+			const auto src = GST_OBJECT (msg->src);
+			const auto isOurs = std::any_of (Branches_.begin (), Branches_.end (),
+					[src] (EncoderBranch *branch)
+					{
+						return gst_object_has_as_ancestor (src, GST_OBJECT (branch->GetElement ()));
+					});
+			if (!isOurs)
+				break;
+
 			qDebug () << Q_FUNC_INFO
 					<< "detected stream error";
 
@@ -249,11 +255,14 @@ namespace HttStream
 
 			return GST_BUS_DROP;
 		}
+		default:
+			break;
+		}
 
 		return GST_BUS_PASS;
 	}
 
-	void HttpStreamFilter::checkCreatePad (SourceState state)
+	void HttpStreamFilter::checkAttachBranches (SourceState state)
 	{
 		if (state != SourceState::Playing)
 			return;
@@ -261,32 +270,41 @@ namespace HttStream
 		disconnect (Path_->GetSourceObject ()->GetQObject (),
 				SIGNAL (stateChanged (SourceState, SourceState)),
 				this,
-				SLOT (checkCreatePad (SourceState)));
-		CreatePad ();
+				SLOT (checkAttachBranches (SourceState)));
 
-		for (const auto sock : PendingSockets_)
-			g_signal_emit_by_name (MSS_, "add", sock);
+		for (const auto format : PendingFormats_)
+			AttachBranch (format);
 
-		PendingSockets_.clear ();
+		PendingFormats_.clear ();
 	}
 
-	void HttpStreamFilter::handleClient (int socket)
+	void HttpStreamFilter::handleFormatRequested (StreamFormat format)
 	{
-		if (ClientsCount_ || HandleFirstClientConnected ())
-			g_signal_emit_by_name (MSS_, "add", socket);
-		else
-			PendingSockets_ << socket;
+		if (!PendingFormats_.isEmpty ())
+		{
+			PendingFormats_ << format;
+			return;
+		}
 
-		++ClientsCount_;
+		if (!TeeBranchPads_.isEmpty () || HandleFirstClientConnected ())
+			AttachBranch (format);
+		else
+			PendingFormats_ << format;
 	}
 
-	void HttpStreamFilter::handleClientDisconnected (int socket)
+	void HttpStreamFilter::handleFormatReleased (StreamFormat format)
 	{
-		g_signal_emit_by_name (MSS_, "remove", socket);
+		PendingFormats_.removeAll (format);
+		DetachBranch (format);
 
-		if (!--ClientsCount_)
+		if (TeeBranchPads_.isEmpty () && PendingFormats_.isEmpty ())
 			HandleLastClientDisconnected ();
 	}
+
+	void HttpStreamFilter::handleStreamTitle (const QString& title)
+	{
+		Server_->SetStreamTitle (title);
+	}
 }
 }
 }
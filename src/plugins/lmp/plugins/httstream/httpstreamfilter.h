@@ -29,10 +29,11 @@
 
 #pragma once
 
-#include <vector>
 #include <QObject>
+#include <QHash>
 #include "interfaces/lmp/ifilterelement.h"
 #include "interfaces/lmp/isourceobject.h"
+#include "encoderbranch.h"
 
 typedef struct _GstPad GstPad;
 typedef struct _GstMessage GstMessage;
@@ -65,24 +66,17 @@ namespace HttStream
 		GstPadTemplate * const TeeTemplate_;
 
 		GstElement * const AudioQueue_;
-		GstElement * const StreamQueue_;
-		GstElement * const AConv_;
 
-		GstElement * const Encoder_;
-
-		GstElement * const Muxer_;
-
-		GstElement * const MSS_;
+		const QList<StreamFormat> Formats_;
+		QHash<StreamFormat, EncoderBranch*> Branches_;
 
 		HttpServer * const Server_;
 
 		GstPad *TeeAudioPad_;
-		GstPad *TeeStreamPad_ = nullptr;
-
-		int ClientsCount_ = 0;
+		QHash<StreamFormat, GstPad*> TeeBranchPads_;
 
 		SourceState StateOnFirst_ = SourceState::Error;
-		QList<int> PendingSockets_;
+		QList<StreamFormat> PendingFormats_;
 	public:
 		HttpStreamFilter (const QByteArray& filterId,
 				const QByteArray& instanceId, IPath *path);
@@ -93,27 +87,27 @@ namespace HttStream
 		IFilterConfigurator* GetConfigurator () const override;
 
 		void SetQuality (double);
+		void SetBitrate (StreamFormat, int);
+		void SetClientBufferSize (int);
 		void SetAddress (const QString&, int);
-
-		void HandleRemoved (int, int);
 	protected:
 		GstElement* GetElement () const override;
 		void PostAdd (IPath*) override;
 	private:
-		void CreatePad ();
-		void DestroyPad ();
-
-		std::vector<GstElement*> GetStreamBranchElements () const;
+		void AttachBranch (StreamFormat);
+		void DetachBranch (StreamFormat);
 
 		bool HandleFirstClientConnected ();
 		void HandleLastClientDisconnected ();
 
-		int HandleError (GstMessage*);
+		int HandleBusMessage (GstMessage*);
 	private slots:
-		void checkCreatePad (SourceState);
+		void checkAttachBranches (SourceState);
+
+		void handleFormatRequested (StreamFormat);
+		void handleFormatReleased (StreamFormat);
 
-		void handleClient (int);
-		void handleClientDisconnected (int);
+		void handleStreamTitle (const QString&);
 	};
 }
 }
@@ -30,8 +30,10 @@
 #include "progressmanager.h"
 #include <QStandardItemModel>
 #include <util/xpc/util.h>
+#include <util/util.h>
 #include <interfaces/ijobholder.h>
 #include "sync/syncmanagerbase.h"
+#include "rganalysismanager.h"
 
 namespace LeechCraft
 {
@@ -60,6 +62,14 @@ namespace LMP
 				SLOT (handleUploadProgress (int, int, SyncManagerBase*)));
 	}
 
+	void ProgressManager::AddRgAnalysisManager (RgAnalysisManager *rgMgr)
+	{
+		connect (rgMgr,
+				SIGNAL (progress (int, int, qint64)),
+				this,
+				SLOT (handleRgProgress (int, int, qint64)));
+	}
+
 	void ProgressManager::HandleWithHash (int done, int total,
 			SyncManagerBase *syncer, Syncer2Row_t& hash, const QString& name, const QString& status)
 	{
@@ -104,5 +114,38 @@ namespace LMP
 		HandleWithHash (done, total, syncer, UpRows_,
 				tr ("Audio upload"), tr ("Uploading..."));
 	}
+
+	void ProgressManager::handleRgProgress (int done, int total, qint64 eta)
+	{
+		if (done >= total)
+		{
+			if (!RgRow_.isEmpty ())
+			{
+				Model_->removeRow (RgRow_.first ()->row ());
+				RgRow_.clear ();
+			}
+			return;
+		}
+
+		if (RgRow_.isEmpty ())
+		{
+			RgRow_ = QList<QStandardItem*>
+			{
+				new QStandardItem (tr ("ReplayGain analysis")),
+				new QStandardItem (),
+				new QStandardItem ()
+			};
+			auto item = RgRow_.at (JobHolderColumn::JobProgress);
+			item->setData (QVariant::fromValue<JobHolderRow> (JobHolderRow::ProcessProgress),
+					CustomDataRoles::RoleJobHolderRow);
+			Model_->appendRow (RgRow_);
+		}
+
+		RgRow_.at (JobHolderColumn::JobStatus)->setText (eta >= 0 ?
+				tr ("Analyzing, %1 left...").arg (Util::MakeTimeFromLong (eta)) :
+				tr ("Analyzing..."));
+		Util::SetJobHolderProgress (RgRow_, done, total,
+				tr ("%1 of %2 albums").arg (done).arg (total));
+	}
 }
 }
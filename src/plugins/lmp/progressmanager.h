@@ -41,6 +41,7 @@ namespace LeechCraft
 namespace LMP
 {
 	class SyncManagerBase;
+	class RgAnalysisManager;
 
 	class ProgressManager : public QObject
 	{
@@ -51,18 +52,22 @@ namespace LMP
 		typedef QHash<SyncManagerBase*, QList<QStandardItem*>> Syncer2Row_t;
 		Syncer2Row_t TCRows_;
 		Syncer2Row_t UpRows_;
+
+		QList<QStandardItem*> RgRow_;
 	public:
 		ProgressManager (QObject* = 0);
 
 		QAbstractItemModel* GetModel () const;
 
 		void AddSyncManager (SyncManagerBase*);
+		void AddRgAnalysisManager (RgAnalysisManager*);
 	private:
 		void HandleWithHash (int, int, SyncManagerBase*,
 				Syncer2Row_t&, const QString&, const QString&);
 	private slots:
 		void handleTCProgress (int, int, SyncManagerBase*);
 		void handleUploadProgress (int, int, SyncManagerBase*);
+		void handleRgProgress (int, int, qint64);
 	};
 }
 }
@@ -28,6 +28,10 @@
  **********************************************************************/
 
 #include "rganalysismanager.h"
+#include <algorithm>
+#include <QThread>
+#include <QtDebug>
+#include "engine/sourceobject.h"
 #include "localcollection.h"
 #include "localcollectionstorage.h"
 #include "engine/rganalyser.h"
@@ -38,17 +42,37 @@ namespace LeechCraft
 {
 namespace LMP
 {
-	RgAnalysisManager::RgAnalysisManager (LocalCollection *coll, QObject *parent)
+	namespace
+	{
+		/** This many track results are collected before being written
+		 * to the storage in a single transaction.
+		 */
+		const int ResultsBatchSize = 50;
+	}
+
+	RgAnalysisManager::RgAnalysisManager (LocalCollection *coll, SourceObject *source, QObject *parent)
 	: QObject { parent }
 	, Coll_ { coll }
+	, Source_ { source }
 	{
 		connect (Coll_,
 				SIGNAL (scanFinished ()),
 				this,
 				SLOT (handleScanFinished ()));
+		connect (Source_,
+				SIGNAL (stateChanged (SourceState, SourceState)),
+				this,
+				SLOT (handlePlayerStateChanged (SourceState)));
 
 		XmlSettingsManager::Instance ().RegisterObject ("AutobuildRG",
 				this, "handleScanFinished");
+		XmlSettingsManager::Instance ().RegisterObject ("RGAnalysersCount",
+				this, "rotateQueue");
+	}
+
+	RgAnalysisManager::~RgAnalysisManager ()
+	{
+		FlushResults ();
 	}
 
 	namespace
@@ -59,9 +83,74 @@ namespace LMP
 		}
 	}
 
+	int RgAnalysisManager::GetMaxAnalysers () const
+	{
+		// Don't compete with the playback for the CPU and the disk.
+		if (Source_->GetState () == SourceState::Playing)
+			return 1;
+
+		const auto configured = XmlSettingsManager::Instance ().property ("RGAnalysersCount").toInt ();
+		return configured > 0 ?
+				configured :
+				std::max (QThread::idealThreadCount (), 1);
+	}
+
+	void RgAnalysisManager::FlushResults ()
+	{
+		// the albums are kept in QueuedAlbums_ until their results are
+		// stored so that a rescan doesn't queue them once again
+		for (const auto albumId : PendingAlbums_)
+			QueuedAlbums_.remove (albumId);
+		PendingAlbums_.clear ();
+
+		if (PendingResults_.isEmpty ())
+			return;
+
+		try
+		{
+			Coll_->GetStorage ()->SetRgTrackInfos (PendingResults_);
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to store"
+					<< PendingResults_.size ()
+					<< "results:"
+					<< e.what ();
+		}
+
+		PendingResults_.clear ();
+	}
+
+	void RgAnalysisManager::EmitProgress ()
+	{
+		qint64 eta = -1;
+		if (DoneAlbums_)
+		{
+			const auto perAlbum = RunTimer_.elapsed () / DoneAlbums_;
+			eta = perAlbum * (TotalAlbums_ - DoneAlbums_) / 1000;
+		}
+
+		emit progress (DoneAlbums_, TotalAlbums_, eta);
+	}
+
 	void RgAnalysisManager::handleAnalysed ()
 	{
-		const auto& result = CurrentAnalyser_->GetResult ();
+		const auto pos = std::find_if (Analysers_.begin (), Analysers_.end (),
+				[this] (const auto& analyser) { return analyser.get () == sender (); });
+		if (pos == Analysers_.end ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unknown analyser"
+					<< sender ();
+			return;
+		}
+
+		const auto analyser = *pos;
+		Analysers_.erase (pos);
+		PendingAlbums_ << Analyser2Album_.take (analyser.get ());
+
+		const auto& result = analyser->GetResult ();
 
 		for (const auto& track : result.Tracks_)
 		{
@@ -74,16 +163,22 @@ namespace LMP
 				continue;
 			}
 
-			Coll_->GetStorage ()->SetRgTrackInfo (id,
+			PendingResults_.append ({ id,
 					{
 						track.TrackGain_,
 						track.TrackPeak_,
 						result.AlbumGain_,
 						result.AlbumPeak_
-					});
+					} });
 		}
 
-		CurrentAnalyser_.reset ();
+		++DoneAlbums_;
+
+		if (PendingResults_.size () >= ResultsBatchSize ||
+				(AlbumsQueue_.isEmpty () && Analysers_.isEmpty ()))
+			FlushResults ();
+
+		EmitProgress ();
 		rotateQueue ();
 	}
 
@@ -94,19 +189,50 @@ namespace LMP
 
 		if (!IsScanAllowed ())
 		{
+			for (const auto& album : AlbumsQueue_)
+				QueuedAlbums_.remove (album->ID_);
 			AlbumsQueue_.clear ();
+
+			FlushResults ();
+
+			TotalAlbums_ = DoneAlbums_;
+			EmitProgress ();
 			return;
 		}
 
-		QStringList paths;
-		for (const auto& track : AlbumsQueue_.takeFirst ()->Tracks_)
-			paths << track.FilePath_;
+		const auto maxCount = GetMaxAnalysers ();
+		while (Analysers_.size () < maxCount && !AlbumsQueue_.isEmpty ())
+		{
+			const auto& album = AlbumsQueue_.takeFirst ();
 
-		CurrentAnalyser_ = std::make_shared<RgAnalyser> (paths);
-		connect (CurrentAnalyser_.get (),
-				SIGNAL (finished ()),
-				this,
-				SLOT (handleAnalysed ()));
+			QStringList paths;
+			for (const auto& track : album->Tracks_)
+				paths << track.FilePath_;
+
+			if (paths.isEmpty ())
+			{
+				PendingAlbums_ << album->ID_;
+				++DoneAlbums_;
+				continue;
+			}
+
+			const auto analyser = std::make_shared<RgAnalyser> (paths);
+			connect (analyser.get (),
+					SIGNAL (finished ()),
+					this,
+					SLOT (handleAnalysed ()));
+			Analysers_ << analyser;
+			Analyser2Album_ [analyser.get ()] = album->ID_;
+		}
+
+		if (AlbumsQueue_.isEmpty () && Analysers_.isEmpty ())
+			FlushResults ();
+	}
+
+	void RgAnalysisManager::handlePlayerStateChanged (SourceState state)
+	{
+		if (state != SourceState::Playing)
+			rotateQueue ();
 	}
 
 	void RgAnalysisManager::handleScanFinished ()
@@ -119,16 +245,30 @@ namespace LMP
 		for (const auto track : Coll_->GetStorage ()->GetOutdatedRgTracks ())
 			albums << Coll_->GetTrackAlbumId (track);
 
-		const bool wasEmpty = AlbumsQueue_.isEmpty ();
+		if (AlbumsQueue_.isEmpty () && Analysers_.isEmpty ())
+		{
+			DoneAlbums_ = 0;
+			TotalAlbums_ = 0;
+			RunTimer_.start ();
+		}
 
 		for (auto albumId : albums)
+		{
+			if (QueuedAlbums_.contains (albumId))
+				continue;
+
 			if (const auto& album = Coll_->GetAlbum (albumId))
+			{
 				AlbumsQueue_ << album;
+				QueuedAlbums_ << albumId;
+				++TotalAlbums_;
+			}
+		}
 
 		qDebug () << AlbumsQueue_.size ()
 				<< "albums to rescan";
-		if (wasEmpty)
-			rotateQueue ();
+		EmitProgress ();
+		rotateQueue ();
 	}
 }
 }
@@ -30,8 +30,12 @@
 #pragma once
 
 #include <QObject>
+#include <QHash>
 #include <QSet>
+#include <QElapsedTimer>
 #include "interfaces/lmp/collectiontypes.h"
+#include "interfaces/lmp/isourceobject.h"
+#include "engine/rgfilter.h"
 
 namespace LeechCraft
 {
@@ -39,23 +43,42 @@ namespace LMP
 {
 	class RgAnalyser;
 	class LocalCollection;
+	class SourceObject;
 
 	class RgAnalysisManager : public QObject
 	{
 		Q_OBJECT
 
 		LocalCollection * const Coll_;
+		SourceObject * const Source_;
 
-		std::shared_ptr<RgAnalyser> CurrentAnalyser_;
+		QList<std::shared_ptr<RgAnalyser>> Analysers_;
+		QHash<RgAnalyser*, int> Analyser2Album_;
 
 		QList<Collection::Album_ptr> AlbumsQueue_;
+		QSet<int> QueuedAlbums_;
+
+		QList<QPair<int, RGData>> PendingResults_;
+		QList<int> PendingAlbums_;
+
+		int DoneAlbums_ = 0;
+		int TotalAlbums_ = 0;
+		QElapsedTimer RunTimer_;
 	public:
-		RgAnalysisManager (LocalCollection *coll, QObject* = nullptr);
+		RgAnalysisManager (LocalCollection *coll, SourceObject *source, QObject* = nullptr);
+		~RgAnalysisManager () override;
+	private:
+		int GetMaxAnalysers () const;
+		void FlushResults ();
+		void EmitProgress ();
 	private slots:
 		void handleAnalysed ();
 		void rotateQueue ();
+		void handlePlayerStateChanged (SourceState);
 	public slots:
 		void handleScanFinished ();
+	signals:
+		void progress (int done, int total, qint64 etaSecs);
 	};
 }
 }
@@ -29,6 +29,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <QObject>
 #include <QFile>
 #include <QFileInfo>
@@ -56,28 +57,77 @@ namespace LMP
 		void errorCopying (const QString&, const QString&);
 	};
 
+	/** @brief Copies the files to a device, possibly several at once.
+	 *
+	 * The CopyJobT type should provide GetQObject(), Upload() and
+	 * GetLocalPath() methods as well as Filename_ and RemoveOnFinish_
+	 * members. The uploadFinished() signal of the syncer is matched
+	 * against the running jobs by the sender and the local path, so
+	 * several jobs could be in flight with the same syncer. Since the
+	 * local path is the only thing the signal carries, jobs sharing it
+	 * with an already running job on the same syncer are held back until
+	 * that one finishes.
+	 */
 	template<typename CopyJobT>
 	class CopyManager : public CopyManagerBase
 	{
 		QList<CopyJobT> Queue_;
-		CopyJobT CurrentJob_;
+		QList<CopyJobT> Running_;
+
+		int MaxRunning_ = 1;
 	public:
 		CopyManager (QObject *parent = 0)
 		: CopyManagerBase (parent)
 		{
 		}
 
+		void SetMaxRunning (int maxRunning)
+		{
+			MaxRunning_ = std::max (maxRunning, 1);
+			StartPending ();
+		}
+
 		void Copy (const CopyJobT& job)
 		{
-			if (IsRunning ())
-				Queue_ << job;
-			else
-				StartJob (job);
+			Queue_ << job;
+			StartPending ();
+		}
+
+		/** Returns the number of queued or running jobs whose source
+		 * files are temporary, like transcoded files.
+		 */
+		int GetTempFilesBacklog () const
+		{
+			const auto isTemp = [] (const CopyJobT& job) { return job.RemoveOnFinish_; };
+			return std::count_if (Queue_.begin (), Queue_.end (), isTemp) +
+					std::count_if (Running_.begin (), Running_.end (), isTemp);
 		}
 	private:
+		bool IsRunning (QObject *syncer, const QString& localPath) const
+		{
+			return std::any_of (Running_.begin (), Running_.end (),
+					[syncer, &localPath] (const CopyJobT& job)
+					{
+						return job.GetQObject () == syncer &&
+								job.GetLocalPath () == localPath;
+					});
+		}
+
+		void StartPending ()
+		{
+			for (int i = 0; i < Queue_.size () && Running_.size () < MaxRunning_; )
+			{
+				const auto& job = Queue_.at (i);
+				if (IsRunning (job.GetQObject (), job.GetLocalPath ()))
+					++i;
+				else
+					StartJob (Queue_.takeAt (i));
+			}
+		}
+
 		void StartJob (const CopyJobT& job)
 		{
-			CurrentJob_ = job;
+			Running_ << job;
 
 			connect (job.GetQObject (),
 					SIGNAL (uploadFinished (QString, QFile::FileError, QString)),
@@ -90,25 +140,30 @@ namespace LMP
 				connect (job.GetQObject (),
 						SIGNAL (uploadProgress (qint64, qint64)),
 						this,
-						SIGNAL (copyProgress (qint64, qint64)));
+						SIGNAL (copyProgress (qint64, qint64)),
+						Qt::UniqueConnection);
 
 			job.Upload ();
 
 			emit startedCopying (job.Filename_);
 		}
-
-		bool IsRunning () const
-		{
-			return !CurrentJob_.Filename_.isEmpty ();
-		}
 	protected:
 		void handleUploadFinished (const QString& localPath, QFile::FileError error, const QString& errorStr) override
 		{
-			const bool remove = CurrentJob_.RemoveOnFinish_;
-			CurrentJob_ = CopyJobT ();
+			const auto syncer = sender ();
+			const auto pos = std::find_if (Running_.begin (), Running_.end (),
+					[syncer, &localPath] (const CopyJobT& job)
+					{
+						return job.GetQObject () == syncer &&
+								job.GetLocalPath () == localPath;
+					});
+			if (pos == Running_.end ())
+				return;
+
+			const bool remove = pos->RemoveOnFinish_;
+			Running_.erase (pos);
 
-			if (!Queue_.isEmpty ())
-				StartJob (Queue_.takeFirst ());
+			StartPending ();
 
 			if (remove)
 				QFile::remove (localPath);
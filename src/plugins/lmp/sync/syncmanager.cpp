@@ -38,6 +38,7 @@
 #include "copymanager.h"
 #include "../core.h"
 #include "../localfileresolver.h"
+#include "../xmlsettingsmanager.h"
 
 namespace LeechCraft
 {
@@ -55,6 +56,11 @@ namespace LMP
 			Syncer_->Upload (From_, OrigPath_, MountPoint_, Filename_);
 		}
 
+		QString GetLocalPath () const
+		{
+			return From_;
+		}
+
 		QString From_;
 		bool RemoveOnFinish_;
 
@@ -95,6 +101,14 @@ namespace LMP
 		Mount2Copiers_ [mount] = mgr;
 	}
 
+	int SyncManager::GetTempFilesBacklog () const
+	{
+		int result = 0;
+		for (const auto copier : Mount2Copiers_)
+			result += copier->GetTempFilesBacklog ();
+		return result;
+	}
+
 	namespace
 	{
 		Util::Either<ResolveError, QString> FixMask (const QString& mask, const QString& transcoded)
@@ -144,7 +158,12 @@ namespace LMP
 						syncTo.MountPath_,
 						filename
 					};
-					Mount2Copiers_ [syncTo.MountPath_]->Copy (copyJob);
+					const auto copier = Mount2Copiers_ [syncTo.MountPath_];
+					copier->SetMaxRunning (XmlSettingsManager::Instance ()
+							.property ("SyncParallelCopies").toInt ());
+					copier->Copy (copyJob);
+
+					UpdateTranscoderPause ();
 				},
 				[&] (const ResolveError& err)
 				{
@@ -61,6 +61,8 @@ namespace LMP
 		void AddFiles (ISyncPlugin*, const QString& mount, const QStringList&, const TranscodingParams&);
 	private:
 		void CreateSyncer (const QString&);
+	protected:
+		int GetTempFilesBacklog () const override;
 	protected slots:
 		void handleFileTranscoded (const QString& from, const QString&, QString);
 	};
@@ -114,6 +114,16 @@ namespace LMP
 		CheckTCFinished ();
 	}
 
+	namespace
+	{
+		const int MaxTempFilesBacklog = 16;
+	}
+
+	void SyncManagerBase::UpdateTranscoderPause ()
+	{
+		Transcoder_->SetPaused (GetTempFilesBacklog () >= MaxTempFilesBacklog);
+	}
+
 	void SyncManagerBase::handleStartedTranscoding (const QString& file)
 	{
 		emit uploadLog (tr ("File %1 started transcoding...")
@@ -146,6 +156,8 @@ namespace LMP
 		emit uploadProgress (++CopiedCount_, TotalCopyCount_, this);
 		emit singleUploadProgress (0, 0, this);
 		CheckUploadFinished ();
+
+		UpdateTranscoderPause ();
 	}
 
 	void SyncManagerBase::handleCopyProgress (qint64 done, qint64 total)
@@ -165,6 +177,8 @@ namespace LMP
 
 		emit uploadProgress (++CopiedCount_, TotalCopyCount_, this);
 		CheckUploadFinished ();
+
+		UpdateTranscoderPause ();
 	}
 }
 }
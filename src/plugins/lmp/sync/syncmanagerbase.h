@@ -58,6 +58,12 @@ namespace LMP
 	protected:
 		void AddFiles (const QStringList&, const TranscodingParams&);
 		void HandleFileTranscoded (const QString&, const QString&);
+
+		/** Pauses the transcoder if too many transcoded files are waiting
+		 * to be copied, and resumes it once the copiers catch up.
+		 */
+		void UpdateTranscoderPause ();
+		virtual int GetTempFilesBacklog () const = 0;
 	private:
 		void CheckTCFinished ();
 		void CheckUploadFinished ();
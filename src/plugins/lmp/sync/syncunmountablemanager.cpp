@@ -130,6 +130,13 @@ namespace LMP
 			from
 		};
 		CopyMgr_->Copy (copyJob);
+
+		UpdateTranscoderPause ();
+	}
+
+	int SyncUnmountableManager::GetTempFilesBacklog () const
+	{
+		return CopyMgr_->GetTempFilesBacklog ();
 	}
 }
 }
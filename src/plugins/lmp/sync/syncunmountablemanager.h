@@ -69,6 +69,11 @@ namespace LMP
 				Syncer_->Upload (Filename_, OrigPath_, DevID_, StorageID_);
 			}
 
+			QString GetLocalPath () const
+			{
+				return Filename_;
+			}
+
 			QString Filename_;
 			bool RemoveOnFinish_;
 
@@ -82,6 +87,8 @@ namespace LMP
 		SyncUnmountableManager (QObject* = 0);
 
 		void AddFiles (const AddFilesParams&);
+	protected:
+		int GetTempFilesBacklog () const override;
 	protected slots:
 		void handleFileTranscoded (const QString& from, const QString& transcoded, QString);
 	};
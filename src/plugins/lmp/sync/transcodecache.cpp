@@ -0,0 +1,143 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "transcodecache.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QUuid>
+#include <QMutexLocker>
+#include <QtDebug>
+#include <util/sys/paths.h>
+#include "transcodingparams.h"
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	TranscodeCache::TranscodeCache ()
+	: Dir_ { Util::CreateIfNotExists ("lmp/transcodecache") }
+	{
+	}
+
+	QByteArray TranscodeCache::MakeKey (const QString& path, const TranscodingParams& params,
+			const QString& extension) const
+	{
+		QFile file { path };
+		if (!file.open (QIODevice::ReadOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< path
+					<< file.errorString ();
+			return {};
+		}
+
+		QCryptographicHash hash { QCryptographicHash::Sha1 };
+		if (!hash.addData (&file))
+			return {};
+
+		QByteArray paramsData;
+		QDataStream stream { &paramsData, QIODevice::WriteOnly };
+		stream << params.FormatID_
+				<< static_cast<int> (params.BitrateType_)
+				<< params.Quality_;
+		hash.addData (paramsData);
+
+		return hash.result ().toHex () + '.' + extension.toLatin1 ();
+	}
+
+	namespace
+	{
+		bool LinkOrCopy (const QString& from, const QString& to)
+		{
+#ifdef Q_OS_UNIX
+			if (!link (QFile::encodeName (from).constData (), QFile::encodeName (to).constData ()))
+				return true;
+#endif
+			return QFile::copy (from, to);
+		}
+	}
+
+	bool TranscodeCache::Restore (const QByteArray& key, const QString& target) const
+	{
+		const auto& cached = GetCachedPath (key);
+		return QFile::exists (cached) && LinkOrCopy (cached, target);
+	}
+
+	void TranscodeCache::Insert (const QByteArray& key, const QString& file, qint64 maxSize)
+	{
+		const auto& cached = GetCachedPath (key);
+		if (QFile::exists (cached))
+			return;
+
+		const auto& part = Dir_.filePath (QUuid::createUuid ().toString () + ".part");
+		if (!LinkOrCopy (file, part))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to cache"
+					<< file;
+			return;
+		}
+
+		if (!QFile::rename (part, cached))
+			QFile::remove (part);
+
+		Evict (maxSize);
+	}
+
+	QString TranscodeCache::GetCachedPath (const QByteArray& key) const
+	{
+		return Dir_.filePath (QString::fromLatin1 (key));
+	}
+
+	void TranscodeCache::Evict (qint64 maxSize)
+	{
+		QMutexLocker locker { &EvictMutex_ };
+
+		const auto& infos = Dir_.entryInfoList (QDir::Files, QDir::Time);
+
+		qint64 total = 0;
+		for (const auto& info : infos)
+		{
+			// being written by a concurrent Insert()
+			if (info.suffix () == "part")
+				continue;
+
+			total += info.size ();
+			if (total > maxSize)
+				QFile::remove (info.absoluteFilePath ());
+		}
+	}
+}
+}
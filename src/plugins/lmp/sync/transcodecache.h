@@ -0,0 +1,67 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QDir>
+#include <QMutex>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	struct TranscodingParams;
+
+	/** @brief On-disk cache of transcoded files.
+	 *
+	 * The files are keyed by the hash of the source file contents and the
+	 * transcoding parameters affecting the output, so a track transcoded
+	 * for one device is reused for another one with the same settings.
+	 *
+	 * All the methods are thread-safe and are expected to be called from
+	 * worker threads since they hash or copy whole files.
+	 */
+	class TranscodeCache
+	{
+		const QDir Dir_;
+		QMutex EvictMutex_;
+	public:
+		TranscodeCache ();
+
+		QByteArray MakeKey (const QString& path, const TranscodingParams&,
+				const QString& extension) const;
+
+		bool Restore (const QByteArray& key, const QString& target) const;
+		void Insert (const QByteArray& key, const QString& file, qint64 maxSize);
+	private:
+		QString GetCachedPath (const QByteArray& key) const;
+		void Evict (qint64 maxSize);
+	};
+}
+}
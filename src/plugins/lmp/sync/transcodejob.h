@@ -38,6 +38,13 @@ namespace LMP
 {
 	struct TranscodingParams;
 
+	/** Returns a unique temporary path for the result of transcoding the
+	 * given file with the given params.
+	 *
+	 * @throws std::runtime_error if the temporary directory is unavailable.
+	 */
+	QString BuildTranscodedPath (const QString& path, const TranscodingParams& params);
+
 	class TranscodeJob : public QObject
 	{
 		Q_OBJECT
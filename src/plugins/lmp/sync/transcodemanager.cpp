@@ -28,11 +28,16 @@
  **********************************************************************/
 
 #include "transcodemanager.h"
+#include <stdexcept>
 #include <QStringList>
 #include <QtDebug>
 #include <QFileInfo>
+#include <QtConcurrentRun>
 #include <util/sll/prelude.h>
+#include <util/threads/futures.h>
 #include "transcodejob.h"
+#include "transcodecache.h"
+#include "../xmlsettingsmanager.h"
 
 namespace LeechCraft
 {
@@ -40,6 +45,7 @@ namespace LMP
 {
 	TranscodeManager::TranscodeManager (QObject *parent)
 	: QObject (parent)
+	, Cache_ (std::make_shared<TranscodeCache> ())
 	{
 	}
 
@@ -74,33 +80,139 @@ namespace LMP
 		Queue_ += Util::Map (files,
 				[&params] (const QString& file) { return qMakePair (file, params); });
 
-		while (RunningJobs_.size () < params.NumThreads_ && !Queue_.isEmpty ())
+		StartPending ();
+	}
+
+	void TranscodeManager::SetPaused (bool paused)
+	{
+		if (Paused_ == paused)
+			return;
+
+		Paused_ = paused;
+		StartPending ();
+	}
+
+	void TranscodeManager::StartPending ()
+	{
+		while (!Paused_ &&
+				!Queue_.isEmpty () &&
+				RunningJobs_.size () + CacheLookups_ < Queue_.first ().second.NumThreads_)
 			EnqueueJob (Queue_.takeFirst ());
 	}
 
+	namespace
+	{
+		struct CacheLookupResult
+		{
+			QByteArray Key_;
+			QString Restored_;
+		};
+	}
+
 	void TranscodeManager::EnqueueJob (const QPair<QString, TranscodingParams>& pair)
+	{
+		emit fileStartedTranscoding (QFileInfo (pair.first).fileName ());
+
+		if (!XmlSettingsManager::Instance ().property ("TranscodeCacheSize").toInt ())
+		{
+			StartTranscoding (pair, {});
+			return;
+		}
+
+		// Formats are only ever constructed in this thread, the static
+		// codecs list they fill isn't guarded.
+		const auto format = Formats {}.GetFormat (pair.second.FormatID_);
+		if (!format)
+		{
+			StartTranscoding (pair, {});
+			return;
+		}
+
+		QString target;
+		try
+		{
+			target = BuildTranscodedPath (pair.first, pair.second);
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< e.what ();
+			StartTranscoding (pair, {});
+			return;
+		}
+
+		++CacheLookups_;
+
+		const auto cache = Cache_;
+		const auto& extension = format->GetFileExtension ();
+		Util::Sequence (this,
+				QtConcurrent::run ([cache, pair, extension, target]
+					{
+						CacheLookupResult result { cache->MakeKey (pair.first, pair.second, extension), {} };
+						if (!result.Key_.isEmpty () && cache->Restore (result.Key_, target))
+							result.Restored_ = target;
+						return result;
+					})) >>
+				[this, pair] (const CacheLookupResult& result)
+				{
+					--CacheLookups_;
+
+					if (result.Restored_.isEmpty ())
+					{
+						StartTranscoding (pair, result.Key_);
+						return;
+					}
+
+					qDebug () << Q_FUNC_INFO
+							<< "reusing cached transcoding result for"
+							<< pair.first;
+
+					StartPending ();
+					emit fileReady (pair.first, result.Restored_, pair.second.FilePattern_);
+				};
+	}
+
+	void TranscodeManager::StartTranscoding (const QPair<QString, TranscodingParams>& pair,
+			const QByteArray& cacheKey)
 	{
 		auto job = new TranscodeJob (pair.first, pair.second, this);
-		RunningJobs_ << job;
+		RunningJobs_ [job] = cacheKey;
 		connect (job,
 				SIGNAL (done (TranscodeJob*, bool)),
 				this,
 				SLOT (handleDone (TranscodeJob*, bool)));
-		emit fileStartedTranscoding (QFileInfo (pair.first).fileName ());
 	}
 
 	void TranscodeManager::handleDone (TranscodeJob *job, bool success)
 	{
-		RunningJobs_.removeAll (job);
+		const auto& cacheKey = RunningJobs_.take (job);
 		job->deleteLater ();
 
-		if (!Queue_.isEmpty ())
-			EnqueueJob (Queue_.takeFirst ());
+		StartPending ();
 
-		if (success)
-			emit fileReady (job->GetOrigPath (), job->GetTranscodedPath (), job->GetTargetPattern ());
-		else
+		if (!success)
+		{
 			emit fileFailed (job->GetOrigPath ());
+			return;
+		}
+
+		const auto& origPath = job->GetOrigPath ();
+		const auto& transcodedPath = job->GetTranscodedPath ();
+		const auto& pattern = job->GetTargetPattern ();
+		if (cacheKey.isEmpty ())
+		{
+			emit fileReady (origPath, transcodedPath, pattern);
+			return;
+		}
+
+		// The file is cached before it is handed over to the copier, which
+		// removes it after copying.
+		const auto cache = Cache_;
+		const auto maxSize = XmlSettingsManager::Instance ()
+				.property ("TranscodeCacheSize").toLongLong () * 1024 * 1024;
+		Util::Sequence (this,
+				QtConcurrent::run ([=] { cache->Insert (cacheKey, transcodedPath, maxSize); })) >>
+				[=] { emit fileReady (origPath, transcodedPath, pattern); };
 	}
 }
 }
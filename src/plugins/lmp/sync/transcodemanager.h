@@ -29,8 +29,10 @@
 
 #pragma once
 
+#include <memory>
 #include <QObject>
 #include <QPair>
+#include <QHash>
 #include "transcodingparams.h"
 
 namespace LeechCraft
@@ -38,6 +40,7 @@ namespace LeechCraft
 namespace LMP
 {
 	class TranscodeJob;
+	class TranscodeCache;
 
 	class TranscodeManager : public QObject
 	{
@@ -45,13 +48,26 @@ namespace LMP
 
 		QList<QPair<QString, TranscodingParams>> Queue_;
 
-		QList<TranscodeJob*> RunningJobs_;
+		QHash<TranscodeJob*, QByteArray> RunningJobs_;
+		int CacheLookups_ = 0;
+
+		bool Paused_ = false;
+
+		const std::shared_ptr<TranscodeCache> Cache_;
 	public:
 		TranscodeManager (QObject* = 0);
 
 		void Enqueue (QStringList, const TranscodingParams&);
+
+		/** Stops starting new transcoding jobs if paused is true, for
+		 * example, if the files are transcoded faster than they are
+		 * copied. The jobs already running are not interrupted.
+		 */
+		void SetPaused (bool paused);
 	private:
+		void StartPending ();
 		void EnqueueJob (const QPair<QString, TranscodingParams>&);
+		void StartTranscoding (const QPair<QString, TranscodingParams>&, const QByteArray& cacheKey);
 	private slots:
 		void handleDone (TranscodeJob*, bool);
 	signals:
@@ -0,0 +1,157 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "localfileresolvertest.h"
+#include <QtTest>
+#include <QtConcurrentMap>
+#include <QTemporaryDir>
+#include <util/sll/either.h>
+#include "../localfileresolver.h"
+
+QTEST_MAIN (LeechCraft::LMP::LocalFileResolverTest)
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	namespace
+	{
+		const int FilesCount = 500;
+
+		/* Each file is 200 frames of silent 128 kbps 44.1 kHz MPEG-1 Layer
+		 * III, which is about 5.2 seconds, followed by an ID3v1 tag.
+		 */
+		const int FramesCount = 200;
+		const int FrameSize = 144 * 128000 / 44100;
+
+		QByteArray MakeField (const QByteArray& value, int size)
+		{
+			return value.left (size).leftJustified (size, '\0');
+		}
+
+		QByteArray MakeMp3 (int num)
+		{
+			QByteArray frame (FrameSize, '\0');
+			frame [0] = static_cast<char> (0xff);
+			frame [1] = static_cast<char> (0xfb);
+			frame [2] = static_cast<char> (0x90);
+
+			QByteArray result;
+			result.reserve (FrameSize * FramesCount + 128);
+			for (int i = 0; i < FramesCount; ++i)
+				result += frame;
+
+			result += "TAG";
+			result += MakeField ("Track " + QByteArray::number (num), 30);
+			result += MakeField ("Artist", 30);
+			result += MakeField ("Album", 30);
+			result += MakeField ("2014", 4);
+			result += MakeField ({}, 28);
+			result += '\0';
+			result += static_cast<char> (num % 100 + 1);
+			result += static_cast<char> (0xff);
+			return result;
+		}
+
+		void ResolveAll (LocalFileResolver& resolver, const QStringList& files)
+		{
+			for (const auto& file : files)
+				resolver.ResolveInfo (file);
+		}
+	}
+
+	LocalFileResolverTest::LocalFileResolverTest () = default;
+
+	LocalFileResolverTest::~LocalFileResolverTest () = default;
+
+	void LocalFileResolverTest::initTestCase ()
+	{
+		Dir_ = std::make_unique<QTemporaryDir> ();
+		QVERIFY (Dir_->isValid ());
+
+		for (int i = 0; i < FilesCount; ++i)
+		{
+			QFile file { Dir_->path () + QString ("/%1.mp3").arg (i) };
+			QVERIFY (file.open (QIODevice::WriteOnly));
+			file.write (MakeMp3 (i));
+			Files_ << file.fileName ();
+		}
+	}
+
+	void LocalFileResolverTest::cleanupTestCase ()
+	{
+		Dir_.reset ();
+	}
+
+	void LocalFileResolverTest::testResolve ()
+	{
+		LocalFileResolver resolver;
+		const auto& result = resolver.ResolveInfo (Files_.value (42));
+		QVERIFY (result.IsRight ());
+
+		const auto& info = result.GetRight ();
+		QCOMPARE (info.Artist_, QString { "Artist" });
+		QCOMPARE (info.Album_, QString { "Album" });
+		QCOMPARE (info.Title_, QString { "Track 42" });
+		QCOMPARE (info.Year_, 2014);
+		QCOMPARE (info.TrackNumber_, 43);
+		QCOMPARE (info.Length_, 5);
+	}
+
+	void LocalFileResolverTest::testCached ()
+	{
+		LocalFileResolver resolver;
+		const auto& first = resolver.ResolveInfo (Files_.value (0));
+		const auto& second = resolver.ResolveInfo (Files_.value (0));
+		QVERIFY (first.IsRight () && second.IsRight ());
+		QCOMPARE (first.GetRight (), second.GetRight ());
+	}
+
+	/* Both benchmarks resolve FilesCount files per iteration with a fresh
+	 * resolver, so that its in-memory cache is not hit.
+	 */
+	void LocalFileResolverTest::benchmarkSerial ()
+	{
+		QBENCHMARK {
+			LocalFileResolver resolver;
+			ResolveAll (resolver, Files_);
+		}
+	}
+
+	void LocalFileResolverTest::benchmarkParallel ()
+	{
+		auto files = Files_;
+		QBENCHMARK {
+			LocalFileResolver resolver;
+			QtConcurrent::blockingMap (files,
+					[&resolver] (const QString& file) { resolver.ResolveInfo (file); });
+		}
+	}
+}
+}
@@ -49,9 +49,9 @@ namespace Monocle
 {
 	namespace
 	{
-		QString GetFileName (const QString& id)
+		QString GetFileName (const QString& id, const QString& ext = "json")
 		{
-			return id.at (0) + '/' + id + ".json";
+			return id.at (0) + '/' + id + '.' + ext;
 		}
 	}
 
@@ -134,5 +134,13 @@ namespace Monocle
 #endif
 		return result;
 	}
+
+	QString DocStateManager::GetDocDataPath (const QString& id, const QString& ext)
+	{
+		if (!DocDir_.exists (id.at (0)))
+			DocDir_.mkdir (id.at (0));
+
+		return DocDir_.absoluteFilePath (GetFileName (id, ext));
+	}
 }
 }
@@ -55,6 +55,8 @@ namespace Monocle
 
 		void SetState (const QString&, const State&);
 		State GetState (const QString&) const;
+
+		QString GetDocDataPath (const QString&, const QString& ext);
 	};
 }
 }
@@ -107,6 +107,10 @@ namespace Monocle
 		: Util::FindNotification (Core::Instance ().GetProxy (), parent)
 		, SearchHandler_ (searchHandler)
 		{
+			connect (SearchHandler_,
+					&TextSearchHandler::searchFinished,
+					this,
+					[this] (bool found) { SetSuccessful (found); });
 		}
 	protected:
 		void handleNext (const QString& text, FindFlags flags)
@@ -0,0 +1,108 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <QList>
+#include <QRectF>
+#include <QString>
+#include <QtPlugin>
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	/** @brief Describes a single word-like text box on a page.
+	 *
+	 * @sa IHaveTextLayout
+	 */
+	struct TextBox
+	{
+		/** @brief The text contained in this box.
+		 */
+		QString Text_;
+
+		/** @brief The bounding rectangle of this box in page coordinates.
+		 */
+		QRectF Rect_;
+
+		/** @brief Whether this box is followed by a whitespace.
+		 *
+		 * If this flag is set, the text of the next box on the page
+		 * doesn't continue the text of this one.
+		 */
+		bool HasSpaceAfter_;
+	};
+
+	/** @brief Interface for documents exposing the geometry of their text.
+	 *
+	 * This interface should be implemented by the documents of formats
+	 * that can provide the text of a page along with the geometry of its
+	 * words. If a document implements this interface, Monocle builds a
+	 * persistent text index for it in background, so that searching
+	 * doesn't require the backend to reextract the text of each page.
+	 *
+	 * @sa ISearchableDocument
+	 */
+	class IHaveTextLayout
+	{
+	public:
+		/** @brief Virtual destructor.
+		 */
+		virtual ~IHaveTextLayout () {}
+
+		/** @brief Returns the text boxes of the given \em page.
+		 *
+		 * The boxes should be returned in reading order. Rectangles
+		 * should be in page coordinates, that is, with width from 0 to
+		 * page's width and height from 0 to page's height.
+		 *
+		 * This function is called from a background thread, though
+		 * never concurrently with itself for the same document. Thus
+		 * the implementation should not touch any state that is also
+		 * used from the GUI thread without proper synchronization.
+		 *
+		 * If the layout can't be obtained at all, for example, because
+		 * the document fails to load in the background thread, an empty
+		 * optional should be returned, and no text index is built then.
+		 * A page without any text should result in an empty list
+		 * instead.
+		 *
+		 * @param[in] page The index of the page to query.
+		 * @return The list of text boxes on the \em page, or an empty
+		 * optional on error.
+		 */
+		virtual boost::optional<QList<TextBox>> GetTextLayout (int page) = 0;
+	};
+}
+}
+
+Q_DECLARE_INTERFACE (LeechCraft::Monocle::IHaveTextLayout,
+		"org.LeechCraft.Monocle.IHaveTextLayout/1.0")
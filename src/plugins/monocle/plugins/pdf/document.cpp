@@ -161,6 +161,35 @@ namespace PDF
 		return page->text (rect);
 	}
 
+	boost::optional<QList<TextBox>> Document::GetTextLayout (int pageNum)
+	{
+		// Poppler documents aren't thread-safe, and this is called from a
+		// background thread, so use a separate instance for that.
+		if (!LayoutDocument_)
+			LayoutDocument_.reset (Poppler::Document::load (DocURL_.toLocalFile ()));
+		if (!LayoutDocument_ || LayoutDocument_->isLocked ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to load"
+					<< DocURL_;
+			return {};
+		}
+
+		std::unique_ptr<Poppler::Page> page (LayoutDocument_->page (pageNum));
+		if (!page)
+			return {};
+
+		const auto& boxes = page->textList ();
+		QList<TextBox> result;
+		result.reserve (boxes.size ());
+		for (const auto box : boxes)
+		{
+			result.append ({ box->text (), box->boundingBox (), box->hasSpaceAfter () });
+			delete box;
+		}
+		return result;
+	}
+
 	QAbstractItemModel* Document::GetOptContentModel ()
 	{
 		return PDocument_->hasOptionalContent () ?
@@ -35,6 +35,7 @@
 #include <interfaces/monocle/idocument.h>
 #include <interfaces/monocle/ihavetoc.h>
 #include <interfaces/monocle/ihavetextcontent.h>
+#include <interfaces/monocle/ihavetextlayout.h>
 #include <interfaces/monocle/ihavefontinfo.h>
 #include <interfaces/monocle/isupportannotations.h>
 #include <interfaces/monocle/isupportforms.h>
@@ -60,6 +61,7 @@ namespace PDF
 				   , public IDocument
 				   , public IHaveTOC
 				   , public IHaveTextContent
+				   , public IHaveTextLayout
 				   , public IHaveOptionalContent
 				   , public IHaveFontInfo
 				   , public ISupportAnnotations
@@ -72,6 +74,7 @@ namespace PDF
 		Q_INTERFACES (LeechCraft::Monocle::IDocument
 				LeechCraft::Monocle::IHaveTOC
 				LeechCraft::Monocle::IHaveTextContent
+				LeechCraft::Monocle::IHaveTextLayout
 				LeechCraft::Monocle::IHaveOptionalContent
 				LeechCraft::Monocle::IHaveFontInfo
 				LeechCraft::Monocle::ISupportAnnotations
@@ -81,6 +84,7 @@ namespace PDF
 				LeechCraft::Monocle::ISaveableDocument)
 
 		PDocument_ptr PDocument_;
+		PDocument_ptr LayoutDocument_;
 		TOCEntryLevel_t TOC_;
 		QUrl DocURL_;
 
@@ -102,6 +106,8 @@ namespace PDF
 
 		QString GetTextContent (int, const QRect&);
 
+		boost::optional<QList<TextBox>> GetTextLayout (int);
+
 		QAbstractItemModel* GetOptContentModel ();
 
 		IPendingFontInfoRequest* RequestFontInfos () const;
@@ -0,0 +1,243 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "textindex.h"
+#include <algorithm>
+#include <cmath>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QtDebug>
+#include "interfaces/monocle/ihavetextlayout.h"
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	namespace
+	{
+		const quint32 IndexMagic = 0x4d544958;
+		const quint8 IndexVersion = 1;
+	}
+
+	QList<QRectF> TextIndexPage::Find (const QString& text, Qt::CaseSensitivity cs) const
+	{
+		QList<QRectF> result;
+		if (text.isEmpty ())
+			return result;
+
+		int pos = 0;
+		while ((pos = Text_.indexOf (text, pos, cs)) >= 0)
+		{
+			result += GetRects (pos, text.size ());
+			pos += text.size ();
+		}
+		return result;
+	}
+
+	QList<QRectF> TextIndexPage::GetRects (int start, int length) const
+	{
+		const auto end = start + length;
+
+		auto boxPos = std::upper_bound (Boxes_.begin (), Boxes_.end (), start,
+				[] (int pos, const TextIndexBox& box) { return pos < box.Start_; });
+		if (boxPos != Boxes_.begin ())
+			--boxPos;
+
+		QList<QRectF> result;
+		for (; boxPos != Boxes_.end () && boxPos->Start_ < end; ++boxPos)
+		{
+			const auto& box = *boxPos;
+			const auto from = std::max (start, box.Start_);
+			const auto to = std::min (end, box.Start_ + box.Length_);
+			if (from >= to)
+				continue;
+
+			const auto charWidth = box.Rect_.width () / box.Length_;
+			const QRectF rect
+			{
+				box.Rect_.left () + charWidth * (from - box.Start_),
+				box.Rect_.top (),
+				charWidth * (to - from),
+				box.Rect_.height ()
+			};
+
+			if (!result.isEmpty () &&
+					std::abs (result.last ().center ().y () - rect.center ().y ()) < rect.height () / 2)
+				result.last () |= rect;
+			else
+				result << rect;
+		}
+		return result;
+	}
+
+	int TextIndex::GetPagesCount () const
+	{
+		return Pages_.size ();
+	}
+
+	const TextIndexPage& TextIndex::GetPage (int page) const
+	{
+		return Pages_.at (page);
+	}
+
+	TextIndex_ptr TextIndex::Build (IHaveTextLayout *layout, int pagesCount, const std::atomic_bool& cancelled)
+	{
+		auto index = std::make_shared<TextIndex> ();
+		index->Pages_.resize (pagesCount);
+
+		for (int i = 0; i < pagesCount; ++i)
+		{
+			if (cancelled)
+				return {};
+
+			auto& page = index->Pages_ [i];
+			const auto& boxes = layout->GetTextLayout (i);
+			if (!boxes)
+				return {};
+
+			page.Boxes_.reserve (boxes->size ());
+			for (const auto& box : *boxes)
+			{
+				if (box.Text_.isEmpty ())
+					continue;
+
+				page.Boxes_.append ({ page.Text_.size (), box.Text_.size (), box.Rect_ });
+				page.Text_ += box.Text_;
+				if (box.HasSpaceAfter_)
+					page.Text_ += ' ';
+			}
+			page.Text_.squeeze ();
+		}
+
+		return index;
+	}
+
+	namespace
+	{
+		void WriteSourceInfo (QDataStream& stream, const QFileInfo& source)
+		{
+			stream << static_cast<qint64> (source.size ())
+					<< source.lastModified ();
+		}
+
+		bool CheckSourceInfo (QDataStream& stream, const QFileInfo& source)
+		{
+			qint64 size = 0;
+			QDateTime modified;
+			stream >> size >> modified;
+			return size == source.size () && modified == source.lastModified ();
+		}
+	}
+
+	TextIndex_ptr TextIndex::Load (const QString& path, const QFileInfo& source)
+	{
+		QFile file { path };
+		if (!file.open (QIODevice::ReadOnly))
+			return {};
+
+		QDataStream stream { &file };
+		stream.setFloatingPointPrecision (QDataStream::SinglePrecision);
+
+		quint32 magic = 0;
+		quint8 version = 0;
+		stream >> magic >> version;
+		if (magic != IndexMagic || version != IndexVersion)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unknown index format in"
+					<< path;
+			return {};
+		}
+
+		if (!CheckSourceInfo (stream, source))
+			return {};
+
+		auto index = std::make_shared<TextIndex> ();
+
+		qint32 pagesCount = 0;
+		stream >> pagesCount;
+		index->Pages_.resize (pagesCount);
+		for (auto& page : index->Pages_)
+		{
+			qint32 boxesCount = 0;
+			stream >> page.Text_ >> boxesCount;
+			page.Boxes_.resize (boxesCount);
+			for (auto& box : page.Boxes_)
+			{
+				qint32 start = 0;
+				qint32 length = 0;
+				stream >> start >> length >> box.Rect_;
+				box.Start_ = start;
+				box.Length_ = length;
+			}
+
+			if (stream.status () != QDataStream::Ok)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "corrupted index"
+						<< path;
+				return {};
+			}
+		}
+
+		return index;
+	}
+
+	void TextIndex::Save (const QString& path, const QFileInfo& source) const
+	{
+		QFile file { path };
+		if (!file.open (QIODevice::WriteOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< path
+					<< file.errorString ();
+			return;
+		}
+
+		QDataStream stream { &file };
+		stream.setFloatingPointPrecision (QDataStream::SinglePrecision);
+
+		stream << IndexMagic << IndexVersion;
+		WriteSourceInfo (stream, source);
+
+		stream << static_cast<qint32> (Pages_.size ());
+		for (const auto& page : Pages_)
+		{
+			stream << page.Text_ << static_cast<qint32> (page.Boxes_.size ());
+			for (const auto& box : page.Boxes_)
+				stream << static_cast<qint32> (box.Start_)
+						<< static_cast<qint32> (box.Length_)
+						<< box.Rect_;
+		}
+	}
+}
+}
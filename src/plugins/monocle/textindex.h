@@ -0,0 +1,100 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <QList>
+#include <QRectF>
+#include <QVector>
+#include <QString>
+
+class QFileInfo;
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	class IHaveTextLayout;
+
+	struct TextIndexBox
+	{
+		int Start_;
+		int Length_;
+		QRectF Rect_;
+	};
+
+	class TextIndexPage
+	{
+		QString Text_;
+		QVector<TextIndexBox> Boxes_;
+	public:
+		QList<QRectF> Find (const QString&, Qt::CaseSensitivity) const;
+
+		friend class TextIndex;
+	private:
+		QList<QRectF> GetRects (int, int) const;
+	};
+
+	class TextIndex;
+	using TextIndex_ptr = std::shared_ptr<const TextIndex>;
+
+	/** Holds the text of each page of a document together with the
+	 * geometry of its words, so that searching doesn't require asking
+	 * the backend to extract the text again.
+	 *
+	 * The index is immutable once built and can be safely queried from
+	 * several threads at once.
+	 */
+	class TextIndex
+	{
+		QVector<TextIndexPage> Pages_;
+	public:
+		int GetPagesCount () const;
+		const TextIndexPage& GetPage (int) const;
+
+		/** Builds the index by querying the text layout of each of the
+		 * \em pagesCount pages of the document via \em layout.
+		 *
+		 * Returns a null pointer if \em cancelled gets set during the
+		 * build or if the layout of some page can't be obtained, so that
+		 * a broken index is never saved.
+		 */
+		static TextIndex_ptr Build (IHaveTextLayout *layout, int pagesCount, const std::atomic_bool& cancelled);
+
+		/** Loads the index saved at \em path, returning a null pointer if
+		 * there is no such index or it has been built for a different
+		 * version of the \em source file.
+		 */
+		static TextIndex_ptr Load (const QString& path, const QFileInfo& source);
+		void Save (const QString& path, const QFileInfo& source) const;
+	};
+}
+}
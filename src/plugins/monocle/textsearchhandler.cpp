@@ -30,9 +30,16 @@
 #include "textsearchhandler.h"
 #include <QGraphicsView>
 #include <QGraphicsRectItem>
+#include <QFileInfo>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
 #include <QtDebug>
 #include <util/sll/qtutil.h>
+#include <util/threads/futures.h>
 #include "interfaces/monocle/isearchabledocument.h"
+#include "interfaces/monocle/ihavetextlayout.h"
+#include "core.h"
+#include "docstatemanager.h"
 #include "pagegraphicsitem.h"
 #include "pageslayoutmanager.h"
 
@@ -47,16 +54,36 @@ namespace Monocle
 	, LayoutMgr_ (mgr)
 	, CurrentRectIndex_ (-1)
 	{
+		connect (&IndexedSearchWatcher_,
+				SIGNAL (resultsReadyAt (int, int)),
+				this,
+				SLOT (handleIndexedResultsReady ()));
+		connect (&IndexedSearchWatcher_,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleIndexedSearchFinished ()));
+	}
+
+	TextSearchHandler::~TextSearchHandler ()
+	{
+		CancelIndexBuild ();
+		IndexedSearchWatcher_.cancel ();
 	}
 
 	void TextSearchHandler::HandleDoc (IDocument_ptr doc, const QList<PageGraphicsItem*>& pages)
 	{
+		CancelIndexBuild ();
+		IndexedSearchWatcher_.cancel ();
+		Index_.reset ();
+
 		Doc_ = doc;
 		Pages_ = pages;
 
 		CurrentHighlights_.clear ();
 		CurrentRectIndex_ = -1;
 		CurrentSearchString_.clear ();
+
+		ScheduleIndexBuild ();
 	}
 
 	bool TextSearchHandler::Search (const QString& text, Util::FindNotification::FindFlags flags)
@@ -68,7 +95,7 @@ namespace Monocle
 			return RequestSearch (text, flags);
 
 		if (CurrentHighlights_.isEmpty ())
-			return false;
+			return IndexedSearchWatcher_.isRunning ();
 
 		if (flags & Util::FindNotification::FindBackwards)
 		{
@@ -115,6 +142,12 @@ namespace Monocle
 		ClearHighlights ();
 		CurrentSearchString_ = text;
 
+		if (Index_)
+		{
+			RequestIndexedSearch (text, flags);
+			return true;
+		}
+
 		const auto searchable = qobject_cast<ISearchableDocument*> (Doc_->GetQObject ());
 		if (!searchable)
 			return false;
@@ -133,28 +166,100 @@ namespace Monocle
 		return !CurrentHighlights_.isEmpty ();
 	}
 
+	void TextSearchHandler::RequestIndexedSearch (const QString& text, Util::FindNotification::FindFlags flags)
+	{
+		IndexedSearchFlags_ = flags;
+		IndexedSearchResults_.clear ();
+		NextIndexedPage_ = 0;
+
+		const auto cs = flags & Util::FindNotification::FindCaseSensitively ?
+				Qt::CaseSensitive :
+				Qt::CaseInsensitive;
+
+		QList<int> pages;
+		for (int i = 0, size = std::min (Index_->GetPagesCount (), Pages_.size ()); i < size; ++i)
+			pages << i;
+
+		IndexedSearchWatcher_.setFuture (QtConcurrent::mapped (pages,
+				std::function<QList<QRectF> (int)>
+				{
+					[index = Index_, text, cs] (int page)
+					{
+						return index->GetPage (page).Find (text, cs);
+					}
+				}));
+	}
+
+	void TextSearchHandler::CancelIndexBuild ()
+	{
+		if (IndexBuildCancelled_)
+			*IndexBuildCancelled_ = true;
+		IndexBuildCancelled_.reset ();
+	}
+
+	void TextSearchHandler::ScheduleIndexBuild ()
+	{
+		const auto layout = qobject_cast<IHaveTextLayout*> (Doc_->GetQObject ());
+		if (!layout)
+			return;
+
+		const auto& url = Doc_->GetDocURL ();
+		if (!url.isLocalFile ())
+			return;
+
+		const QFileInfo source { url.toLocalFile () };
+		const auto& indexPath = Core::Instance ().GetDocStateManager ()->
+				GetDocDataPath (source.fileName (), "textindex");
+
+		const auto cancelled = std::make_shared<std::atomic_bool> (false);
+		IndexBuildCancelled_ = cancelled;
+
+		Util::Sequence (this,
+				QtConcurrent::run ([doc = Doc_, layout, pagesCount = Doc_->GetNumPages (),
+							source, indexPath, cancelled]
+						{
+							if (const auto loaded = TextIndex::Load (indexPath, source))
+								return loaded;
+
+							const auto built = TextIndex::Build (layout, pagesCount, *cancelled);
+							if (built)
+								built->Save (indexPath, source);
+							return built;
+						})) >>
+				[this, cancelled] (const TextIndex_ptr& index)
+				{
+					if (!*cancelled)
+						Index_ = index;
+				};
+	}
+
 	void TextSearchHandler::BuildHighlights (const QMap<int, QList<QRectF>>& map)
 	{
-		const QBrush brush (Qt::yellow);
 		for (const auto& pair : Util::Stlize (map))
+			BuildPageHighlights (pair.first, pair.second);
+	}
+
+	void TextSearchHandler::BuildPageHighlights (int pageNum, const QList<QRectF>& rects)
+	{
+		const QBrush brush (Qt::yellow);
+		const auto page = Pages_.at (pageNum);
+		for (const auto& rect : rects)
 		{
-			const auto page = Pages_.at (pair.first);
-			for (const auto& rect : pair.second)
-			{
-				const auto item = new QGraphicsRectItem (page);
-				item->setBrush (brush);
-				item->setZValue (1);
-				item->setOpacity (0.2);
-				CurrentHighlights_ << item;
-
-				page->RegisterChildRect (item, rect,
-						[item] (const QRectF& rect) { item->setRect (rect); });
-			}
+			const auto item = new QGraphicsRectItem (page);
+			item->setBrush (brush);
+			item->setZValue (1);
+			item->setOpacity (0.2);
+			CurrentHighlights_ << item;
+
+			page->RegisterChildRect (item, rect,
+					[item] (const QRectF& rect) { item->setRect (rect); });
 		}
 	}
 
 	void TextSearchHandler::ClearHighlights ()
 	{
+		IndexedSearchWatcher_.cancel ();
+
 		for (auto item : CurrentHighlights_)
 		{
 			auto parentPage = static_cast<PageGraphicsItem*> (item->parentItem ());
@@ -164,6 +269,7 @@ namespace Monocle
 		}
 
 		CurrentHighlights_.clear ();
+		CurrentRectIndex_ = -1;
 	}
 
 	void TextSearchHandler::SelectItem (int index)
@@ -190,5 +296,41 @@ namespace Monocle
 			emit navigateRequested ({}, pageIdx, x, y);
 		}
 	}
+
+	void TextSearchHandler::handleIndexedResultsReady ()
+	{
+		// Pages are published in order, so that the highlights indexes
+		// stay in the document order regardless of which page finishes
+		// first.
+		if (!Index_ || IndexedSearchWatcher_.isCanceled ())
+			return;
+
+		const auto& future = IndexedSearchWatcher_.future ();
+		const auto pagesCount = std::min (Index_->GetPagesCount (), Pages_.size ());
+		while (NextIndexedPage_ < pagesCount && future.isResultReadyAt (NextIndexedPage_))
+		{
+			const auto& rects = future.resultAt (NextIndexedPage_);
+			if (!rects.isEmpty ())
+			{
+				IndexedSearchResults_ [NextIndexedPage_] = rects;
+				BuildPageHighlights (NextIndexedPage_, rects);
+			}
+			++NextIndexedPage_;
+		}
+
+		if (CurrentRectIndex_ < 0 && !CurrentHighlights_.isEmpty ())
+			SelectItem (0);
+	}
+
+	void TextSearchHandler::handleIndexedSearchFinished ()
+	{
+		if (IndexedSearchWatcher_.isCanceled ())
+			return;
+
+		handleIndexedResultsReady ();
+
+		emit gotSearchResults ({ CurrentSearchString_, IndexedSearchFlags_, IndexedSearchResults_ });
+		emit searchFinished (!CurrentHighlights_.isEmpty ());
+	}
 }
 }
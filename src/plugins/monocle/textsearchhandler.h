@@ -29,10 +29,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <QObject>
 #include <QMap>
+#include <QFutureWatcher>
 #include <util/gui/findnotification.h>
 #include "interfaces/monocle/idocument.h"
+#include "textindex.h"
 
 class QGraphicsRectItem;
 class QGraphicsView;
@@ -63,12 +67,21 @@ namespace Monocle
 		IDocument_ptr Doc_;
 		QList<PageGraphicsItem*> Pages_;
 
+		TextIndex_ptr Index_;
+		std::shared_ptr<std::atomic_bool> IndexBuildCancelled_;
+
+		QFutureWatcher<QList<QRectF>> IndexedSearchWatcher_;
+		Util::FindNotification::FindFlags IndexedSearchFlags_;
+		QMap<int, QList<QRectF>> IndexedSearchResults_;
+		int NextIndexedPage_ = 0;
+
 		QString CurrentSearchString_;
 
 		QList<QGraphicsRectItem*> CurrentHighlights_;
 		int CurrentRectIndex_;
 	public:
 		TextSearchHandler (QGraphicsView*, PagesLayoutManager*, QObject* = 0);
+		~TextSearchHandler ();
 
 		void HandleDoc (IDocument_ptr, const QList<PageGraphicsItem*>&);
 
@@ -76,15 +89,29 @@ namespace Monocle
 		void SetPreparedResults (const TextSearchHandlerResults&, int selectedItem);
 	private:
 		bool RequestSearch (const QString&, Util::FindNotification::FindFlags);
+		void RequestIndexedSearch (const QString&, Util::FindNotification::FindFlags);
+
+		void CancelIndexBuild ();
+		void ScheduleIndexBuild ();
 
 		void BuildHighlights (const QMap<int, QList<QRectF>>&);
+		void BuildPageHighlights (int, const QList<QRectF>&);
 		void ClearHighlights ();
 
 		void SelectItem (int);
+	private slots:
+		void handleIndexedResultsReady ();
+		void handleIndexedSearchFinished ();
 	signals:
 		void navigateRequested (const QString&, int, double, double);
 
 		void gotSearchResults (const TextSearchHandlerResults&);
+
+		/** Emitted when a search that has been running in background
+		 * finishes, with \em found being whether anything has been
+		 * found.
+		 */
+		void searchFinished (bool found);
 	};
 }
 }
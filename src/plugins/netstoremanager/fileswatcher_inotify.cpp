@@ -28,183 +28,274 @@
  **********************************************************************/
 
 #include "fileswatcher_inotify.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <stdexcept>
 #include <sys/inotify.h>
-#include <sys/poll.h>
+#include <unistd.h>
 #include <QtDebug>
 #include <QStringList>
+#include <QFile>
+#include <QFileInfo>
 #include <QTimer>
+#include <QSocketNotifier>
 #include "utils.h"
 
 namespace LeechCraft
 {
 namespace NetStoreManager
 {
+	namespace
+	{
+		const int FlushDelay = 300;
+		const int MaxFlushDelay = 2000;
+
+		QString GetParentPath (const QString& path)
+		{
+			return path.section ('/', 0, -2);
+		}
+	}
+
 	FilesWatcherInotify::FilesWatcherInotify (QObject *parent)
 	: FilesWatcherBase (parent)
-	, INotifyDescriptor_ (inotify_init ())
-	, WatchMask_ (IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MODIFY |IN_MOVED_FROM | IN_MOVED_TO)
-	, WaitMSecs_ (50)
-	, Timer_ (new QTimer (this))
+	, INotifyDescriptor_ (inotify_init1 (IN_NONBLOCK | IN_CLOEXEC))
+	, WatchMask_ (IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO)
+	, FlushTimer_ (new QTimer (this))
 	{
 		if (INotifyDescriptor_ < 0)
 			throw std::runtime_error ("inotify_init failed. Synchronization will not work.");
 
-		EventSize_ = sizeof (struct inotify_event);
-		BufferLength_ = 1024 * (EventSize_ + 16);
+		Notifier_ = new QSocketNotifier (INotifyDescriptor_, QSocketNotifier::Read, this);
+		connect (Notifier_,
+				SIGNAL (activated (int)),
+				this,
+				SLOT (checkNotifications ()));
 
-		connect (Timer_,
+		FlushTimer_->setSingleShot (true);
+		connect (FlushTimer_,
 				SIGNAL (timeout ()),
 				this,
-				SLOT (checkNotifications ()));
+				SLOT (flushEvents ()));
 	}
 
-	void FilesWatcherInotify::AddPath (const QString& path)
+	void FilesWatcherInotify::AddWatch (const QString& path)
 	{
-		const int fd = inotify_add_watch (INotifyDescriptor_, path.toUtf8 (), WatchMask_);
-		WatchedPathes2Descriptors_.insert ({ path, fd });
+		const int fd = inotify_add_watch (INotifyDescriptor_, QFile::encodeName (path).constData (), WatchMask_);
+		if (fd < 0)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to watch"
+					<< path
+					<< std::strerror (errno);
+			if (errno == ENOSPC)
+				qWarning () << Q_FUNC_INFO
+						<< "consider raising fs.inotify.max_user_watches";
+			return;
+		}
 
-		if (!Timer_->isActive ())
-			Timer_->start (1000);
+		// the same directory may be already watched under another name
+		WatchedPathes2Descriptors_.right.erase (fd);
+		WatchedPathes2Descriptors_.left.erase (path);
+		WatchedPathes2Descriptors_.insert ({ path, fd });
 	}
 
-	void FilesWatcherInotify::RenamePath (const QString& oldPath, const QString& newPath)
+	void FilesWatcherInotify::AddTree (const QString& path, bool notify)
 	{
-		const auto leftMap = WatchedPathes2Descriptors_.left;
-		QStringList pathsToRemove;
-		QStringList pathsToAdd;
-		for (const auto& pair : leftMap)
+		if (!QFileInfo (path).isDir ())
+			return;
+
+		AddWatch (path);
+		if (notify)
+			Enqueue (EventType::Created, true, path);
+
+		// entries created before the watch has been added are reported here,
+		// duplicates are merged by Enqueue()
+		const auto paths = Utils::ScanDir (QDir::AllEntries | QDir::NoDotAndDotDot,
+				path,
+				true);
+		for (const auto& p : paths)
 		{
-			QString path = pair.first;
-			if (path.startsWith (oldPath))
-			{
-				pathsToRemove << path;
-				path.replace (oldPath, newPath);
-				pathsToAdd << path;
-			}
+			const bool isDir = QFileInfo (p).isDir ();
+			if (isDir)
+				AddWatch (p);
+
+			if (notify)
+				Enqueue (EventType::Created, isDir, p);
 		}
+	}
+
+	QList<QPair<QString, int>> FilesWatcherInotify::GetTreeWatches (const QString& path) const
+	{
+		QList<QPair<QString, int>> result;
 
-		for (const auto& path : pathsToRemove)
-			RemoveWatchingPath (path);
+		const auto& left = WatchedPathes2Descriptors_.left;
+		const auto rootPos = left.find (path);
+		if (rootPos != left.end ())
+			result.append ({ rootPos->first, rootPos->second });
+
+		const auto& prefix = path + '/';
+		for (auto it = left.lower_bound (prefix);
+				it != left.end () && it->first.startsWith (prefix); ++it)
+			result.append ({ it->first, it->second });
+
+		return result;
+	}
 
-		for (const auto& path : pathsToAdd)
-			AddPath (path);
+	void FilesWatcherInotify::RemoveTree (const QString& path)
+	{
+		for (const auto& pair : GetTreeWatches (path))
+			RemoveWatchingPath (pair.second);
 	}
 
-	void FilesWatcherInotify::HandleNotification (int descriptor)
+	void FilesWatcherInotify::RenameTree (const QString& oldPath, const QString& newPath)
 	{
-		const auto buffer = std::make_unique<char []> (BufferLength_);
-		ssize_t length = read (descriptor, buffer.get (), BufferLength_);
-		if (length < 0)
+		// watches follow the inodes, so only the paths need to be updated
+		for (const auto& pair : GetTreeWatches (oldPath))
 		{
-			qDebug () << "read error";
-			return;
+			const auto& path = newPath + pair.first.mid (oldPath.size ());
+			WatchedPathes2Descriptors_.right.erase (pair.second);
+			WatchedPathes2Descriptors_.left.erase (path);
+			WatchedPathes2Descriptors_.insert ({ path, pair.second });
 		}
+	}
+
+	void FilesWatcherInotify::Rescan (const QString& root)
+	{
+		QSet<QString> existing;
+		if (QFileInfo (root).isDir ())
+			existing << root;
+		for (const auto& path : Utils::ScanDir (QDir::Dirs | QDir::NoDotAndDotDot, root, true))
+			existing << path;
+
+		for (const auto& pair : GetTreeWatches (root))
+			if (!existing.remove (pair.first))
+				RemoveWatchingPath (pair.second);
 
-		int i = 0;
+		for (const auto& path : existing)
+			AddWatch (path);
+
+		PendingRescans_ << root;
+	}
 
-		QList<inotify_event*> eventsBuffer;
-		while (i < length)
+	void FilesWatcherInotify::HandleEvent (const inotify_event& event)
+	{
+		if (event.mask & IN_Q_OVERFLOW)
 		{
-			struct inotify_event *event = reinterpret_cast<inotify_event*> (&buffer [i]);
+			qWarning () << Q_FUNC_INFO
+					<< "inotify queue overflow, rescanning"
+					<< Roots_;
+			for (const auto& root : Roots_)
+				Rescan (root);
+			return;
+		}
 
-			const QString path = WatchedPathes2Descriptors_.right.at (event->wd);
-			const QString fullPath = path + "/" + QString (event->name);
+		const auto pos = WatchedPathes2Descriptors_.right.find (event.wd);
+		if (pos == WatchedPathes2Descriptors_.right.end ())
+			return;
 
-			i += EventSize_ + event->len;
+		const QString dirPath = pos->second;
+		if (event.mask & IN_IGNORED)
+		{
+			WatchedPathes2Descriptors_.right.erase (pos);
+			return;
+		}
 
-// 			if (!(event->mask & IN_ISDIR) &&
-// 					IsInExceptionList (fullPath))
-// 				continue;
+		const bool isDir = event.mask & IN_ISDIR;
+		const QString fullPath = event.len ?
+				dirPath + "/" + QFile::decodeName (event.name) :
+				dirPath;
 
-			if (event->mask & IN_CREATE)
-			{
-				if (event->mask & IN_ISDIR)
-					AddPathWithNotify (fullPath);
-				else
-					emit fileWasCreated (fullPath);
-			}
-			else if (event->mask & IN_DELETE)
-			{
-				if (!(event->mask & IN_ISDIR))
-					emit fileWasRemoved (fullPath);
-			}
-			else if (event->mask & IN_MODIFY)
-			{
-				if (!(event->mask & IN_ISDIR))
-					emit fileWasUpdated (fullPath);
-			}
-			else if (event->mask & IN_MOVED_FROM)
-			{
-				eventsBuffer << event;
-			}
-			else if (event->mask & IN_MOVED_TO)
+		if (event.mask & IN_DELETE_SELF)
+		{
+			// removal of subdirectories is reported by their parents
+			if (Roots_.contains (dirPath))
+				Enqueue (EventType::Removed, true, dirPath);
+		}
+		else if (event.mask & IN_CREATE)
+		{
+			if (isDir)
+				AddTree (fullPath, true);
+			else
+				Enqueue (EventType::Created, false, fullPath);
+		}
+		else if (event.mask & IN_DELETE)
+		{
+			if (isDir)
+				RemoveTree (fullPath);
+			Enqueue (EventType::Removed, isDir, fullPath);
+		}
+		else if (event.mask & (IN_MODIFY | IN_CLOSE_WRITE))
+		{
+			if (!isDir)
+				Enqueue (EventType::Updated, false, fullPath);
+		}
+		else if (event.mask & IN_MOVED_FROM)
+			Cookie2PendingMove_ [event.cookie] = { fullPath, isDir };
+		else if (event.mask & IN_MOVED_TO)
+		{
+			const auto movePos = Cookie2PendingMove_.find (event.cookie);
+			if (movePos == Cookie2PendingMove_.end ())
 			{
-				if (eventsBuffer.isEmpty ())
-					AddPathWithNotify (fullPath);
+				if (isDir)
+					AddTree (fullPath, true);
 				else
-					for (auto it = eventsBuffer.begin (); it < eventsBuffer.end (); ++it)
-					{
-						if ((*it)->cookie == event->cookie &&
-								(*it)->wd == event->wd)
-						{
-							QString oldPath = path + "/" + QString ((*it)->name);
-							if (QFileInfo (fullPath).isDir ())
-								RenamePath (oldPath, fullPath);
-
-							emit entryWasRenamed (oldPath, fullPath);
-							it = eventsBuffer.erase (it);
-							break;
-						}
-						else if ((*it)->cookie == event->cookie)
-						{
-							const QString oldPrePath = WatchedPathes2Descriptors_.right.at ((*it)->wd);
-							emit entryWasMoved (oldPrePath + "/" + QString ((*it)->name),
-									fullPath);
-							it = eventsBuffer.erase (it);
-							break;
-						}
-					}
+					Enqueue (EventType::Created, false, fullPath);
+				return;
 			}
-			else if (event->mask & IN_DELETE_SELF)
-				emit dirWasRemoved (path);
-
-			if (event->mask & IN_IGNORED)
-				RemoveWatchingPath (event->wd);
-		}
-
-		for (auto it = eventsBuffer.begin (); it < eventsBuffer.end (); )
-		{
-			const QString path = WatchedPathes2Descriptors_.right.at ((*it)->wd);
-			const QString fullPath = path + "/" + QString ((*it)->name);
 
-			if ((*it)->mask & IN_ISDIR)
-				emit dirWasRemoved (fullPath);
-			else
-				emit fileWasRemoved (fullPath);
+			const auto oldPath = movePos->Path_;
+			Cookie2PendingMove_.erase (movePos);
 
-			it = eventsBuffer.erase (it);
+			if (isDir)
+				RenameTree (oldPath, fullPath);
+			EnqueueMove (oldPath, fullPath, isDir);
 		}
 	}
 
-	void FilesWatcherInotify::AddPathWithNotify (const QString& path)
+	void FilesWatcherInotify::Enqueue (EventType type, bool isDir, const QString& path)
 	{
-		if (!QFileInfo (path).isDir ())
+		const auto pos = PendingPath2Event_.find (path);
+		if (pos == PendingPath2Event_.end ())
+		{
+			PendingPath2Event_ [path] = PendingEvents_.size ();
+			PendingEvents_.append ({ type, isDir, path, {} });
 			return;
+		}
 
-		AddPath (path);
-		emit dirWasCreated (path);
-		const auto paths = Utils::ScanDir (QDir::AllEntries | QDir::NoDotAndDotDot,
-				path,
-				true);
-		for (const auto& p : paths)
-			if (QFileInfo (p).isDir ())
+		auto& event = PendingEvents_ [*pos];
+		switch (type)
+		{
+		case EventType::Created:
+			if (event.Type_ == EventType::Removed)
+				event.Type_ = isDir ? EventType::Created : EventType::Updated;
+			event.IsDir_ = isDir;
+			break;
+		case EventType::Updated:
+			if (event.Type_ != EventType::Created)
+				event.Type_ = EventType::Updated;
+			break;
+		case EventType::Removed:
+			if (event.Type_ == EventType::Created)
 			{
-				AddPath (p);
-				emit dirWasCreated (p);
+				event.Type_ = EventType::None;
+				PendingPath2Event_.erase (pos);
 			}
 			else
-				emit fileWasCreated (p);
+				event.Type_ = EventType::Removed;
+			break;
+		case EventType::None:
+		case EventType::Moved:
+			break;
+		}
+	}
+
+	void FilesWatcherInotify::EnqueueMove (const QString& oldPath, const QString& newPath, bool isDir)
+	{
+		PendingEvents_.append ({ EventType::Moved, isDir, oldPath, newPath });
+
+		// later events must not be merged with the ones preceding the move
+		PendingPath2Event_.clear ();
 	}
 
 	bool FilesWatcherInotify::IsInExceptionList (const QString& path) const
@@ -234,46 +325,65 @@ namespace NetStoreManager
 		WatchedPathes2Descriptors_.right.erase (descriptor);
 	}
 
-	void FilesWatcherInotify::RemoveWatchingPath (const QString& path)
-	{
-		if (!WatchedPathes2Descriptors_.left.count (path))
-			return;
-
-		RemoveWatchingPath (WatchedPathes2Descriptors_.left.at (path));
-	}
-
 	void FilesWatcherInotify::updatePaths (const QStringList& paths)
 	{
 		for (const auto& path : paths)
-			if (!WatchedPathes2Descriptors_.left.count (path))
-				AddPath (path);
+			if (!Roots_.contains (path))
+				AddTree (path, false);
 
-		for (auto it = WatchedPathes2Descriptors_.left.begin ();
-				it != WatchedPathes2Descriptors_.left.end (); )
-		{
-			if (!paths.contains (it->first))
-				it = WatchedPathes2Descriptors_.left.erase (it);
-			else
-				++it;
-		}
+		for (const auto& root : Roots_)
+			if (!paths.contains (root))
+				RemoveTree (root);
+
+		Roots_ = paths;
 	}
 
 	void FilesWatcherInotify::checkNotifications ()
 	{
-		struct pollfd pfd = { INotifyDescriptor_, POLLIN, 0 };
-		int res = poll (&pfd, 1, WaitMSecs_);
-
-		if (res < 0)
-			qDebug () << "error";
-		else if (!res)
+		alignas (inotify_event) char buffer [64 * 1024];
+		while (true)
 		{
+			const auto length = read (INotifyDescriptor_, buffer, sizeof (buffer));
+			if (length < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				if (errno != EAGAIN)
+					qWarning () << Q_FUNC_INFO
+							<< "read error"
+							<< std::strerror (errno);
+				break;
+			}
+			if (!length)
+				break;
+
+			for (ssize_t i = 0; i < length; )
+			{
+				const auto event = reinterpret_cast<const inotify_event*> (buffer + i);
+				HandleEvent (*event);
+				i += sizeof (inotify_event) + event->len;
+			}
 		}
+
+		if (PendingEvents_.isEmpty () &&
+				Cookie2PendingMove_.isEmpty () &&
+				PendingRescans_.isEmpty ())
+			return;
+
+		if (!FirstPendingEvent_.isValid ())
+			FirstPendingEvent_.start ();
+
+		if (FirstPendingEvent_.elapsed () >= MaxFlushDelay)
+			flushEvents ();
 		else
-			HandleNotification (INotifyDescriptor_);
+			FlushTimer_->start (FlushDelay);
 	}
 
 	void FilesWatcherInotify::release ()
 	{
+		Notifier_->setEnabled (false);
+		FlushTimer_->stop ();
+
 		for (auto map : WatchedPathes2Descriptors_.left)
 			inotify_rm_watch (INotifyDescriptor_, map.second);
 
@@ -287,9 +397,102 @@ namespace NetStoreManager
 		ExceptionMasks_.removeAll ("");
 		ExceptionMasks_.removeDuplicates ();
 
+		QList<int> excluded;
 		for (const auto& pair : WatchedPathes2Descriptors_.left)
 			if (IsInExceptionList (pair.first))
-				RemoveWatchingPath (pair.second);
+				excluded << pair.second;
+
+		for (const auto descriptor : excluded)
+			RemoveWatchingPath (descriptor);
+	}
+
+	void FilesWatcherInotify::flushEvents ()
+	{
+		FlushTimer_->stop ();
+		FirstPendingEvent_.invalidate ();
+
+		// the other half of these moves is outside of the watched trees
+		for (const auto& move : Cookie2PendingMove_)
+		{
+			if (move.IsDir_)
+				RemoveTree (move.Path_);
+			Enqueue (EventType::Removed, move.IsDir_, move.Path_);
+		}
+		Cookie2PendingMove_.clear ();
+
+		const auto events = PendingEvents_;
+		PendingEvents_.clear ();
+		PendingPath2Event_.clear ();
+
+		const auto rescans = PendingRescans_;
+		PendingRescans_.clear ();
+
+		// directories that were created and removed before this flush
+		// merge into EventType::None, their children are gone as well,
+		// unless the directory has been created again afterwards
+		QSet<QString> existingDirs;
+		for (const auto& event : events)
+			if (event.IsDir_ && event.Type_ == EventType::Created)
+				existingDirs << event.Path_;
+
+		QStringList removedDirs;
+		for (const auto& event : events)
+			if (event.IsDir_ &&
+					(event.Type_ == EventType::Removed ||
+						(event.Type_ == EventType::None && !existingDirs.contains (event.Path_))))
+				removedDirs << event.Path_ + '/';
+
+		auto isUnder = [] (const QString& path, const QStringList& dirs)
+		{
+			return std::any_of (dirs.begin (), dirs.end (),
+					[&path] (const QString& dir) { return path.startsWith (dir); });
+		};
+
+		QStringList rescannedDirs;
+		for (const auto& root : rescans)
+			rescannedDirs << root + '/';
+
+		for (const auto& event : events)
+		{
+			// rescanning picks these up anyway
+			if (rescans.contains (event.Path_) || isUnder (event.Path_, rescannedDirs))
+				continue;
+
+			// removing the directory removes everything inside it as well
+			if (event.Type_ != EventType::Moved && isUnder (event.Path_, removedDirs))
+				continue;
+
+			switch (event.Type_)
+			{
+			case EventType::None:
+				break;
+			case EventType::Created:
+				if (event.IsDir_)
+					emit dirWasCreated (event.Path_);
+				else
+					emit fileWasCreated (event.Path_);
+				break;
+			case EventType::Updated:
+				if (!event.IsDir_)
+					emit fileWasUpdated (event.Path_);
+				break;
+			case EventType::Removed:
+				if (event.IsDir_)
+					emit dirWasRemoved (event.Path_);
+				else
+					emit fileWasRemoved (event.Path_);
+				break;
+			case EventType::Moved:
+				if (GetParentPath (event.Path_) == GetParentPath (event.NewPath_))
+					emit entryWasRenamed (event.Path_, event.NewPath_);
+				else
+					emit entryWasMoved (event.Path_, event.NewPath_);
+				break;
+			}
+		}
+
+		for (const auto& root : rescans)
+			emit rescanRequested (root);
 	}
 }
 }
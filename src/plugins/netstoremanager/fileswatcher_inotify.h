@@ -35,10 +35,15 @@
 
 #include <QObject>
 #include <QStringList>
-#include <QMultiMap>
+#include <QHash>
+#include <QSet>
+#include <QElapsedTimer>
 #include "fileswatcherbase.h"
 
 class QTimer;
+class QSocketNotifier;
+
+struct inotify_event;
 
 namespace LeechCraft
 {
@@ -50,32 +55,73 @@ namespace NetStoreManager
 
 		int INotifyDescriptor_;
 		const uint32_t WatchMask_;
-		const int  WaitMSecs_;
-		size_t BufferLength_;
-		size_t EventSize_;
+		QSocketNotifier *Notifier_;
 
 		typedef boost::bimaps::bimap<QString, int> descriptorsMap;
 		descriptorsMap WatchedPathes2Descriptors_;
+		QStringList Roots_;
 
 		QStringList ExceptionMasks_;
-		QTimer *Timer_;
+
+		enum class EventType
+		{
+			None,
+			Created,
+			Updated,
+			Removed,
+			Moved
+		};
+
+		struct Event
+		{
+			EventType Type_;
+			bool IsDir_;
+			QString Path_;
+			QString NewPath_;
+		};
+
+		/** Debounced events in the order they happened. Events for the
+		 * same path are merged into a single one unless a move happened
+		 * in between.
+		 */
+		QList<Event> PendingEvents_;
+		QHash<QString, int> PendingPath2Event_;
+
+		struct PendingMove
+		{
+			QString Path_;
+			bool IsDir_;
+		};
+		QHash<uint32_t, PendingMove> Cookie2PendingMove_;
+
+		QSet<QString> PendingRescans_;
+
+		QTimer *FlushTimer_;
+		QElapsedTimer FirstPendingEvent_;
 	public:
 		FilesWatcherInotify (QObject *parent = 0);
 	private:
-		void AddPath (const QString& path);
-		void RenamePath (const QString& oldPath, const QString& newPath);
-		void HandleNotification (int descriptor);
-		void AddPathWithNotify (const QString& path);
+		void AddWatch (const QString& path);
+		void AddTree (const QString& path, bool notify);
+		void RemoveTree (const QString& path);
+		void RenameTree (const QString& oldPath, const QString& newPath);
+		QList<QPair<QString, int>> GetTreeWatches (const QString& path) const;
+		void Rescan (const QString& root);
+
+		void HandleEvent (const inotify_event& event);
+		void Enqueue (EventType type, bool isDir, const QString& path);
+		void EnqueueMove (const QString& oldPath, const QString& newPath, bool isDir);
+
 		bool IsInExceptionList (const QString& path) const;
 		void RemoveWatchingPath (int descriptor);
-		void RemoveWatchingPath (const QString& path);
-
 	public slots:
 		void updatePaths (const QStringList& paths);
 
 		void checkNotifications ();
 		void release ();
 		void updateExceptions (QStringList masks);
+	private slots:
+		void flushEvents ();
 	};
 }
 }
@@ -56,6 +56,11 @@ namespace NetStoreManager
 		void fileWasUpdated (const QString& path);
 		void entryWasRenamed (const QString& oldName, const QString& newName);
 		void entryWasMoved (const QString& oldPath, const QString& newPath);
+
+		/** Emitted when some changes under the path might have been
+		 * lost, so it has to be compared against the remote side again.
+		 */
+		void rescanRequested (const QString& path);
 	};
 }
 }
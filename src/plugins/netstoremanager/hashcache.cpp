@@ -0,0 +1,329 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2010-2012  Oleg Linkin
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "hashcache.h"
+#include <algorithm>
+#include <vector>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QThread>
+#include <QtConcurrentRun>
+#include <QtDebug>
+#include <util/sys/paths.h>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+namespace LeechCraft
+{
+namespace NetStoreManager
+{
+	bool FileStamp::IsValid () const
+	{
+		return Size_ >= 0;
+	}
+
+	bool operator== (const FileStamp& left, const FileStamp& right)
+	{
+		return left.Size_ == right.Size_ &&
+				left.MTime_ == right.MTime_ &&
+				left.Inode_ == right.Inode_;
+	}
+
+	bool operator!= (const FileStamp& left, const FileStamp& right)
+	{
+		return !(left == right);
+	}
+
+	namespace
+	{
+		const qint64 ReadChunkSize = 1024 * 1024;
+
+		QCryptographicHash::Algorithm NSMHashType2QtCryproHashAlgorithm (HashAlgorithm hash)
+		{
+			switch (hash)
+			{
+			case HashAlgorithm::Md4:
+				return QCryptographicHash::Md4;
+			case HashAlgorithm::Sha1:
+				return QCryptographicHash::Sha1;
+			case HashAlgorithm::Md5:
+			default:
+				return QCryptographicHash::Md5;
+			}
+		}
+
+		FileStamp GetFileStamp (const QString& path)
+		{
+#ifdef Q_OS_UNIX
+			struct stat st;
+			if (stat (QFile::encodeName (path).constData (), &st) || !S_ISREG (st.st_mode))
+				return {};
+
+#ifdef Q_OS_LINUX
+			const qint64 mtimeNSecs = st.st_mtim.tv_nsec;
+#else
+			const qint64 mtimeNSecs = 0;
+#endif
+			return
+			{
+				static_cast<qint64> (st.st_size),
+				static_cast<qint64> (st.st_mtime) * 1000000000 + mtimeNSecs,
+				static_cast<quint64> (st.st_ino)
+			};
+#else
+			const QFileInfo fi { path };
+			if (!fi.isFile ())
+				return {};
+
+			return { fi.size (), fi.lastModified ().toMSecsSinceEpoch (), 0 };
+#endif
+		}
+
+		struct HashResult
+		{
+			FileStamp Stamp_;
+			QByteArray Hash_;
+		};
+
+		HashResult HashFile (const QString& path, HashAlgorithm algorithm)
+		{
+			const auto& stamp = GetFileStamp (path);
+
+			QFile file { path };
+			if (!file.open (QIODevice::ReadOnly))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to open file for hash calculation"
+						<< path
+						<< file.errorString ();
+				return {};
+			}
+
+			QCryptographicHash hash { NSMHashType2QtCryproHashAlgorithm (algorithm) };
+			std::vector<char> buffer (ReadChunkSize);
+			while (true)
+			{
+				const auto read = file.read (buffer.data (), buffer.size ());
+				if (read < 0)
+				{
+					qWarning () << Q_FUNC_INFO
+							<< "error reading"
+							<< path
+							<< file.errorString ();
+					return {};
+				}
+				if (!read)
+					break;
+
+				hash.addData (buffer.data (), read);
+			}
+
+			if (GetFileStamp (path) != stamp)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< path
+						<< "has been changed while hashing";
+				return {};
+			}
+
+			return { stamp, hash.result () };
+		}
+
+		QString GetCachePath ()
+		{
+			return Util::GetUserDir (Util::UserDir::Cache, "netstoremanager").filePath ("hashes");
+		}
+	}
+
+	HashCache::HashCache ()
+	{
+		Pool_.setMaxThreadCount (std::max (1, std::min (QThread::idealThreadCount (), 4)));
+		Load ();
+	}
+
+	HashCache::~HashCache ()
+	{
+		Save ();
+	}
+
+	QFuture<QHash<QString, QByteArray>> HashCache::GetHashes (const QStringList& paths, HashAlgorithm algorithm)
+	{
+		// waiting for the hashing jobs in Pool_ from a thread of the
+		// global pool, so that concurrent requests can't starve Pool_
+		return QtConcurrent::run ([self = shared_from_this (), paths, algorithm]
+				{
+					return self->ComputeHashes (paths, algorithm);
+				});
+	}
+
+	QHash<QString, QByteArray> HashCache::ComputeHashes (const QStringList& paths, HashAlgorithm algorithm)
+	{
+		QHash<QString, QByteArray> result;
+		QList<QPair<QString, QFuture<HashResult>>> pending;
+
+		for (const auto& path : paths)
+		{
+			const auto& stamp = GetFileStamp (path);
+			if (stamp.IsValid ())
+			{
+				QMutexLocker locker { &Mutex_ };
+				const auto pos = Entries_.constFind ({ path, static_cast<int> (algorithm) });
+				if (pos != Entries_.constEnd () && pos->Stamp_ == stamp)
+				{
+					result [path] = pos->Hash_;
+					continue;
+				}
+			}
+
+			pending.append ({ path, QtConcurrent::run (&Pool_, HashFile, path, algorithm) });
+		}
+
+		for (const auto& pair : pending)
+		{
+			const auto& hashResult = pair.second.result ();
+			result [pair.first] = hashResult.Hash_;
+
+			if (!hashResult.Stamp_.IsValid ())
+				continue;
+
+			QMutexLocker locker { &Mutex_ };
+			Entries_ [{ pair.first, static_cast<int> (algorithm) }] = { hashResult.Stamp_, hashResult.Hash_ };
+			IsDirty_ = true;
+		}
+
+		return result;
+	}
+
+	void HashCache::Prune (const QString& dirPath, const QStringList& files)
+	{
+		const auto& prefix = dirPath + '/';
+		const auto& filesSet = QSet<QString>::fromList (files);
+
+		QMutexLocker locker { &Mutex_ };
+		for (auto i = Entries_.begin (); i != Entries_.end (); )
+			if (i.key ().first.startsWith (prefix) && !filesSet.contains (i.key ().first))
+			{
+				i = Entries_.erase (i);
+				IsDirty_ = true;
+			}
+			else
+				++i;
+	}
+
+	void HashCache::Save ()
+	{
+		QMutexLocker locker { &Mutex_ };
+		if (!IsDirty_)
+			return;
+
+		QSaveFile file { GetCachePath () };
+		if (!file.open (QIODevice::WriteOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< file.fileName ()
+					<< file.errorString ();
+			return;
+		}
+
+		QDataStream out { &file };
+		out << static_cast<quint8> (1)
+				<< static_cast<quint32> (Entries_.size ());
+		for (auto i = Entries_.begin (), end = Entries_.end (); i != end; ++i)
+			out << i.key ().first
+					<< static_cast<quint8> (i.key ().second)
+					<< i->Stamp_.Size_
+					<< i->Stamp_.MTime_
+					<< i->Stamp_.Inode_
+					<< i->Hash_;
+
+		if (!file.commit ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to save"
+					<< file.fileName ()
+					<< file.errorString ();
+			return;
+		}
+
+		IsDirty_ = false;
+	}
+
+	void HashCache::Load ()
+	{
+		QFile file { GetCachePath () };
+		if (!file.exists ())
+			return;
+
+		if (!file.open (QIODevice::ReadOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< file.fileName ()
+					<< file.errorString ();
+			return;
+		}
+
+		QDataStream in { &file };
+		quint8 version = 0;
+		in >> version;
+		if (version != 1)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unknown version"
+					<< version;
+			return;
+		}
+
+		quint32 count = 0;
+		in >> count;
+
+		QMutexLocker locker { &Mutex_ };
+		for (quint32 i = 0; i < count && in.status () == QDataStream::Ok; ++i)
+		{
+			QString path;
+			quint8 algorithm = 0;
+			Entry entry;
+			in >> path
+					>> algorithm
+					>> entry.Stamp_.Size_
+					>> entry.Stamp_.MTime_
+					>> entry.Stamp_.Inode_
+					>> entry.Hash_;
+			Entries_ [{ path, algorithm }] = entry;
+		}
+	}
+}
+}
@@ -0,0 +1,102 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2010-2012  Oleg Linkin
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QThreadPool>
+#include <QStringList>
+#include "interfaces/netstoremanager/isupportfilelistings.h"
+
+namespace LeechCraft
+{
+namespace NetStoreManager
+{
+	struct FileStamp
+	{
+		qint64 Size_ = -1;
+		qint64 MTime_ = 0;
+		quint64 Inode_ = 0;
+
+		bool IsValid () const;
+	};
+
+	bool operator== (const FileStamp&, const FileStamp&);
+	bool operator!= (const FileStamp&, const FileStamp&);
+
+	/** Persistent cache of local files' content hashes.
+	 *
+	 * A hash is reused while the file's size, modification time and
+	 * inode stay the same. Missing hashes are computed by reading files
+	 * in chunks on a dedicated thread pool, so that large files are
+	 * never loaded into memory as a whole.
+	 *
+	 * This class is thread-safe and is meant to be owned by a shared
+	 * pointer.
+	 */
+	class HashCache : public std::enable_shared_from_this<HashCache>
+	{
+		struct Entry
+		{
+			FileStamp Stamp_;
+			QByteArray Hash_;
+		};
+
+		mutable QMutex Mutex_;
+		QHash<QPair<QString, int>, Entry> Entries_;
+		bool IsDirty_ = false;
+
+		QThreadPool Pool_;
+	public:
+		HashCache ();
+		~HashCache ();
+
+		HashCache (const HashCache&) = delete;
+		HashCache& operator= (const HashCache&) = delete;
+
+		/** Returns the future with the hashes of the given files. Files
+		 * that can't be read map to empty hashes.
+		 */
+		QFuture<QHash<QString, QByteArray>> GetHashes (const QStringList& paths, HashAlgorithm);
+
+		/** Forgets the hashes of files under dirPath that aren't in the
+		 * files list.
+		 */
+		void Prune (const QString& dirPath, const QStringList& files);
+
+		void Save ();
+	private:
+		QHash<QString, QByteArray> ComputeHashes (const QStringList& paths, HashAlgorithm);
+		void Load ();
+	};
+}
+}
@@ -65,6 +65,8 @@ namespace NetStoreManager
 		qRegisterMetaTypeStreamOperators<QList<SyncerInfo>> ("QList<SyncerInfo>");
 		qRegisterMetaType<Change> ("Change");
 		qRegisterMetaTypeStreamOperators<Change> ("Change");
+		qRegisterMetaType<Changes_t> ("Changes_t");
+		qRegisterMetaTypeStreamOperators<Changes_t> ("Changes_t");
 		qRegisterMetaType<StorageItem> ("StorageItem");
 		qRegisterMetaTypeStreamOperators<StorageItem> ("StorageItem");
 
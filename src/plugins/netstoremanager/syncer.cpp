@@ -28,13 +28,13 @@
  **********************************************************************/
 
 #include "syncer.h"
-#include <future>
-#include <QCryptographicHash>
+#include <algorithm>
 #include <QFileInfo>
 #include <QStandardItem>
 #include <QtDebug>
-#include <QUuid>
+#include <util/threads/futures.h>
 #include "interfaces/netstoremanager/istorageaccount.h"
+#include "hashcache.h"
 #include "utils.h"
 
 namespace LeechCraft
@@ -42,14 +42,28 @@ namespace LeechCraft
 namespace NetStoreManager
 {
 	Syncer::Syncer (const QString& dirPath, const QString& remotePath,
-			IStorageAccount *isa, QObject *parent)
+			IStorageAccount *isa, const std::shared_ptr<HashCache>& hashCache,
+			QObject *parent)
 	: QObject (parent)
 	, LocalPath_ (dirPath)
 	, RemotePath_ (remotePath)
 	, Started_ (false)
 	, Account_ (isa)
 	, SFLAccount_ (qobject_cast<ISupportFileListings*> (isa->GetQObject ()))
+	, ListingReceived_ (false)
+	, SyncRequested_ (false)
+	, SnapshotPending_ (false)
+	, ResyncRequested_ (false)
+	, HashCache_ (hashCache)
 	{
+		connect (isa->GetQObject (),
+				SIGNAL (upFinished (QByteArray, QString)),
+				this,
+				SLOT (handleUploadFinished (QByteArray, QString)));
+		connect (isa->GetQObject (),
+				SIGNAL (upError (QString, QString)),
+				this,
+				SLOT (handleUploadError (QString, QString)));
 	}
 
 	QByteArray Syncer::GetAccountID () const
@@ -67,11 +81,6 @@ namespace NetStoreManager
 		return RemotePath_;
 	}
 
-	Snapshot_t Syncer::GetSnapshot () const
-	{
-		return Snapshot_;
-	}
-
 	void Syncer::SetSnapshot (const Changes_t& changes)
 	{
 		Snapshot_.clear ();
@@ -147,94 +156,303 @@ namespace NetStoreManager
 			}
 	}
 
-	namespace
+	QString Syncer::ToRemotePath (const QString& path) const
 	{
-		QCryptographicHash::Algorithm NSMHashType2QtCryproHashAlgorithm (HashAlgorithm hash)
-		{
-			switch (hash)
-			{
-			case HashAlgorithm::Md4:
-				return QCryptographicHash::Md4;
-			case HashAlgorithm::Sha1:
-				return QCryptographicHash::Sha1;
-			case HashAlgorithm::Md5:
-			default:
-				return QCryptographicHash::Md5;
-			}
-		}
+		return RemotePath_.isEmpty () ?
+				path :
+				RemotePath_ + '/' + path;
 	}
 
-	Snapshot_t Syncer::CreateSnapshot ()
+	Snapshot_t Syncer::CreateSnapshot (const QList<QFileInfo>& infos,
+			const QHash<QString, QByteArray>& hashes, HashAlgorithm algorithm) const
 	{
 		Snapshot_t snapshot;
-
-		for (const auto& fi : QDir (LocalPath_).entryInfoList (QDir::NoDotAndDotDot | QDir::AllEntries))
+		for (const auto& fi : infos)
 		{
 			const QString path = fi.absoluteFilePath ().remove (LocalPath_ + "/");
+
 			Change change;
-			StorageItem storage;
-			if (!Id2Path_.right.count (path))
-				change.ItemID_ = Id2Path_.right.at (path);
-			else
-			{
-				change.ItemID_ = QUuid::createUuid ().toByteArray ();
+			change.ID_ = path.toUtf8 ();
+			change.Deleted_ = false;
 
-				storage.IsDirectory_ = fi.isDir ();
-				storage.Name_ = fi.fileName ();
-				storage.ModifyDate_ = fi.lastModified ();
-				storage.ID_ = change.ItemID_;
-			}
+			const auto remotePos = Id2Path_.right.find (ToRemotePath (path));
+			if (remotePos != Id2Path_.right.end ())
+				change.ItemID_ = remotePos->second;
+
+			auto& storage = change.Item_;
+			storage.ID_ = change.ItemID_;
+			storage.IsDirectory_ = fi.isDir ();
+			storage.Name_ = fi.fileName ();
+			storage.ModifyDate_ = fi.lastModified ();
+			storage.HashType_ = algorithm;
 
 			if (fi.isFile ())
 			{
-				QFile file (fi.absoluteFilePath ());
-				if (file.open (QIODevice::ReadOnly))
-				{
-					const auto& ba = file.readAll ();
-					storage.Hash_ = QCryptographicHash::hash (ba,
-							NSMHashType2QtCryproHashAlgorithm (SFLAccount_->GetCheckSumAlgorithm ()));
-					file.close ();
-				}
-				else
-					qWarning () << Q_FUNC_INFO
-							<< "unable to open file for hash calculation";
-
+				storage.Hash_ = hashes.value (fi.absoluteFilePath ()).toHex ();
 				storage.Size_ = fi.size ();
 			}
 
-			change.Item_ = storage;
 			snapshot [change.ID_] = change;
 		}
 
 		return snapshot;
 	}
 
+	Snapshot_t Syncer::CreateRemoteSnapshot () const
+	{
+		const auto& prefix = RemotePath_.isEmpty () ?
+				QString () :
+				RemotePath_ + '/';
+
+		Snapshot_t snapshot;
+		for (const auto& pair : Id2Path_.left)
+		{
+			if (!pair.second.startsWith (prefix))
+				continue;
+
+			Change change;
+			change.ID_ = pair.second.mid (prefix.size ()).toUtf8 ();
+			change.Deleted_ = false;
+			change.ItemID_ = pair.first;
+			change.Item_ = Id2Item_.value (pair.first);
+			snapshot [change.ID_] = change;
+		}
+		return snapshot;
+	}
+
+	namespace
+	{
+		bool IsSameItem (const StorageItem& newItem, const StorageItem& oldItem)
+		{
+			if (newItem.IsDirectory_ || oldItem.IsDirectory_)
+				return newItem.IsDirectory_ == oldItem.IsDirectory_;
+
+			if (newItem.Size_ != oldItem.Size_)
+				return false;
+
+			if (!newItem.Hash_.isEmpty () && !oldItem.Hash_.isEmpty ())
+				return newItem.Hash_.toLower () == oldItem.Hash_.toLower ();
+
+			return newItem.ModifyDate_ <= oldItem.ModifyDate_;
+		}
+
+		QByteArray GetParentKey (const QByteArray& key)
+		{
+			const auto pos = key.lastIndexOf ('/');
+			return pos < 0 ? QByteArray () : key.left (pos);
+		}
+	}
+
 	Snapshot_t Syncer::CreateDiffSnapshot (const Snapshot_t& newSnapshot,
-			const Snapshot_t& oldSnapshot)
+			const Snapshot_t& oldSnapshot, const Snapshot_t& syncedSnapshot)
 	{
 		Snapshot_t diffSnapshot;
+
+		for (auto i = newSnapshot.begin (), end = newSnapshot.end (); i != end; ++i)
+		{
+			const auto oldPos = oldSnapshot.find (i.key ());
+			if (oldPos == oldSnapshot.end ())
+			{
+				diffSnapshot [i.key ()] = *i;
+				continue;
+			}
+
+			if (IsSameItem (i->Item_, oldPos->Item_))
+				continue;
+
+			auto change = *i;
+			change.ItemID_ = oldPos->ItemID_;
+			diffSnapshot [i.key ()] = change;
+		}
+
+		for (auto i = oldSnapshot.begin (), end = oldSnapshot.end (); i != end; ++i)
+		{
+			// only what we've synced before and what has been removed locally
+			// since then goes away, remote-only items are left intact
+			if (newSnapshot.contains (i.key ()) ||
+					!syncedSnapshot.contains (i.key ()))
+				continue;
+
+			auto change = *i;
+			change.Deleted_ = true;
+			diffSnapshot [i.key ()] = change;
+		}
+
 		return diffSnapshot;
 	}
 
+	void Syncer::ApplyDiff (const Snapshot_t& diff, const Snapshot_t& remoteSnapshot)
+	{
+		auto keys = diff.keys ();
+		std::sort (keys.begin (), keys.end ());
+
+		QList<QByteArray> toTrash;
+		for (const auto& key : keys)
+		{
+			auto change = diff [key];
+			if (change.Deleted_)
+			{
+				// the whole removed directory goes to the trash at once
+				bool parentDeleted = false;
+				for (auto parent = GetParentKey (key); !parent.isEmpty () && !parentDeleted;
+						parent = GetParentKey (parent))
+					parentDeleted = diff.contains (parent) && diff [parent].Deleted_;
+
+				if (!parentDeleted)
+					toTrash << change.ItemID_;
+				continue;
+			}
+
+			if (InFlight_.contains (key) ||
+					std::any_of (PendingChanges_.begin (), PendingChanges_.end (),
+							[&key] (const Change& pending) { return pending.ID_ == key; }))
+				continue;
+
+			if (!change.ItemID_.isEmpty () &&
+					remoteSnapshot [key].Item_.IsDirectory_ != change.Item_.IsDirectory_)
+			{
+				toTrash << change.ItemID_;
+				change.ItemID_.clear ();
+			}
+
+			PendingChanges_ << change;
+		}
+
+		if (!toTrash.isEmpty ())
+			SFLAccount_->MoveToTrash (toTrash);
+
+		ProcessPendingChanges ();
+	}
+
+	void Syncer::ProcessPendingChanges ()
+	{
+		QList<Change> stillPending;
+		for (const auto& change : PendingChanges_)
+		{
+			const auto& path = QString::fromUtf8 (change.ID_);
+			const auto& remoteParent = ToRemotePath (path).section ('/', 0, -2);
+
+			QByteArray parentId;
+			if (!remoteParent.isEmpty ())
+			{
+				const auto parentPos = Id2Path_.right.find (remoteParent);
+				if (parentPos == Id2Path_.right.end ())
+				{
+					stillPending << change;
+					continue;
+				}
+				parentId = parentPos->second;
+			}
+
+			InFlight_ << change.ID_;
+
+			if (change.Item_.IsDirectory_)
+				SFLAccount_->CreateDirectory (change.Item_.Name_, parentId);
+			else if (change.ItemID_.isEmpty ())
+				Account_->Upload (LocalPath_ + '/' + path, parentId);
+			else
+				Account_->Upload (LocalPath_ + '/' + path, parentId,
+						UploadType::Update, change.ItemID_);
+		}
+		PendingChanges_ = stillPending;
+	}
+
+	void Syncer::MarkLanded (const QByteArray& itemId)
+	{
+		const auto pos = Id2Path_.left.find (itemId);
+		if (pos == Id2Path_.left.end ())
+			return;
+
+		const auto& prefix = RemotePath_.isEmpty () ?
+				QString () :
+				RemotePath_ + '/';
+		if (pos->second.startsWith (prefix))
+			InFlight_.remove (pos->second.mid (prefix.size ()).toUtf8 ());
+	}
+
 	void Syncer::start ()
 	{
-		if (Started_)
+		if (Started_ || !SFLAccount_)
 			return;
 
 		Started_ = true;
 		QStringList path = RemotePath_.split ('/');
 		CreateRemotePath (path);
 
-		const auto& newSnapshot = CreateSnapshot ();
-		//TODO create diff
+		if (ListingReceived_)
+			Sync ();
+		else
+			SyncRequested_ = true;
+	}
+
+	void Syncer::Sync ()
+	{
+		if (SnapshotPending_)
+		{
+			ResyncRequested_ = true;
+			return;
+		}
+
+		const auto algorithm = SFLAccount_->GetCheckSumAlgorithm ();
+
+		QList<QFileInfo> infos;
+		QStringList files;
+		for (const auto& path : Utils::ScanDir (QDir::NoDotAndDotDot | QDir::AllEntries, LocalPath_, true))
+		{
+			const QFileInfo fi { path };
+			infos << fi;
+			if (fi.isFile ())
+				files << path;
+		}
+
+		SnapshotPending_ = true;
+		Util::Sequence (this, HashCache_->GetHashes (files, algorithm)) >>
+				[this, infos, files, algorithm] (const QHash<QString, QByteArray>& hashes)
+				{
+					SnapshotPending_ = false;
+
+					HashCache_->Prune (LocalPath_, files);
+					HashCache_->Save ();
+
+					if (Started_)
+					{
+						const auto& newSnapshot = CreateSnapshot (infos, hashes, algorithm);
+						const auto& remoteSnapshot = CreateRemoteSnapshot ();
+						ApplyDiff (CreateDiffSnapshot (newSnapshot, remoteSnapshot, Snapshot_), remoteSnapshot);
+						Snapshot_ = newSnapshot;
+
+						emit snapshotUpdated (Snapshot_.values ());
+					}
+
+					if (ResyncRequested_)
+					{
+						ResyncRequested_ = false;
+						Sync ();
+					}
+				};
 	}
 
 	void Syncer::stop ()
 	{
 		CallsQueue_.clear ();
+		PendingChanges_.clear ();
+		InFlight_.clear ();
+		SyncRequested_ = false;
+		ResyncRequested_ = false;
 		Started_ = false;
 	}
 
+	void Syncer::rescan ()
+	{
+		if (!Started_)
+			return;
+
+		if (ListingReceived_)
+			Sync ();
+		else
+			SyncRequested_ = true;
+	}
+
 	void Syncer::handleGotItems (const QList<StorageItem>& items)
 	{
 		Id2Item_.clear ();
@@ -282,6 +500,16 @@ namespace NetStoreManager
 			childItems.clear();
 		}
 
+		ListingReceived_ = true;
+
+		ProcessPendingChanges ();
+
+		if (SyncRequested_)
+		{
+			SyncRequested_ = false;
+			Sync ();
+		}
+
 		if (!CallsQueue_.isEmpty ())
 			CallsQueue_.dequeue () ();
 	}
@@ -293,6 +521,9 @@ namespace NetStoreManager
 			(Id2Path_.left.at (parentId) + "/") :
 			QString ())
 				+ item.Name_ });
+		MarkLanded (item.ID_);
+
+		ProcessPendingChanges ();
 
 		if (!CallsQueue_.isEmpty ())
 			CallsQueue_.dequeue () ();
@@ -328,13 +559,26 @@ namespace NetStoreManager
 				else
 					Id2Path_.insert ({ id, path });
 				Id2Item_ [id] = item;
+				MarkLanded (id);
 			}
 		}
 
+		ProcessPendingChanges ();
+
 		if (!CallsQueue_.isEmpty ())
 			CallsQueue_.dequeue () ();
 	}
 
+	void Syncer::handleUploadFinished (const QByteArray&, const QString& filepath)
+	{
+		InFlight_.remove (QString (filepath).remove (LocalPath_ + "/").toUtf8 ());
+	}
+
+	void Syncer::handleUploadError (const QString&, const QString& filepath)
+	{
+		InFlight_.remove (QString (filepath).remove (LocalPath_ + "/").toUtf8 ());
+	}
+
 	void Syncer::localDirWasCreated (const QString& path)
 	{
 		if (!SFLAccount_)
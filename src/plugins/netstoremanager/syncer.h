@@ -30,13 +30,16 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 
 #ifndef Q_MOC_RUN
 #include <boost/bimap.hpp>
 #endif
 
 #include <QObject>
+#include <QFileInfo>
 #include <QQueue>
+#include <QSet>
 #include "interfaces/netstoremanager/isupportfilelistings.h"
 #include "syncmanager.h"
 
@@ -45,6 +48,7 @@ namespace LeechCraft
 namespace NetStoreManager
 {
 	class IStorageAccount;
+	class HashCache;
 
 	class Syncer : public QObject
 	{
@@ -58,18 +62,26 @@ namespace NetStoreManager
 		QHash<QByteArray, StorageItem> Id2Item_;
 		boost::bimaps::bimap<QByteArray, QString> Id2Path_;
 		QQueue<std::function<void (void)>> CallsQueue_;
+		bool ListingReceived_;
+		bool SyncRequested_;
+		bool SnapshotPending_;
+		bool ResyncRequested_;
+
+		const std::shared_ptr<HashCache> HashCache_;
+		QList<Change> PendingChanges_;
+		QSet<QByteArray> InFlight_;
 
 		Snapshot_t Snapshot_;
 
 	public:
 		explicit Syncer (const QString& dirPath, const QString& remotePath,
-				IStorageAccount *isa, QObject *parent = 0);
+				IStorageAccount *isa, const std::shared_ptr<HashCache>& hashCache,
+				QObject *parent = 0);
 
 		QByteArray GetAccountID () const;
 		QString GetLocalPath () const;
 		QString GetRemotePath () const;
 
-		Snapshot_t GetSnapshot () const;
 		void SetSnapshot (const Changes_t& changes);
 
 		bool IsStarted () const;
@@ -77,17 +89,27 @@ namespace NetStoreManager
 		void CreateRemotePath (const QStringList& path);
 		void DeleteRemotePath (const QStringList& path);
 		void RenameItem (const StorageItem& item, const QString& path);
-		Snapshot_t CreateSnapshot ();
+		QString ToRemotePath (const QString& path) const;
+		Snapshot_t CreateSnapshot (const QList<QFileInfo>& infos,
+				const QHash<QString, QByteArray>& hashes, HashAlgorithm algorithm) const;
+		Snapshot_t CreateRemoteSnapshot () const;
 		Snapshot_t CreateDiffSnapshot (const Snapshot_t& newSnapshot,
-				const Snapshot_t& oldSnapshot);
+				const Snapshot_t& oldSnapshot, const Snapshot_t& syncedSnapshot);
+		void ApplyDiff (const Snapshot_t& diff, const Snapshot_t& remoteSnapshot);
+		void Sync ();
+		void ProcessPendingChanges ();
+		void MarkLanded (const QByteArray& itemId);
 
 	public slots:
 		void start ();
 		void stop ();
+		void rescan ();
 
 		void handleGotItems (const QList<StorageItem>& items);
 		void handleGotNewItem (const StorageItem& item, const QByteArray& parentId);
 		void handleGotChanges (const QList<Change>& changes);
+		void handleUploadFinished (const QByteArray& id, const QString& filepath);
+		void handleUploadError (const QString& error, const QString& filepath);
 
 		void localDirWasCreated (const QString& path);
 		void localDirWasRemoved (const QString& path);
@@ -95,6 +117,9 @@ namespace NetStoreManager
 		void localFileWasRemoved (const QString& path);
 		void localFileWasUpdated (const QString& path);
 		void localFileWasRenamed (const QString& oldName, const QString& newName);
+
+	signals:
+		void snapshotUpdated (const Changes_t& snapshot);
 	};
 }
 }
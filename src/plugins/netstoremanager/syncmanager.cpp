@@ -29,10 +29,13 @@
 
 #include "syncmanager.h"
 #include <QtDebug>
+#include <QCoreApplication>
 #include <QSettings>
 #include <QThread>
+#include <QTimer>
 #include "accountsmanager.h"
 #include "syncer.h"
+#include "hashcache.h"
 #if defined (Q_OS_LINUX)
 	#include "fileswatcher_inotify.h"
 #else
@@ -48,7 +51,18 @@ namespace NetStoreManager
 	SyncManager::SyncManager (AccountsManager *am, QObject *parent)
 	: QObject (parent)
 	, AM_ (am)
+	, HashCache_ (std::make_shared<HashCache> ())
+	, RescanTimer_ (new QTimer (this))
 	{
+		// the watcher has already coalesced the events, this additionally
+		// merges the bursts of them into a single rescan per syncer
+		RescanTimer_->setSingleShot (true);
+		RescanTimer_->setInterval (2000);
+		connect (RescanTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (flushRescans ()));
+
 #if defined (Q_OS_LINUX)
 		FilesWatcher_ = new FilesWatcherInotify (this);
 #else
@@ -83,6 +97,10 @@ namespace NetStoreManager
 				SIGNAL (entryWasRenamed (QString, QString)),
 				this,
 				SLOT (handleEntryWasRenamed (QString, QString)));
+		connect (FilesWatcher_,
+				SIGNAL (rescanRequested (QString)),
+				this,
+				SLOT (handleRescanRequested (QString)));
 
 		for (auto account : AM_->GetAccounts ())
 		{
@@ -106,6 +124,9 @@ namespace NetStoreManager
 
 	void SyncManager::Release ()
 	{
+		RescanTimer_->stop ();
+		PendingRescans_.clear ();
+
 		for (auto syncer : Syncer2Thread_.keys ())
 		{
 			syncer->stop ();
@@ -123,6 +144,8 @@ namespace NetStoreManager
 			syncer->deleteLater ();
 			thread->deleteLater ();
 		}
+
+		HashCache_->Save ();
 	}
 
 	void SyncManager::handleDirectoriesToSyncUpdated (const QList<SyncerInfo>& infos)
@@ -162,7 +185,12 @@ namespace NetStoreManager
 			const QString& baseDir, const QString& remoteDir)
 	{
 		QThread *thread = new QThread (this);
-		Syncer *syncer = new Syncer (baseDir, remoteDir, isa);
+		Syncer *syncer = new Syncer (baseDir, remoteDir, isa, HashCache_);
+		ReadSnapshot (syncer);
+		connect (syncer,
+				SIGNAL (snapshotUpdated (Changes_t)),
+				this,
+				SLOT (handleSnapshotUpdated (Changes_t)));
 		syncer->moveToThread (thread);
 		thread->start ();
 		Syncer2Thread_ [syncer] = thread;
@@ -170,12 +198,35 @@ namespace NetStoreManager
 		return syncer;
 	}
 
-	void SyncManager::WriteSnapshots ()
+	namespace
 	{
+		QString GetSnapshotGroup (Syncer *syncer)
+		{
+			return "Snapshots/" + QString::fromLatin1 (syncer->GetAccountID ().toHex ());
+		}
 	}
 
-	void SyncManager::ReadSnapshots ()
+	void SyncManager::WriteSnapshot (Syncer *syncer, const Changes_t& snapshot)
 	{
+		QSettings settings (QCoreApplication::organizationName (),
+				QCoreApplication::applicationName () + "_NetStoreManager");
+		settings.beginGroup (GetSnapshotGroup (syncer));
+		settings.setValue ("LocalPath", syncer->GetLocalPath ());
+		settings.setValue ("RemotePath", syncer->GetRemotePath ());
+		settings.setValue ("Snapshot", QVariant::fromValue (snapshot));
+		settings.endGroup ();
+	}
+
+	void SyncManager::ReadSnapshot (Syncer *syncer)
+	{
+		QSettings settings (QCoreApplication::organizationName (),
+				QCoreApplication::applicationName () + "_NetStoreManager");
+		settings.beginGroup (GetSnapshotGroup (syncer));
+		// the snapshot is meaningless for another pair of directories
+		if (settings.value ("LocalPath").toString () == syncer->GetLocalPath () &&
+				settings.value ("RemotePath").toString () == syncer->GetRemotePath ())
+			syncer->SetSnapshot (settings.value ("Snapshot").value<Changes_t> ());
+		settings.endGroup ();
 	}
 
 	Syncer* SyncManager::GetSyncerByID (const QByteArray& id) const
@@ -189,53 +240,80 @@ namespace NetStoreManager
 	Syncer* SyncManager::GetSyncerByLocalPath (const QString& localPath) const
 	{
 		for (auto syncer : AccountID2Syncer_)
-			if (localPath.startsWith (syncer->GetLocalPath ()))
+		{
+			const auto& root = syncer->GetLocalPath ();
+			if (localPath == root || localPath.startsWith (root + '/'))
 				return syncer;
+		}
 
 		return 0;
 	}
 
+	void SyncManager::ScheduleRescan (const QString& localPath)
+	{
+		auto syncer = GetSyncerByLocalPath (localPath);
+		if (!syncer)
+			return;
+
+		PendingRescans_ << syncer;
+		RescanTimer_->start ();
+	}
+
 	void SyncManager::handleDirWasCreated (const QString& path)
 	{
-// 		if (auto syncer = GetSyncerByLocalPath (path))
-// 			syncer->localDirWasCreated (path);
+		ScheduleRescan (path);
 	}
 
 	void SyncManager::handleDirWasRemoved (const QString& path)
 	{
-// 		if (auto syncer = GetSyncerByLocalPath (path))
-// 			syncer->localDirWasRemoved (path);
+		ScheduleRescan (path);
 	}
 
 	void SyncManager::handleFileWasCreated (const QString& path)
 	{
-// 		if (auto syncer = GetSyncerByLocalPath (path))
-// 			syncer->localFileWasCreated (path);
+		ScheduleRescan (path);
 	}
 
 	void SyncManager::handleFileWasRemoved (const QString& path)
 	{
-// 		if (auto syncer = GetSyncerByLocalPath (path))
-// 			syncer->localFileWasRemoved (path);
+		ScheduleRescan (path);
 	}
 
 	void SyncManager::handleFileWasUpdated (const QString& path)
 	{
-// 		if (auto syncer = GetSyncerByLocalPath (path))
-// 			syncer->localFileWasUpdated (path);
+		ScheduleRescan (path);
 	}
 
 	void SyncManager::handleEntryWasMoved (const QString& oldPath,
 			const QString& newPath)
 	{
-		qDebug () << Q_FUNC_INFO << oldPath << newPath;
+		ScheduleRescan (oldPath);
+		ScheduleRescan (newPath);
 	}
 
 	void SyncManager::handleEntryWasRenamed (const QString& oldName,
 			const QString& newName)
 	{
-// 		if (auto syncer = GetSyncerByLocalPath (oldName))
-// 			syncer->localFileWasRenamed (oldName, newName);
+		ScheduleRescan (oldName);
+		ScheduleRescan (newName);
+	}
+
+	void SyncManager::handleRescanRequested (const QString& path)
+	{
+		ScheduleRescan (path);
+	}
+
+	void SyncManager::flushRescans ()
+	{
+		for (auto syncer : PendingRescans_)
+			QMetaObject::invokeMethod (syncer, "rescan", Qt::QueuedConnection);
+		PendingRescans_.clear ();
+	}
+
+	void SyncManager::handleSnapshotUpdated (const Changes_t& snapshot)
+	{
+		if (auto syncer = qobject_cast<Syncer*> (sender ()))
+			WriteSnapshot (syncer, snapshot);
 	}
 
 	void SyncManager::handleGotListing (const QList<StorageItem>& items)
@@ -29,8 +29,10 @@
 
 #pragma once
 
+#include <memory>
 #include <QObject>
 #include <QVariant>
+#include <QSet>
 #include "interfaces/netstoremanager/istorageaccount.h"
 #include "interfaces/netstoremanager/isupportfilelistings.h"
 #include "syncwidget.h"
@@ -39,6 +41,7 @@ typedef QList<LeechCraft::NetStoreManager::Change> Changes_t;
 Q_DECLARE_METATYPE (Changes_t)
 
 class QThread;
+class QTimer;
 
 namespace LeechCraft
 {
@@ -47,6 +50,7 @@ namespace NetStoreManager
 	class AccountsManager;
 	class FilesWatcherBase;
 	class Syncer;
+	class HashCache;
 
 	typedef QHash<QByteArray, Change> Snapshot_t;
 
@@ -58,6 +62,10 @@ namespace NetStoreManager
 		FilesWatcherBase *FilesWatcher_;
 		QHash<QString, Syncer*> AccountID2Syncer_;
 		QHash<Syncer*, QThread*> Syncer2Thread_;
+		const std::shared_ptr<HashCache> HashCache_;
+
+		QSet<Syncer*> PendingRescans_;
+		QTimer *RescanTimer_;
 
 	public:
 		SyncManager (AccountsManager *am, QObject *parent = 0);
@@ -66,10 +74,11 @@ namespace NetStoreManager
 	private:
 		Syncer* CreateSyncer (IStorageAccount *isa, const QString& baseDir,
 				const QString& remoteDir);
-		void WriteSnapshots ();
-		void ReadSnapshots ();
+		void WriteSnapshot (Syncer *syncer, const Changes_t& snapshot);
+		void ReadSnapshot (Syncer *syncer);
 		Syncer* GetSyncerByID (const QByteArray& id) const;
 		Syncer* GetSyncerByLocalPath (const QString& localPath) const;
+		void ScheduleRescan (const QString& localPath);
 
 	public slots:
 		void handleDirectoriesToSyncUpdated (const QList<SyncerInfo>& map);
@@ -82,6 +91,9 @@ namespace NetStoreManager
 		void handleFileWasUpdated (const QString& path);
 		void handleEntryWasMoved (const QString& oldPath, const QString& newPath);
 		void handleEntryWasRenamed (const QString& oldName, const QString& newName);
+		void handleRescanRequested (const QString& path);
+		void flushRescans ();
+		void handleSnapshotUpdated (const Changes_t& snapshot);
 
 		void handleGotListing (const QList<StorageItem>& items);
 		void handleGotNewItem (const StorageItem& item, const QByteArray& parentId);
@@ -142,11 +142,19 @@ namespace Poshuku
 				SIGNAL (added (const HistoryItem&)),
 				HistoryModel_,
 				SLOT (handleItemAdded (const HistoryItem&)));
+		connect (StorageBackend_.get (),
+				SIGNAL (historyCleared (history_items_t)),
+				HistoryModel_,
+				SLOT (handleHistoryCleared (history_items_t)));
 
 		connect (StorageBackend_.get (),
 				SIGNAL (added (const HistoryItem&)),
 				URLCompletionModel_,
 				SLOT (handleItemAdded (const HistoryItem&)));
+		connect (StorageBackend_.get (),
+				SIGNAL (historyCleared (history_items_t)),
+				URLCompletionModel_,
+				SLOT (handleHistoryCleared (history_items_t)));
 
 		connect (StorageBackend_.get (),
 				SIGNAL (added (const FavoritesModel::FavoritesItem&)),
@@ -165,6 +173,7 @@ namespace Poshuku
 
 		HistoryModel_->HandleStorageReady ();
 		FavoritesModel_->HandleStorageReady ();
+		URLCompletionModel_->HandleStorageReady ();
 	}
 
 	void Core::Release ()
@@ -34,7 +34,6 @@
 #include <QAction>
 #include <QtDebug>
 #include <util/xpc/defaulthookproxy.h>
-#include <util/sll/prelude.h>
 #include <interfaces/core/icoreproxy.h>
 #include <interfaces/core/iiconthememanager.h>
 #include "core.h"
@@ -47,6 +46,13 @@ namespace Poshuku
 {
 	namespace
 	{
+		const int DateTimeRole = Qt::UserRole + 1;
+
+		QString NormalizeText (QString text)
+		{
+			return text.trimmed ().replace ('\n', ' ');
+		}
+
 		/** Returns the number of the section for the given date.
 			*
 			* - Today
@@ -103,6 +109,33 @@ namespace Poshuku
 				return QObject::tr ("Last %n month(s)", "", number - 3);
 			}
 		}
+
+		/** Returns the [from; to) period of dates corresponding to the
+			* section with the given number, with \em today being the
+			* date passed to SectionNumber() as the current one. An invalid
+			* end means the period is open.
+			*/
+		QPair<QDateTime, QDateTime> SectionBounds (int number, const QDate& today)
+		{
+			switch (number)
+			{
+			case 0:
+				return { QDateTime { today }, {} };
+			case 1:
+			case 2:
+				return { QDateTime { today.addDays (-number) }, QDateTime { today.addDays (-number + 1) } };
+			case 3:
+				return { QDateTime { today.addDays (-7) }, QDateTime { today.addDays (-2) } };
+			case 4:
+				return { QDateTime { today.addMonths (-1) }, QDateTime { today.addDays (-7) } };
+			default:
+				return
+				{
+					QDateTime { today.addMonths (-(number - 3)) },
+					QDateTime { today.addMonths (-(number - 4)) }
+				};
+			}
+		}
 	};
 
 	HistoryModel::HistoryModel (QObject *parent)
@@ -116,6 +149,10 @@ namespace Poshuku
 	{
 		loadData ();
 
+		// Collecting garbage may take a while on big histories, so don't
+		// do that right on startup.
+		QTimer::singleShot (60 * 1000, this, SLOT (collectGarbage ()));
+
 		GarbageTimer_->start (15 * 60 * 1000);
 		connect (GarbageTimer_,
 				SIGNAL (timeout ()),
@@ -148,21 +185,67 @@ namespace Poshuku
 		Core::Instance ().GetStorageBackend ()->AddToHistory (item);
 	}
 
+	bool HistoryModel::hasChildren (const QModelIndex& parent) const
+	{
+		if (IsSection (parent) && !LoadedSections_.contains (parent.row ()))
+			return true;
+
+		return QStandardItemModel::hasChildren (parent);
+	}
+
+	bool HistoryModel::canFetchMore (const QModelIndex& parent) const
+	{
+		return IsSection (parent) && !LoadedSections_.contains (parent.row ());
+	}
+
+	void HistoryModel::fetchMore (const QModelIndex& parent)
+	{
+		if (!canFetchMore (parent))
+			return;
+
+		const auto section = parent.row ();
+		LoadedSections_ << section;
+
+		const auto& bounds = SectionBounds (section, LoadTime_.date ());
+		history_items_t items;
+		Core::Instance ().GetStorageBackend ()->LoadHistorySection (bounds.first, bounds.second, items);
+
+		const auto sectionItem = item (section);
+		for (const auto& histItem : items)
+			sectionItem->appendRow (MakeRow (histItem));
+	}
+
+	void HistoryModel::FetchAllSections ()
+	{
+		for (int i = 0; i < rowCount (); ++i)
+			fetchMore (index (i, 0));
+	}
+
+	/* Only the sections that have already been fetched are returned, so
+	 * that the GUI thread never waits for the whole history to load.
+	 * FetchAllSections() can be used to get everything.
+	 */
 	QList<QMap<QString, QVariant>> HistoryModel::getItemsMap () const
 	{
-		return Util::Map (Items_,
-				[] (const auto& item)
-				{
-					return QVariantMap
+		QList<QMap<QString, QVariant>> result;
+		for (int section = 0; section < rowCount (); ++section)
+		{
+			if (!LoadedSections_.contains (section))
+				continue;
+
+			const auto sectionItem = item (section);
+			for (int row = 0; row < sectionItem->rowCount (); ++row)
+				result << QVariantMap
 					{
-						{ "Title", item.Title_ },
-						{ "DateTime", item.DateTime_ },
-						{ "URL", item.URL_ }
+						{ "Title", sectionItem->child (row, ColumnTitle)->text () },
+						{ "DateTime", sectionItem->child (row, ColumnDate)->data (DateTimeRole) },
+						{ "URL", sectionItem->child (row, ColumnURL)->text () }
 					};
-				});
+		}
+		return result;
 	}
 
-	void HistoryModel::Add (const HistoryItem& histItem, int section)
+	void HistoryModel::EnsureSections (int section)
 	{
 		while (section >= rowCount ())
 		{
@@ -180,54 +263,115 @@ namespace Poshuku
 
 			appendRow (sectItems);
 		}
+	}
 
+	QList<QStandardItem*> HistoryModel::MakeRow (const HistoryItem& histItem) const
+	{
 		const auto icon = Core::Instance ().GetIcon (QUrl { histItem.URL_ });
-		auto normalizeText = [] (QString text)
-		{
-			return text.trimmed ().replace ('\n', ' ');
-		};
 		const QList<QStandardItem*> items
 		{
-			new QStandardItem { icon, normalizeText (histItem.Title_) },
-			new QStandardItem { normalizeText (histItem.URL_) },
+			new QStandardItem { icon, NormalizeText (histItem.Title_) },
+			new QStandardItem { NormalizeText (histItem.URL_) },
 			new QStandardItem { QLocale {}.toString (histItem.DateTime_, QLocale::ShortFormat) }
 		};
 		for (const auto item : items)
 			item->setEditable (false);
-		item (section)->appendRow (items);
+		items [ColumnDate]->setData (histItem.DateTime_, DateTimeRole);
+		return items;
 	}
 
-	void HistoryModel::loadData ()
+	bool HistoryModel::IsSection (const QModelIndex& index) const
 	{
-		collectGarbage ();
+		return index.isValid () &&
+				!index.parent ().isValid () &&
+				!index.column ();
+	}
 
+	void HistoryModel::loadData ()
+	{
 		if (const auto rc = rowCount ())
 			removeRows (0, rc);
 
-		Items_.clear ();
-		Core::Instance ().GetStorageBackend ()->LoadHistory (Items_);
+		LoadedSections_.clear ();
+		LoadTime_ = QDateTime::currentDateTime ();
+
+		const auto& oldest = Core::Instance ().GetStorageBackend ()->GetOldestHistoryDate ();
+		if (oldest.isValid ())
+			EnsureSections (SectionNumber (oldest, LoadTime_));
+	}
+
+	void HistoryModel::handleItemAdded (const HistoryItem& item)
+	{
+		const auto& now = QDateTime::currentDateTime ();
 
-		QSet<QString> urls;
-		for (auto i = Items_.begin (); i != Items_.end (); )
+		// the sections have shifted since they've been built, and the
+		// lazy loading makes rebuilding them cheap
+		if (now.date () != LoadTime_.date ())
 		{
-			if (urls.contains (i->URL_))
-				i = Items_.erase (i);
-			else
-			{
-				urls << i->URL_;
-				++i;
-			}
+			loadData ();
+			return;
 		}
 
-		const auto& now = QDateTime::currentDateTime ();
-		for (const auto& item : Items_)
-			Add (item, SectionNumber (item.DateTime_, now));
+		const auto section = item.DateTime_ >= now ?
+				0 :
+				SectionNumber (item.DateTime_, now);
+		EnsureSections (section);
+
+		if (LoadedSections_.contains (section))
+			this->item (section)->insertRow (0, MakeRow (item));
 	}
 
-	void HistoryModel::handleItemAdded (const HistoryItem& item)
+	void HistoryModel::handleHistoryCleared (const history_items_t& removed)
 	{
-		Items_.push_back (item);
-		Add (item, SectionNumber (item.DateTime_));
+		QHash<int, QSet<QPair<QString, QDateTime>>> section2removed;
+		for (const auto& histItem : removed)
+		{
+			const auto section = SectionNumber (histItem.DateTime_, LoadTime_);
+			if (LoadedSections_.contains (section))
+				section2removed [section] << qMakePair (NormalizeText (histItem.URL_), histItem.DateTime_);
+		}
+
+		for (auto i = section2removed.begin (), end = section2removed.end (); i != end; ++i)
+		{
+			const auto sectionItem = item (i.key ());
+
+			// removing the contiguous runs of rows at once, from the bottom
+			int runEnd = -1;
+			for (int row = sectionItem->rowCount () - 1; row >= -1; --row)
+			{
+				const bool isRemoved = row >= 0 &&
+						i->contains ({
+								sectionItem->child (row, ColumnURL)->text (),
+								sectionItem->child (row, ColumnDate)->data (DateTimeRole).toDateTime ()
+							});
+				if (isRemoved)
+				{
+					if (runEnd < 0)
+						runEnd = row;
+					continue;
+				}
+
+				if (runEnd >= 0)
+				{
+					sectionItem->removeRows (row + 1, runEnd - row);
+					runEnd = -1;
+				}
+			}
+		}
+
+		const auto& oldest = Core::Instance ().GetStorageBackend ()->GetOldestHistoryDate ();
+		const auto sectionsCount = oldest.isValid () ?
+				SectionNumber (oldest, LoadTime_) + 1 :
+				0;
+		if (sectionsCount >= rowCount ())
+			return;
+
+		removeRows (sectionsCount, rowCount () - sectionsCount);
+		for (auto it = LoadedSections_.begin (); it != LoadedSections_.end (); )
+			if (*it >= sectionsCount)
+				it = LoadedSections_.erase (it);
+			else
+				++it;
 	}
 
 	void HistoryModel::collectGarbage ()
@@ -30,6 +30,7 @@
 #pragma once
 
 #include <vector>
+#include <QSet>
 #include <QStringList>
 #include <QDateTime>
 #include <QStandardItemModel>
@@ -48,7 +49,9 @@ namespace Poshuku
 		Q_OBJECT
 
 		QTimer * const GarbageTimer_;
-		history_items_t Items_;
+
+		QDateTime LoadTime_;
+		QSet<int> LoadedSections_;
 	public:
 		enum Columns
 		{
@@ -60,15 +63,24 @@ namespace Poshuku
 		HistoryModel (QObject* = nullptr);
 
 		void HandleStorageReady ();
+
+		bool hasChildren (const QModelIndex& = {}) const override;
+		bool canFetchMore (const QModelIndex&) const override;
+		void fetchMore (const QModelIndex&) override;
+
+		void FetchAllSections ();
 	public slots:
 		void addItem (QString title, QString url, QDateTime datetime);
 		QList<QMap<QString, QVariant>> getItemsMap () const;
 	private:
-		void Add (const HistoryItem&, int section);
+		void EnsureSections (int);
+		QList<QStandardItem*> MakeRow (const HistoryItem&) const;
+		bool IsSection (const QModelIndex&) const;
 	private slots:
 		void loadData ();
 		void collectGarbage ();
 		void handleItemAdded (const HistoryItem&);
+		void handleHistoryCleared (const history_items_t&);
 	signals:
 		// Hook support signals
 		/** @brief Called when an entry is going to be added to
@@ -85,6 +85,10 @@ namespace Poshuku
 		const int section = Ui_.HistoryFilterType_->currentIndex ();
 		const auto& text = Ui_.HistoryFilterLine_->text ();
 
+		// Filtering needs the items of all the sections to be loaded.
+		if (!text.isEmpty ())
+			Core::Instance ().GetHistoryModel ()->FetchAllSections ();
+
 		switch (section)
 		{
 		case 1:
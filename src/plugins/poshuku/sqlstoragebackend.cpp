@@ -29,13 +29,16 @@
 
 #include "sqlstoragebackend.h"
 #include <stdexcept>
+#include <functional>
 #include <QDir>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QThread>
+#include <QtConcurrentRun>
 #include <QtDebug>
 #include <util/db/dblock.h>
 #include <util/db/util.h>
+#include <util/threads/futures.h>
 #include <util/util.h>
 #include "xmlsettingsmanager.h"
 
@@ -43,6 +46,175 @@ namespace LeechCraft
 {
 namespace Poshuku
 {
+	namespace
+	{
+		const QString HistoryLoaderQuery = "SELECT "
+				"title, "
+				"date, "
+				"url "
+				"FROM history "
+				"ORDER BY date DESC";
+
+		QString GetHistoryEraserCondition (StorageBackend::Type type)
+		{
+			switch (type)
+			{
+			case StorageBackend::SBSQLite:
+				return "(julianday ('now') - julianday (date) > :age)";
+			case StorageBackend::SBPostgres:
+				return "(date - now () > :age * interval '1 day')";
+			case StorageBackend::SBMysql:
+				break;
+			}
+
+			qWarning () << Q_FUNC_INFO
+					<< "it's not MySQL";
+			return {};
+		}
+
+		QString GetHistoryTruncaterCondition (StorageBackend::Type type)
+		{
+			switch (type)
+			{
+			case StorageBackend::SBSQLite:
+				return "date IN "
+						"(SELECT date FROM history ORDER BY date DESC "
+						"LIMIT 10000 OFFSET :num)";
+			case StorageBackend::SBPostgres:
+				return "date IN "
+						"	(SELECT date FROM history ORDER BY date DESC OFFSET :num)";
+			case StorageBackend::SBMysql:
+				break;
+			}
+
+			qWarning () << Q_FUNC_INFO
+					<< "it's not MySQL";
+			return {};
+		}
+
+		/** Removes the history items matching the condition and appends
+			* them to the removed list.
+			*/
+		bool RemoveHistoryItems (QSqlDatabase& db, const QString& condition,
+				const QString& placeholder, const QVariant& value, history_items_t& removed)
+		{
+			QSqlQuery selector { db };
+			selector.prepare ("SELECT title, date, url FROM history WHERE " + condition);
+			selector.bindValue (placeholder, value);
+			if (!selector.exec ())
+			{
+				Util::DBLock::DumpError (selector);
+				return false;
+			}
+
+			while (selector.next ())
+				removed.push_back ({
+						selector.value (0).toString (),
+						selector.value (1).toDateTime (),
+						selector.value (2).toString ()
+					});
+
+			QSqlQuery eraser { db };
+			eraser.prepare ("DELETE FROM history WHERE " + condition);
+			eraser.bindValue (placeholder, value);
+			if (!eraser.exec ())
+			{
+				Util::DBLock::DumpError (eraser);
+				return false;
+			}
+
+			return true;
+		}
+
+		history_items_t RunHistoryCleanup (QSqlDatabase& db, StorageBackend::Type type, int age, int items)
+		{
+			Util::DBLock lock { db };
+			lock.Init ();
+
+			history_items_t removed;
+			if (!RemoveHistoryItems (db, GetHistoryEraserCondition (type), ":age", age, removed) ||
+					!RemoveHistoryItems (db, GetHistoryTruncaterCondition (type), ":num", items, removed))
+				return {};
+
+			lock.Good ();
+			return removed;
+		}
+
+		QStringList GetPragmas (StorageBackend::Type type)
+		{
+			if (type != StorageBackend::SBSQLite)
+				return {};
+
+			const auto xsm = XmlSettingsManager::Instance ();
+			return
+			{
+				"PRAGMA journal_mode = " + xsm->property ("SQLiteJournalMode").toString () + ";",
+				"PRAGMA synchronous = " + xsm->property ("SQLiteSynchronous").toString () + ";",
+				"PRAGMA temp_store = " + xsm->property ("SQLiteTempStore").toString () + ";"
+			};
+		}
+
+		void ApplyPragmas (QSqlDatabase& db, const QStringList& pragmas)
+		{
+			QSqlQuery pragma { db };
+			for (const auto& str : pragmas)
+				if (!pragma.exec (str))
+					Util::DBLock::DumpError (pragma);
+		}
+
+		/** Everything needed to open another connection to the same
+		 * database from a different thread, collected in the thread
+		 * owning the main connection.
+		 */
+		struct ConnectionInfo
+		{
+			QString Driver_;
+			QString DBName_;
+			QString Host_;
+			int Port_;
+			QString User_;
+			QString Password_;
+			QStringList Pragmas_;
+		};
+
+		ConnectionInfo GetConnectionInfo (const QSqlDatabase& db, StorageBackend::Type type)
+		{
+			return
+			{
+				db.driverName (),
+				db.databaseName (),
+				db.hostName (),
+				db.port (),
+				db.userName (),
+				db.password (),
+				GetPragmas (type)
+			};
+		}
+
+		void WithConnection (const ConnectionInfo& info, const QString& baseName,
+				const std::function<void (QSqlDatabase&)>& func)
+		{
+			const auto& connName = Util::GenConnectionName (baseName);
+			{
+				auto db = QSqlDatabase::addDatabase (info.Driver_, connName);
+				db.setDatabaseName (info.DBName_);
+				db.setHostName (info.Host_);
+				db.setPort (info.Port_);
+				db.setUserName (info.User_);
+				db.setPassword (info.Password_);
+
+				if (db.open ())
+				{
+					ApplyPragmas (db, info.Pragmas_);
+					func (db);
+				}
+				else
+					Util::DBLock::DumpError (db.lastError ());
+			}
+			QSqlDatabase::removeDatabase (connName);
+		}
+	}
+
 	SQLStorageBackend::SQLStorageBackend (StorageBackend::Type type)
 	: Type_ { type }
 	, DBGuard_ { Util::MakeScopeGuard ([this] { DB_.close (); }) }
@@ -117,30 +289,10 @@ namespace Poshuku
 
 	void SQLStorageBackend::Prepare ()
 	{
-		if (Type_ == SBSQLite)
-		{
-			QSqlQuery pragma (DB_);
-			if (!pragma.exec (QString ("PRAGMA journal_mode = %1;")
-						.arg (XmlSettingsManager::Instance ()->
-							property ("SQLiteJournalMode").toString ())))
-				LeechCraft::Util::DBLock::DumpError (pragma);
-			if (!pragma.exec (QString ("PRAGMA synchronous = %1;")
-						.arg (XmlSettingsManager::Instance ()->
-							property ("SQLiteSynchronous").toString ())))
-				LeechCraft::Util::DBLock::DumpError (pragma);
-			if (!pragma.exec (QString ("PRAGMA temp_store = %1;")
-						.arg (XmlSettingsManager::Instance ()->
-							property ("SQLiteTempStore").toString ())))
-				LeechCraft::Util::DBLock::DumpError (pragma);
-		}
+		ApplyPragmas (DB_, GetPragmas (Type_));
 
 		HistoryLoader_ = QSqlQuery (DB_);
-		HistoryLoader_.prepare ("SELECT "
-				"title, "
-				"date, "
-				"url "
-				"FROM history "
-				"ORDER BY date DESC");
+		HistoryLoader_.prepare (HistoryLoaderQuery);
 
 		HistoryRatedLoader_ = QSqlQuery (DB_);
 		switch (Type_)
@@ -186,44 +338,21 @@ namespace Poshuku
 				":url"
 				")");
 
-		HistoryEraser_ = QSqlQuery (DB_);
-		switch (Type_)
-		{
-		case SBSQLite:
-			HistoryEraser_.prepare ("DELETE FROM history "
-					"WHERE "
-					"(julianday ('now') - julianday (date) > :age)");
-			break;
-		case SBPostgres:
-			HistoryEraser_.prepare ("DELETE FROM history "
-					"WHERE "
-					"(date - now () > :age * interval '1 day')");
-			break;
-		case SBMysql:
-			qWarning () << Q_FUNC_INFO
-					<< "it's not MySQL";
-			break;
-		}
+		HistorySectionLoader_ = QSqlQuery (DB_);
+		HistorySectionLoader_.prepare ("SELECT "
+				"title, "
+				"date, "
+				"url "
+				"FROM history AS h "
+				"WHERE date >= :from "
+				"AND date < :to "
+				"AND NOT EXISTS "
+				"	(SELECT 1 FROM history AS later "
+				"	WHERE later.url = h.url AND later.date > h.date) "
+				"ORDER BY date DESC");
 
-		HistoryTruncater_ = QSqlQuery (DB_);
-		switch (Type_)
-		{
-		case SBSQLite:
-			HistoryTruncater_.prepare ("DELETE FROM history "
-					"WHERE date IN "
-					"(SELECT date FROM history ORDER BY date DESC "
-					"LIMIT 10000 OFFSET :num)");
-			break;
-		case SBPostgres:
-			HistoryTruncater_.prepare ("DELETE FROM history "
-					"WHERE date IN "
-					"	(SELECT date FROM history ORDER BY date DESC OFFSET :num)");
-			break;
-		case SBMysql:
-			qWarning () << Q_FUNC_INFO
-					<< "it's not MySQL";
-			break;
-		}
+		HistoryOldestDateGetter_ = QSqlQuery (DB_);
+		HistoryOldestDateGetter_.prepare ("SELECT MIN (date) FROM history");
 
 		FavoritesLoader_ = QSqlQuery (DB_);
 		switch (Type_)
@@ -310,6 +439,32 @@ namespace Poshuku
 		HistoryLoader_.finish ();
 	}
 
+	std::function<history_items_t ()> SQLStorageBackend::GetConcurrentHistoryLoader () const
+	{
+		return [info = GetConnectionInfo (DB_, Type_)]
+		{
+			history_items_t items;
+			WithConnection (info, "org.LeechCraft.Poshuku.HistoryLoader",
+					[&items] (QSqlDatabase& db)
+					{
+						QSqlQuery query { db };
+						if (!query.exec (HistoryLoaderQuery))
+						{
+							Util::DBLock::DumpError (query);
+							return;
+						}
+
+						while (query.next ())
+							items.push_back ({
+									query.value (0).toString (),
+									query.value (1).toDateTime (),
+									query.value (2).toString ()
+								});
+					});
+			return items;
+		};
+	}
+
 	void SQLStorageBackend::LoadResemblingHistory (const QString& base,
 			history_items_t& items) const
 	{
@@ -337,6 +492,48 @@ namespace Poshuku
 		HistoryRatedLoader_.finish ();
 	}
 
+	void SQLStorageBackend::LoadHistorySection (const QDateTime& from,
+			const QDateTime& to, history_items_t& items) const
+	{
+		HistorySectionLoader_.bindValue (":from",
+				from.isValid () ? from : QDateTime::fromMSecsSinceEpoch (0));
+		HistorySectionLoader_.bindValue (":to",
+				to.isValid () ? to : QDateTime::currentDateTime ().addYears (100));
+		if (!HistorySectionLoader_.exec ())
+		{
+			LeechCraft::Util::DBLock::DumpError (HistorySectionLoader_);
+			return;
+		}
+
+		while (HistorySectionLoader_.next ())
+		{
+			HistoryItem item =
+			{
+				HistorySectionLoader_.value (0).toString (),
+				HistorySectionLoader_.value (1).toDateTime (),
+				HistorySectionLoader_.value (2).toString ()
+			};
+			items.push_back (item);
+		}
+
+		HistorySectionLoader_.finish ();
+	}
+
+	QDateTime SQLStorageBackend::GetOldestHistoryDate () const
+	{
+		if (!HistoryOldestDateGetter_.exec ())
+		{
+			LeechCraft::Util::DBLock::DumpError (HistoryOldestDateGetter_);
+			return {};
+		}
+
+		QDateTime result;
+		if (HistoryOldestDateGetter_.next ())
+			result = HistoryOldestDateGetter_.value (0).toDateTime ();
+		HistoryOldestDateGetter_.finish ();
+		return result;
+	}
+
 	void SQLStorageBackend::AddToHistory (const HistoryItem& item)
 	{
 		HistoryAdder_.bindValue (":title", item.Title_);
@@ -354,23 +551,28 @@ namespace Poshuku
 
 	void SQLStorageBackend::ClearOldHistory (int age, int items)
 	{
-		LeechCraft::Util::DBLock lock (DB_);
-		lock.Init ();
-		HistoryEraser_.bindValue (":age", age);
-		HistoryTruncater_.bindValue (":num", items);
-
-		if (!HistoryEraser_.exec ())
-		{
-			LeechCraft::Util::DBLock::DumpError (HistoryEraser_);
+		// The cleanup may take a while on big histories, so it is done
+		// in background over a separate connection to the same database,
+		// one cleanup at a time.
+		if (CleanupRunning_)
 			return;
-		}
-		if (!HistoryTruncater_.exec ())
-		{
-			LeechCraft::Util::DBLock::DumpError (HistoryTruncater_);
-			return;
-		}
 
-		lock.Good ();
+		CleanupRunning_ = true;
+
+		Util::Sequence (this,
+				QtConcurrent::run ([type = Type_, info = GetConnectionInfo (DB_, Type_), age, items]
+					{
+						history_items_t removed;
+						WithConnection (info, "org.LeechCraft.Poshuku.Cleanup",
+								[&] (QSqlDatabase& db) { removed = RunHistoryCleanup (db, type, age, items); });
+						return removed;
+					})) >>
+				[this] (const history_items_t& removed)
+				{
+					CleanupRunning_ = false;
+					if (!removed.isEmpty ())
+						emit historyCleared (removed);
+				};
 	}
 
 	void SQLStorageBackend::LoadFavorites (
@@ -499,6 +701,10 @@ namespace Poshuku
 				LeechCraft::Util::DBLock::DumpError (query);
 		}
 
+		if (!query.exec ("CREATE INDEX IF NOT EXISTS idx_history_url_date "
+					"ON history (url, date)"))
+			LeechCraft::Util::DBLock::DumpError (query);
+
 		if (!DB_.tables ().contains ("favorites"))
 		{
 			if (!query.exec ("CREATE TABLE favorites ("
@@ -47,6 +47,8 @@ namespace Poshuku
 		QSqlDatabase DB_;
 		const Util::DefaultScopeGuard DBGuard_;
 
+		bool CleanupRunning_ = false;
+
 				/** Returns:
 					* - title
 					* - date
@@ -63,19 +65,25 @@ namespace Poshuku
 					*/
 				HistoryRatedLoader_,
 				/** Binds:
-					* - date
+					* - from
+					* - to
+					*
+					* Returns:
 					* - title
+					* - date
 					* - url
 					*/
-				HistoryAdder_,
-				/** Binds:
-					* - age
+				HistorySectionLoader_,
+				/** Returns:
+					* - date
 					*/
-				HistoryEraser_,
+				HistoryOldestDateGetter_,
 				/** Binds:
-					* - items
+					* - date
+					* - title
+					* - url
 					*/
-				HistoryTruncater_,
+				HistoryAdder_,
 				/** Returns:
 					* - title
 					* - url
@@ -119,6 +127,10 @@ namespace Poshuku
 		virtual void LoadHistory (history_items_t&) const;
 		virtual void LoadResemblingHistory (const QString&,
 				history_items_t&) const;
+		std::function<history_items_t ()> GetConcurrentHistoryLoader () const override;
+		virtual void LoadHistorySection (const QDateTime&, const QDateTime&,
+				history_items_t&) const;
+		virtual QDateTime GetOldestHistoryDate () const;
 		virtual void AddToHistory (const HistoryItem&);
 		virtual void ClearOldHistory (int, int);
 		virtual void LoadFavorites (FavoritesModel::items_t&) const;
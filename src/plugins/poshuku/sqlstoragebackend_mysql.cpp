@@ -97,6 +97,22 @@ namespace Poshuku
 				"ORDER BY rating ASC "
 				"LIMIT 100");
 
+		HistorySectionLoader_ = QSqlQuery (DB_);
+		HistorySectionLoader_.prepare ("SELECT "
+				"title, "
+				"date, "
+				"url "
+				"FROM history AS h "
+				"WHERE date >= ? "
+				"AND date < ? "
+				"AND NOT EXISTS "
+				"	(SELECT 1 FROM history AS later "
+				"	WHERE later.url = h.url AND later.date > h.date) "
+				"ORDER BY date DESC");
+
+		HistoryOldestDateGetter_ = QSqlQuery (DB_);
+		HistoryOldestDateGetter_.prepare ("SELECT MIN(date) FROM history");
+
 		HistoryAdder_ = QSqlQuery (DB_);
 		HistoryAdder_.prepare ("INSERT INTO history ("
 				"date, "
@@ -108,16 +124,24 @@ namespace Poshuku
 				"? "
 				")");
 
+		const QString eraserCondition = "WHERE "
+				" DATE_ADD(date, INTERVAL ? DAY) < now ()";
+
+		HistoryEraserSelector_ = QSqlQuery (DB_);
+		HistoryEraserSelector_.prepare ("SELECT title, date, url FROM history " + eraserCondition);
+
 		HistoryEraser_ = QSqlQuery (DB_);
-		HistoryEraser_.prepare ("DELETE FROM history "
-				"WHERE "
-				" DATE_ADD(date, INTERVAL ? DAY) < now () )");
+		HistoryEraser_.prepare ("DELETE FROM history " + eraserCondition);
 
-		HistoryTruncater_ = QSqlQuery (DB_);
-		HistoryTruncater_.prepare ("DELETE FROM history "
-				"WHERE date IN "
+		const QString truncaterCondition = "WHERE date IN "
 				"(SELECT date FROM history ORDER BY date DESC "
-				"LIMIT 10000 OFFSET ?)");
+				"LIMIT 10000 OFFSET ?)";
+
+		HistoryTruncaterSelector_ = QSqlQuery (DB_);
+		HistoryTruncaterSelector_.prepare ("SELECT title, date, url FROM history " + truncaterCondition);
+
+		HistoryTruncater_ = QSqlQuery (DB_);
+		HistoryTruncater_.prepare ("DELETE FROM history " + truncaterCondition);
 
 		FavoritesLoader_ = QSqlQuery (DB_);
 		FavoritesLoader_.prepare ("SELECT "
@@ -214,6 +238,48 @@ namespace Poshuku
 		HistoryRatedLoader_.finish ();
 	}
 
+	void SQLStorageBackendMysql::LoadHistorySection (const QDateTime& from,
+			const QDateTime& to, history_items_t& items) const
+	{
+		HistorySectionLoader_.bindValue (0,
+				from.isValid () ? from : QDateTime::fromMSecsSinceEpoch (0));
+		HistorySectionLoader_.bindValue (1,
+				to.isValid () ? to : QDateTime::currentDateTime ().addYears (100));
+		if (!HistorySectionLoader_.exec ())
+		{
+			LeechCraft::Util::DBLock::DumpError (HistorySectionLoader_);
+			return;
+		}
+
+		while (HistorySectionLoader_.next ())
+		{
+			HistoryItem item =
+			{
+				HistorySectionLoader_.value (0).toString (),
+				HistorySectionLoader_.value (1).toDateTime (),
+				HistorySectionLoader_.value (2).toString ()
+			};
+			items.push_back (item);
+		}
+
+		HistorySectionLoader_.finish ();
+	}
+
+	QDateTime SQLStorageBackendMysql::GetOldestHistoryDate () const
+	{
+		if (!HistoryOldestDateGetter_.exec ())
+		{
+			LeechCraft::Util::DBLock::DumpError (HistoryOldestDateGetter_);
+			return {};
+		}
+
+		QDateTime result;
+		if (HistoryOldestDateGetter_.next ())
+			result = HistoryOldestDateGetter_.value (0).toDateTime ();
+		HistoryOldestDateGetter_.finish ();
+		return result;
+	}
+
 	void SQLStorageBackendMysql::AddToHistory (const HistoryItem& item)
 	{
 		HistoryAdder_.bindValue (0, item.Title_);
@@ -229,25 +295,51 @@ namespace Poshuku
 		emit added (item);
 	}
 
+	namespace
+	{
+		bool RemoveHistoryItems (QSqlQuery& selector, QSqlQuery& eraser,
+				const QVariant& value, history_items_t& removed)
+		{
+			selector.bindValue (0, value);
+			if (!selector.exec ())
+			{
+				LeechCraft::Util::DBLock::DumpError (selector);
+				return false;
+			}
+
+			while (selector.next ())
+				removed.push_back ({
+						selector.value (0).toString (),
+						selector.value (1).toDateTime (),
+						selector.value (2).toString ()
+					});
+			selector.finish ();
+
+			eraser.bindValue (0, value);
+			if (!eraser.exec ())
+			{
+				LeechCraft::Util::DBLock::DumpError (eraser);
+				return false;
+			}
+
+			return true;
+		}
+	}
+
 	void SQLStorageBackendMysql::ClearOldHistory (int age, int items)
 	{
 		LeechCraft::Util::DBLock lock (DB_);
 		lock.Init ();
-		HistoryEraser_.bindValue (0, age);
-		HistoryTruncater_.bindValue (1, items);
 
-		if (!HistoryEraser_.exec ())
-		{
-			LeechCraft::Util::DBLock::DumpError (HistoryEraser_);
-			return;
-		}
-		if (!HistoryTruncater_.exec ())
-		{
-			LeechCraft::Util::DBLock::DumpError (HistoryTruncater_);
+		history_items_t removed;
+		if (!RemoveHistoryItems (HistoryEraserSelector_, HistoryEraser_, age, removed) ||
+				!RemoveHistoryItems (HistoryTruncaterSelector_, HistoryTruncater_, items, removed))
 			return;
-		}
 
 		lock.Good ();
+
+		if (!removed.isEmpty ())
+			emit historyCleared (removed);
 	}
 
 	void SQLStorageBackendMysql::LoadFavorites (
@@ -59,16 +59,48 @@ namespace Poshuku
 					* - url
 					*/
 				HistoryRatedLoader_,
+				/** Binds:
+					* - from
+					* - to
+					*
+					* Returns:
+					* - title
+					* - date
+					* - url
+					*/
+				HistorySectionLoader_,
+				/** Returns:
+					* - date
+					*/
+				HistoryOldestDateGetter_,
 				/** Binds:
 					* - date
 					* - title
 					* - url
 					*/
 				HistoryAdder_,
+				/** Binds:
+					* - age
+					*
+					* Returns:
+					* - title
+					* - date
+					* - url
+					*/
+				HistoryEraserSelector_,
 				/** Binds:
 					* - age
 					*/
 				HistoryEraser_,
+				/** Binds:
+					* - items
+					*
+					* Returns:
+					* - title
+					* - date
+					* - url
+					*/
+				HistoryTruncaterSelector_,
 				/** Binds:
 					* - items
 					*/
@@ -116,6 +148,9 @@ namespace Poshuku
 		virtual void LoadHistory (history_items_t&) const;
 		virtual void LoadResemblingHistory (const QString&,
 				history_items_t&) const;
+		virtual void LoadHistorySection (const QDateTime&, const QDateTime&,
+				history_items_t&) const;
+		virtual QDateTime GetOldestHistoryDate () const;
 		virtual void AddToHistory (const HistoryItem&);
 		virtual void ClearOldHistory (int, int);
 		virtual void LoadFavorites (FavoritesModel::items_t&) const;
@@ -52,6 +52,13 @@ namespace Poshuku
 		Util::Unreachable ();
 	}
 
+	std::function<history_items_t ()> StorageBackend::GetConcurrentHistoryLoader () const
+	{
+		history_items_t items;
+		LoadHistory (items);
+		return [items] { return items; };
+	}
+
 	std::shared_ptr<StorageBackend> StorageBackend::Create ()
 	{
 		StorageBackend::Type type;
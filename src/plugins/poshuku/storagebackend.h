@@ -30,6 +30,7 @@
 #ifndef PLUGINS_POSHUKU_STORAGEBACKEND_H
 #define PLUGINS_POSHUKU_STORAGEBACKEND_H
 #include <memory>
+#include <functional>
 #include <QObject>
 #include "interfaces/poshuku/poshukutypes.h"
 #include "interfaces/poshuku/istoragebackend.h"
@@ -85,6 +86,41 @@ namespace Poshuku
 		virtual void LoadResemblingHistory (const QString& base,
 				history_items_t& items) const = 0;
 
+		/** @brief Returns a function loading all the history items.
+			*
+			* Unlike LoadHistory(), the returned function may be called
+			* from any thread, so that the history could be loaded in
+			* background. The default implementation loads the history
+			* right away in the calling thread.
+			*
+			* @return The function returning all the history items sorted
+			* by date in descending order.
+			*/
+		virtual std::function<history_items_t ()> GetConcurrentHistoryLoader () const;
+
+		/** @brief Get history items last visited in the given period.
+			*
+			* Puts the history items (HistoryItem) whose most recent visit
+			* happened in the [from; to) period into the passed container,
+			* one item per URL, sorted by date in descending order. Invalid
+			* from or to mean the period is unbounded from the
+			* corresponding side.
+			*
+			* @param[in] from The beginning of the period.
+			* @param[in] to The end of the period (not inclusive).
+			* @param[out] items The container with items. They would be
+			* appended to the container.
+			*/
+		virtual void LoadHistorySection (const QDateTime& from,
+				const QDateTime& to, history_items_t& items) const = 0;
+
+		/** @brief Returns the date of the oldest history item.
+			*
+			* @return The date of the oldest item, or an invalid date if
+			* the history is empty.
+			*/
+		virtual QDateTime GetOldestHistoryDate () const = 0;
+
 		/** @brief Add an item to history.
 			*
 			* Adds the passed item to the storage and emits the added() signal
@@ -99,6 +135,11 @@ namespace Poshuku
 			* Removes all the history items that are older than days. Also
 			* removes items that are overlimit.
 			*
+			* The backend may perform the removal asynchronously, using a
+			* separate connection in a background thread. Either way, the
+			* historyCleared() signal is emitted once it is done, unless
+			* nothing has been removed.
+			*
 			* @param[in] days Maximum age of an item.
 			* @param[in] items How much items should be kept at most.
 			*/
@@ -160,6 +201,12 @@ namespace Poshuku
 		void added (const FavoritesModel::FavoritesItem&);
 		void updated (const FavoritesModel::FavoritesItem&);
 		void removed (const FavoritesModel::FavoritesItem&);
+
+		/** @brief Emitted after ClearOldHistory() has removed some items.
+			*
+			* @param[in] removed The history items that have been removed.
+			*/
+		void historyCleared (const history_items_t& removed);
 	};
 }
 }
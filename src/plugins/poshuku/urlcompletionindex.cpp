@@ -0,0 +1,255 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "urlcompletionindex.h"
+#include <algorithm>
+#include <cmath>
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+	namespace
+	{
+		/* A visit's weight halves each HalfLife seconds. Since the decay
+		 * is exponential, the relative order of the scores doesn't depend
+		 * on the current time, so they can be accumulated once and never
+		 * recalculated. The scores are kept in log-space to avoid
+		 * overflows.
+		 */
+		const double HalfLife = 14 * 24 * 3600;
+
+		double GetVisitScore (const QDateTime& dt)
+		{
+			return dt.toMSecsSinceEpoch () / 1000. / HalfLife * std::log (2.);
+		}
+
+		double AddScores (double s1, double s2)
+		{
+			const auto max = std::max (s1, s2);
+			return max + std::log1p (std::exp (std::min (s1, s2) - max));
+		}
+
+		double SubtractScore (double total, double s)
+		{
+			// rounding errors may make the only remaining visits' score
+			// look like nothing, keep the total then
+			return s < total ?
+					total + std::log1p (-std::exp (s - total)) :
+					total;
+		}
+
+		quint64 GetTrigram (const QChar *chars)
+		{
+			return (static_cast<quint64> (chars [0].unicode ()) << 32) |
+					(static_cast<quint64> (chars [1].unicode ()) << 16) |
+					chars [2].unicode ();
+		}
+
+		QString MakeHaystack (const QString& title, const QString& url)
+		{
+			return (title + '\n' + url).toCaseFolded ();
+		}
+	}
+
+	void URLCompletionIndex::Reset (const history_items_t& items)
+	{
+		QWriteLocker locker { &Lock_ };
+
+		Entries_.clear ();
+		URL2Entry_.clear ();
+		Trigrams_.clear ();
+		RemovedEntries_ = 0;
+
+		for (const auto& item : items)
+			AddUnlocked (item);
+	}
+
+	void URLCompletionIndex::Add (const HistoryItem& item)
+	{
+		QWriteLocker locker { &Lock_ };
+		AddUnlocked (item);
+	}
+
+	void URLCompletionIndex::Remove (const history_items_t& items)
+	{
+		QWriteLocker locker { &Lock_ };
+
+		for (const auto& item : items)
+		{
+			const auto pos = URL2Entry_.find (item.URL_);
+			if (pos == URL2Entry_.end ())
+				continue;
+
+			auto& entry = Entries_ [*pos];
+			if (--entry.Visits_ > 0)
+			{
+				entry.Score_ = SubtractScore (entry.Score_, GetVisitScore (item.DateTime_));
+				continue;
+			}
+
+			URL2Entry_.erase (pos);
+			entry = { {}, {}, {}, {}, 0, 0 };
+			++RemovedEntries_;
+		}
+
+		if (RemovedEntries_ > Entries_.size () / 2)
+			Compact ();
+	}
+
+	history_items_t URLCompletionIndex::Find (const QString& base,
+			int limit, const IsCancelled_f& isCancelled) const
+	{
+		const auto& needle = base.toCaseFolded ();
+
+		QReadLocker locker { &Lock_ };
+
+		QVector<int> candidates;
+		if (needle.size () >= 3)
+		{
+			const QVector<int> *smallest = nullptr;
+			for (int i = 0; i <= needle.size () - 3; ++i)
+			{
+				const auto pos = Trigrams_.find (GetTrigram (needle.constData () + i));
+				if (pos == Trigrams_.end ())
+					return {};
+
+				if (!smallest || pos->size () < smallest->size ())
+					smallest = &*pos;
+			}
+			candidates = *smallest;
+		}
+		else
+		{
+			candidates.reserve (Entries_.size ());
+			for (int i = 0; i < Entries_.size (); ++i)
+				candidates << i;
+		}
+
+		QVector<int> matching;
+		for (int i = 0; i < candidates.size (); ++i)
+		{
+			if (!(i % 1024) && isCancelled ())
+				return {};
+
+			const auto idx = candidates.at (i);
+			const auto& entry = Entries_.at (idx);
+			if (entry.Visits_ && entry.Haystack_.contains (needle))
+				matching << idx;
+		}
+
+		// An entry may be listed several times for a trigram if its
+		// title has changed since it's been indexed.
+		std::sort (matching.begin (), matching.end ());
+		matching.erase (std::unique (matching.begin (), matching.end ()), matching.end ());
+
+		const auto resultSize = std::min (limit, matching.size ());
+		std::partial_sort (matching.begin (), matching.begin () + resultSize, matching.end (),
+				[this] (int left, int right)
+					{ return Entries_.at (left).Score_ > Entries_.at (right).Score_; });
+
+		history_items_t result;
+		result.reserve (resultSize);
+		for (int i = 0; i < resultSize; ++i)
+		{
+			const auto& entry = Entries_.at (matching.at (i));
+			result.push_back ({ entry.Title_, entry.LastVisit_, entry.URL_ });
+		}
+		return result;
+	}
+
+	void URLCompletionIndex::AddUnlocked (const HistoryItem& item)
+	{
+		const auto visitScore = GetVisitScore (item.DateTime_);
+
+		const auto pos = URL2Entry_.find (item.URL_);
+		if (pos == URL2Entry_.end ())
+		{
+			const auto idx = Entries_.size ();
+			Entries_.append ({
+					item.URL_,
+					item.Title_,
+					MakeHaystack (item.Title_, item.URL_),
+					item.DateTime_,
+					visitScore,
+					1
+				});
+			URL2Entry_ [item.URL_] = idx;
+			IndexHaystack (idx);
+			return;
+		}
+
+		auto& entry = Entries_ [*pos];
+		entry.Score_ = AddScores (entry.Score_, visitScore);
+		++entry.Visits_;
+		if (item.DateTime_ < entry.LastVisit_)
+			return;
+
+		entry.LastVisit_ = item.DateTime_;
+		if (!item.Title_.isEmpty () && item.Title_ != entry.Title_)
+		{
+			entry.Title_ = item.Title_;
+			entry.Haystack_ = MakeHaystack (item.Title_, item.URL_);
+			IndexHaystack (*pos);
+		}
+	}
+
+	void URLCompletionIndex::Compact ()
+	{
+		const auto entries = Entries_;
+
+		Entries_.clear ();
+		URL2Entry_.clear ();
+		Trigrams_.clear ();
+		RemovedEntries_ = 0;
+
+		for (const auto& entry : entries)
+		{
+			if (!entry.Visits_)
+				continue;
+
+			const auto idx = Entries_.size ();
+			Entries_.append (entry);
+			URL2Entry_ [entry.URL_] = idx;
+			IndexHaystack (idx);
+		}
+	}
+
+	void URLCompletionIndex::IndexHaystack (int idx)
+	{
+		const auto& haystack = Entries_.at (idx).Haystack_;
+		for (int i = 0; i <= haystack.size () - 3; ++i)
+		{
+			auto& list = Trigrams_ [GetTrigram (haystack.constData () + i)];
+			if (list.isEmpty () || list.last () != idx)
+				list << idx;
+		}
+	}
+}
+}
@@ -0,0 +1,96 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QVector>
+#include <interfaces/poshuku/poshukutypes.h>
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+	/** In-memory index of the visited URLs used for the address bar
+	 * completion.
+	 *
+	 * The history is deduplicated by URL, and each URL gets a frecency
+	 * score accumulated over all its visits. Substring lookups are
+	 * narrowed down by a trigram index over case-folded titles and URLs.
+	 *
+	 * All public methods are thread-safe, so lookups can be run in
+	 * background while new visits are being added from the GUI thread.
+	 */
+	class URLCompletionIndex
+	{
+		struct Entry
+		{
+			QString URL_;
+			QString Title_;
+			QString Haystack_;
+			QDateTime LastVisit_;
+			double Score_;
+			int Visits_;
+		};
+
+		mutable QReadWriteLock Lock_;
+
+		/** Entries whose visits have all been removed stay here with no
+		 * visits until the next compaction, so that the indices in
+		 * Trigrams_ stay valid.
+		 */
+		QVector<Entry> Entries_;
+		int RemovedEntries_ = 0;
+		QHash<QString, int> URL2Entry_;
+		QHash<quint64, QVector<int>> Trigrams_;
+	public:
+		using IsCancelled_f = std::function<bool ()>;
+
+		void Reset (const history_items_t&);
+		void Add (const HistoryItem&);
+
+		/** Forgets the given visits, dropping the URLs that have no
+		 * visits left.
+		 */
+		void Remove (const history_items_t&);
+
+		/** Returns at most \em limit items resembling \em base, sorted by
+		 * their frecency. Returns an empty list as soon as
+		 * \em isCancelled returns true.
+		 */
+		history_items_t Find (const QString& base, int limit, const IsCancelled_f& isCancelled) const;
+	private:
+		void AddUnlocked (const HistoryItem&);
+		void IndexHaystack (int);
+		void Compact ();
+	};
+}
+}
@@ -32,10 +32,13 @@
 #include <QUrl>
 #include <QTimer>
 #include <QApplication>
+#include <QtConcurrentRun>
 #include <QtDebug>
 #include <util/xpc/defaulthookproxy.h>
+#include <util/threads/futures.h>
 #include <interfaces/core/icoreproxy.h>
 #include "core.h"
+#include "urlcompletionindex.h"
 
 namespace LeechCraft
 {
@@ -44,6 +47,8 @@ namespace Poshuku
 	URLCompletionModel::URLCompletionModel (QObject *parent)
 	: QAbstractItemModel { parent }
 	, ValidateTimer_ { new QTimer { this } }
+	, Index_ { std::make_shared<URLCompletionIndex> () }
+	, QueryGeneration_ { std::make_shared<std::atomic_int> (0) }
 	{
 		ValidateTimer_->setSingleShot (true);
 		connect (ValidateTimer_,
@@ -123,19 +128,95 @@ namespace Poshuku
 		endInsertRows ();
 	}
 
+	void URLCompletionModel::HandleStorageReady ()
+	{
+		RebuildIndex ();
+	}
+
+	void URLCompletionModel::RebuildIndex ()
+	{
+		IndexReady_ = false;
+
+		const auto& loader = Core::Instance ().GetStorageBackend ()->GetConcurrentHistoryLoader ();
+		Util::Sequence (this, QtConcurrent::run ([index = Index_, loader] { index->Reset (loader ()); })) >>
+				[this]
+				{
+					for (const auto& item : PendingIndexItems_)
+						Index_->Add (item);
+					PendingIndexItems_.clear ();
+
+					if (!PendingIndexRemovals_.isEmpty ())
+					{
+						Index_->Remove (PendingIndexRemovals_);
+						PendingIndexRemovals_.clear ();
+					}
+
+					IndexReady_ = true;
+				};
+	}
+
 	void URLCompletionModel::setBase (const QString& str)
 	{
 		Valid_ = false;
 		Base_ = str;
 
+		++*QueryGeneration_;
+
 		ValidateTimer_->stop ();
 		ValidateTimer_->start ();
 	}
 
 	void URLCompletionModel::validate ()
 	{
+		if (IndexReady_ && !Base_.startsWith ('!'))
+		{
+			RequestIndexed ();
+			return;
+		}
+
 		PopulateNonHook ();
+		RunHooks ();
+	}
+
+	void URLCompletionModel::RequestIndexed ()
+	{
+		const auto generation = ++*QueryGeneration_;
+		const auto isCancelled = [current = QueryGeneration_, generation]
+				{ return *current != generation; };
 
+		Util::Sequence (this,
+				QtConcurrent::run ([index = Index_, base = Base_, isCancelled]
+						{ return index->Find (base, 100, isCancelled); })) >>
+				[this, isCancelled] (const history_items_t& items)
+				{
+					if (isCancelled ())
+						return;
+
+					Valid_ = true;
+					SetItems (items);
+					RunHooks ();
+				};
+	}
+
+	void URLCompletionModel::SetItems (const history_items_t& items)
+	{
+		if (!Items_.isEmpty ())
+		{
+			beginRemoveRows ({}, 0, Items_.size () - 1);
+			Items_.clear ();
+			endRemoveRows ();
+		}
+
+		if (!items.isEmpty ())
+		{
+			beginInsertRows ({}, 0, items.size () - 1);
+			Items_ = items;
+			endInsertRows ();
+		}
+	}
+
+	void URLCompletionModel::RunHooks ()
+	{
 		Util::DefaultHookProxy_ptr proxy (new Util::DefaultHookProxy);
 		int size = Items_.size ();
 		emit hookURLCompletionNewStringRequested (proxy, this, Base_, size);
@@ -154,9 +235,28 @@ namespace Poshuku
 		}
 	}
 
-	void URLCompletionModel::handleItemAdded (const HistoryItem&)
+	void URLCompletionModel::handleItemAdded (const HistoryItem& item)
 	{
 		Valid_ = false;
+
+		if (IndexReady_)
+			Index_->Add (item);
+		else
+			PendingIndexItems_ << item;
+	}
+
+	void URLCompletionModel::handleHistoryCleared (const history_items_t& removed)
+	{
+		Valid_ = false;
+
+		if (!IndexReady_)
+		{
+			PendingIndexRemovals_ += removed;
+			return;
+		}
+
+		// compacting the index after big cleanups may take a while
+		QtConcurrent::run ([index = Index_, removed] { index->Remove (removed); });
 	}
 
 	void URLCompletionModel::PopulateNonHook ()
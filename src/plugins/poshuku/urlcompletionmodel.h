@@ -29,6 +29,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <QAbstractItemModel>
 #include <interfaces/core/ihookproxy.h>
 #include <interfaces/poshuku/iurlcompletionmodel.h>
@@ -40,6 +42,8 @@ namespace LeechCraft
 {
 namespace Poshuku
 {
+	class URLCompletionIndex;
+
 	class URLCompletionModel : public QAbstractItemModel
 							 , public IURLCompletionModel
 	{
@@ -52,6 +56,13 @@ namespace Poshuku
 		QString Base_;
 
 		QTimer * const ValidateTimer_;
+
+		const std::shared_ptr<URLCompletionIndex> Index_;
+		bool IndexReady_ = false;
+		history_items_t PendingIndexItems_;
+		history_items_t PendingIndexRemovals_;
+
+		const std::shared_ptr<std::atomic_int> QueryGeneration_;
 	public:
 		enum
 		{
@@ -70,13 +81,20 @@ namespace Poshuku
 		virtual int rowCount (const QModelIndex& = QModelIndex ()) const;
 
 		void AddItem (const QString& title, const QString& url, size_t pos);
+
+		void HandleStorageReady ();
 	private:
 		void PopulateNonHook ();
+		void RebuildIndex ();
+		void RequestIndexed ();
+		void SetItems (const history_items_t&);
+		void RunHooks ();
 	private slots:
 		void validate ();
 	public slots:
 		void setBase (const QString&);
 		void handleItemAdded (const HistoryItem&);
+		void handleHistoryCleared (const history_items_t&);
 	signals:
 		// Plugin API
 		void hookURLCompletionNewStringRequested (LeechCraft::IHookProxy_ptr proxy,
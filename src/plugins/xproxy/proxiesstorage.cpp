@@ -30,19 +30,45 @@
 #include "proxiesstorage.h"
 #include <QSettings>
 #include <QCoreApplication>
+#include <QMutexLocker>
 #include <util/sll/qtutil.h>
 #include <util/sll/prelude.h>
 #include "urllistscript.h"
 #include "scriptsmanager.h"
+#include "rulesmatcher.h"
 
 namespace LeechCraft
 {
 namespace XProxy
 {
+	bool operator== (const DecisionKey& left, const DecisionKey& right)
+	{
+		return left.Port_ == right.Port_ &&
+				left.Host_ == right.Host_ &&
+				left.Proto_ == right.Proto_;
+	}
+
+	uint qHash (const DecisionKey& key)
+	{
+		return qHash (key.Host_) ^ qHash (key.Proto_) ^ key.Port_;
+	}
+
+	namespace
+	{
+		const int DecisionsCacheSize = 1024;
+	}
+
 	ProxiesStorage::ProxiesStorage (const ScriptsManager *manager, QObject *parent)
 	: QObject { parent }
 	, ScriptsMgr_ { manager }
+	, Matcher_ { std::make_shared<RulesMatcher> () }
+	, Decisions_ { DecisionsCacheSize }
 	{
+		for (const auto script : ScriptsMgr_->GetScripts ())
+			connect (script,
+					&UrlListScript::urlsChanged,
+					this,
+					[this] { InvalidateMatching (); });
 	}
 
 	QList<Proxy> ProxiesStorage::GetKnownProxies () const
@@ -65,29 +91,18 @@ namespace XProxy
 				reqPort = pos->second;
 		}
 
-		QList<Proxy> result;
-		for (const auto& pair : Proxies_)
-		{
-			if (result.contains (pair.first))
-				continue;
-
-			if (std::any_of (pair.second.begin (), pair.second.end (),
-					[&reqHost, reqPort, &proto] (const ReqTarget& target)
-					{
-						if (target.Port_ && reqPort > 0 && target.Port_ != reqPort)
-							return false;
+		const DecisionKey key { reqHost, reqPort, proto };
 
-						if (!target.Protocols_.isEmpty () && !target.Protocols_.contains (proto))
-							return false;
+		QMutexLocker locker { &MatchingLock_ };
+		if (const auto cached = Decisions_.object (key))
+			return *cached;
 
-						if (!target.Host_.Matches (reqHost))
-							return false;
+		const auto matcher = Matcher_;
+		const auto scripts = MatcherScripts_;
+		locker.unlock ();
 
-						return true;
-					}))
-				result << pair.first;
-		}
-		for (const auto& pair : Util::Stlize (Scripts_))
+		auto result = matcher->FindMatching (reqHost, reqPort, proto);
+		for (const auto& pair : Util::Stlize (scripts))
 		{
 			if (result.contains (pair.first))
 				continue;
@@ -97,6 +112,11 @@ namespace XProxy
 						{ return script->Accepts (reqHost, reqPort, proto); }))
 				result << pair.first;
 		}
+
+		locker.relock ();
+		if (matcher == Matcher_)
+			Decisions_.insert (key, new QList<Proxy> (result));
+
 		return result;
 	}
 
@@ -107,6 +127,7 @@ namespace XProxy
 					[this, &proxy] { Proxies_.append ({ proxy, {} }); },
 					[] (auto) {}
 				});
+		InvalidateMatching ();
 	}
 
 	void ProxiesStorage::UpdateProxy (const Proxy& oldProxy, const Proxy& newProxy)
@@ -128,12 +149,16 @@ namespace XProxy
 
 		const auto& oldScripts = Scripts_.take (oldProxy);
 		Scripts_ [newProxy] += oldScripts;
+
+		InvalidateMatching ();
 	}
 
 	void ProxiesStorage::RemoveProxy (const Proxy& proxy)
 	{
 		EraseFromProxiesList (proxy);
 		Scripts_.remove (proxy);
+
+		InvalidateMatching ();
 	}
 
 	QList<ReqTarget> ProxiesStorage::GetTargets (const Proxy& proxy) const
@@ -152,6 +177,7 @@ namespace XProxy
 					[this, &proxy, &targets] { Proxies_.append ({ proxy, targets }); },
 					[&targets] (auto it) { it->second = targets; }
 				});
+		InvalidateMatching ();
 	}
 
 	QList<UrlListScript*> ProxiesStorage::GetScripts (const Proxy& proxy) const
@@ -164,12 +190,16 @@ namespace XProxy
 		Scripts_ [proxy] = lists;
 		for (const auto script : lists)
 			script->SetEnabled (true);
+
+		InvalidateMatching ();
 	}
 
 	void ProxiesStorage::Swap (int row1, int row2)
 	{
 		using std::swap;
 		swap (Proxies_ [row1], Proxies_ [row2]);
+
+		InvalidateMatching ();
 	}
 
 	void ProxiesStorage::LoadSettings ()
@@ -199,6 +229,8 @@ namespace XProxy
 						<< entry.first;
 
 		settings.endGroup ();
+
+		InvalidateMatching ();
 	}
 
 	void ProxiesStorage::SaveSettings () const
@@ -221,6 +253,16 @@ namespace XProxy
 		settings.endGroup ();
 	}
 
+	void ProxiesStorage::InvalidateMatching ()
+	{
+		const auto matcher = std::make_shared<RulesMatcher> (Proxies_);
+
+		QMutexLocker locker { &MatchingLock_ };
+		Matcher_ = matcher;
+		MatcherScripts_ = Scripts_;
+		Decisions_.clear ();
+	}
+
 	void ProxiesStorage::EraseFromProxiesList (const Proxy& proxy)
 	{
 		DoOnProxiesList (proxy,
@@ -29,8 +29,11 @@
 
 #pragma once
 
+#include <memory>
 #include <QObject>
 #include <QMap>
+#include <QCache>
+#include <QMutex>
 #include <util/sll/eithercont.h>
 #include "structures.h"
 
@@ -40,6 +43,17 @@ namespace XProxy
 {
 	class UrlListScript;
 	class ScriptsManager;
+	class RulesMatcher;
+
+	struct DecisionKey
+	{
+		QString Host_;
+		int Port_;
+		QString Proto_;
+	};
+
+	bool operator== (const DecisionKey&, const DecisionKey&);
+	uint qHash (const DecisionKey&);
 
 	class ProxiesStorage : public QObject
 	{
@@ -47,6 +61,11 @@ namespace XProxy
 
 		QList<QPair<Proxy, QList<ReqTarget>>> Proxies_;
 		QMap<Proxy, QList<UrlListScript*>> Scripts_;
+
+		mutable QMutex MatchingLock_;
+		std::shared_ptr<const RulesMatcher> Matcher_;
+		QMap<Proxy, QList<UrlListScript*>> MatcherScripts_;
+		mutable QCache<DecisionKey, QList<Proxy>> Decisions_;
 	public:
 		ProxiesStorage (const ScriptsManager*, QObject* = nullptr);
 
@@ -70,6 +89,8 @@ namespace XProxy
 		void LoadSettings ();
 		void SaveSettings () const;
 	private:
+		void InvalidateMatching ();
+
 		void EraseFromProxiesList (const Proxy&);
 
 		template<typename R = void>
@@ -0,0 +1,320 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "rulesmatcher.h"
+#include <algorithm>
+#include <QRegExp>
+#include <QtDebug>
+
+namespace LeechCraft
+{
+namespace XProxy
+{
+	namespace
+	{
+		enum class PatternKind
+		{
+			Exact,
+			Subdomains,
+			DomainAndSubdomains,
+			Other
+		};
+
+		struct ParsedPattern
+		{
+			PatternKind Kind_;
+			QString Host_;
+		};
+
+		bool IsEscaped (const QString& str, int pos)
+		{
+			int backslashes = 0;
+			while (pos - backslashes > 0 && str.at (pos - backslashes - 1) == '\\')
+				++backslashes;
+			return backslashes % 2;
+		}
+
+		bool Unescape (const QString& str, QString& result)
+		{
+			static const QString Special { ".^$|?*+()[]{}" };
+
+			result.clear ();
+			result.reserve (str.size ());
+			for (int i = 0; i < str.size (); ++i)
+			{
+				const auto c = str.at (i);
+				if (c == '\\')
+				{
+					if (++i == str.size ())
+						return false;
+
+					const auto next = str.at (i);
+					if (next.isLetterOrNumber ())
+						return false;
+
+					result += next;
+				}
+				else if (Special.contains (c))
+					return false;
+				else
+					result += c;
+			}
+
+			return !result.isEmpty ();
+		}
+
+		ParsedPattern ParsePattern (QString body)
+		{
+			/* QRegExp-backed RegExp does an exact match, while the PCRE one
+			 * searches for the pattern anywhere in the string, so only
+			 * explicit anchors count in the latter case.
+			 */
+			const bool implicitAnchors = !Util::RegExp::IsFast ();
+			bool startAnchored = implicitAnchors;
+			bool endAnchored = implicitAnchors;
+
+			if (body.startsWith ('^'))
+			{
+				body.remove (0, 1);
+				startAnchored = true;
+			}
+			if (body.endsWith ('$') && !IsEscaped (body, body.size () - 1))
+			{
+				body.chop (1);
+				endAnchored = true;
+			}
+
+			if (!endAnchored)
+				return { PatternKind::Other, {} };
+
+			auto kind = PatternKind::Other;
+			if (body.startsWith (".*\\."))
+			{
+				kind = PatternKind::Subdomains;
+				body.remove (0, 4);
+			}
+			else if (!startAnchored && body.startsWith ("\\."))
+			{
+				kind = PatternKind::Subdomains;
+				body.remove (0, 2);
+			}
+			else if (body.startsWith ("(.*\\.)?"))
+			{
+				kind = PatternKind::DomainAndSubdomains;
+				body.remove (0, 7);
+			}
+			else if (body.startsWith ("(?:.*\\.)?"))
+			{
+				kind = PatternKind::DomainAndSubdomains;
+				body.remove (0, 9);
+			}
+			else if (startAnchored)
+				kind = PatternKind::Exact;
+
+			QString host;
+			if (kind == PatternKind::Other || !Unescape (body, host))
+				return { PatternKind::Other, {} };
+
+			return { kind, host };
+		}
+
+		bool IsCombinable (const QString& pattern)
+		{
+			static const QRegExp backref { "\\\\[1-9]" };
+			return !pattern.isEmpty () && !pattern.contains (backref);
+		}
+	}
+
+	RulesMatcher::RulesMatcher (const Rules_t& rules)
+	{
+		SuffixNodes_.emplace_back ();
+
+		QStringList combinable;
+		QStringList combinableCS;
+		for (const auto& pair : rules)
+		{
+			const auto proxyIdx = Proxies_.size ();
+			Proxies_ << pair.first;
+
+			for (const auto& target : pair.second)
+				AddTarget (target, proxyIdx, combinable, combinableCS);
+		}
+
+		for (const auto& pair : { qMakePair (combinable, Qt::CaseInsensitive), qMakePair (combinableCS, Qt::CaseSensitive) })
+		{
+			if (pair.first.isEmpty ())
+				continue;
+
+			const Util::RegExp rx { pair.first.join ('|'), pair.second };
+			if (rx.IsValid ())
+				Combined_ << rx;
+			else
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to combine"
+						<< pair.first.size ()
+						<< "patterns, falling back to matching them one by one";
+				HasUncombinable_ = true;
+			}
+		}
+	}
+
+	QList<Proxy> RulesMatcher::FindMatching (const QString& reqHost, int reqPort, const QString& proto) const
+	{
+		if (Proxies_.isEmpty ())
+			return {};
+
+		std::vector<bool> matched (Proxies_.size ());
+
+		auto check = [&] (int targetIdx, auto verify)
+		{
+			const auto& target = Targets_.at (targetIdx);
+			if (matched [target.ProxyIdx_])
+				return;
+
+			if (target.Port_ && reqPort > 0 && target.Port_ != reqPort)
+				return;
+
+			if (!target.Protocols_.isEmpty () && !target.Protocols_.contains (proto))
+				return;
+
+			if (verify (target))
+				matched [target.ProxyIdx_] = true;
+		};
+
+		const auto& host = reqHost.toLower ();
+
+		const auto exactPos = ExactHosts_.find (host);
+		if (exactPos != ExactHosts_.end ())
+			for (const auto targetIdx : *exactPos)
+				check (targetIdx,
+						[&reqHost] (const Target& target)
+							{ return target.Verify_.isEmpty () || reqHost == target.Verify_; });
+
+		const auto& labels = host.splitRef ('.');
+		int node = 0;
+		for (int i = labels.size () - 1; i > 0; --i)
+		{
+			node = SuffixNodes_ [node].Children_.value (labels.at (i).toString (), -1);
+			if (node < 0)
+				break;
+
+			for (const auto targetIdx : SuffixNodes_ [node].Targets_)
+				check (targetIdx,
+						[&reqHost] (const Target& target)
+							{ return target.Verify_.isEmpty () || reqHost.endsWith ('.' + target.Verify_); });
+		}
+
+		if (!RegExpTargets_.isEmpty () &&
+				(HasUncombinable_ ||
+				 std::any_of (Combined_.begin (), Combined_.end (),
+						[&reqHost] (const Util::RegExp& rx) { return rx.Matches (reqHost); })))
+			for (const auto targetIdx : RegExpTargets_)
+				check (targetIdx,
+						[&reqHost] (const Target& target) { return target.Host_.Matches (reqHost); });
+
+		QList<Proxy> result;
+		for (int i = 0; i < Proxies_.size (); ++i)
+			if (matched [i])
+				result << Proxies_.at (i);
+		return result;
+	}
+
+	void RulesMatcher::AddTarget (const ReqTarget& reqTarget, int proxyIdx,
+			QStringList& combinable, QStringList& combinableCS)
+	{
+		const auto& pattern = reqTarget.Host_.GetPattern ();
+		if (!reqTarget.Host_.IsValid ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "skipping invalid pattern"
+					<< pattern;
+			return;
+		}
+
+		const auto targetIdx = Targets_.size ();
+		Targets_.push_back ({ proxyIdx, reqTarget.Port_, reqTarget.Protocols_, {}, reqTarget.Host_ });
+
+		const auto cs = reqTarget.Host_.GetCaseSensitivity ();
+		const auto& parsed = ParsePattern (pattern);
+		if (parsed.Kind_ == PatternKind::Other)
+		{
+			RegExpTargets_ << targetIdx;
+
+			if (!IsCombinable (pattern))
+				HasUncombinable_ = true;
+			else
+				(cs == Qt::CaseSensitive ? combinableCS : combinable) << "(?:" + pattern + ")";
+			return;
+		}
+
+		if (cs == Qt::CaseSensitive)
+			Targets_ [targetIdx].Verify_ = parsed.Host_;
+
+		const auto& key = parsed.Host_.toLower ();
+		switch (parsed.Kind_)
+		{
+		case PatternKind::Exact:
+			ExactHosts_ [key] << targetIdx;
+			break;
+		case PatternKind::DomainAndSubdomains:
+			ExactHosts_ [key] << targetIdx;
+			SuffixNodes_ [GetSuffixNode (key)].Targets_ << targetIdx;
+			break;
+		case PatternKind::Subdomains:
+			SuffixNodes_ [GetSuffixNode (key)].Targets_ << targetIdx;
+			break;
+		case PatternKind::Other:
+			break;
+		}
+	}
+
+	int RulesMatcher::GetSuffixNode (const QString& domain)
+	{
+		const auto& labels = domain.split ('.');
+
+		int node = 0;
+		for (auto i = labels.rbegin (), end = labels.rend (); i != end; ++i)
+		{
+			const auto child = SuffixNodes_ [node].Children_.value (*i, -1);
+			if (child >= 0)
+			{
+				node = child;
+				continue;
+			}
+
+			const int newNode = SuffixNodes_.size ();
+			SuffixNodes_.emplace_back ();
+			SuffixNodes_ [node].Children_ [*i] = newNode;
+			node = newNode;
+		}
+		return node;
+	}
+}
+}
@@ -0,0 +1,94 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <QHash>
+#include <QVector>
+#include "structures.h"
+
+namespace LeechCraft
+{
+namespace XProxy
+{
+	/** Compiled form of the host-based proxy rules.
+	 *
+	 * Host patterns that are plain host names go to a hash, patterns
+	 * matching a domain's subdomains go to a suffix trie over domain
+	 * labels, and the rest are prefiltered by a single regexp combining
+	 * all of them. The result is the same as matching each ReqTarget in
+	 * order.
+	 */
+	class RulesMatcher
+	{
+	public:
+		using Rules_t = QList<QPair<Proxy, QList<ReqTarget>>>;
+	private:
+		struct Target
+		{
+			int ProxyIdx_;
+			int Port_;
+			QStringList Protocols_;
+
+			/** For case-sensitive patterns: the exact host (or the
+			 * ".domain" suffix) the request host must have, since the
+			 * indices are case-insensitive.
+			 */
+			QString Verify_;
+
+			Util::RegExp Host_;
+		};
+
+		struct SuffixNode
+		{
+			QHash<QString, int> Children_;
+			QVector<int> Targets_;
+		};
+
+		QList<Proxy> Proxies_;
+		QVector<Target> Targets_;
+
+		QHash<QString, QVector<int>> ExactHosts_;
+		std::vector<SuffixNode> SuffixNodes_;
+
+		QVector<int> RegExpTargets_;
+		QList<Util::RegExp> Combined_;
+		bool HasUncombinable_ = false;
+	public:
+		RulesMatcher () = default;
+		explicit RulesMatcher (const Rules_t&);
+
+		QList<Proxy> FindMatching (const QString& reqHost, int reqPort, const QString& proto) const;
+	private:
+		void AddTarget (const ReqTarget&, int proxyIdx, QStringList& combinable, QStringList& combinableCS);
+		int GetSuffixNode (const QString& domain);
+	};
+}
+}
@@ -0,0 +1,241 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "rulesmatchertest.h"
+#include <algorithm>
+#include <QtTest>
+#include "../rulesmatcher.h"
+
+QTEST_MAIN (LeechCraft::XProxy::RulesMatcherTest)
+
+namespace LeechCraft
+{
+namespace XProxy
+{
+	namespace
+	{
+		Proxy MakeProxy (int port)
+		{
+			return { QNetworkProxy::HttpProxy, "proxy.local", port, {}, {} };
+		}
+
+		ReqTarget MakeTarget (const QString& pattern, int port = 0, const QStringList& protos = {},
+				Qt::CaseSensitivity cs = Qt::CaseInsensitive)
+		{
+			return { { pattern, cs }, port, protos };
+		}
+
+		QList<int> Ports (const QList<Proxy>& proxies)
+		{
+			QList<int> result;
+			for (const auto& proxy : proxies)
+				result << proxy.Port_;
+			return result;
+		}
+
+		QList<Proxy> FindLinear (const RulesMatcher::Rules_t& rules,
+				const QString& reqHost, int reqPort, const QString& proto)
+		{
+			QList<Proxy> result;
+			for (const auto& pair : rules)
+			{
+				if (result.contains (pair.first))
+					continue;
+
+				if (std::any_of (pair.second.begin (), pair.second.end (),
+						[&reqHost, reqPort, &proto] (const ReqTarget& target)
+						{
+							if (target.Port_ && reqPort > 0 && target.Port_ != reqPort)
+								return false;
+
+							if (!target.Protocols_.isEmpty () && !target.Protocols_.contains (proto))
+								return false;
+
+							return target.Host_.Matches (reqHost);
+						}))
+					result << pair.first;
+			}
+			return result;
+		}
+
+		RulesMatcher::Rules_t GetBigRules ()
+		{
+			RulesMatcher::Rules_t rules;
+			for (int i = 0; i < 50; ++i)
+			{
+				QList<ReqTarget> targets;
+				for (int j = 0; j < 10; ++j)
+				{
+					const auto& domain = QString { "site%1-%2\\.com" }.arg (i).arg (j);
+					targets << MakeTarget ("^" + domain + "$")
+							<< MakeTarget ("^(.*\\.)?cdn\\." + domain + "$")
+							<< MakeTarget (".*\\.static\\." + domain + "$", 443)
+							<< MakeTarget ("^[a-z]+[0-9]+\\.mirror" + QString::number (i * 10 + j) + "\\.org$");
+				}
+				rules.append ({ MakeProxy (1000 + i), targets });
+			}
+			return rules;
+		}
+
+		QStringList GetBigHosts ()
+		{
+			QStringList hosts;
+			for (int i = 0; i < 1000; ++i)
+				switch (i % 5)
+				{
+				case 0:
+					hosts << QString { "site%1-%2.com" }.arg (i % 50).arg (i % 10);
+					break;
+				case 1:
+					hosts << QString { "img.cdn.site%1-%2.com" }.arg (i % 50).arg (i % 10);
+					break;
+				case 2:
+					hosts << QString { "abc%1.mirror%2.org" }.arg (i).arg (i % 500);
+					break;
+				default:
+					hosts << QString { "www.unrelated%1.net" }.arg (i);
+					break;
+				}
+			return hosts;
+		}
+	}
+
+	void RulesMatcherTest::testExactHosts ()
+	{
+		const RulesMatcher matcher { { { MakeProxy (1), { MakeTarget ("^example\\.com$") } } } };
+
+		QCOMPARE (Ports (matcher.FindMatching ("example.com", 80, "http")), QList<int> { 1 });
+		QCOMPARE (Ports (matcher.FindMatching ("EXAMPLE.com", 80, "http")), QList<int> { 1 });
+		QCOMPARE (Ports (matcher.FindMatching ("www.example.com", 80, "http")), QList<int> {});
+		QCOMPARE (Ports (matcher.FindMatching ("example.org", 80, "http")), QList<int> {});
+	}
+
+	void RulesMatcherTest::testSubdomains ()
+	{
+		const RulesMatcher matcher
+		{
+			{
+				{ MakeProxy (1), { MakeTarget (".*\\.example\\.com$") } },
+				{ MakeProxy (2), { MakeTarget ("^(.*\\.)?example\\.org$") } },
+				{ MakeProxy (3), { MakeTarget ("^(?:.*\\.)?Example\\.net$", 0, {}, Qt::CaseSensitive) } }
+			}
+		};
+
+		QCOMPARE (Ports (matcher.FindMatching ("example.com", 80, "http")), QList<int> {});
+		QCOMPARE (Ports (matcher.FindMatching ("a.b.example.com", 80, "http")), QList<int> { 1 });
+		QCOMPARE (Ports (matcher.FindMatching ("notexample.com", 80, "http")), QList<int> {});
+		QCOMPARE (Ports (matcher.FindMatching ("example.org", 80, "http")), QList<int> { 2 });
+		QCOMPARE (Ports (matcher.FindMatching ("www.example.org", 80, "http")), QList<int> { 2 });
+		QCOMPARE (Ports (matcher.FindMatching ("Example.net", 80, "http")), QList<int> { 3 });
+		QCOMPARE (Ports (matcher.FindMatching ("www.Example.net", 80, "http")), QList<int> { 3 });
+		QCOMPARE (Ports (matcher.FindMatching ("www.example.net", 80, "http")), QList<int> {});
+	}
+
+	void RulesMatcherTest::testRegExps ()
+	{
+		const RulesMatcher matcher
+		{
+			{
+				{ MakeProxy (1), { MakeTarget ("^mirror[0-9]+\\.example\\.com$") } },
+				{ MakeProxy (2), { MakeTarget ("^(a+)\\1\\.example\\.com$") } },
+				{ MakeProxy (3), { MakeTarget ("^[invalid") } }
+			}
+		};
+
+		QCOMPARE (Ports (matcher.FindMatching ("mirror42.example.com", 80, "http")), QList<int> { 1 });
+		QCOMPARE (Ports (matcher.FindMatching ("mirror.example.com", 80, "http")), QList<int> {});
+		QCOMPARE (Ports (matcher.FindMatching ("aaaa.example.com", 80, "http")), QList<int> { 2 });
+		QCOMPARE (Ports (matcher.FindMatching ("aaa.example.com", 80, "http")), QList<int> {});
+	}
+
+	void RulesMatcherTest::testPortsAndProtocols ()
+	{
+		const RulesMatcher matcher
+		{
+			{
+				{ MakeProxy (1), { MakeTarget ("^example\\.com$", 443) } },
+				{ MakeProxy (2), { MakeTarget ("^example\\.com$", 0, { "ftp" }) } }
+			}
+		};
+
+		QCOMPARE (Ports (matcher.FindMatching ("example.com", 443, "https")), QList<int> { 1 });
+		QCOMPARE (Ports (matcher.FindMatching ("example.com", 80, "http")), QList<int> {});
+		QCOMPARE (Ports (matcher.FindMatching ("example.com", -1, "ftp")), (QList<int> { 1, 2 }));
+	}
+
+	void RulesMatcherTest::testOrder ()
+	{
+		const RulesMatcher matcher
+		{
+			{
+				{ MakeProxy (1), { MakeTarget ("^exam.*\\.com$") } },
+				{ MakeProxy (2), { MakeTarget (".*\\.com$") } },
+				{ MakeProxy (3), { MakeTarget ("^example\\.com$"), MakeTarget ("^(.*\\.)?example\\.com$") } }
+			}
+		};
+
+		QCOMPARE (Ports (matcher.FindMatching ("example.com", 80, "http")), (QList<int> { 1, 2, 3 }));
+		QCOMPARE (Ports (matcher.FindMatching ("www.example.com", 80, "http")), (QList<int> { 2, 3 }));
+	}
+
+	void RulesMatcherTest::testSameAsLinear ()
+	{
+		const auto& rules = GetBigRules ();
+		const RulesMatcher matcher { rules };
+
+		for (const auto& host : GetBigHosts ())
+			for (const auto port : { 80, 443 })
+				QCOMPARE (matcher.FindMatching (host, port, "http"), FindLinear (rules, host, port, "http"));
+	}
+
+	/* Both benchmarks do a thousand decisions per iteration against 2000
+	 * rules, so the reported time per iteration in msecs is the inverse
+	 * of a million decisions per second.
+	 */
+	void RulesMatcherTest::benchmarkLinear ()
+	{
+		const auto& rules = GetBigRules ();
+		const auto& hosts = GetBigHosts ();
+		QBENCHMARK {
+			for (const auto& host : hosts)
+				FindLinear (rules, host, 443, "https");
+		}
+	}
+
+	void RulesMatcherTest::benchmarkIndexed ()
+	{
+		const RulesMatcher matcher { GetBigRules () };
+		const auto& hosts = GetBigHosts ();
+		QBENCHMARK {
+			for (const auto& host : hosts)
+				matcher.FindMatching (host, 443, "https");
+		}
+	}
+}
+}
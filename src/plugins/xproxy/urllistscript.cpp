@@ -120,6 +120,8 @@ namespace XProxy
 			const auto& url = QUrl::fromEncoded (urlStr.toUtf8 ());
 			Hosts_.insert ({ url.host (), url.port (), url.scheme () });
 		}
+
+		emit urlsChanged ();
 	}
 
 	void UrlListScript::refresh ()
@@ -72,6 +72,8 @@ namespace XProxy
 		void SetUrlsImpl (const QStringList&);
 	public slots:
 		void refresh ();
+	signals:
+		void urlsChanged ();
 	};
 
 	using ScriptEntry_t = QPair<QByteArray, Proxy>;
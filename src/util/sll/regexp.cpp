@@ -114,6 +114,11 @@ namespace Util
 			return CS_;
 		}
 
+		bool IsValid () const
+		{
+			return RE_;
+		}
+
 		int Exec (const QByteArray& utf8) const
 		{
 			return RE_ ? pcre_exec (RE_, Extra_, utf8.constData (), utf8.size (), 0, 0, NULL, 0) : -1;
@@ -186,6 +191,18 @@ namespace Util
 	{
 	}
 
+	bool RegExp::IsValid () const
+	{
+		if (!Impl_)
+			return false;
+
+#ifdef USE_PCRE
+		return Impl_->PRx_.IsValid ();
+#else
+		return Impl_->Rx_.isValid ();
+#endif
+	}
+
 	bool RegExp::Matches (const QString& str) const
 	{
 		if (!Impl_)
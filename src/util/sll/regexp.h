@@ -49,6 +49,8 @@ namespace Util
 		RegExp () = default;
 		RegExp (const QString&, Qt::CaseSensitivity);
 
+		bool IsValid () const;
+
 		bool Matches (const QString&) const;
 		bool Matches (const QByteArray&) const;
 